@@ -0,0 +1,497 @@
+#include "BoundingVolumeHierarchy.h"
+#include <algorithm>
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy(float margin, float maxCostGrowth) :
+	root(NullNode),
+	freeList(NullNode),
+	proxyCount(0),
+	margin(margin),
+	maxCostGrowth(maxCostGrowth),
+	costAtRebuild(0.0f),
+	rebuildCount(0)
+{
+}
+
+int BoundingVolumeHierarchy::Insert(const AABB& bounds, unsigned int userData)
+{
+	int leaf = AllocateNode();
+	nodes[leaf].bounds = Bounds::Expand(bounds, margin);
+	nodes[leaf].userData = userData;
+	nodes[leaf].height = 0;
+	InsertLeaf(leaf);
+	proxyCount++;
+	return leaf;
+}
+
+void BoundingVolumeHierarchy::Remove(int proxy)
+{
+	RemoveLeaf(proxy);
+	FreeNode(proxy);
+	proxyCount--;
+}
+
+// --------------------------------------------------------
+// Moves a proxy to new bounds, returning true if the tree 
+// changed - still inside its fat box means nothing to do
+// --------------------------------------------------------
+bool BoundingVolumeHierarchy::Update(int proxy, const AABB& bounds)
+{
+	if (Bounds::Contains(nodes[proxy].bounds, bounds))
+		return false;
+
+	nodes[proxy].bounds = Bounds::Expand(bounds, margin);
+	RefitAncestors(nodes[proxy].parent);
+	return true;
+}
+
+void BoundingVolumeHierarchy::Clear()
+{
+	nodes.clear();
+	root = NullNode;
+	freeList = NullNode;
+	proxyCount = 0;
+	costAtRebuild = 0.0f;
+}
+
+void BoundingVolumeHierarchy::Optimize()
+{
+	RebuildIfDegraded(maxCostGrowth);
+}
+
+// --------------------------------------------------------
+// Throws away every internal node and rebuilds the tree top
+// down over the existing leaves with a binned SAH
+// --------------------------------------------------------
+void BoundingVolumeHierarchy::Rebuild()
+{
+	std::vector<int> leaves;
+	leaves.reserve(proxyCount);
+	for (int i = 0; i < (int)nodes.size(); i++)
+	{
+		if (nodes[i].height == 0)
+			leaves.push_back(i);
+		else if (nodes[i].height > 0)
+			FreeNode(i);
+	}
+
+	root = leaves.empty() ? NullNode : BuildRange(leaves.data(), leaves.size(), NullNode);
+	costAtRebuild = GetCost();
+	rebuildCount++;
+}
+
+// --------------------------------------------------------
+// Rebuilds if refitting has grown the tree's SAH cost by
+// more than the given factor since the last rebuild
+// --------------------------------------------------------
+bool BoundingVolumeHierarchy::RebuildIfDegraded(float maxCostGrowth)
+{
+	if (GetCost() <= costAtRebuild * maxCostGrowth)
+		return false;
+
+	Rebuild();
+	return true;
+}
+
+void BoundingVolumeHierarchy::QueryFrustum(const Frustum& frustum, std::vector<unsigned int>& results) const
+{
+	if (root == NullNode)
+		return;
+
+	std::vector<int> stack;
+	stack.push_back(root);
+	while (!stack.empty())
+	{
+		int index = stack.back();
+		stack.pop_back();
+
+		const Node& node = nodes[index];
+		FrustumTest test = Bounds::TestFrustum(frustum, node.bounds);
+		if (test == FrustumTest::Outside)
+			continue;
+
+		// Everything under a fully visible node is visible too
+		if (test == FrustumTest::Inside || node.IsLeaf())
+		{
+			CollectLeaves(index, results);
+			continue;
+		}
+
+		stack.push_back(node.children[0]);
+		stack.push_back(node.children[1]);
+	}
+}
+
+void BoundingVolumeHierarchy::QueryAABB(const AABB& bounds, std::vector<unsigned int>& results) const
+{
+	QueryLeaves([&bounds](const AABB& nodeBounds) { return Bounds::Overlaps(nodeBounds, bounds); }, results);
+}
+
+void BoundingVolumeHierarchy::QuerySphere(const BoundingSphere& sphere, std::vector<unsigned int>& results) const
+{
+	QueryLeaves([&sphere](const AABB& nodeBounds) { return Bounds::Overlaps(nodeBounds, sphere); }, results);
+}
+
+void BoundingVolumeHierarchy::QueryRay(const Ray& ray, float maxDistance, std::vector<unsigned int>& results) const
+{
+	QueryLeaves([&ray, maxDistance](const AABB& nodeBounds) { return Bounds::IntersectRay(ray, nodeBounds, maxDistance, 0); }, results);
+}
+
+template<typename Test>
+void BoundingVolumeHierarchy::QueryLeaves(const Test& overlaps, std::vector<unsigned int>& results) const
+{
+	if (root == NullNode)
+		return;
+
+	std::vector<int> stack;
+	stack.push_back(root);
+	while (!stack.empty())
+	{
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+		if (!overlaps(node.bounds))
+			continue;
+
+		if (node.IsLeaf())
+		{
+			results.push_back(node.userData);
+			continue;
+		}
+
+		stack.push_back(node.children[0]);
+		stack.push_back(node.children[1]);
+	}
+}
+
+bool BoundingVolumeHierarchy::Raycast(const Ray& ray, float maxDistance,
+	const std::function<float(unsigned int userData, float maxDistance)>& intersect,
+	float* hitDistance, unsigned int* hitUserData) const
+{
+	if (root == NullNode)
+		return false;
+
+	bool hit = false;
+	std::vector<int> stack;
+	stack.push_back(root);
+	while (!stack.empty())
+	{
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+
+		// Every hit shortens the ray, pruning anything further away
+		if (!Bounds::IntersectRay(ray, node.bounds, maxDistance, 0))
+			continue;
+
+		if (node.IsLeaf())
+		{
+			float distance = intersect(node.userData, maxDistance);
+			if (distance >= 0.0f && distance <= maxDistance)
+			{
+				maxDistance = distance;
+				hit = true;
+				if (hitDistance) *hitDistance = distance;
+				if (hitUserData) *hitUserData = node.userData;
+			}
+			continue;
+		}
+
+		// Visit the nearer child first so it can prune the other
+		float near0 = 0, near1 = 0;
+		bool hit0 = Bounds::IntersectRay(ray, nodes[node.children[0]].bounds, maxDistance, &near0);
+		bool hit1 = Bounds::IntersectRay(ray, nodes[node.children[1]].bounds, maxDistance, &near1);
+		int first = node.children[0];
+		int second = node.children[1];
+		if (hit0 && hit1 && near1 < near0)
+		{
+			first = node.children[1];
+			second = node.children[0];
+		}
+		if (hit0 || hit1)
+		{
+			stack.push_back(second);
+			stack.push_back(first);
+		}
+	}
+	return hit;
+}
+
+unsigned int BoundingVolumeHierarchy::GetUserData(int proxy) const { return nodes[proxy].userData; }
+const AABB& BoundingVolumeHierarchy::GetFatBounds(int proxy) const { return nodes[proxy].bounds; }
+size_t BoundingVolumeHierarchy::GetProxyCount() const { return proxyCount; }
+const char* BoundingVolumeHierarchy::GetName() const { return "Dynamic BVH"; }
+int BoundingVolumeHierarchy::GetHeight() const { return root == NullNode ? 0 : nodes[root].height; }
+unsigned int BoundingVolumeHierarchy::GetRebuildCount() const { return rebuildCount; }
+
+// --------------------------------------------------------
+// The SAH tree cost: the total surface area of internal
+// nodes, proportional to how many a random ray would visit
+// --------------------------------------------------------
+float BoundingVolumeHierarchy::GetCost() const
+{
+	float cost = 0.0f;
+	for (const Node& node : nodes)
+	{
+		if (node.height > 0)
+			cost += Bounds::SurfaceArea(node.bounds);
+	}
+	return cost;
+}
+
+int BoundingVolumeHierarchy::AllocateNode()
+{
+	int index;
+	if (freeList != NullNode)
+	{
+		index = freeList;
+		freeList = nodes[index].parent;
+	}
+	else
+	{
+		index = (int)nodes.size();
+		nodes.push_back(Node());
+	}
+
+	Node& node = nodes[index];
+	node.bounds = Bounds::Empty();
+	node.parent = NullNode;
+	node.children[0] = NullNode;
+	node.children[1] = NullNode;
+	node.userData = 0;
+	node.height = 0;
+	return index;
+}
+
+void BoundingVolumeHierarchy::FreeNode(int node)
+{
+	nodes[node].parent = freeList;
+	nodes[node].height = -1;
+	freeList = node;
+}
+
+// --------------------------------------------------------
+// Pairs a new leaf with the sibling that adds the least 
+// surface area to the tree, walking down from the root
+// --------------------------------------------------------
+void BoundingVolumeHierarchy::InsertLeaf(int leaf)
+{
+	if (root == NullNode)
+	{
+		root = leaf;
+		nodes[leaf].parent = NullNode;
+		return;
+	}
+
+	AABB leafBounds = nodes[leaf].bounds;
+	int index = root;
+	while (!nodes[index].IsLeaf())
+	{
+		const Node& node = nodes[index];
+		float area = Bounds::SurfaceArea(node.bounds);
+		float combinedArea = Bounds::SurfaceArea(Bounds::Union(node.bounds, leafBounds));
+
+		// Cost of making a new parent for this node and the leaf,
+		// and the cost every ancestor pays for growing to fit it
+		float cost = 2.0f * combinedArea;
+		float inheritedCost = 2.0f * (combinedArea - area);
+
+		float childCosts[2];
+		for (int c = 0; c < 2; c++)
+		{
+			const Node& child = nodes[node.children[c]];
+			float grownArea = Bounds::SurfaceArea(Bounds::Union(child.bounds, leafBounds));
+			childCosts[c] = child.IsLeaf() ?
+				grownArea + inheritedCost :
+				grownArea - Bounds::SurfaceArea(child.bounds) + inheritedCost;
+		}
+
+		if (cost < childCosts[0] && cost < childCosts[1])
+			break;
+
+		index = childCosts[0] < childCosts[1] ? node.children[0] : node.children[1];
+	}
+
+	int sibling = index;
+	int oldParent = nodes[sibling].parent;
+	int newParent = AllocateNode();
+	nodes[newParent].parent = oldParent;
+	nodes[newParent].bounds = Bounds::Union(nodes[sibling].bounds, leafBounds);
+	nodes[newParent].children[0] = sibling;
+	nodes[newParent].children[1] = leaf;
+	nodes[newParent].height = nodes[sibling].height + 1;
+	nodes[sibling].parent = newParent;
+	nodes[leaf].parent = newParent;
+
+	if (oldParent == NullNode)
+	{
+		root = newParent;
+	}
+	else
+	{
+		int slot = nodes[oldParent].children[0] == sibling ? 0 : 1;
+		nodes[oldParent].children[slot] = newParent;
+		RefitAncestors(oldParent);
+	}
+}
+
+// Splices a leaf out, replacing its parent with its sibling
+void BoundingVolumeHierarchy::RemoveLeaf(int leaf)
+{
+	if (leaf == root)
+	{
+		root = NullNode;
+		return;
+	}
+
+	int parent = nodes[leaf].parent;
+	int grandParent = nodes[parent].parent;
+	int sibling = nodes[parent].children[0] == leaf ? nodes[parent].children[1] : nodes[parent].children[0];
+
+	if (grandParent == NullNode)
+	{
+		root = sibling;
+		nodes[sibling].parent = NullNode;
+	}
+	else
+	{
+		int slot = nodes[grandParent].children[0] == parent ? 0 : 1;
+		nodes[grandParent].children[slot] = sibling;
+		nodes[sibling].parent = grandParent;
+		RefitAncestors(grandParent);
+	}
+	FreeNode(parent);
+}
+
+void BoundingVolumeHierarchy::RefitAncestors(int node)
+{
+	while (node != NullNode)
+	{
+		const Node& left = nodes[nodes[node].children[0]];
+		const Node& right = nodes[nodes[node].children[1]];
+		nodes[node].bounds = Bounds::Union(left.bounds, right.bounds);
+		nodes[node].height = 1 + (left.height > right.height ? left.height : right.height);
+		node = nodes[node].parent;
+	}
+}
+
+// --------------------------------------------------------
+// Builds a subtree over a range of leaves, splitting where
+// the binned surface area heuristic is cheapest
+// --------------------------------------------------------
+int BoundingVolumeHierarchy::BuildRange(int* leaves, size_t count, int parent)
+{
+	if (count == 1)
+	{
+		nodes[leaves[0]].parent = parent;
+		return leaves[0];
+	}
+
+	// Split along the axis where the leaf centers are most spread out
+	AABB centerBounds = Bounds::Empty();
+	for (size_t i = 0; i < count; i++)
+	{
+		DirectX::XMFLOAT3 center = Bounds::Center(nodes[leaves[i]].bounds);
+		centerBounds = Bounds::Union(centerBounds, AABB{ center, center });
+	}
+	float extents[3] = {
+		centerBounds.max.x - centerBounds.min.x,
+		centerBounds.max.y - centerBounds.min.y,
+		centerBounds.max.z - centerBounds.min.z };
+	int axis = 0;
+	if (extents[1] > extents[axis]) axis = 1;
+	if (extents[2] > extents[axis]) axis = 2;
+	float axisMin = (&centerBounds.min.x)[axis];
+
+	auto centerOnAxis = [this, axis](int leaf)
+	{
+		DirectX::XMFLOAT3 center = Bounds::Center(nodes[leaf].bounds);
+		return (&center.x)[axis];
+	};
+
+	size_t mid = count / 2;
+	if (extents[axis] > 0.0f)
+	{
+		const int BinCount = 12;
+		struct Bin { AABB bounds; size_t count; };
+		Bin bins[BinCount];
+		for (Bin& bin : bins) { bin.bounds = Bounds::Empty(); bin.count = 0; }
+
+		float binScale = BinCount / extents[axis];
+		auto binOf = [&](int leaf)
+		{
+			int bin = (int)((centerOnAxis(leaf) - axisMin) * binScale);
+			return bin < BinCount ? bin : BinCount - 1;
+		};
+		for (size_t i = 0; i < count; i++)
+		{
+			Bin& bin = bins[binOf(leaves[i])];
+			bin.bounds = Bounds::Union(bin.bounds, nodes[leaves[i]].bounds);
+			bin.count++;
+		}
+
+		// Sweep from the right, then from the left, pricing each split
+		float rightCosts[BinCount] = {};
+		AABB rightBounds = Bounds::Empty();
+		size_t rightCount = 0;
+		for (int b = BinCount - 1; b > 0; b--)
+		{
+			rightBounds = Bounds::Union(rightBounds, bins[b].bounds);
+			rightCount += bins[b].count;
+			rightCosts[b] = rightCount * Bounds::SurfaceArea(rightBounds);
+		}
+
+		AABB leftBounds = Bounds::Empty();
+		size_t leftCount = 0;
+		float bestCost = -1.0f;
+		int bestSplit = 0;
+		for (int b = 0; b < BinCount - 1; b++)
+		{
+			leftBounds = Bounds::Union(leftBounds, bins[b].bounds);
+			leftCount += bins[b].count;
+			float cost = leftCount * Bounds::SurfaceArea(leftBounds) + rightCosts[b + 1];
+			if (leftCount > 0 && leftCount < count && (bestCost < 0.0f || cost < bestCost))
+			{
+				bestCost = cost;
+				bestSplit = b;
+			}
+		}
+
+		if (bestCost >= 0.0f)
+			mid = std::partition(leaves, leaves + count, [&](int leaf) { return binOf(leaf) <= bestSplit; }) - leaves;
+	}
+
+	// Degenerate spreads fall back to a median split
+	if (mid == 0 || mid == count)
+	{
+		mid = count / 2;
+		std::nth_element(leaves, leaves + mid, leaves + count,
+			[&](int a, int b) { return centerOnAxis(a) < centerOnAxis(b); });
+	}
+
+	int node = AllocateNode();
+	int left = BuildRange(leaves, mid, node);
+	int right = BuildRange(leaves + mid, count - mid, node);
+	nodes[node].parent = parent;
+	nodes[node].children[0] = left;
+	nodes[node].children[1] = right;
+	nodes[node].bounds = Bounds::Union(nodes[left].bounds, nodes[right].bounds);
+	nodes[node].height = 1 + (nodes[left].height > nodes[right].height ? nodes[left].height : nodes[right].height);
+	return node;
+}
+
+void BoundingVolumeHierarchy::CollectLeaves(int node, std::vector<unsigned int>& results) const
+{
+	std::vector<int> stack;
+	stack.push_back(node);
+	while (!stack.empty())
+	{
+		const Node& current = nodes[stack.back()];
+		stack.pop_back();
+		if (current.IsLeaf())
+		{
+			results.push_back(current.userData);
+			continue;
+		}
+
+		stack.push_back(current.children[0]);
+		stack.push_back(current.children[1]);
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <vector>
+#include "SpatialPartition.h"
+
+// --------------------------------------------------------
+// A dynamic bounding volume hierarchy over world-space boxes
+//
+// - Each proxy is a leaf holding a "fat" box (its bounds plus
+//    a margin), so small movements don't touch the tree at all
+// - Movement past the margin refits the leaf's ancestors in
+//    place, which is cheap but slowly degrades the tree, so
+//    Rebuild() re-partitions everything with a binned SAH
+// - Proxy ids are leaf node indices and survive rebuilds
+// - Queries test the fat boxes, so results are conservative
+// --------------------------------------------------------
+class BoundingVolumeHierarchy : public SpatialPartition
+{
+public:
+	static constexpr int NullNode = NullProxy;
+
+	BoundingVolumeHierarchy(float margin = 0.1f, float maxCostGrowth = 1.5f);
+
+	int Insert(const AABB& bounds, unsigned int userData) override;
+	void Remove(int proxy) override;
+	bool Update(int proxy, const AABB& bounds) override;
+	void Clear() override;
+	void Optimize() override;
+
+	void Rebuild();
+	bool RebuildIfDegraded(float maxCostGrowth);
+
+	void QueryFrustum(const Frustum& frustum, std::vector<unsigned int>& results) const override;
+	void QueryAABB(const AABB& bounds, std::vector<unsigned int>& results) const override;
+	void QuerySphere(const BoundingSphere& sphere, std::vector<unsigned int>& results) const override;
+	void QueryRay(const Ray& ray, float maxDistance, std::vector<unsigned int>& results) const override;
+	bool Raycast(const Ray& ray, float maxDistance,
+		const std::function<float(unsigned int userData, float maxDistance)>& intersect,
+		float* hitDistance, unsigned int* hitUserData) const override;
+
+	size_t GetProxyCount() const override;
+	const char* GetName() const override;
+
+	unsigned int GetUserData(int proxy) const;
+	const AABB& GetFatBounds(int proxy) const;
+	int GetHeight() const;
+	float GetCost() const;
+	unsigned int GetRebuildCount() const;
+
+private:
+	struct Node
+	{
+		AABB bounds;
+		int parent;		// Next free node while on the free list
+		int children[2];
+		unsigned int userData;
+		int height;		// 0 for leaves, -1 while free
+
+		bool IsLeaf() const { return children[0] == NullNode; }
+	};
+
+	std::vector<Node> nodes;
+	int root;
+	int freeList;
+	size_t proxyCount;
+	float margin;
+	float maxCostGrowth;
+	float costAtRebuild;
+	unsigned int rebuildCount;
+
+	int AllocateNode();
+	void FreeNode(int node);
+	void InsertLeaf(int leaf);
+	void RemoveLeaf(int leaf);
+	void RefitAncestors(int node);
+	int BuildRange(int* leaves, size_t count, int parent);
+	void CollectLeaves(int node, std::vector<unsigned int>& results) const;
+
+	// Shared traversal for the overlap queries
+	template<typename Test> void QueryLeaves(const Test& overlaps, std::vector<unsigned int>& results) const;
+};
@@ -0,0 +1,228 @@
+#include "BoundingVolumeHierarchy.h"
+#include "TestHarness.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	AABB MakeBox(float x, float y, float z, float halfSize)
+	{
+		return { XMFLOAT3(x - halfSize, y - halfSize, z - halfSize), XMFLOAT3(x + halfSize, y + halfSize, z + halfSize) };
+	}
+
+	AABB RandomBox(std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> size(0.1f, 3.0f);
+		return MakeBox(position(random), position(random), position(random), size(random));
+	}
+
+	std::vector<unsigned int> Sorted(std::vector<unsigned int> values)
+	{
+		std::sort(values.begin(), values.end());
+		return values;
+	}
+
+	// A tree with proxies inserted, moved and removed at random,
+	// plus the fat bounds each live proxy should have
+	struct RandomTree
+	{
+		BoundingVolumeHierarchy bvh;
+		std::vector<int> proxies;		// By userData, NullProxy once removed
+		std::vector<AABB> bounds;
+
+		RandomTree(size_t count, unsigned int seed)
+		{
+			std::mt19937 random(seed);
+			for (size_t i = 0; i < count; i++)
+			{
+				bounds.push_back(RandomBox(random));
+				proxies.push_back(bvh.Insert(bounds[i], (unsigned int)i));
+			}
+			for (size_t i = 0; i < count; i += 3)
+			{
+				bounds[i] = RandomBox(random);
+				bvh.Update(proxies[i], bounds[i]);
+			}
+			for (size_t i = 1; i < count; i += 7)
+			{
+				bvh.Remove(proxies[i]);
+				proxies[i] = SpatialPartition::NullProxy;
+			}
+		}
+
+		// What a linear scan over the fat boxes finds
+		template<typename Test>
+		std::vector<unsigned int> BruteForce(const Test& overlaps) const
+		{
+			std::vector<unsigned int> results;
+			for (size_t i = 0; i < proxies.size(); i++)
+			{
+				if (proxies[i] != SpatialPartition::NullProxy && overlaps(bvh.GetFatBounds(proxies[i])))
+					results.push_back((unsigned int)i);
+			}
+			return results;
+		}
+	};
+}
+
+TEST_CASE(ProxiesKeepTheirUserDataAndFatBounds)
+{
+	BoundingVolumeHierarchy bvh(0.5f);
+	AABB box = MakeBox(1.0f, 2.0f, 3.0f, 1.0f);
+	int proxy = bvh.Insert(box, 42);
+	CHECK(bvh.GetUserData(proxy) == 42);
+	CHECK(bvh.GetProxyCount() == 1);
+	CHECK(Bounds::Contains(bvh.GetFatBounds(proxy), box));
+	CHECK(bvh.GetFatBounds(proxy).min.x == box.min.x - 0.5f);
+
+	// Moving within the margin leaves the tree alone
+	CHECK(!bvh.Update(proxy, MakeBox(1.2f, 2.0f, 3.0f, 1.0f)));
+	CHECK(bvh.Update(proxy, MakeBox(5.0f, 2.0f, 3.0f, 1.0f)));
+	CHECK(bvh.GetFatBounds(proxy).min.x == 4.0f - 0.5f);
+}
+
+TEST_CASE(QueriesMatchABruteForceScan)
+{
+	RandomTree tree(2000, 7);
+	std::mt19937 random(99);
+	for (int query = 0; query < 50; query++)
+	{
+		AABB box = RandomBox(random);
+		box = Bounds::Expand(box, 10.0f);
+		std::vector<unsigned int> found;
+		tree.bvh.QueryAABB(box, found);
+		CHECK(Sorted(found) == tree.BruteForce([&](const AABB& fat) { return Bounds::Overlaps(fat, box); }));
+
+		BoundingSphere sphere = { Bounds::Center(box), 15.0f };
+		found.clear();
+		tree.bvh.QuerySphere(sphere, found);
+		CHECK(Sorted(found) == tree.BruteForce([&](const AABB& fat) { return Bounds::Overlaps(fat, sphere); }));
+	}
+}
+
+TEST_CASE(FrustumCullMatchesABruteForceScan)
+{
+	RandomTree tree(2000, 11);
+	for (float yaw = 0.0f; yaw < XM_2PI; yaw += 0.5f)
+	{
+		XMMATRIX view = XMMatrixLookToLH(XMVectorSet(0, 0, 0, 0), XMVectorSet(sinf(yaw), 0, cosf(yaw), 0), XMVectorSet(0, 1, 0, 0));
+		XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, 1.5f, 0.1f, 80.0f);
+		XMFLOAT4X4 viewProjection;
+		XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(view, projection));
+		Frustum frustum = Bounds::FrustumFromMatrix(viewProjection);
+
+		std::vector<unsigned int> found;
+		tree.bvh.QueryFrustum(frustum, found);
+		std::vector<unsigned int> expected = tree.BruteForce([&](const AABB& fat) { return Bounds::TestFrustum(frustum, fat) != FrustumTest::Outside; });
+		CHECK(!expected.empty());
+		CHECK(Sorted(found) == expected);
+	}
+}
+
+TEST_CASE(RaycastFindsTheClosestHit)
+{
+	RandomTree tree(2000, 23);
+	std::mt19937 random(5);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	int hits = 0;
+	for (int cast = 0; cast < 200; cast++)
+	{
+		XMFLOAT3 direction(unit(random), unit(random), unit(random));
+		XMStoreFloat3(&direction, XMVector3Normalize(XMLoadFloat3(&direction)));
+		Ray ray = { XMFLOAT3(unit(random) * 50.0f, unit(random) * 50.0f, unit(random) * 50.0f), direction };
+
+		// Hits the proxies' real bounds, not their fat ones
+		auto intersect = [&](unsigned int userData, float maxDistance)
+			{
+				float distance = -1.0f;
+				return Bounds::IntersectRay(ray, tree.bounds[userData], maxDistance, &distance) ? distance : -1.0f;
+			};
+
+		float bestDistance = 1000.0f;
+		bool expectHit = false;
+		for (size_t i = 0; i < tree.proxies.size(); i++)
+		{
+			float distance = 0;
+			if (tree.proxies[i] != SpatialPartition::NullProxy && Bounds::IntersectRay(ray, tree.bounds[i], bestDistance, &distance))
+			{
+				bestDistance = distance;
+				expectHit = true;
+			}
+		}
+
+		float hitDistance = -1.0f;
+		unsigned int hitUserData = 0;
+		bool hit = tree.bvh.Raycast(ray, 1000.0f, intersect, &hitDistance, &hitUserData);
+		REQUIRE(hit == expectHit);
+		if (hit)
+		{
+			hits++;
+			CHECK(hitDistance == bestDistance);
+			CHECK(tree.proxies[hitUserData] != SpatialPartition::NullProxy);
+		}
+	}
+	CHECK(hits > 0);
+}
+
+TEST_CASE(RebuildKeepsProxiesAndImprovesTheTree)
+{
+	// Inserting in a sweep builds a poor tree incrementally
+	BoundingVolumeHierarchy bvh;
+	std::vector<int> proxies;
+	for (int i = 0; i < 1024; i++)
+		proxies.push_back(bvh.Insert(MakeBox((float)(i % 32) * 3.0f, 0.0f, (float)(i / 32) * 3.0f, 1.0f), (unsigned int)i));
+
+	float costBefore = bvh.GetCost();
+	bvh.Rebuild();
+	CHECK(bvh.GetRebuildCount() == 1);
+	CHECK(bvh.GetCost() <= costBefore);
+	CHECK(bvh.GetHeight() <= 2 * 10 + 2);
+	CHECK(bvh.GetProxyCount() == 1024);
+	for (int i = 0; i < 1024; i++)
+		CHECK(bvh.GetUserData(proxies[i]) == (unsigned int)i);
+
+	std::vector<unsigned int> all;
+	bvh.QueryAABB(MakeBox(0.0f, 0.0f, 0.0f, 1000.0f), all);
+	CHECK(all.size() == 1024);
+}
+
+TEST_CASE(RebuildsOnlyOnceTheCostHasGrown)
+{
+	BoundingVolumeHierarchy bvh(0.1f, 1.5f);
+	std::vector<int> proxies;
+	for (int i = 0; i < 256; i++)
+		proxies.push_back(bvh.Insert(MakeBox((float)i, 0.0f, 0.0f, 0.4f), (unsigned int)i));
+	bvh.Rebuild();
+	CHECK(!bvh.RebuildIfDegraded(1.5f));
+
+	// Scattering the proxies with refits alone leaves huge internal nodes
+	std::mt19937 random(3);
+	for (int proxy : proxies)
+		bvh.Update(proxy, RandomBox(random));
+	CHECK(bvh.RebuildIfDegraded(1.5f));
+	CHECK(bvh.GetRebuildCount() == 2);
+}
+
+TEST_CASE(RemovedSlotsAreReusedAndClearEmpties)
+{
+	BoundingVolumeHierarchy bvh;
+	int a = bvh.Insert(MakeBox(0, 0, 0, 1), 1);
+	bvh.Insert(MakeBox(5, 0, 0, 1), 2);
+	bvh.Remove(a);
+	CHECK(bvh.GetProxyCount() == 1);
+
+	std::vector<unsigned int> found;
+	bvh.QueryAABB(MakeBox(0, 0, 0, 100), found);
+	CHECK(found == std::vector<unsigned int>{ 2 });
+
+	bvh.Clear();
+	CHECK(bvh.GetProxyCount() == 0);
+	CHECK(bvh.GetHeight() == 0);
+	found.clear();
+	bvh.QueryAABB(MakeBox(0, 0, 0, 100), found);
+	CHECK(found.empty());
+}
@@ -0,0 +1,228 @@
+#include "Bounds.h"
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+AABB Bounds::Empty()
+{
+	AABB box = {};
+	box.min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+	box.max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	return box;
+}
+
+AABB Bounds::Union(const AABB& a, const AABB& b)
+{
+	AABB box = {};
+	box.min = XMFLOAT3(fminf(a.min.x, b.min.x), fminf(a.min.y, b.min.y), fminf(a.min.z, b.min.z));
+	box.max = XMFLOAT3(fmaxf(a.max.x, b.max.x), fmaxf(a.max.y, b.max.y), fmaxf(a.max.z, b.max.z));
+	return box;
+}
+
+AABB Bounds::Expand(const AABB& box, float margin)
+{
+	AABB expanded = box;
+	expanded.min.x -= margin; expanded.min.y -= margin; expanded.min.z -= margin;
+	expanded.max.x += margin; expanded.max.y += margin; expanded.max.z += margin;
+	return expanded;
+}
+
+AABB Bounds::FromSphere(const BoundingSphere& sphere)
+{
+	AABB box = {};
+	box.min = XMFLOAT3(sphere.center.x - sphere.radius, sphere.center.y - sphere.radius, sphere.center.z - sphere.radius);
+	box.max = XMFLOAT3(sphere.center.x + sphere.radius, sphere.center.y + sphere.radius, sphere.center.z + sphere.radius);
+	return box;
+}
+
+// --------------------------------------------------------
+// Bounds of a local-space box after a (row-vector) world
+// transform, by transforming its center and extents
+// --------------------------------------------------------
+AABB Bounds::Transform(const AABB& localBox, const XMFLOAT4X4& world)
+{
+	float center[3] = {
+		(localBox.min.x + localBox.max.x) * 0.5f,
+		(localBox.min.y + localBox.max.y) * 0.5f,
+		(localBox.min.z + localBox.max.z) * 0.5f };
+	float extents[3] = {
+		(localBox.max.x - localBox.min.x) * 0.5f,
+		(localBox.max.y - localBox.min.y) * 0.5f,
+		(localBox.max.z - localBox.min.z) * 0.5f };
+
+	float newCenter[3] = {};
+	float newExtents[3] = {};
+	for (int col = 0; col < 3; col++)
+	{
+		newCenter[col] = world.m[3][col];
+		for (int row = 0; row < 3; row++)
+		{
+			newCenter[col] += center[row] * world.m[row][col];
+			newExtents[col] += extents[row] * fabsf(world.m[row][col]);
+		}
+	}
+
+	AABB box = {};
+	box.min = XMFLOAT3(newCenter[0] - newExtents[0], newCenter[1] - newExtents[1], newCenter[2] - newExtents[2]);
+	box.max = XMFLOAT3(newCenter[0] + newExtents[0], newCenter[1] + newExtents[1], newCenter[2] + newExtents[2]);
+	return box;
+}
+
+XMFLOAT3 Bounds::Center(const AABB& box)
+{
+	return XMFLOAT3(
+		(box.min.x + box.max.x) * 0.5f,
+		(box.min.y + box.max.y) * 0.5f,
+		(box.min.z + box.max.z) * 0.5f);
+}
+
+float Bounds::SurfaceArea(const AABB& box)
+{
+	float x = box.max.x - box.min.x;
+	float y = box.max.y - box.min.y;
+	float z = box.max.z - box.min.z;
+	if (x < 0 || y < 0 || z < 0) return 0.0f;
+	return 2.0f * (x * y + y * z + z * x);
+}
+
+bool Bounds::Contains(const AABB& outer, const AABB& inner)
+{
+	return
+		outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+		outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+}
+
+bool Bounds::Overlaps(const AABB& a, const AABB& b)
+{
+	return
+		a.min.x <= b.max.x && a.max.x >= b.min.x &&
+		a.min.y <= b.max.y && a.max.y >= b.min.y &&
+		a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+bool Bounds::Overlaps(const AABB& box, const BoundingSphere& sphere)
+{
+	// Distance from the sphere's center to the closest point in the box
+	float dx = fmaxf(box.min.x - sphere.center.x, fmaxf(0.0f, sphere.center.x - box.max.x));
+	float dy = fmaxf(box.min.y - sphere.center.y, fmaxf(0.0f, sphere.center.y - box.max.y));
+	float dz = fmaxf(box.min.z - sphere.center.z, fmaxf(0.0f, sphere.center.z - box.max.z));
+	return dx * dx + dy * dy + dz * dz <= sphere.radius * sphere.radius;
+}
+
+// --------------------------------------------------------
+// Extracts the clip planes from a row-vector view-projection
+// matrix (D3D conventions, so clip-space z runs from 0 to w)
+// --------------------------------------------------------
+Frustum Bounds::FrustumFromMatrix(const XMFLOAT4X4& m)
+{
+	Frustum frustum = {};
+	frustum.planes[0] = XMFLOAT4(m._14 + m._11, m._24 + m._21, m._34 + m._31, m._44 + m._41); // Left
+	frustum.planes[1] = XMFLOAT4(m._14 - m._11, m._24 - m._21, m._34 - m._31, m._44 - m._41); // Right
+	frustum.planes[2] = XMFLOAT4(m._14 + m._12, m._24 + m._22, m._34 + m._32, m._44 + m._42); // Bottom
+	frustum.planes[3] = XMFLOAT4(m._14 - m._12, m._24 - m._22, m._34 - m._32, m._44 - m._42); // Top
+	frustum.planes[4] = XMFLOAT4(m._13, m._23, m._33, m._43);                                 // Near
+	frustum.planes[5] = XMFLOAT4(m._14 - m._13, m._24 - m._23, m._34 - m._33, m._44 - m._43); // Far
+
+	// Normalize so plane distances are in world units
+	for (XMFLOAT4& plane : frustum.planes)
+	{
+		float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+		if (length > 0.0f)
+		{
+			plane.x /= length; plane.y /= length; plane.z /= length; plane.w /= length;
+		}
+	}
+	return frustum;
+}
+
+FrustumTest Bounds::TestFrustum(const Frustum& frustum, const AABB& box)
+{
+	FrustumTest result = FrustumTest::Inside;
+	for (const XMFLOAT4& plane : frustum.planes)
+	{
+		// The box corners furthest along and against the plane normal
+		float px = plane.x >= 0 ? box.max.x : box.min.x;
+		float py = plane.y >= 0 ? box.max.y : box.min.y;
+		float pz = plane.z >= 0 ? box.max.z : box.min.z;
+		if (plane.x * px + plane.y * py + plane.z * pz + plane.w < 0)
+			return FrustumTest::Outside;
+
+		float nx = plane.x >= 0 ? box.min.x : box.max.x;
+		float ny = plane.y >= 0 ? box.min.y : box.max.y;
+		float nz = plane.z >= 0 ? box.min.z : box.max.z;
+		if (plane.x * nx + plane.y * ny + plane.z * nz + plane.w < 0)
+			result = FrustumTest::Intersects;
+	}
+	return result;
+}
+
+// Slab test
+bool Bounds::IntersectRay(const Ray& ray, const AABB& box, float maxDistance, float* distance)
+{
+	const float origin[3] = { ray.origin.x, ray.origin.y, ray.origin.z };
+	const float direction[3] = { ray.direction.x, ray.direction.y, ray.direction.z };
+	const float boxMin[3] = { box.min.x, box.min.y, box.min.z };
+	const float boxMax[3] = { box.max.x, box.max.y, box.max.z };
+
+	float tMin = 0.0f;
+	float tMax = maxDistance;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (fabsf(direction[axis]) < 1e-12f)
+		{
+			// Parallel to this slab - must already be between its planes
+			if (origin[axis] < boxMin[axis] || origin[axis] > boxMax[axis])
+				return false;
+			continue;
+		}
+
+		float inverse = 1.0f / direction[axis];
+		float t0 = (boxMin[axis] - origin[axis]) * inverse;
+		float t1 = (boxMax[axis] - origin[axis]) * inverse;
+		if (t0 > t1) { float swap = t0; t0 = t1; t1 = swap; }
+		tMin = fmaxf(tMin, t0);
+		tMax = fminf(tMax, t1);
+		if (tMin > tMax)
+			return false;
+	}
+
+	if (distance) *distance = tMin;
+	return true;
+}
+
+bool Bounds::IntersectTriangle(const Ray& ray, const XMFLOAT3& v0, const XMFLOAT3& v1, const XMFLOAT3& v2,
+	float maxDistance, float* distance, float* u, float* v)
+{
+	const float Epsilon = 1e-8f;
+	XMFLOAT3 edge1(v1.x - v0.x, v1.y - v0.y, v1.z - v0.z);
+	XMFLOAT3 edge2(v2.x - v0.x, v2.y - v0.y, v2.z - v0.z);
+	const XMFLOAT3& d = ray.direction;
+
+	// p = d x edge2
+	XMFLOAT3 p(d.y * edge2.z - d.z * edge2.y, d.z * edge2.x - d.x * edge2.z, d.x * edge2.y - d.y * edge2.x);
+	float determinant = edge1.x * p.x + edge1.y * p.y + edge1.z * p.z;
+	if (fabsf(determinant) < Epsilon)
+		return false; // Parallel to the triangle
+
+	float inverse = 1.0f / determinant;
+	XMFLOAT3 s(ray.origin.x - v0.x, ray.origin.y - v0.y, ray.origin.z - v0.z);
+	float baryU = (s.x * p.x + s.y * p.y + s.z * p.z) * inverse;
+	if (baryU < 0.0f || baryU > 1.0f)
+		return false;
+
+	// q = s x edge1
+	XMFLOAT3 q(s.y * edge1.z - s.z * edge1.y, s.z * edge1.x - s.x * edge1.z, s.x * edge1.y - s.y * edge1.x);
+	float baryV = (d.x * q.x + d.y * q.y + d.z * q.z) * inverse;
+	if (baryV < 0.0f || baryU + baryV > 1.0f)
+		return false;
+
+	float t = (edge2.x * q.x + edge2.y * q.y + edge2.z * q.z) * inverse;
+	if (t < 0.0f || t > maxDistance)
+		return false;
+
+	if (distance) *distance = t;
+	if (u) *u = baryU;
+	if (v) *v = baryV;
+	return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <DirectXMath.h>
+
+// Axis-aligned bounding box
+struct AABB
+{
+	DirectX::XMFLOAT3 min;
+	DirectX::XMFLOAT3 max;
+};
+
+struct BoundingSphere
+{
+	DirectX::XMFLOAT3 center;
+	float radius;
+};
+
+// A ray - the direction needn't be normalized, but distances
+// along the ray are measured in multiples of its length (so
+// a ray brought into an entity's space keeps world distances)
+struct Ray
+{
+	DirectX::XMFLOAT3 origin;
+	DirectX::XMFLOAT3 direction;
+};
+
+// Six inward-facing planes (a, b, c, d) - a point p is inside
+// when a*p.x + b*p.y + c*p.z + d >= 0 for every plane
+struct Frustum
+{
+	DirectX::XMFLOAT4 planes[6];
+};
+
+// Result of testing a box against a frustum
+enum class FrustumTest
+{
+	Outside,
+	Intersects,
+	Inside
+};
+
+// Plain-math bounding volume helpers shared by the scene partitions
+namespace Bounds
+{
+	AABB Empty();
+	AABB Union(const AABB& a, const AABB& b);
+	AABB Expand(const AABB& box, float margin);
+	AABB FromSphere(const BoundingSphere& sphere);
+	AABB Transform(const AABB& localBox, const DirectX::XMFLOAT4X4& world);
+	DirectX::XMFLOAT3 Center(const AABB& box);
+	float SurfaceArea(const AABB& box);
+	bool Contains(const AABB& outer, const AABB& inner);
+	bool Overlaps(const AABB& a, const AABB& b);
+	bool Overlaps(const AABB& box, const BoundingSphere& sphere);
+
+	Frustum FrustumFromMatrix(const DirectX::XMFLOAT4X4& viewProjection);
+	FrustumTest TestFrustum(const Frustum& frustum, const AABB& box);
+
+	// Returns true if the ray enters the box within [0, maxDistance], 
+	// reporting the entry distance (0 if the ray starts inside)
+	bool IntersectRay(const Ray& ray, const AABB& box, float maxDistance, float* distance);
+
+	// Moller-Trumbore - hits from either side, reporting the distance
+	// along the ray and the barycentrics of v1 and v2
+	bool IntersectTriangle(const Ray& ray, const DirectX::XMFLOAT3& v0, const DirectX::XMFLOAT3& v1, const DirectX::XMFLOAT3& v2,
+		float maxDistance, float* distance, float* u, float* v);
+}
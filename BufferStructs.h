@@ -2,18 +2,75 @@
 
 #include <DirectXMath.h>
 
-struct VertexShaderData
+// Changes once per frame - bound to b0 in every stage
+struct PerFrameData
 {
-	DirectX::XMFLOAT4X4 matrix;
 	DirectX::XMFLOAT4X4 view;
 	DirectX::XMFLOAT4X4 projection;
+	DirectX::XMFLOAT4X4 viewProjection;
+	float time;
+	DirectX::XMFLOAT3 padding;
 };
 
-struct PixelShaderData
+// Per-material data has no struct - Material builds it from
+// the pixel shader's PerMaterial cbuffer or materials
+// StructuredBuffer (see ConstantBufferLayout)
+
+// Most instances one draw takes, so big batches still split
+// across the draw recording threads
+const unsigned int MaxInstancesPerDraw = 256;
+
+// Changes per instance - every instance drawn in a frame goes into
+// one StructuredBuffer, bound to t0 in the vertex shader
+struct PerInstanceData
 {
-	DirectX::XMFLOAT4 colorTint;
-	DirectX::XMFLOAT2 uv;
-	DirectX::XMFLOAT2 padding;
-	DirectX::XMFLOAT3 normal;
-	float time;
+	DirectX::XMFLOAT4X4 world;
+	DirectX::XMFLOAT4X4 worldViewProjection;	// Precomputed on the CPU
+	unsigned int materialId;					// Record in the material table, if any
+	unsigned int padding[3];					// Keeps the stride a whole number of registers
+};
+
+// Changes per draw - where its instances start in that buffer, in
+// a slice of the constant buffer ring bound to b1 in the vertex shader
+struct PerDrawData
+{
+	unsigned int firstInstance;
+	unsigned int padding[3];
+};
+
+enum class LightType : unsigned int { Point, Spot };
+
+// One point or spot light - matches Light in LitPS.hlsl, and is
+// a whole number of registers so it packs the same everywhere
+struct Light
+{
+	DirectX::XMFLOAT3 position;
+	float range;
+	DirectX::XMFLOAT3 color;
+	float intensity;
+	DirectX::XMFLOAT3 direction;		// Spot lights only, normalized
+	LightType type;
+	float spotInnerCos;					// Full brightness inside this cone...
+	float spotOuterCos;					// ...fading to nothing at this one
+	float padding[2];
+};
+
+// Where one cluster's lights sit in the light index list
+struct LightCluster
+{
+	unsigned int offset;
+	unsigned int count;
+};
+
+// How pixels find their cluster - bound to b2 in LitPS.hlsl
+struct LightClusterData
+{
+	unsigned int tilesX;
+	unsigned int tilesY;
+	unsigned int slices;
+	unsigned int lightCount;
+	float screenWidth;
+	float screenHeight;
+	float sliceScale;		// slice = log(view depth) * sliceScale - sliceBias
+	float sliceBias;
 };
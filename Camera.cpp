@@ -17,7 +17,8 @@ Camera::Camera(float aR, XMFLOAT3 pos, XMFLOAT3 rot, float fov, float nearP, flo
 	lookSensitivity(0.005f),
 	isPerspective(true),
 	projectionMatrix(XMFLOAT4X4()),
-	viewMatrix(XMFLOAT4X4())
+	viewMatrix(XMFLOAT4X4()),
+	viewProjectionMatrix(XMFLOAT4X4())
 {
 	this->transform.SetPosition(pos);
 	this->transform.SetRotation(rot);
@@ -38,6 +39,11 @@ DirectX::XMFLOAT4X4 Camera::GetProjectionMatrix()
 	return projectionMatrix;
 }
 
+DirectX::XMFLOAT4X4 Camera::GetViewProjectionMatrix()
+{
+	return viewProjectionMatrix;
+}
+
 float Camera::GetFOV()
 {
 	return fov;
@@ -48,10 +54,30 @@ Transform Camera::GetTransform()
 	return transform;
 }
 
+// --------------------------------------------------------
+// World-space ray from the camera through a pixel, found by
+// unprojecting it onto the near and far planes
+// --------------------------------------------------------
+Ray Camera::GetPickRay(float screenX, float screenY, float screenWidth, float screenHeight)
+{
+	float ndcX = 2.0f * screenX / screenWidth - 1.0f;
+	float ndcY = 1.0f - 2.0f * screenY / screenHeight;
+
+	XMMATRIX inverseViewProjection = XMMatrixInverse(0, XMLoadFloat4x4(&viewProjectionMatrix));
+	XMVECTOR nearPoint = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 0.0f, 1.0f), inverseViewProjection);
+	XMVECTOR farPoint = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 1.0f, 1.0f), inverseViewProjection);
+
+	Ray ray = {};
+	XMStoreFloat3(&ray.origin, nearPoint);
+	XMStoreFloat3(&ray.direction, XMVector3Normalize(farPoint - nearPoint));
+	return ray;
+}
+
 void Camera::UpdateProjectionMatrix(float aspectRatio)
 {
 	XMMATRIX projection = XMMatrixPerspectiveFovLH(XMConvertToRadians(fov), aspectRatio, nearPlane, farPlane);
 	XMStoreFloat4x4(&projectionMatrix, projection);
+	UpdateViewProjectionMatrix();
 }
 
 void Camera::UpdateViewMatrix()
@@ -61,6 +87,13 @@ void Camera::UpdateViewMatrix()
 	XMFLOAT3 worldUp = XMFLOAT3(0.0f, 1.0f, 0.0f);
 	XMMATRIX view = XMMatrixLookToLH(XMLoadFloat3(&pos), XMLoadFloat3(&direction), XMLoadFloat3(&worldUp));
 	XMStoreFloat4x4(&viewMatrix, view);
+	UpdateViewProjectionMatrix();
+}
+
+void Camera::UpdateViewProjectionMatrix()
+{
+	XMMATRIX viewProjection = XMLoadFloat4x4(&viewMatrix) * XMLoadFloat4x4(&projectionMatrix);
+	XMStoreFloat4x4(&viewProjectionMatrix, viewProjection);
 }
 
 void Camera::Update(float dt)
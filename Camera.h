@@ -2,6 +2,7 @@
 #include <DirectXMath.h>
 #include "Transform.h"
 #include "Input.h"
+#include "Bounds.h"
 
 class Camera
 {
@@ -15,11 +16,14 @@ public:
 
 	DirectX::XMFLOAT4X4 GetViewMatrix();
 	DirectX::XMFLOAT4X4 GetProjectionMatrix();
+	DirectX::XMFLOAT4X4 GetViewProjectionMatrix();
 	float GetFOV();
 	Transform GetTransform();
+	Ray GetPickRay(float screenX, float screenY, float screenWidth, float screenHeight);
 
 	void UpdateProjectionMatrix(float aspectRatio);
 	void UpdateViewMatrix();
+	void UpdateViewProjectionMatrix();
 
 	void Update(float dt);
 
@@ -28,6 +32,7 @@ private:
 	Transform transform;
 	DirectX::XMFLOAT4X4 viewMatrix;
 	DirectX::XMFLOAT4X4 projectionMatrix;
+	DirectX::XMFLOAT4X4 viewProjectionMatrix;	// Cached view * projection, refreshed whenever either changes
 
 	float fov;
 	float nearPlane;
@@ -0,0 +1,149 @@
+#include "ChromeTrace.h"
+#include <cstdio>
+
+namespace
+{
+	// Every event belongs to the one process
+	const int ProcessId = 1;
+}
+
+ChromeTraceWriter::ChromeTraceWriter() :
+	firstEvent(true),
+	hasOrigin(false),
+	origin(0),
+	eventCount(0),
+	line()
+{
+}
+
+ChromeTraceWriter::~ChromeTraceWriter()
+{
+	// An unfinished trace is still worth closing into valid JSON
+	if (file.is_open())
+		Close(std::vector<std::string>());
+}
+
+bool ChromeTraceWriter::Open(const char* path)
+{
+	if (file.is_open())
+		file.close();
+
+	file.open(path, std::ios::out | std::ios::trunc | std::ios::binary);
+	if (!file)
+		return false;
+
+	firstEvent = true;
+	hasOrigin = false;
+	origin = 0;
+	eventCount = 0;
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	return file.good();
+}
+
+// --------------------------------------------------------
+// Writes the frame itself on the first thread, followed by
+// every scope finished during it
+// --------------------------------------------------------
+void ChromeTraceWriter::WriteFrame(const ProfileFrame& frame)
+{
+	if (!file.is_open())
+		return;
+
+	if (!hasOrigin)
+	{
+		// Scopes collected by the first frame may predate it
+		origin = frame.start;
+		for (const ProfileEvent& event : frame.events)
+		{
+			if (event.start < origin)
+				origin = event.start;
+		}
+		hasOrigin = true;
+	}
+
+	char frameName[32];
+	snprintf(frameName, sizeof(frameName), "Frame %llu", frame.frameNumber);
+	WriteEvent(frameName, 0, frame.start, frame.end);
+
+	for (const ProfileEvent& event : frame.events)
+	{
+		WriteEvent(event.name, event.threadIndex, event.start, event.end);
+	}
+}
+
+bool ChromeTraceWriter::Close(const std::vector<std::string>& threadNames)
+{
+	if (!file.is_open())
+		return false;
+
+	// Metadata events give the viewer readable thread names
+	for (size_t i = 0; i < threadNames.size(); i++)
+	{
+		WriteSeparator();
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << ProcessId << ",\"tid\":" << i << ",\"args\":{\"name\":\"";
+		WriteEscaped(threadNames[i].c_str());
+		file << "\"}}";
+	}
+
+	file << "\n]}\n";
+	bool succeeded = file.good();
+	file.close();
+	return succeeded;
+}
+
+bool ChromeTraceWriter::IsOpen() const { return file.is_open(); }
+size_t ChromeTraceWriter::GetEventCount() const { return eventCount; }
+
+void ChromeTraceWriter::WriteEvent(const char* name, unsigned int threadIndex, long long start, long long end)
+{
+	WriteSeparator();
+	file << "{\"name\":\"";
+	WriteEscaped(name);
+	file << "\",\"ph\":\"X\",\"pid\":" << ProcessId << ",\"tid\":" << threadIndex;
+	WriteTimestamp(",\"ts\":", start - origin);
+	WriteTimestamp(",\"dur\":", end > start ? end - start : 0);
+	file << '}';
+	eventCount++;
+}
+
+void ChromeTraceWriter::WriteSeparator()
+{
+	file << (firstEvent ? "\n" : ",\n");
+	firstEvent = false;
+}
+
+// Copies text into the file as the inside of a JSON string
+void ChromeTraceWriter::WriteEscaped(const char* text)
+{
+	if (!text)
+		return;
+
+	for (const char* c = text; *c; c++)
+	{
+		unsigned char character = (unsigned char)*c;
+		if (character == '"' || character == '\\')
+		{
+			file.put('\\');
+			file.put((char)character);
+		}
+		else if (character < 0x20)
+		{
+			int length = snprintf(line, sizeof(line), "\\u%04x", character);
+			file.write(line, length);
+		}
+		else
+		{
+			file.put((char)character);
+		}
+	}
+}
+
+// Nanoseconds written as fractional microseconds, exactly
+void ChromeTraceWriter::WriteTimestamp(const char* key, long long nanoseconds)
+{
+	const char* sign = nanoseconds < 0 ? "-" : "";
+	unsigned long long magnitude = nanoseconds < 0 ? 0ull - (unsigned long long)nanoseconds : (unsigned long long)nanoseconds;
+	int length = snprintf(line, sizeof(line), "%s%s%llu.%03llu", key, sign, magnitude / 1000, magnitude % 1000);
+	if (length > 0)
+		file.write(line, length);
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <fstream>
+#include <string>
+#include <vector>
+#include "Profiler.h"
+
+// --------------------------------------------------------
+// Streams profiler frames to a Chrome Trace Event JSON file,
+// which chrome://tracing and ui.perfetto.dev can open
+//
+// - Each scope becomes a complete ("X") event on its profiler
+//    thread, so nesting is rebuilt from the timestamps
+// - Events are formatted into a fixed buffer and written as
+//    they arrive; nothing is allocated per event
+// - Timestamps are microseconds since the first written frame
+// --------------------------------------------------------
+class ChromeTraceWriter
+{
+public:
+	ChromeTraceWriter();
+	~ChromeTraceWriter();
+
+	bool Open(const char* path);
+	void WriteFrame(const ProfileFrame& frame);
+
+	// Names the profiler's threads and finishes the JSON
+	bool Close(const std::vector<std::string>& threadNames);
+
+	bool IsOpen() const;
+	size_t GetEventCount() const;
+
+private:
+	std::ofstream file;
+	bool firstEvent;
+	bool hasOrigin;
+	long long origin;
+	size_t eventCount;
+	char line[512];
+
+	void WriteEvent(const char* name, unsigned int threadIndex, long long start, long long end);
+	void WriteSeparator();
+	void WriteEscaped(const char* text);
+	void WriteTimestamp(const char* key, long long nanoseconds);
+};
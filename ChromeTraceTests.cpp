@@ -0,0 +1,374 @@
+#include "ChromeTrace.h"
+#include "TestHarness.h"
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+
+namespace
+{
+	const char* TracePath = "ChromeTraceTests.json";
+
+	// --------------------------------------------------------
+	// Just enough of a strict JSON parser to check the writer's
+	// output: anything malformed, including trailing commas and
+	// raw control characters in strings, fails the whole parse
+	// --------------------------------------------------------
+	struct JsonValue
+	{
+		enum Type { Null, Bool, Number, String, Array, Object } type = Null;
+		double number = 0;
+		std::string text;
+		std::vector<JsonValue> items;
+		std::map<std::string, JsonValue> members;
+
+		const JsonValue* Find(const char* key) const
+		{
+			std::map<std::string, JsonValue>::const_iterator member = members.find(key);
+			return member == members.end() ? 0 : &member->second;
+		}
+	};
+
+	class JsonParser
+	{
+	public:
+		JsonParser(const std::string& json) : json(json), position(0) {}
+
+		bool Parse(JsonValue& value)
+		{
+			return ParseValue(value) && (SkipSpace(), position == json.size());
+		}
+
+	private:
+		const std::string& json;
+		size_t position;
+
+		void SkipSpace()
+		{
+			while (position < json.size() && strchr(" \t\r\n", json[position]))
+				position++;
+		}
+
+		bool Expect(char c)
+		{
+			SkipSpace();
+			if (position >= json.size() || json[position] != c)
+				return false;
+			position++;
+			return true;
+		}
+
+		bool ParseValue(JsonValue& value)
+		{
+			SkipSpace();
+			if (position >= json.size())
+				return false;
+
+			char c = json[position];
+			if (c == '{') return ParseObject(value);
+			if (c == '[') return ParseArray(value);
+			if (c == '"') { value.type = JsonValue::String; return ParseString(value.text); }
+			if (json.compare(position, 4, "true") == 0) { value.type = JsonValue::Bool; value.number = 1; position += 4; return true; }
+			if (json.compare(position, 5, "false") == 0) { value.type = JsonValue::Bool; position += 5; return true; }
+			if (json.compare(position, 4, "null") == 0) { position += 4; return true; }
+			return ParseNumber(value);
+		}
+
+		bool ParseObject(JsonValue& value)
+		{
+			value.type = JsonValue::Object;
+			position++;
+			if (Expect('}'))
+				return true;
+			do
+			{
+				std::string key;
+				SkipSpace();
+				if (!ParseString(key) || !Expect(':') || !ParseValue(value.members[key]))
+					return false;
+			} while (Expect(','));
+			return Expect('}');
+		}
+
+		bool ParseArray(JsonValue& value)
+		{
+			value.type = JsonValue::Array;
+			position++;
+			if (Expect(']'))
+				return true;
+			do
+			{
+				value.items.push_back(JsonValue());
+				if (!ParseValue(value.items.back()))
+					return false;
+			} while (Expect(','));
+			return Expect(']');
+		}
+
+		bool ParseString(std::string& text)
+		{
+			if (position >= json.size() || json[position] != '"')
+				return false;
+			for (position++; position < json.size(); position++)
+			{
+				unsigned char c = (unsigned char)json[position];
+				if (c == '"')
+				{
+					position++;
+					return true;
+				}
+				if (c < 0x20)
+					return false;
+				if (c != '\\')
+				{
+					text += (char)c;
+					continue;
+				}
+
+				if (++position >= json.size())
+					return false;
+				char escape = json[position];
+				const char* simple = strchr("\"\\/bfnrt", escape);
+				if (escape == 'u')
+				{
+					if (position + 4 >= json.size())
+						return false;
+					unsigned long code = strtoul(json.substr(position + 1, 4).c_str(), 0, 16);
+					if (code >= 0x80)
+						return false; // The writer only escapes control characters
+					text += (char)code;
+					position += 4;
+				}
+				else if (simple && escape)
+				{
+					text += "\"\\/\b\f\n\r\t"[simple - "\"\\/bfnrt"];
+				}
+				else
+				{
+					return false;
+				}
+			}
+			return false;
+		}
+
+		bool ParseNumber(JsonValue& value)
+		{
+			// JSON numbers: no leading +, no bare '.', no leading zeros
+			size_t start = position;
+			if (json[position] == '-') position++;
+			if (position >= json.size() || !isdigit((unsigned char)json[position]))
+				return false;
+			if (json[position] == '0' && position + 1 < json.size() && isdigit((unsigned char)json[position + 1]))
+				return false;
+			while (position < json.size() && strchr("0123456789.eE+-", json[position]))
+				position++;
+			value.type = JsonValue::Number;
+			value.number = strtod(json.substr(start, position - start).c_str(), 0);
+			return true;
+		}
+	};
+
+	bool ReadTrace(JsonValue& root)
+	{
+		FILE* file = fopen(TracePath, "rb");
+		if (!file)
+			return false;
+		std::string json;
+		char buffer[4096];
+		for (size_t read; (read = fread(buffer, 1, sizeof(buffer), file)) > 0; )
+			json.append(buffer, read);
+		fclose(file);
+		return JsonParser(json).Parse(root);
+	}
+
+	ProfileEvent MakeEvent(const char* name, long long start, long long end, unsigned int threadIndex, unsigned int depth)
+	{
+		ProfileEvent event = {};
+		event.name = name;
+		event.start = start;
+		event.end = end;
+		event.threadIndex = threadIndex;
+		event.depth = depth;
+		return event;
+	}
+}
+
+TEST_CASE(TraceIsValidJsonWithCompleteEvents)
+{
+	ProfileFrame frame = {};
+	frame.frameNumber = 7;
+	frame.start = 1000000;
+	frame.end = 17666666;
+	frame.events.push_back(MakeEvent("Update", 1001500, 5000000, 0, 0));
+	frame.events.push_back(MakeEvent("Physics", 1002000, 3000001, 0, 1));
+	frame.events.push_back(MakeEvent("Job", 1500000, 2500000, 1, 0));
+
+	ChromeTraceWriter writer;
+	REQUIRE(writer.Open(TracePath));
+	writer.WriteFrame(frame);
+	CHECK(writer.GetEventCount() == 4);
+	REQUIRE(writer.Close({ "Main", "Worker 1" }));
+	CHECK(!writer.IsOpen());
+
+	JsonValue root;
+	REQUIRE(ReadTrace(root));
+	REQUIRE(root.type == JsonValue::Object);
+	const JsonValue* events = root.Find("traceEvents");
+	REQUIRE(events && events->type == JsonValue::Array);
+	REQUIRE(events->items.size() == 4 + 2);
+	CHECK(root.Find("displayTimeUnit") && root.Find("displayTimeUnit")->text == "ms");
+
+	// The frame comes first, then its scopes, all relative to the frame start
+	const char* names[] = { "Frame 7", "Update", "Physics", "Job" };
+	const double starts[] = { 0.0, 1.5, 2.0, 500.0 };
+	const double durations[] = { 16666.666, 3998.5, 1998.001, 1000.0 };
+	const double threads[] = { 0, 0, 0, 1 };
+	for (size_t i = 0; i < 4; i++)
+	{
+		const JsonValue& event = events->items[i];
+		REQUIRE(event.type == JsonValue::Object);
+		CHECK(event.Find("name") && event.Find("name")->text == names[i]);
+		CHECK(event.Find("ph") && event.Find("ph")->text == "X");
+		CHECK(event.Find("pid") && event.Find("pid")->type == JsonValue::Number);
+		REQUIRE(event.Find("tid") && event.Find("ts") && event.Find("dur"));
+		CHECK(event.Find("tid")->number == threads[i]);
+		CHECK_NEAR(event.Find("ts")->number, starts[i], 1e-6);
+		CHECK_NEAR(event.Find("dur")->number, durations[i], 1e-6);
+	}
+
+	// Then one metadata event naming each thread
+	for (size_t i = 0; i < 2; i++)
+	{
+		const JsonValue& metadata = events->items[4 + i];
+		CHECK(metadata.Find("ph") && metadata.Find("ph")->text == "M");
+		CHECK(metadata.Find("name") && metadata.Find("name")->text == "thread_name");
+		REQUIRE(metadata.Find("tid") && metadata.Find("args"));
+		CHECK(metadata.Find("tid")->number == (double)i);
+		const JsonValue* name = metadata.Find("args")->Find("name");
+		CHECK(name && name->text == (i == 0 ? "Main" : "Worker 1"));
+	}
+	remove(TracePath);
+}
+
+TEST_CASE(NamesAreEscaped)
+{
+	ProfileFrame frame = {};
+	frame.frameNumber = 1;
+	frame.end = 100;
+	frame.events.push_back(MakeEvent("Quote \" slash \\ tab \t newline \n", 0, 50, 0, 0));
+
+	ChromeTraceWriter writer;
+	REQUIRE(writer.Open(TracePath));
+	writer.WriteFrame(frame);
+	REQUIRE(writer.Close({ "Thread \"A\"\\" }));
+
+	JsonValue root;
+	REQUIRE(ReadTrace(root));
+	const JsonValue& events = *root.Find("traceEvents");
+	REQUIRE(events.items.size() == 3);
+	CHECK(events.items[1].Find("name")->text == "Quote \" slash \\ tab \t newline \n");
+	CHECK(events.items[2].Find("args")->Find("name")->text == "Thread \"A\"\\");
+	remove(TracePath);
+}
+
+TEST_CASE(OriginIsTheEarliestScopeOfTheFirstFrame)
+{
+	// Startup scopes collected by the first frame began before it
+	ProfileFrame first = {};
+	first.frameNumber = 1;
+	first.start = 5000;
+	first.end = 9000;
+	first.events.push_back(MakeEvent("Startup", 2000, 4000, 0, 0));
+	ProfileFrame second = {};
+	second.frameNumber = 2;
+	second.start = 9000;
+	second.end = 12000;
+
+	ChromeTraceWriter writer;
+	REQUIRE(writer.Open(TracePath));
+	writer.WriteFrame(first);
+	writer.WriteFrame(second);
+	REQUIRE(writer.Close({}));
+
+	JsonValue root;
+	REQUIRE(ReadTrace(root));
+	const JsonValue& events = *root.Find("traceEvents");
+	REQUIRE(events.items.size() == 3);
+	CHECK_NEAR(events.items[0].Find("ts")->number, 3.0, 1e-9);
+	CHECK_NEAR(events.items[1].Find("ts")->number, 0.0, 1e-9);
+	CHECK_NEAR(events.items[2].Find("ts")->number, 7.0, 1e-9);
+	remove(TracePath);
+}
+
+TEST_CASE(ProfilerFramesRoundTrip)
+{
+	CpuProfiler profiler;
+	profiler.SetThreadName("Main");
+	ChromeTraceWriter writer;
+	REQUIRE(writer.Open(TracePath));
+	size_t scopes = 0;
+	for (int frame = 0; frame < 3; frame++)
+	{
+		profiler.BeginFrame();
+		{
+			ProfileScope update(profiler, "Update");
+			ProfileScope draw(profiler, "Draw");
+		}
+		profiler.EndFrame();
+		scopes += profiler.GetLastFrame().events.size();
+		writer.WriteFrame(profiler.GetLastFrame());
+	}
+	REQUIRE(writer.Close(profiler.GetThreadNames()));
+
+	JsonValue root;
+	REQUIRE(ReadTrace(root));
+	const JsonValue& events = *root.Find("traceEvents");
+	CHECK(events.items.size() == 3 + scopes + 1);
+	for (const JsonValue& event : events.items)
+	{
+		if (event.Find("ph")->text == "X")
+			CHECK(event.Find("ts")->number >= 0.0 && event.Find("dur")->number >= 0.0);
+	}
+	remove(TracePath);
+}
+
+TEST_CASE(UnclosedTraceIsFinishedOnDestruction)
+{
+	{
+		ChromeTraceWriter writer;
+		REQUIRE(writer.Open(TracePath));
+		ProfileFrame frame = {};
+		frame.frameNumber = 1;
+		writer.WriteFrame(frame);
+	}
+	JsonValue root;
+	CHECK(ReadTrace(root));
+	remove(TracePath);
+}
+
+TEST_CASE(EmptyTraceIsStillValid)
+{
+	ChromeTraceWriter writer;
+	REQUIRE(writer.Open(TracePath));
+	REQUIRE(writer.Close({}));
+	CHECK(!writer.Close({}));
+
+	JsonValue root;
+	REQUIRE(ReadTrace(root));
+	CHECK(root.Find("traceEvents")->items.empty());
+	remove(TracePath);
+}
+
+TEST_CASE(ParserRejectsMalformedJson)
+{
+	// Keeps the checks above honest
+	const char* bad[] = { "{\"a\":[1,2,]}", "{\"a\":1", "[\"tab\there\"]", "{\"a\":01}", "{\"a\":.5}", "[1] [2]" };
+	for (const char* json : bad)
+	{
+		JsonValue value;
+		CHECK(!JsonParser(json).Parse(value));
+	}
+	JsonValue good;
+	CHECK(JsonParser("{\"a\":[1,-2.5e3,\"x\\u0009\",true,null]}").Parse(good));
+}
@@ -0,0 +1,89 @@
+#include "ClusteredLighting.h"
+#include "Graphics.h"
+#include "Profiler.h"
+#include <cstring>
+
+ClusteredLighting::ClusteredLighting(unsigned int tilesX, unsigned int tilesY, unsigned int slices) :
+	grid(tilesX, tilesY, slices)
+{
+	D3D11_BUFFER_DESC desc = {};
+	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	desc.ByteWidth = (sizeof(LightClusterData) + 15) / 16 * 16;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	Graphics::Device->CreateBuffer(&desc, 0, constantBuffer.GetAddressOf());
+}
+
+const LightClusterGrid& ClusteredLighting::GetGrid() const { return grid; }
+
+unsigned int ClusteredLighting::Update(ID3D11DeviceContext* context, const std::vector<Light>& lights,
+	const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection, float screenWidth, float screenHeight)
+{
+	{
+		PROFILE_SCOPE("Cluster Lights");
+		grid.SetProjection(projection);
+		grid.Assign(lights.data(), lights.size(), view);
+	}
+
+	PROFILE_SCOPE("Upload Lights");
+	unsigned int bytes = 0;
+	bytes += Write(context, lightBuffer, lights.data(), (unsigned int)lights.size(), sizeof(Light));
+	bytes += Write(context, clusterBuffer, grid.GetClusters().data(), (unsigned int)grid.GetClusters().size(), sizeof(LightCluster));
+	bytes += Write(context, indexBuffer, grid.GetLightIndices().data(), (unsigned int)grid.GetLightIndices().size(), sizeof(unsigned int));
+
+	LightClusterData data = grid.GetShaderData(screenWidth, screenHeight, (unsigned int)lights.size());
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	context->Map(constantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+	memcpy(mapped.pData, &data, sizeof(data));
+	context->Unmap(constantBuffer.Get(), 0);
+	return bytes + sizeof(data);
+}
+
+void ClusteredLighting::Bind(ID3D11DeviceContext* context) const
+{
+	ID3D11ShaderResourceView* views[] =
+	{
+		lightBuffer.shaderResourceView.Get(),
+		clusterBuffer.shaderResourceView.Get(),
+		indexBuffer.shaderResourceView.Get(),
+	};
+	context->PSSetShaderResources(FirstSlot, 3, views);
+	context->PSSetConstantBuffers(2, 1, constantBuffer.GetAddressOf());
+}
+
+unsigned int ClusteredLighting::Write(ID3D11DeviceContext* context, DynamicBuffer& target, const void* data, unsigned int count, unsigned int stride)
+{
+	if (count > target.capacity)
+	{
+		// Rounded up generously, since lights can be added every frame
+		target.capacity = target.capacity * 2 > count ? target.capacity * 2 : count;
+		if (target.capacity < 64)
+			target.capacity = 64;
+
+		D3D11_BUFFER_DESC desc = {};
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		desc.ByteWidth = target.capacity * stride;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		desc.StructureByteStride = stride;
+		desc.Usage = D3D11_USAGE_DYNAMIC;
+		target.buffer.Reset();
+		target.shaderResourceView.Reset();
+		Graphics::Device->CreateBuffer(&desc, 0, target.buffer.GetAddressOf());
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc = {};
+		viewDesc.Format = DXGI_FORMAT_UNKNOWN;
+		viewDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		viewDesc.Buffer.FirstElement = 0;
+		viewDesc.Buffer.NumElements = target.capacity;
+		Graphics::Device->CreateShaderResourceView(target.buffer.Get(), &viewDesc, target.shaderResourceView.GetAddressOf());
+	}
+	if (count == 0)
+		return 0;
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	context->Map(target.buffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+	memcpy(mapped.pData, data, (size_t)count * stride);
+	context->Unmap(target.buffer.Get(), 0);
+	return count * stride;
+}
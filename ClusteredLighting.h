@@ -0,0 +1,47 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <vector>
+#include "LightClusterGrid.h"
+
+// --------------------------------------------------------
+// Culls the scene's lights into a LightClusterGrid each frame
+// and uploads everything LitPS.hlsl needs to light with them
+//
+// - Lights, per-cluster ranges and the light index list each
+//    go in a dynamic StructuredBuffer, rewritten every frame
+//    and grown by doubling when they run out of room
+// - Bind() sets them on t1-t3 and the grid constants on b2,
+//    and only sets state, so any context can call it
+// --------------------------------------------------------
+class ClusteredLighting
+{
+public:
+	ClusteredLighting(unsigned int tilesX = 16, unsigned int tilesY = 9, unsigned int slices = 24);
+
+	// Returns bytes uploaded
+	unsigned int Update(ID3D11DeviceContext* context, const std::vector<Light>& lights,
+		const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection, float screenWidth, float screenHeight);
+	void Bind(ID3D11DeviceContext* context) const;
+
+	const LightClusterGrid& GetGrid() const;
+
+	static const unsigned int FirstSlot = 1;
+
+private:
+	struct DynamicBuffer
+	{
+		Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shaderResourceView;
+		unsigned int capacity = 0;		// In elements
+	};
+
+	// Returns bytes uploaded
+	static unsigned int Write(ID3D11DeviceContext* context, DynamicBuffer& target, const void* data, unsigned int count, unsigned int stride);
+
+	LightClusterGrid grid;
+	DynamicBuffer lightBuffer;
+	DynamicBuffer clusterBuffer;
+	DynamicBuffer indexBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> constantBuffer;
+};
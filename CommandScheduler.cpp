@@ -0,0 +1,69 @@
+#include "CommandScheduler.h"
+
+CommandScheduler::CommandScheduler(JobSystem* jobSystem, size_t minDrawsPerPartition) :
+	jobSystem(jobSystem),
+	minDrawsPerPartition(minDrawsPerPartition),
+	lastPartitionCount(0)
+{
+}
+
+// --------------------------------------------------------
+// Divides drawCount draws into at most maxPartitions nearly
+// equal, contiguous ranges, never making a range smaller than
+// minDrawsPerPartition (unless there is only one range)
+// --------------------------------------------------------
+std::vector<DrawRange> CommandScheduler::Partition(size_t drawCount, size_t maxPartitions, size_t minDrawsPerPartition)
+{
+	std::vector<DrawRange> ranges;
+	if (drawCount == 0 || maxPartitions == 0)
+		return ranges;
+
+	if (minDrawsPerPartition == 0) minDrawsPerPartition = 1;
+	size_t partitions = drawCount / minDrawsPerPartition;
+	if (partitions > maxPartitions) partitions = maxPartitions;
+	if (partitions == 0) partitions = 1;
+
+	// Spread the remainder over the first few ranges
+	size_t baseCount = drawCount / partitions;
+	size_t remainder = drawCount % partitions;
+	size_t first = 0;
+	for (size_t i = 0; i < partitions; i++)
+	{
+		DrawRange range = {};
+		range.first = first;
+		range.count = baseCount + (i < remainder ? 1 : 0);
+		ranges.push_back(range);
+		first += range.count;
+	}
+	return ranges;
+}
+
+void CommandScheduler::Submit(size_t drawCount, const std::vector<CommandContext*>& contexts)
+{
+	std::vector<DrawRange> ranges = Partition(drawCount, contexts.size(), minDrawsPerPartition);
+	lastPartitionCount = ranges.size();
+	if (ranges.empty())
+		return;
+
+	// One job per range; this thread helps record while it waits
+	auto recordRanges = [&contexts, &ranges](size_t first, size_t last)
+	{
+		for (size_t i = first; i < last; i++)
+		{
+			contexts[i]->Record(ranges[i]);
+		}
+	};
+
+	if (jobSystem)
+		jobSystem->ParallelFor(ranges.size(), 1, recordRanges);
+	else
+		recordRanges(0, ranges.size());
+
+	// Replay strictly in draw-list order
+	for (size_t i = 0; i < ranges.size(); i++)
+	{
+		contexts[i]->Execute();
+	}
+}
+
+size_t CommandScheduler::GetLastPartitionCount() { return lastPartitionCount; }
@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include "JobSystem.h"
+
+// A contiguous run of the frame's draw list
+struct DrawRange
+{
+	size_t first;
+	size_t count;
+};
+
+// --------------------------------------------------------
+// Something that can record a range of draws on one thread
+// and later replay them, in order, on the submitting thread
+//
+// - The real implementation wraps a D3D11 deferred context,
+//    but nothing here depends on the graphics API
+// --------------------------------------------------------
+class CommandContext
+{
+public:
+	virtual ~CommandContext() {}
+
+	virtual void Record(DrawRange range) = 0;	// Called on a worker thread
+	virtual void Execute() = 0;					// Called on the submitting thread
+};
+
+// --------------------------------------------------------
+// Splits a draw list across command contexts, records them
+// in parallel, then executes the results in draw-list order
+// --------------------------------------------------------
+class CommandScheduler
+{
+public:
+	CommandScheduler(JobSystem* jobSystem = 0, size_t minDrawsPerPartition = 16);
+
+	static std::vector<DrawRange> Partition(size_t drawCount, size_t maxPartitions, size_t minDrawsPerPartition);
+	void Submit(size_t drawCount, const std::vector<CommandContext*>& contexts);
+
+	size_t GetLastPartitionCount();
+
+private:
+	JobSystem* jobSystem;
+	size_t minDrawsPerPartition;
+	size_t lastPartitionCount;
+};
@@ -0,0 +1,239 @@
+#include "CommandScheduler.h"
+#include "TestHarness.h"
+#include <algorithm>
+#include <chrono>
+#include <set>
+
+namespace
+{
+	// Every call any context saw, in the order they happened
+	struct CallLog
+	{
+		struct Call
+		{
+			bool execute;
+			size_t context;
+			std::thread::id thread;
+			DrawRange range;
+		};
+
+		std::mutex mutex;
+		std::vector<Call> calls;
+
+		void Add(bool execute, size_t context, DrawRange range)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			calls.push_back({ execute, context, std::this_thread::get_id(), range });
+		}
+	};
+
+	// Stands in for a deferred context: recording takes a while, so
+	// the workers overlap, and executing replays what was recorded
+	class MockContext : public CommandContext
+	{
+	public:
+		MockContext(CallLog& log, size_t index) : log(log), index(index), recorded({ 0, 0 }) {}
+
+		void Record(DrawRange range) override
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+			recorded = range;
+			log.Add(false, index, range);
+		}
+
+		void Execute() override
+		{
+			log.Add(true, index, recorded);
+		}
+
+	private:
+		CallLog& log;
+		size_t index;
+		DrawRange recorded;
+	};
+
+	struct MockContexts
+	{
+		CallLog log;
+		std::vector<std::unique_ptr<MockContext>> owned;
+		std::vector<CommandContext*> contexts;
+
+		MockContexts(size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				owned.push_back(std::make_unique<MockContext>(log, i));
+				contexts.push_back(owned.back().get());
+			}
+		}
+	};
+
+	// Ranges start at zero and each picks up where the last ended
+	bool CoversContiguously(const std::vector<DrawRange>& ranges, size_t drawCount)
+	{
+		size_t next = 0;
+		for (const DrawRange& range : ranges)
+		{
+			if (range.first != next || range.count == 0)
+				return false;
+			next += range.count;
+		}
+		return next == drawCount;
+	}
+
+	unsigned int TestWorkers()
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		return hardwareThreads > 4 ? hardwareThreads - 1 : 3;
+	}
+}
+
+TEST_CASE(PartitionsCoverEveryDrawOnce)
+{
+	const size_t drawCounts[] = { 1, 2, 15, 16, 17, 100, 1000, 12345 };
+	for (size_t drawCount : drawCounts)
+	{
+		for (size_t maxPartitions = 1; maxPartitions <= 12; maxPartitions++)
+		{
+			std::vector<DrawRange> ranges = CommandScheduler::Partition(drawCount, maxPartitions, 16);
+			CHECK(CoversContiguously(ranges, drawCount));
+			CHECK(!ranges.empty() && ranges.size() <= maxPartitions);
+		}
+	}
+}
+
+TEST_CASE(NothingToDrawMakesNoPartitions)
+{
+	CHECK(CommandScheduler::Partition(0, 8, 16).empty());
+	CHECK(CommandScheduler::Partition(100, 0, 16).empty());
+}
+
+TEST_CASE(SmallListsStayInOnePartition)
+{
+	// Fewer draws than the minimum still get recorded, all together
+	for (size_t drawCount = 1; drawCount < 16; drawCount++)
+	{
+		std::vector<DrawRange> ranges = CommandScheduler::Partition(drawCount, 8, 16);
+		REQUIRE(ranges.size() == 1);
+		CHECK(ranges[0].first == 0 && ranges[0].count == drawCount);
+	}
+
+	// A minimum of zero is treated as one
+	std::vector<DrawRange> single = CommandScheduler::Partition(3, 8, 0);
+	CHECK(single.size() == 3);
+	CHECK(CoversContiguously(single, 3));
+}
+
+TEST_CASE(PartitionsRespectTheMinimumAndMaximum)
+{
+	for (size_t drawCount = 16; drawCount < 600; drawCount += 7)
+	{
+		std::vector<DrawRange> ranges = CommandScheduler::Partition(drawCount, 6, 16);
+		CHECK(ranges.size() <= 6);
+		CHECK(ranges.size() == std::min<size_t>(drawCount / 16, 6));
+
+		// Nearly equal: no range more than one draw longer than another
+		size_t shortest = drawCount, longest = 0;
+		for (const DrawRange& range : ranges)
+		{
+			CHECK(range.count >= 16);
+			shortest = std::min(shortest, range.count);
+			longest = std::max(longest, range.count);
+		}
+		CHECK(longest - shortest <= 1);
+	}
+
+	// Large lists use every partition they're allowed
+	std::vector<DrawRange> ranges = CommandScheduler::Partition(100000, 7, 16);
+	CHECK(ranges.size() == 7);
+	CHECK(CoversContiguously(ranges, 100000));
+}
+
+TEST_CASE(RecordingRunsOnSeveralThreads)
+{
+	JobSystem jobs(TestWorkers());
+	MockContexts mocks(8);
+	CommandScheduler scheduler(&jobs, 16);
+	scheduler.Submit(1000, mocks.contexts);
+	CHECK(scheduler.GetLastPartitionCount() == 8);
+
+	std::set<std::thread::id> recordingThreads;
+	for (const CallLog::Call& call : mocks.log.calls)
+	{
+		if (!call.execute)
+			recordingThreads.insert(call.thread);
+	}
+	CHECK(recordingThreads.size() > 1);
+}
+
+TEST_CASE(ExecutesFollowRecordingOnTheCallingThread)
+{
+	JobSystem jobs(TestWorkers());
+	for (JobSystem* jobSystem : { (JobSystem*)0, &jobs })
+	{
+		MockContexts mocks(6);
+		CommandScheduler scheduler(jobSystem, 16);
+		scheduler.Submit(500, mocks.contexts);
+
+		const std::vector<CallLog::Call>& calls = mocks.log.calls;
+		REQUIRE(calls.size() == 12);
+
+		// Every context recorded once, before anything executed
+		std::vector<DrawRange> expected = CommandScheduler::Partition(500, 6, 16);
+		std::set<size_t> recorded;
+		for (size_t i = 0; i < 6; i++)
+		{
+			CHECK(!calls[i].execute);
+			recorded.insert(calls[i].context);
+			CHECK(calls[i].range.first == expected[calls[i].context].first);
+			CHECK(calls[i].range.count == expected[calls[i].context].count);
+		}
+		CHECK(recorded.size() == 6);
+
+		// Then replayed here, in draw-list order
+		for (size_t i = 0; i < 6; i++)
+		{
+			const CallLog::Call& call = calls[6 + i];
+			CHECK(call.execute);
+			CHECK(call.context == i);
+			CHECK(call.thread == std::this_thread::get_id());
+			CHECK(call.range.first == expected[i].first);
+		}
+	}
+}
+
+TEST_CASE(SmallListsUseOneContext)
+{
+	JobSystem jobs(TestWorkers());
+	for (JobSystem* jobSystem : { (JobSystem*)0, &jobs })
+	{
+		MockContexts mocks(4);
+		CommandScheduler scheduler(jobSystem, 16);
+		scheduler.Submit(10, mocks.contexts);
+		CHECK(scheduler.GetLastPartitionCount() == 1);
+
+		const std::vector<CallLog::Call>& calls = mocks.log.calls;
+		REQUIRE(calls.size() == 2);
+		CHECK(!calls[0].execute && calls[0].context == 0);
+		CHECK(calls[0].range.first == 0 && calls[0].range.count == 10);
+		CHECK(calls[1].execute && calls[1].context == 0);
+		CHECK(calls[1].thread == std::this_thread::get_id());
+
+		// Without a job system it all happens right here
+		if (!jobSystem)
+			CHECK(calls[0].thread == std::this_thread::get_id());
+	}
+}
+
+TEST_CASE(EmptyListsTouchNoContexts)
+{
+	JobSystem jobs(TestWorkers());
+	MockContexts mocks(4);
+	CommandScheduler scheduler(&jobs, 16);
+	scheduler.Submit(0, mocks.contexts);
+	CHECK(scheduler.GetLastPartitionCount() == 0);
+	CHECK(mocks.log.calls.empty());
+
+	scheduler.Submit(100, {});
+	CHECK(scheduler.GetLastPartitionCount() == 0);
+}
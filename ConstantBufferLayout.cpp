@@ -0,0 +1,367 @@
+#include "ConstantBufferLayout.h"
+#include <cstring>
+
+namespace
+{
+	const unsigned int RegisterSize = 16;
+	const unsigned int ComponentSize = 4;
+
+	unsigned int AlignToRegister(unsigned int offset)
+	{
+		return (offset + RegisterSize - 1) / RegisterSize * RegisterSize;
+	}
+
+	bool IsMatrix(const ShaderParameterDesc& desc)
+	{
+		return desc.parameterClass == ShaderParameterClass::MatrixRows || desc.parameterClass == ShaderParameterClass::MatrixColumns;
+	}
+
+	// A row_major matrix takes a register per row, a column_major
+	// one a register per column
+	unsigned int GetRegisterCount(const ShaderParameterDesc& desc)
+	{
+		if (desc.parameterClass == ShaderParameterClass::MatrixRows) return desc.rows;
+		if (desc.parameterClass == ShaderParameterClass::MatrixColumns) return desc.columns;
+		return 1;
+	}
+
+	unsigned int GetComponentsPerRegister(const ShaderParameterDesc& desc)
+	{
+		if (desc.parameterClass == ShaderParameterClass::MatrixColumns) return desc.rows;
+		return desc.columns;
+	}
+
+	bool SameShape(const ShaderParameterDesc& a, const ShaderParameterDesc& b)
+	{
+		return a.type == b.type && a.parameterClass == b.parameterClass && a.rows == b.rows && a.columns == b.columns;
+	}
+}
+
+ConstantBufferLayout::ConstantBufferLayout(const std::string& name, LayoutPacking packing) :
+	name(name),
+	packing(packing),
+	end(0)
+{
+}
+
+unsigned int ConstantBufferLayout::Add(const ShaderParameterDesc& desc)
+{
+	ShaderParameter parameter = {};
+	parameter.desc = desc;
+	unsigned int registerCount = GetRegisterCount(desc);
+	unsigned int registerBytes = GetComponentsPerRegister(desc) * ComponentSize;
+	unsigned int elementCount = desc.elements > 0 ? desc.elements : 1;
+
+	if (packing == LayoutPacking::Structured)
+	{
+		// Everything is a whole number of components, so each
+		// value simply follows the last
+		parameter.registerStride = registerBytes;
+		parameter.elementSize = registerCount * registerBytes;
+		parameter.elementStride = parameter.elementSize;
+		parameter.size = parameter.elementStride * elementCount;
+		parameter.offset = end;
+	}
+	else
+	{
+		parameter.registerStride = RegisterSize;
+		parameter.elementSize = (registerCount - 1) * RegisterSize + registerBytes;
+		parameter.elementStride = registerCount * RegisterSize;
+		parameter.size = parameter.elementStride * (elementCount - 1) + parameter.elementSize;
+
+		// Arrays and matrices start a fresh register, anything else only
+		// moves on if it would cross into the next one
+		unsigned int offset = end;
+		if (desc.elements > 0 || IsMatrix(desc) || offset % RegisterSize + parameter.size > RegisterSize)
+			offset = AlignToRegister(offset);
+		parameter.offset = offset;
+	}
+
+	end = parameter.offset + parameter.size;
+	parameters.push_back(parameter);
+	return parameter.offset;
+}
+
+const std::string& ConstantBufferLayout::GetName() const { return name; }
+LayoutPacking ConstantBufferLayout::GetPacking() const { return packing; }
+const std::vector<ShaderParameter>& ConstantBufferLayout::GetParameters() const { return parameters; }
+unsigned int ConstantBufferLayout::GetSize() const { return packing == LayoutPacking::Structured ? end : AlignToRegister(end); }
+
+const ShaderParameter* ConstantBufferLayout::Find(const std::string& name) const
+{
+	for (const ShaderParameter& parameter : parameters)
+	{
+		if (parameter.desc.name == name)
+			return &parameter;
+	}
+	return 0;
+}
+
+unsigned int ConstantBufferLayout::Repack(const ConstantBufferLayout& toLayout, unsigned char* to,
+	const ConstantBufferLayout& fromLayout, const unsigned char* from, bool* changed)
+{
+	unsigned int copied = 0;
+	for (const ShaderParameter& parameter : toLayout.parameters)
+	{
+		const ShaderParameter* source = fromLayout.Find(parameter.desc.name);
+		if (!source || !SameShape(parameter.desc, source->desc))
+			continue;
+
+		// Arrays of different lengths share their leading elements
+		unsigned int elements = parameter.desc.elements < source->desc.elements ? parameter.desc.elements : source->desc.elements;
+		if (elements == 0)
+			elements = 1;
+
+		// A register (matrix row or column) at a time, since the
+		// two packings space them differently
+		unsigned int registerCount = GetRegisterCount(parameter.desc);
+		unsigned int registerBytes = GetComponentsPerRegister(parameter.desc) * ComponentSize;
+		for (unsigned int e = 0; e < elements; e++)
+		{
+			for (unsigned int r = 0; r < registerCount; r++)
+			{
+				const unsigned char* fromRegister = from + source->offset + e * source->elementStride + r * source->registerStride;
+				unsigned char* toRegister = to + parameter.offset + e * parameter.elementStride + r * parameter.registerStride;
+				if (memcmp(toRegister, fromRegister, registerBytes) != 0)
+				{
+					memcpy(toRegister, fromRegister, registerBytes);
+					*changed = true;
+				}
+			}
+		}
+		copied++;
+	}
+	return copied;
+}
+
+ParameterBlock::ParameterBlock(std::shared_ptr<const ConstantBufferLayout> layout) :
+	layout(layout),
+	data(layout ? layout->GetSize() : 0, 0),
+	dirty(true),
+	version(0)
+{
+}
+
+bool ParameterBlock::SetFloat(const std::string& name, float value)
+{
+	const ShaderParameter* parameter = layout ? layout->Find(name) : 0;
+	if (!parameter || parameter->desc.type != ShaderParameterType::Float || parameter->desc.columns != 1 || IsMatrix(parameter->desc))
+		return false;
+	return Set(name, &value, sizeof(value));
+}
+
+bool ParameterBlock::SetFloat2(const std::string& name, const float* values)
+{
+	const ShaderParameter* parameter = layout ? layout->Find(name) : 0;
+	if (!parameter || parameter->desc.type != ShaderParameterType::Float || parameter->desc.columns != 2 || IsMatrix(parameter->desc))
+		return false;
+	return Set(name, values, 2 * sizeof(float));
+}
+
+bool ParameterBlock::SetFloat3(const std::string& name, const float* values)
+{
+	const ShaderParameter* parameter = layout ? layout->Find(name) : 0;
+	if (!parameter || parameter->desc.type != ShaderParameterType::Float || parameter->desc.columns != 3 || IsMatrix(parameter->desc))
+		return false;
+	return Set(name, values, 3 * sizeof(float));
+}
+
+bool ParameterBlock::SetFloat4(const std::string& name, const float* values)
+{
+	const ShaderParameter* parameter = layout ? layout->Find(name) : 0;
+	if (!parameter || parameter->desc.type != ShaderParameterType::Float || parameter->desc.columns != 4 || IsMatrix(parameter->desc))
+		return false;
+	return Set(name, values, 4 * sizeof(float));
+}
+
+bool ParameterBlock::SetInt(const std::string& name, int value)
+{
+	const ShaderParameter* parameter = layout ? layout->Find(name) : 0;
+	if (!parameter || parameter->desc.type == ShaderParameterType::Float || parameter->desc.columns != 1 || IsMatrix(parameter->desc))
+		return false;
+	return Set(name, &value, sizeof(value));
+}
+
+bool ParameterBlock::SetMatrix(const std::string& name, const float* values, unsigned int element)
+{
+	const ShaderParameter* parameter = layout ? layout->Find(name) : 0;
+	if (!parameter || parameter->desc.type != ShaderParameterType::Float || !IsMatrix(parameter->desc))
+		return false;
+
+	const ShaderParameterDesc& desc = parameter->desc;
+	if (element >= (desc.elements > 0 ? desc.elements : 1))
+		return false;
+
+	// Unused register lanes stay zero
+	float packed[16] = {};
+	unsigned int lanes = parameter->registerStride / ComponentSize;
+	for (unsigned int row = 0; row < desc.rows; row++)
+	{
+		for (unsigned int column = 0; column < desc.columns; column++)
+		{
+			unsigned int index = desc.parameterClass == ShaderParameterClass::MatrixRows ?
+				row * lanes + column :
+				column * lanes + row;
+			packed[index] = values[row * desc.columns + column];
+		}
+	}
+	return Set(name, packed, parameter->elementSize, element);
+}
+
+bool ParameterBlock::Set(const std::string& name, const void* values, unsigned int size, unsigned int element)
+{
+	const ShaderParameter* parameter = layout ? layout->Find(name) : 0;
+	if (!parameter || size > parameter->elementSize)
+		return false;
+	if (element >= (parameter->desc.elements > 0 ? parameter->desc.elements : 1))
+		return false;
+
+	// Setting a value that's already there doesn't need an upload
+	unsigned char* destination = data.data() + parameter->offset + element * parameter->elementStride;
+	if (memcmp(destination, values, size) != 0)
+	{
+		memcpy(destination, values, size);
+		Changed();
+	}
+	return true;
+}
+
+bool ParameterBlock::Get(const std::string& name, void* values, unsigned int size, unsigned int element) const
+{
+	const ShaderParameter* parameter = layout ? layout->Find(name) : 0;
+	if (!parameter || size > parameter->elementSize)
+		return false;
+	if (element >= (parameter->desc.elements > 0 ? parameter->desc.elements : 1))
+		return false;
+
+	memcpy(values, data.data() + parameter->offset + element * parameter->elementStride, size);
+	return true;
+}
+
+unsigned int ParameterBlock::CopyMatching(const ParameterBlock& other)
+{
+	if (!layout || !other.layout)
+		return 0;
+
+	bool changed = false;
+	unsigned int copied = ConstantBufferLayout::Repack(*layout, data.data(), *other.layout, other.data.data(), &changed);
+	if (changed)
+		Changed();
+	return copied;
+}
+
+void ParameterBlock::CopyFrom(const ParameterBlock& other)
+{
+	if (layout == other.layout && data == other.data)
+		return;
+
+	layout = other.layout;
+	data = other.data;
+	Changed();
+}
+
+std::shared_ptr<const ConstantBufferLayout> ParameterBlock::GetLayout() const { return layout; }
+const unsigned char* ParameterBlock::GetData() const { return data.data(); }
+unsigned int ParameterBlock::GetSize() const { return (unsigned int)data.size(); }
+bool ParameterBlock::IsDirty() const { return dirty; }
+void ParameterBlock::ClearDirty() { dirty = false; }
+unsigned int ParameterBlock::GetVersion() const { return version; }
+
+void ParameterBlock::Changed()
+{
+	dirty = true;
+	version++;
+}
+
+bool ParameterOverrides::Capture(const ParameterBlock& block, const std::string& name, unsigned int element)
+{
+	std::shared_ptr<const ConstantBufferLayout> layout = block.GetLayout();
+	const ShaderParameter* parameter = layout ? layout->Find(name) : 0;
+	if (!parameter)
+		return false;
+
+	unsigned int size = parameter->elementSize;
+	Override* existing = Find(name, element);
+	if (existing && existing->size != size)
+	{
+		Remove(name, element);
+		existing = 0;
+	}
+	if (!existing)
+	{
+		Override added = { name, element, (unsigned int)data.size(), size };
+		data.resize(data.size() + size);
+		overrides.push_back(added);
+		existing = &overrides.back();
+	}
+
+	if (!block.Get(name, data.data() + existing->dataOffset, size, element))
+	{
+		Remove(name, element);
+		return false;
+	}
+	version++;
+	return true;
+}
+
+bool ParameterOverrides::Remove(const std::string& name, unsigned int element)
+{
+	Override* removed = Find(name, element);
+	if (!removed)
+		return false;
+
+	// Close the gap so the values stay packed
+	unsigned int offset = removed->dataOffset;
+	unsigned int size = removed->size;
+	data.erase(data.begin() + offset, data.begin() + offset + size);
+	overrides.erase(overrides.begin() + (removed - overrides.data()));
+	for (Override& other : overrides)
+	{
+		if (other.dataOffset > offset)
+			other.dataOffset -= size;
+	}
+	version++;
+	return true;
+}
+
+void ParameterOverrides::Clear()
+{
+	overrides.clear();
+	data.clear();
+	version++;
+}
+
+unsigned int ParameterOverrides::Apply(ParameterBlock& block) const
+{
+	unsigned int applied = 0;
+	for (const Override& entry : overrides)
+	{
+		if (block.Set(entry.name, data.data() + entry.dataOffset, entry.size, entry.element))
+			applied++;
+	}
+	return applied;
+}
+
+bool ParameterOverrides::IsOverridden(const std::string& name, unsigned int element) const
+{
+	for (const Override& entry : overrides)
+	{
+		if (entry.name == name && entry.element == element)
+			return true;
+	}
+	return false;
+}
+
+size_t ParameterOverrides::GetCount() const { return overrides.size(); }
+size_t ParameterOverrides::GetByteCount() const { return data.size(); }
+unsigned int ParameterOverrides::GetVersion() const { return version; }
+
+ParameterOverrides::Override* ParameterOverrides::Find(const std::string& name, unsigned int element)
+{
+	for (Override& entry : overrides)
+	{
+		if (entry.name == name && entry.element == element)
+			return &entry;
+	}
+	return 0;
+}
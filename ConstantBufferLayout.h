@@ -0,0 +1,172 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+
+enum class ShaderParameterType : unsigned char { Float, Int, UInt, Bool };
+
+// Matrices can be stored a row or a column per register
+enum class ShaderParameterClass : unsigned char { Scalar, Vector, MatrixRows, MatrixColumns };
+
+// cbuffers pad into 16 byte registers; StructuredBuffer
+// elements are packed tightly on 4 byte boundaries
+enum class LayoutPacking : unsigned char { ConstantBuffer, Structured };
+
+// One cbuffer variable (or StructuredBuffer member) as the
+// shader declares it
+struct ShaderParameterDesc
+{
+	std::string name;
+	ShaderParameterType type;
+	ShaderParameterClass parameterClass;
+	unsigned int rows;			// 1 unless a matrix
+	unsigned int columns;		// 1 for scalars
+	unsigned int elements;		// 0 unless an array
+};
+
+// Where a parameter ended up once packed
+struct ShaderParameter
+{
+	ShaderParameterDesc desc;
+	unsigned int offset;
+	unsigned int size;				// Bytes covered, up to the end of the last component
+	unsigned int elementSize;		// Bytes one element covers, unpadded
+	unsigned int elementStride;		// Distance between array elements
+	unsigned int registerStride;	// Distance between matrix rows or columns
+};
+
+// --------------------------------------------------------
+// Lays out a cbuffer with HLSL's packing rules
+//
+// - Everything is made of 16 byte registers
+// - Scalars and vectors pack into the current register, but
+//    never straddle into the next one
+// - Matrices and arrays always start a new register, and each
+//    array element (and matrix row or column) takes a whole
+//    register, except that the last one is not padded out
+// - The total size is rounded up to a whole register
+// - packoffset and structs aren't supported
+//
+// With Structured packing it instead lays out one element of
+// a StructuredBuffer, where nothing is padded: every value
+// follows straight on from the last and the size is the sum
+// --------------------------------------------------------
+class ConstantBufferLayout
+{
+public:
+	ConstantBufferLayout(const std::string& name = std::string(), LayoutPacking packing = LayoutPacking::ConstantBuffer);
+
+	// Places a parameter after the last one; returns its offset
+	unsigned int Add(const ShaderParameterDesc& desc);
+
+	const std::string& GetName() const;
+	LayoutPacking GetPacking() const;
+	const ShaderParameter* Find(const std::string& name) const;
+	const std::vector<ShaderParameter>& GetParameters() const;
+	unsigned int GetSize() const;
+
+	// Copies every parameter two layouts share by name and shape
+	// from one set of bytes to another, repacking where the
+	// layouts differ.  Returns how many were shared; changed is
+	// set if any destination byte changed.
+	static unsigned int Repack(const ConstantBufferLayout& toLayout, unsigned char* to,
+		const ConstantBufferLayout& fromLayout, const unsigned char* from, bool* changed);
+
+private:
+	std::string name;
+	LayoutPacking packing;
+	std::vector<ShaderParameter> parameters;
+	unsigned int end;		// Just past the last parameter
+};
+
+// --------------------------------------------------------
+// The bytes of one cbuffer (or StructuredBuffer element),
+// filled in by parameter name
+//
+// - Setters return false if the name is missing or the value
+//    doesn't fit, and leave the block untouched
+// - Any change marks the block dirty until the caller has
+//    uploaded it and called ClearDirty()
+// --------------------------------------------------------
+class ParameterBlock
+{
+public:
+	ParameterBlock(std::shared_ptr<const ConstantBufferLayout> layout = std::shared_ptr<const ConstantBufferLayout>());
+
+	bool SetFloat(const std::string& name, float value);
+	bool SetFloat2(const std::string& name, const float* values);
+	bool SetFloat3(const std::string& name, const float* values);
+	bool SetFloat4(const std::string& name, const float* values);
+	bool SetInt(const std::string& name, int value);
+
+	// Values are given a row at a time (rows * columns floats)
+	// and rearranged to suit how the shader stores the matrix
+	bool SetMatrix(const std::string& name, const float* values, unsigned int element = 0);
+
+	// Copies raw component data into one element
+	bool Set(const std::string& name, const void* data, unsigned int size, unsigned int element = 0);
+	bool Get(const std::string& name, void* data, unsigned int size, unsigned int element = 0) const;
+
+	// Copies every parameter the two layouts share by name and shape
+	unsigned int CopyMatching(const ParameterBlock& other);
+
+	// Takes on another block's layout and values
+	void CopyFrom(const ParameterBlock& other);
+
+	std::shared_ptr<const ConstantBufferLayout> GetLayout() const;
+	const unsigned char* GetData() const;
+	unsigned int GetSize() const;
+	bool IsDirty() const;
+	void ClearDirty();
+
+	// Bumped on every change, so copies can tell they are stale
+	unsigned int GetVersion() const;
+
+private:
+	std::shared_ptr<const ConstantBufferLayout> layout;
+	std::vector<unsigned char> data;
+	bool dirty;
+	unsigned int version;
+
+	void Changed();
+};
+
+// --------------------------------------------------------
+// Just the parameters a material instance changes from its
+// parent, stored as packed bytes by name
+//
+// - Apply() writes them over a block holding the parent's
+//    values; names the block's layout lacks are skipped, so
+//    overrides survive the parent's shader changing
+// - Setting the same parameter again replaces the old value
+// --------------------------------------------------------
+class ParameterOverrides
+{
+public:
+	// Records one element as it currently sits in block
+	bool Capture(const ParameterBlock& block, const std::string& name, unsigned int element = 0);
+	bool Remove(const std::string& name, unsigned int element = 0);
+	void Clear();
+
+	unsigned int Apply(ParameterBlock& block) const;
+	bool IsOverridden(const std::string& name, unsigned int element = 0) const;
+
+	size_t GetCount() const;
+	size_t GetByteCount() const;
+	unsigned int GetVersion() const;
+
+private:
+	struct Override
+	{
+		std::string name;
+		unsigned int element;
+		unsigned int dataOffset;	// Into data
+		unsigned int size;
+	};
+
+	std::vector<Override> overrides;
+	std::vector<unsigned char> data;
+	unsigned int version = 0;
+
+	Override* Find(const std::string& name, unsigned int element);
+};
@@ -0,0 +1,233 @@
+#include "ConstantBufferLayout.h"
+#include "TestHarness.h"
+
+namespace
+{
+	ShaderParameterDesc Scalar(const char* name, unsigned int elements = 0, ShaderParameterType type = ShaderParameterType::Float)
+	{
+		return { name, type, ShaderParameterClass::Scalar, 1, 1, elements };
+	}
+
+	ShaderParameterDesc Vector(const char* name, unsigned int columns, unsigned int elements = 0)
+	{
+		return { name, ShaderParameterType::Float, ShaderParameterClass::Vector, 1, columns, elements };
+	}
+
+	ShaderParameterDesc Matrix(const char* name, ShaderParameterClass parameterClass, unsigned int rows, unsigned int columns, unsigned int elements = 0)
+	{
+		return { name, ShaderParameterType::Float, parameterClass, rows, columns, elements };
+	}
+}
+
+TEST_CASE(VectorsPackIntoTheCurrentRegister)
+{
+	// float; float3 fits in the rest of register 0
+	ConstantBufferLayout layout;
+	CHECK(layout.Add(Scalar("a")) == 0);
+	CHECK(layout.Add(Vector("b", 3)) == 4);
+	CHECK(layout.GetSize() == 16);
+
+	// float2; float2 also share one
+	ConstantBufferLayout pairs;
+	pairs.Add(Vector("a", 2));
+	CHECK(pairs.Add(Vector("b", 2)) == 8);
+	CHECK(pairs.GetSize() == 16);
+}
+
+TEST_CASE(Float3NeverStraddlesARegister)
+{
+	// float2 then float3 would cross into register 1, so it moves there
+	ConstantBufferLayout layout;
+	layout.Add(Vector("a", 2));
+	CHECK(layout.Add(Vector("b", 3)) == 16);
+	CHECK(layout.Find("b")->size == 12);
+	CHECK(layout.GetSize() == 32);
+
+	// A float can still fill the gap after a float3
+	CHECK(layout.Add(Scalar("c")) == 28);
+	CHECK(layout.GetSize() == 32);
+
+	// float3; float3 can't share either
+	ConstantBufferLayout twoFloat3s;
+	twoFloat3s.Add(Vector("a", 3));
+	CHECK(twoFloat3s.Add(Vector("b", 3)) == 16);
+}
+
+TEST_CASE(ArrayElementsTakeWholeRegistersButTheLast)
+{
+	// float a[3]: 16 + 16 + 4 bytes, and the next value packs after it
+	ConstantBufferLayout layout;
+	CHECK(layout.Add(Scalar("a", 3)) == 0);
+	const ShaderParameter* a = layout.Find("a");
+	CHECK(a->elementStride == 16);
+	CHECK(a->elementSize == 4);
+	CHECK(a->size == 36);
+	CHECK(layout.Add(Scalar("b")) == 36);
+	CHECK(layout.GetSize() == 48);
+}
+
+TEST_CASE(ArraysStartANewRegister)
+{
+	// Even a single float would fit, but the array doesn't start there
+	ConstantBufferLayout layout;
+	layout.Add(Scalar("x"));
+	CHECK(layout.Add(Vector("v", 2, 2)) == 16);
+	CHECK(layout.Find("v")->size == 24);
+	CHECK(layout.Add(Vector("y", 2)) == 40);
+	CHECK(layout.GetSize() == 48);
+}
+
+TEST_CASE(MatricesTakeARegisterPerColumnOrRow)
+{
+	// column_major float4x4 after a float starts at register 1
+	ConstantBufferLayout columns;
+	columns.Add(Scalar("a"));
+	CHECK(columns.Add(Matrix("m", ShaderParameterClass::MatrixColumns, 4, 4)) == 16);
+	CHECK(columns.Find("m")->size == 64);
+	CHECK(columns.Add(Scalar("c")) == 80);
+	CHECK(columns.GetSize() == 96);
+
+	// column_major float3x3: three registers, the last only 12 bytes
+	ConstantBufferLayout matrix3x3;
+	matrix3x3.Add(Matrix("m", ShaderParameterClass::MatrixColumns, 3, 3));
+	CHECK(matrix3x3.Find("m")->size == 44);
+	CHECK(matrix3x3.Add(Scalar("b")) == 44);
+
+	// row_major float2x3: a register per row of three
+	ConstantBufferLayout rows;
+	rows.Add(Matrix("m", ShaderParameterClass::MatrixRows, 2, 3));
+	CHECK(rows.Find("m")->size == 28);
+	CHECK(rows.Find("m")->registerStride == 16);
+	CHECK(rows.Add(Vector("b", 2)) == 32);
+
+	// column_major float2x3 is three columns of two
+	ConstantBufferLayout columns2x3;
+	columns2x3.Add(Matrix("m", ShaderParameterClass::MatrixColumns, 2, 3));
+	CHECK(columns2x3.Find("m")->size == 40);
+}
+
+TEST_CASE(MatrixArraysPadEveryElement)
+{
+	ConstantBufferLayout layout;
+	layout.Add(Matrix("bones", ShaderParameterClass::MatrixColumns, 4, 3, 2));
+	const ShaderParameter* bones = layout.Find("bones");
+	CHECK(bones->elementStride == 48);
+	CHECK(bones->elementSize == 48);
+	CHECK(bones->size == 96);
+	CHECK(layout.GetSize() == 96);
+}
+
+TEST_CASE(StructuredPackingHasNoPadding)
+{
+	ConstantBufferLayout layout("Instance", LayoutPacking::Structured);
+	CHECK(layout.Add(Vector("a", 2)) == 0);
+	CHECK(layout.Add(Vector("b", 3)) == 8);
+	CHECK(layout.Add(Matrix("m", ShaderParameterClass::MatrixRows, 3, 3)) == 20);
+	CHECK(layout.Find("m")->registerStride == 12);
+	CHECK(layout.Add(Scalar("c", 2)) == 56);
+	CHECK(layout.GetSize() == 64);
+	CHECK(layout.GetPacking() == LayoutPacking::Structured);
+}
+
+TEST_CASE(MatricesAreStoredAsTheShaderReadsThem)
+{
+	// Values go in a row at a time; column_major swaps them round
+	std::shared_ptr<ConstantBufferLayout> layout = std::make_shared<ConstantBufferLayout>();
+	layout->Add(Matrix("columns", ShaderParameterClass::MatrixColumns, 4, 4));
+	layout->Add(Matrix("rows", ShaderParameterClass::MatrixRows, 2, 3));
+	ParameterBlock block(layout);
+
+	float values[16];
+	for (int i = 0; i < 16; i++)
+		values[i] = (float)i;
+	REQUIRE(block.SetMatrix("columns", values));
+	float stored[16];
+	REQUIRE(block.Get("columns", stored, sizeof(stored)));
+	CHECK(stored[1] == 4.0f);
+	CHECK(stored[4] == 1.0f);
+	CHECK(stored[5] == 5.0f);
+
+	// A row_major 2x3 pads each row of three out to a register
+	REQUIRE(block.SetMatrix("rows", values));
+	float rows[7];
+	REQUIRE(block.Get("rows", rows, sizeof(rows)));
+	CHECK(rows[0] == 0.0f && rows[2] == 2.0f);
+	CHECK(rows[3] == 0.0f);
+	CHECK(rows[4] == 3.0f && rows[6] == 5.0f);
+}
+
+TEST_CASE(SettersCheckTheNameAndShape)
+{
+	std::shared_ptr<ConstantBufferLayout> layout = std::make_shared<ConstantBufferLayout>("PerMaterial");
+	layout->Add(Vector("colorTint", 4));
+	layout->Add(Scalar("index", 0, ShaderParameterType::Int));
+	layout->Add(Vector("offsets", 2, 3));
+	ParameterBlock block(layout);
+	CHECK(block.GetSize() == layout->GetSize());
+	CHECK(block.IsDirty());
+	block.ClearDirty();
+
+	float color[4] = { 1, 2, 3, 4 };
+	CHECK(block.SetFloat4("colorTint", color));
+	CHECK(block.IsDirty());
+	block.ClearDirty();
+	unsigned int version = block.GetVersion();
+
+	// Writing the same value again isn't a change
+	CHECK(block.SetFloat4("colorTint", color));
+	CHECK(!block.IsDirty());
+	CHECK(block.GetVersion() == version);
+
+	CHECK(!block.SetFloat3("colorTint", color));
+	CHECK(!block.SetFloat("missing", 1.0f));
+	CHECK(!block.SetFloat("index", 1.0f));
+	CHECK(block.SetInt("index", 7));
+
+	float offset[2] = { 9, 8 };
+	CHECK(block.Set("offsets", offset, sizeof(offset), 2));
+	CHECK(!block.Set("offsets", offset, sizeof(offset), 3));
+	CHECK(!block.Set("offsets", offset, 12, 0));
+
+	ParameterBlock empty(nullptr);
+	CHECK(empty.GetSize() == 0);
+	CHECK(!empty.SetFloat("a", 1.0f));
+}
+
+TEST_CASE(RepackMovesValuesBetweenPackings)
+{
+	// The same parameters packed both ways keep their values
+	std::shared_ptr<ConstantBufferLayout> packed = std::make_shared<ConstantBufferLayout>();
+	std::shared_ptr<ConstantBufferLayout> structured = std::make_shared<ConstantBufferLayout>("", LayoutPacking::Structured);
+	for (ConstantBufferLayout* layout : { packed.get(), structured.get() })
+	{
+		layout->Add(Scalar("time"));
+		layout->Add(Matrix("world", ShaderParameterClass::MatrixRows, 3, 4));
+		layout->Add(Vector("uvs", 2, 2));
+	}
+
+	ParameterBlock source(packed);
+	float world[12];
+	for (int i = 0; i < 12; i++)
+		world[i] = (float)(i + 1);
+	float uv[2] = { 0.5f, 0.25f };
+	source.SetFloat("time", 3.0f);
+	source.SetMatrix("world", world);
+	source.Set("uvs", uv, sizeof(uv), 1);
+
+	ParameterBlock target(structured);
+	CHECK(target.CopyMatching(source) == 3);
+	float copied[12];
+	REQUIRE(target.Get("world", copied, sizeof(copied)));
+	for (int i = 0; i < 12; i++)
+		CHECK(copied[i] == world[i]);
+	float copiedUV[2];
+	REQUIRE(target.Get("uvs", copiedUV, sizeof(copiedUV), 1));
+	CHECK(copiedUV[0] == 0.5f && copiedUV[1] == 0.25f);
+
+	// Shapes that differ are skipped, shorter arrays share their front
+	std::shared_ptr<ConstantBufferLayout> other = std::make_shared<ConstantBufferLayout>();
+	other->Add(Vector("time", 2));
+	other->Add(Vector("uvs", 2, 1));
+	ParameterBlock partial(other);
+	CHECK(partial.CopyMatching(source) == 1);
+}
@@ -0,0 +1,184 @@
+#include "ConstantBufferRing.h"
+#include "Graphics.h"
+#include <cstring>
+
+// Constant buffer offsets must be multiples of 16 constants (256 bytes)
+static const unsigned int SliceAlignment = 256;
+
+ConstantBufferRing::ConstantBufferRing(unsigned int sizeInBytes, unsigned int maxFramesInFlight) :
+	allocator(sizeInBytes, SliceAlignment),
+	mappedData(0),
+	frameIndex(0),
+	maxFramesInFlight(maxFramesInFlight),
+	noOverwriteSupported(false),
+	overflowed(false)
+{
+	// Writing into a mapped constant buffer without discarding it 
+	// requires the D3D11.1 runtime and driver support
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	if (SUCCEEDED(Graphics::Device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))))
+	{
+		noOverwriteSupported = options.MapNoOverwriteOnDynamicConstantBuffer;
+	}
+
+	CreateBuffer(allocator.GetCapacity());
+
+	D3D11_QUERY_DESC queryDesc = {};
+	queryDesc.Query = D3D11_QUERY_EVENT;
+	frameFences.resize(maxFramesInFlight);
+	fenceFrameIndices.resize(maxFramesInFlight, 0);
+	for (auto& fence : frameFences)
+	{
+		Graphics::Device->CreateQuery(&queryDesc, fence.GetAddressOf());
+	}
+}
+
+ConstantBufferRing::~ConstantBufferRing()
+{
+	if (mappedData)
+		Graphics::Context->Unmap(buffer.Get(), 0);
+}
+
+void ConstantBufferRing::CreateBuffer(unsigned int sizeInBytes)
+{
+	D3D11_BUFFER_DESC desc = {};
+	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	desc.ByteWidth = sizeInBytes;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	buffer.Reset();
+	Graphics::Device->CreateBuffer(&desc, 0, buffer.GetAddressOf());
+}
+
+// --------------------------------------------------------
+// Reclaims slices from frames the GPU has finished, blocking
+// only when every fence is still pending
+// --------------------------------------------------------
+void ConstantBufferRing::WaitForFrameSlot()
+{
+	unsigned long long completed = 0;
+	for (unsigned long long f = (frameIndex > maxFramesInFlight ? frameIndex - maxFramesInFlight : 1); f < frameIndex; f++)
+	{
+		unsigned int slot = (unsigned int)(f % maxFramesInFlight);
+		if (fenceFrameIndices[slot] != f)
+			continue;
+
+		// The oldest frame must be finished before its fence slot can be reused
+		bool mustWait = (f + maxFramesInFlight == frameIndex);
+		BOOL done = FALSE;
+		while (Graphics::Context->GetData(frameFences[slot].Get(), &done, sizeof(done), mustWait ? 0 : D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+		{
+			if (!mustWait) break;
+		}
+		if (!done && !mustWait)
+			break;
+
+		completed = f;
+	}
+
+	if (completed > 0)
+		allocator.ReleaseFramesUpTo(completed);
+}
+
+void ConstantBufferRing::BeginFrame()
+{
+	frameIndex++;
+
+	// Last frame ran out of room, so switch to a buffer twice the size.
+	// The old buffer stays alive until the GPU is done with it.
+	if (overflowed)
+	{
+		allocator = RingAllocator(allocator.GetCapacity() * 2, SliceAlignment);
+		CreateBuffer(allocator.GetCapacity());
+		overflowed = false;
+	}
+
+	D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+	if (noOverwriteSupported)
+	{
+		WaitForFrameSlot();
+	}
+	else
+	{
+		// Without no-overwrite maps the driver renames the whole buffer
+		// for us, so every frame can start from the beginning
+		allocator.Reset();
+		mapType = D3D11_MAP_WRITE_DISCARD;
+	}
+
+	// A fresh buffer must be discarded before it can be mapped for no-overwrite
+	if (allocator.GetUsedBytes() == 0)
+		mapType = D3D11_MAP_WRITE_DISCARD;
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	Graphics::Context->Map(buffer.Get(), 0, mapType, 0, &mapped);
+	mappedData = (unsigned char*)mapped.pData;
+
+	allocator.BeginFrame(frameIndex);
+}
+
+// --------------------------------------------------------
+// Copies data into the next free slice.  Returns false when
+// the ring is full (it will grow at the start of next frame).
+// --------------------------------------------------------
+bool ConstantBufferRing::Allocate(const void* data, unsigned int size, ConstantBufferSlice* slice)
+{
+	if (!mappedData)
+		return false;
+
+	unsigned int offset = allocator.Allocate(size);
+	if (offset == RingAllocator::InvalidOffset)
+	{
+		overflowed = true;
+		return false;
+	}
+
+	memcpy(mappedData + offset, data, size);
+	slice->firstConstant = offset / 16;
+	slice->numConstants = allocator.AlignSize(size) / 16;
+	return true;
+}
+
+void ConstantBufferRing::FinishWrites()
+{
+	if (!mappedData)
+		return;
+
+	Graphics::Context->Unmap(buffer.Get(), 0);
+	mappedData = 0;
+}
+
+void ConstantBufferRing::EndFrame()
+{
+	FinishWrites();
+	allocator.EndFrame();
+
+	// Fence everything submitted so far, including this frame's draws
+	unsigned int slot = (unsigned int)(frameIndex % maxFramesInFlight);
+	Graphics::Context->End(frameFences[slot].Get());
+	fenceFrameIndices[slot] = frameIndex;
+}
+
+void ConstantBufferRing::BindVS(unsigned int slot, const ConstantBufferSlice& slice)
+{
+	BindVS(Graphics::Context.Get(), slot, slice);
+}
+
+void ConstantBufferRing::BindPS(unsigned int slot, const ConstantBufferSlice& slice)
+{
+	BindPS(Graphics::Context.Get(), slot, slice);
+}
+
+// Safe to call from several threads at once as long as each has its own context
+void ConstantBufferRing::BindVS(ID3D11DeviceContext1* context, unsigned int slot, const ConstantBufferSlice& slice)
+{
+	context->VSSetConstantBuffers1(slot, 1, buffer.GetAddressOf(), &slice.firstConstant, &slice.numConstants);
+}
+
+void ConstantBufferRing::BindPS(ID3D11DeviceContext1* context, unsigned int slot, const ConstantBufferSlice& slice)
+{
+	context->PSSetConstantBuffers1(slot, 1, buffer.GetAddressOf(), &slice.firstConstant, &slice.numConstants);
+}
+
+unsigned int ConstantBufferRing::GetSize() { return allocator.GetCapacity(); }
+unsigned int ConstantBufferRing::GetFrameBytes() { return allocator.GetFrameBytes(); }
@@ -0,0 +1,56 @@
+#pragma once
+#include <d3d11_1.h>
+#include <wrl/client.h>
+#include <vector>
+#include "RingAllocator.h"
+
+// A region of the ring, in the units VSSetConstantBuffers1 expects
+struct ConstantBufferSlice
+{
+	unsigned int firstConstant;		// Offset in 16-byte shader constants
+	unsigned int numConstants;		// Size in 16-byte shader constants
+};
+
+// --------------------------------------------------------
+// One large dynamic constant buffer shared by every draw in a frame
+//
+// - The buffer is mapped once per frame, per-object data is written
+//    into 256-byte aligned slices, and each draw binds its slice 
+//    with VSSetConstantBuffers1/PSSetConstantBuffers1 offsets
+// - Event queries act as frame fences so slices still being read 
+//    by the GPU are never overwritten
+// --------------------------------------------------------
+class ConstantBufferRing
+{
+public:
+	ConstantBufferRing(unsigned int sizeInBytes, unsigned int maxFramesInFlight = 3);
+	~ConstantBufferRing();
+
+	void BeginFrame();
+	bool Allocate(const void* data, unsigned int size, ConstantBufferSlice* slice);
+	void FinishWrites();
+	void EndFrame();
+
+	void BindVS(unsigned int slot, const ConstantBufferSlice& slice);
+	void BindPS(unsigned int slot, const ConstantBufferSlice& slice);
+	void BindVS(ID3D11DeviceContext1* context, unsigned int slot, const ConstantBufferSlice& slice);
+	void BindPS(ID3D11DeviceContext1* context, unsigned int slot, const ConstantBufferSlice& slice);
+
+	unsigned int GetSize();
+	unsigned int GetFrameBytes();
+
+private:
+	void CreateBuffer(unsigned int sizeInBytes);
+	void WaitForFrameSlot();
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+	std::vector<Microsoft::WRL::ComPtr<ID3D11Query>> frameFences;
+	std::vector<unsigned long long> fenceFrameIndices;
+
+	RingAllocator allocator;
+	unsigned char* mappedData;
+	unsigned long long frameIndex;
+	unsigned int maxFramesInFlight;
+	bool noOverwriteSupported;
+	bool overflowed;
+};
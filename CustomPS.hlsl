@@ -1,12 +1,17 @@
-cbuffer ExternalData : register(b0)
+cbuffer PerFrame : register(b0)
 {
-    float4 color;
-    float2 uv;
-    float2 padding;
-    float3 normal;
+    matrix view;
+    matrix projection;
+    matrix viewProjection;
     float time;
 }
 
+cbuffer PerMaterial : register(b1)
+{
+    float tileCount;
+    float2 scrollSpeed;
+}
+
 // Struct representing the data we expect to receive from earlier pipeline stages
 // - Should match the output of our corresponding vertex shader
 // - The name of the struct itself is unimportant
@@ -35,8 +40,7 @@ struct VertexToPixel
 // --------------------------------------------------------
 float4 main(VertexToPixel input) : SV_TARGET
 {
-    float tileCount = 4.0;
-    float x = cos(input.uv.x * 6.2832 * tileCount) + time * 3;
-    float y = sin(input.uv.y * 6.2832 * tileCount) + time * 2;
+    float x = cos(input.uv.x * 6.2832 * tileCount) + time * scrollSpeed.x;
+    float y = sin(input.uv.y * 6.2832 * tileCount) + time * scrollSpeed.y;
     return float4(cos(x) + 0.1f, sin(y) + 0.1f, sin(y * 0.25f) + 0.2f, cos(x * 0.5f) + 0.25f);
 }
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include "DrawRecording.h"
+#include "Graphics.h"
+
+void RecordDrawItems(ID3D11DeviceContext1* context, ConstantBufferRing* ring, const DrawItem* items, size_t count)
+{
+	// Materials share pipeline states, and each state only rebinds
+	// the parts that differ from the one before it
+	Material* boundMaterial = 0;
+	const PipelineState* boundState = 0;
+	ID3D11Buffer* boundParameters = 0;
+	ID3D11ShaderResourceView* boundTable = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		const DrawItem& item = items[i];
+		if (item.material != boundMaterial)
+		{
+			Material* material = item.material;
+			const PipelineState* state = material->GetPipelineState().get();
+			if (state && state != boundState)
+			{
+				state->Apply(context, boundState);
+				boundState = state;
+			}
+
+			// Instances without overrides share their parent's buffer
+			ID3D11Buffer* parameters = material->GetConstantBuffer().Get();
+			if (parameters && parameters != boundParameters)
+			{
+				context->PSSetConstantBuffers(material->GetParameterSlot(), 1, &parameters);
+				boundParameters = parameters;
+			}
+
+			// Table materials all read one buffer by material ID
+			MaterialParameterBuffer* table = material->GetParameterTable();
+			ID3D11ShaderResourceView* tableView = table ? table->GetShaderResourceView() : 0;
+			if (tableView && tableView != boundTable)
+			{
+				context->PSSetShaderResources(material->GetParameterSlot(), 1, &tableView);
+				boundTable = tableView;
+			}
+			boundMaterial = material;
+		}
+
+		ring->BindVS(context, 1, item.drawSlice);
+		item.mesh->DrawInstanced(context, item.instanceCount);
+	}
+}
+
+DeferredDrawContext::DeferredDrawContext(const FrameRecordingState* frameState) :
+	frameState(frameState)
+{
+	Graphics::Device->CreateDeferredContext1(0, deferredContext.GetAddressOf());
+}
+
+void DeferredDrawContext::Record(DrawRange range)
+{
+	// Deferred contexts start from default state, so everything the
+	// immediate context would have inherited must be set up again
+	ID3D11DeviceContext1* context = deferredContext.Get();
+	context->OMSetRenderTargets(1, &frameState->renderTarget, frameState->depthBuffer);
+	context->RSSetViewports(1, &frameState->viewport);
+	context->VSSetConstantBuffers(0, 1, &frameState->perFrameConstantBuffer);
+	context->PSSetConstantBuffers(0, 1, &frameState->perFrameConstantBuffer);
+	frameState->instanceBuffer->Bind(context);
+	if (frameState->lighting)
+		frameState->lighting->Bind(context);
+
+	RecordDrawItems(context, frameState->constantBufferRing, frameState->drawList->data() + range.first, range.count);
+
+	commandList.Reset();
+	context->FinishCommandList(FALSE, commandList.GetAddressOf());
+}
+
+void DeferredDrawContext::Execute()
+{
+	if (!commandList)
+		return;
+
+	// Not restoring the immediate context's state is cheaper; the caller
+	// re-binds whatever it needs afterwards
+	Graphics::Context->ExecuteCommandList(commandList.Get(), FALSE);
+	commandList.Reset();
+}
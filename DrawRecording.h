@@ -0,0 +1,64 @@
+#pragma once
+#include <d3d11_1.h>
+#include <wrl/client.h>
+#include <vector>
+#include "CommandScheduler.h"
+#include "ClusteredLighting.h"
+#include "ConstantBufferRing.h"
+#include "InstanceBuffer.h"
+#include "Material.h"
+#include "Mesh.h"
+
+// One visible entity, before draws are formed
+struct DrawInstance
+{
+	Material* material;
+	Mesh* mesh;
+	unsigned int entity;
+	unsigned long long sortKey;		// Batch, then mesh; equal keys can share a draw
+};
+
+// Everything needed to issue one instanced draw, gathered before recording starts
+struct DrawItem
+{
+	Material* material;					// The first instance's; the rest share its state
+	Mesh* mesh;
+	ConstantBufferSlice drawSlice;		// Its PerDrawData
+	unsigned int instanceCount;
+};
+
+// State shared by every context recording the same frame
+struct FrameRecordingState
+{
+	const std::vector<DrawItem>* drawList;
+	ConstantBufferRing* constantBufferRing;
+	const InstanceBuffer* instanceBuffer;
+	ID3D11Buffer* perFrameConstantBuffer;
+	const ClusteredLighting* lighting;
+	ID3D11RenderTargetView* renderTarget;
+	ID3D11DepthStencilView* depthBuffer;
+	D3D11_VIEWPORT viewport;
+};
+
+// Issues draws onto any context, only rebinding pipeline state and
+// material parameters where they change
+void RecordDrawItems(ID3D11DeviceContext1* context, ConstantBufferRing* ring, const DrawItem* items, size_t count);
+
+// --------------------------------------------------------
+// Records a range of the draw list into a D3D11 deferred
+// context and plays the resulting command list back on the
+// immediate context
+// --------------------------------------------------------
+class DeferredDrawContext : public CommandContext
+{
+public:
+	DeferredDrawContext(const FrameRecordingState* frameState);
+
+	void Record(DrawRange range) override;
+	void Execute() override;
+
+private:
+	const FrameRecordingState* frameState;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext1> deferredContext;
+	Microsoft::WRL::ComPtr<ID3D11CommandList> commandList;
+};
@@ -0,0 +1,120 @@
+#include "EntityRegistry.h"
+
+EntityRegistry::EntityRegistry() {}
+
+Entity EntityRegistry::Create(MeshHandle mesh, MaterialHandle material, const std::string& name)
+{
+	// Reuse a freed slot if possible, otherwise grow the sparse table
+	Entity entity = {};
+	if (!freeIndices.empty())
+	{
+		entity.index = freeIndices.back();
+		freeIndices.pop_back();
+	}
+	else
+	{
+		entity.index = (unsigned int)sparseToDense.size();
+		sparseToDense.push_back(InvalidIndex);
+		generations.push_back(0);
+	}
+	entity.generation = generations[entity.index];
+
+	sparseToDense[entity.index] = (unsigned int)denseEntities.size();
+	transforms.push_back(Transform());
+	meshes.push_back(mesh);
+	materials.push_back(material);
+	names.push_back(name);
+	denseEntities.push_back(entity);
+	return entity;
+}
+
+// --------------------------------------------------------
+// Removes an entity by moving the last one into its slot
+// --------------------------------------------------------
+void EntityRegistry::Destroy(Entity entity)
+{
+	if (!IsAlive(entity))
+		return;
+
+	unsigned int dense = sparseToDense[entity.index];
+	unsigned int last = (unsigned int)denseEntities.size() - 1;
+	if (dense != last)
+	{
+		transforms[dense] = transforms[last];
+		meshes[dense] = meshes[last];
+		materials[dense] = materials[last];
+		names[dense] = std::move(names[last]);
+		denseEntities[dense] = denseEntities[last];
+		sparseToDense[denseEntities[dense].index] = dense;
+	}
+
+	transforms.pop_back();
+	meshes.pop_back();
+	materials.pop_back();
+	names.pop_back();
+	denseEntities.pop_back();
+
+	// Invalidate any outstanding handles to this slot
+	sparseToDense[entity.index] = InvalidIndex;
+	generations[entity.index]++;
+	freeIndices.push_back(entity.index);
+}
+
+bool EntityRegistry::IsAlive(Entity entity)
+{
+	return entity.index < sparseToDense.size() &&
+		generations[entity.index] == entity.generation &&
+		sparseToDense[entity.index] != InvalidIndex;
+}
+
+void EntityRegistry::Reserve(size_t count)
+{
+	transforms.reserve(count);
+	meshes.reserve(count);
+	materials.reserve(count);
+	names.reserve(count);
+	denseEntities.reserve(count);
+	sparseToDense.reserve(count);
+	generations.reserve(count);
+}
+
+void EntityRegistry::Clear()
+{
+	// Destroy everything so old handles stay invalid
+	while (!denseEntities.empty())
+	{
+		Destroy(denseEntities.back());
+	}
+}
+
+size_t EntityRegistry::Count() { return denseEntities.size(); }
+
+unsigned int EntityRegistry::GetDenseIndex(Entity entity)
+{
+	return IsAlive(entity) ? sparseToDense[entity.index] : InvalidIndex;
+}
+
+// For systems that only store Entity::index, like the scene BVH
+unsigned int EntityRegistry::GetDenseIndex(unsigned int entityIndex)
+{
+	return entityIndex < sparseToDense.size() ? sparseToDense[entityIndex] : InvalidIndex;
+}
+
+Transform* EntityRegistry::GetTransform(Entity entity)
+{
+	return IsAlive(entity) ? &transforms[sparseToDense[entity.index]] : 0;
+}
+
+MeshHandle EntityRegistry::GetMesh(Entity entity) { return meshes[sparseToDense[entity.index]]; }
+MaterialHandle EntityRegistry::GetMaterial(Entity entity) { return materials[sparseToDense[entity.index]]; }
+std::string EntityRegistry::GetName(Entity entity) { return names[sparseToDense[entity.index]]; }
+
+void EntityRegistry::SetMesh(Entity entity, MeshHandle mesh) { meshes[sparseToDense[entity.index]] = mesh; }
+void EntityRegistry::SetMaterial(Entity entity, MaterialHandle material) { materials[sparseToDense[entity.index]] = material; }
+void EntityRegistry::SetName(Entity entity, const std::string& name) { names[sparseToDense[entity.index]] = name; }
+
+std::vector<Transform>& EntityRegistry::GetTransforms() { return transforms; }
+std::vector<MeshHandle>& EntityRegistry::GetMeshes() { return meshes; }
+std::vector<MaterialHandle>& EntityRegistry::GetMaterials() { return materials; }
+std::vector<std::string>& EntityRegistry::GetNames() { return names; }
+std::vector<Entity>& EntityRegistry::GetEntities() { return denseEntities; }
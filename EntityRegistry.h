@@ -0,0 +1,76 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Transform.h"
+
+// Indices into Game's meshList and materialList
+typedef unsigned int MeshHandle;
+typedef unsigned int MaterialHandle;
+
+// --------------------------------------------------------
+// A stable reference to an entity
+//
+// - 'index' never moves while the entity is alive
+// - 'generation' is bumped whenever an index is recycled, so
+//    handles to destroyed entities can be detected
+// --------------------------------------------------------
+struct Entity
+{
+	unsigned int index;
+	unsigned int generation;
+};
+
+// --------------------------------------------------------
+// Data-oriented storage for every entity in the scene
+//
+// - Components live in tightly packed parallel arrays, so the 
+//    per-frame loops walk contiguous memory with no refcounting
+// - Removal swaps the last entity into the hole, keeping the
+//    arrays dense; the sparse table keeps handles stable
+// --------------------------------------------------------
+class EntityRegistry
+{
+public:
+	static constexpr unsigned int InvalidIndex = 0xFFFFFFFF;
+
+	EntityRegistry();
+
+	Entity Create(MeshHandle mesh, MaterialHandle material, const std::string& name);
+	void Destroy(Entity entity);
+	bool IsAlive(Entity entity);
+	void Reserve(size_t count);
+	void Clear();
+
+	size_t Count();
+	unsigned int GetDenseIndex(Entity entity);
+	unsigned int GetDenseIndex(unsigned int entityIndex);
+
+	// Per-entity access through a handle
+	Transform* GetTransform(Entity entity);
+	MeshHandle GetMesh(Entity entity);
+	MaterialHandle GetMaterial(Entity entity);
+	std::string GetName(Entity entity);
+	void SetMesh(Entity entity, MeshHandle mesh);
+	void SetMaterial(Entity entity, MaterialHandle material);
+	void SetName(Entity entity, const std::string& name);
+
+	// Dense arrays for iteration - all Count() long and in the same order
+	std::vector<Transform>& GetTransforms();
+	std::vector<MeshHandle>& GetMeshes();
+	std::vector<MaterialHandle>& GetMaterials();
+	std::vector<std::string>& GetNames();
+	std::vector<Entity>& GetEntities();
+
+private:
+	// Dense component arrays
+	std::vector<Transform> transforms;
+	std::vector<MeshHandle> meshes;
+	std::vector<MaterialHandle> materials;
+	std::vector<std::string> names;
+	std::vector<Entity> denseEntities;
+
+	// Sparse lookup, indexed by Entity::index
+	std::vector<unsigned int> sparseToDense;
+	std::vector<unsigned int> generations;
+	std::vector<unsigned int> freeIndices;
+};
@@ -0,0 +1,113 @@
+#include "EntityRegistry.h"
+#include "TestHarness.h"
+#include <random>
+
+TEST_CASE(CreatedHandlesAreDistinctAndAlive)
+{
+	EntityRegistry registry;
+	Entity a = registry.Create(1, 2, "a");
+	Entity b = registry.Create(3, 4, "b");
+	CHECK(a.index != b.index);
+	CHECK(registry.IsAlive(a));
+	CHECK(registry.IsAlive(b));
+	CHECK(registry.Count() == 2);
+	CHECK(registry.GetMesh(b) == 3);
+	CHECK(registry.GetMaterial(b) == 4);
+	CHECK(registry.GetName(a) == "a");
+}
+
+TEST_CASE(DestroyedHandlesStayDead)
+{
+	EntityRegistry registry;
+	Entity a = registry.Create(0, 0, "a");
+	registry.Destroy(a);
+	CHECK(!registry.IsAlive(a));
+	CHECK(registry.GetTransform(a) == 0);
+	CHECK(registry.GetDenseIndex(a) == EntityRegistry::InvalidIndex);
+
+	// Destroying twice does nothing
+	registry.Destroy(a);
+	CHECK(registry.Count() == 0);
+}
+
+TEST_CASE(ReusedIndicesGetANewGeneration)
+{
+	EntityRegistry registry;
+	Entity a = registry.Create(0, 0, "a");
+	registry.Destroy(a);
+	Entity b = registry.Create(5, 6, "b");
+	CHECK(b.index == a.index);
+	CHECK(b.generation != a.generation);
+	CHECK(!registry.IsAlive(a));
+	CHECK(registry.IsAlive(b));
+
+	// An old handle can't destroy the entity now in its slot
+	registry.Destroy(a);
+	CHECK(registry.IsAlive(b));
+	CHECK(registry.GetMesh(b) == 5);
+}
+
+TEST_CASE(HandlesSurviveOtherEntitiesMoving)
+{
+	EntityRegistry registry;
+	Entity a = registry.Create(1, 0, "a");
+	Entity b = registry.Create(2, 0, "b");
+	Entity c = registry.Create(3, 0, "c");
+	registry.GetTransform(c)->SetPosition(7.0f, 8.0f, 9.0f);
+
+	// c is swapped into a's dense slot
+	registry.Destroy(a);
+	CHECK(registry.GetDenseIndex(c) == 0);
+	CHECK(registry.GetMesh(c) == 3);
+	CHECK(registry.GetName(c) == "c");
+	CHECK(registry.GetTransform(c)->GetPosition().x == 7.0f);
+	CHECK(registry.GetMesh(b) == 2);
+}
+
+TEST_CASE(DenseArraysStayPackedAndInStep)
+{
+	EntityRegistry registry;
+	std::vector<Entity> live;
+	std::mt19937 random(42);
+	for (int step = 0; step < 5000; step++)
+	{
+		if (live.empty() || random() % 3 != 0)
+		{
+			unsigned int tag = (unsigned int)step;
+			live.push_back(registry.Create(tag, tag * 2, std::to_string(tag)));
+		}
+		else
+		{
+			size_t victim = random() % live.size();
+			registry.Destroy(live[victim]);
+			live[victim] = live.back();
+			live.pop_back();
+		}
+	}
+
+	REQUIRE(registry.Count() == live.size());
+	CHECK(registry.GetTransforms().size() == live.size());
+	CHECK(registry.GetMeshes().size() == live.size());
+	CHECK(registry.GetMaterials().size() == live.size());
+	CHECK(registry.GetNames().size() == live.size());
+	for (const Entity& entity : live)
+	{
+		REQUIRE(registry.IsAlive(entity));
+		unsigned int dense = registry.GetDenseIndex(entity);
+		REQUIRE(dense < registry.Count());
+		CHECK(registry.GetEntities()[dense].index == entity.index);
+		CHECK(registry.GetMaterials()[dense] == registry.GetMeshes()[dense] * 2);
+		CHECK(registry.GetNames()[dense] == std::to_string(registry.GetMeshes()[dense]));
+	}
+}
+
+TEST_CASE(ClearInvalidatesEveryHandle)
+{
+	EntityRegistry registry;
+	Entity a = registry.Create(0, 0, "a");
+	Entity b = registry.Create(0, 0, "b");
+	registry.Clear();
+	CHECK(registry.Count() == 0);
+	CHECK(!registry.IsAlive(a));
+	CHECK(!registry.IsAlive(b));
+}
@@ -0,0 +1,51 @@
+#include "FrameExchange.h"
+
+FrameExchange::FrameExchange() :
+	snapshots(),
+	writeIndex(0),
+	publishedIndex(-1),
+	readIndex(-1),
+	publishedFrameCount(0)
+{
+}
+
+FrameSnapshot& FrameExchange::BeginWrite()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	changed.wait(lock, [this]() { return readIndex != writeIndex; });
+	return snapshots[writeIndex];
+}
+
+void FrameExchange::Publish()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		publishedIndex = writeIndex;
+		writeIndex = 1 - writeIndex;
+		publishedFrameCount++;
+	}
+	changed.notify_all();
+}
+
+const FrameSnapshot& FrameExchange::AcquireRead()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	changed.wait(lock, [this]() { return publishedIndex >= 0; });
+	readIndex = publishedIndex;
+	return snapshots[readIndex];
+}
+
+void FrameExchange::ReleaseRead()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		readIndex = -1;
+	}
+	changed.notify_all();
+}
+
+unsigned long long FrameExchange::GetPublishedFrameCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return publishedFrameCount;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <condition_variable>
+#include <mutex>
+#include "FrameSnapshot.h"
+
+// --------------------------------------------------------
+// Double-buffered hand-off of frame snapshots between the
+// simulation and render threads
+//
+// - The writer fills one snapshot while the reader draws the
+//    other; Publish() makes the written one the newest
+// - BeginWrite() blocks rather than overwrite a snapshot that
+//    is still being read, so the renderer never sees a 
+//    half-written (torn) frame
+// --------------------------------------------------------
+class FrameExchange
+{
+public:
+	FrameExchange();
+
+	// Simulation side
+	FrameSnapshot& BeginWrite();
+	void Publish();
+
+	// Render side - returns the newest published snapshot, waiting
+	// only if nothing has been published yet
+	const FrameSnapshot& AcquireRead();
+	void ReleaseRead();
+
+	unsigned long long GetPublishedFrameCount();
+
+private:
+	FrameSnapshot snapshots[2];
+	int writeIndex;
+	int publishedIndex;		// -1 until the first Publish()
+	int readIndex;			// -1 when no one is reading
+	unsigned long long publishedFrameCount;
+
+	std::mutex mutex;
+	std::condition_variable changed;
+};
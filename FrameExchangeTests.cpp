@@ -0,0 +1,121 @@
+#include "FrameExchange.h"
+#include "TestHarness.h"
+#include <chrono>
+#include <thread>
+
+namespace
+{
+	// Every value in a snapshot is derived from its frame number,
+	// so a reader can tell if it sees parts of two frames
+	void FillSnapshot(FrameSnapshot& snapshot, unsigned long long frame)
+	{
+		float value = (float)frame;
+		size_t count = 64 + frame % 64;
+		snapshot.frameNumber = frame;
+		snapshot.totalTime = value;
+		snapshot.worldMatrices.assign(count, DirectX::XMFLOAT4X4());
+		snapshot.meshes.assign(count, (MeshHandle)frame);
+		for (DirectX::XMFLOAT4X4& world : snapshot.worldMatrices)
+		{
+			world._11 = value;
+			world._44 = value;
+		}
+	}
+
+	bool IsWhole(const FrameSnapshot& snapshot)
+	{
+		float value = (float)snapshot.frameNumber;
+		if (snapshot.totalTime != value ||
+			snapshot.worldMatrices.size() != 64 + snapshot.frameNumber % 64 ||
+			snapshot.meshes.size() != snapshot.worldMatrices.size())
+			return false;
+
+		for (const DirectX::XMFLOAT4X4& world : snapshot.worldMatrices)
+			if (world._11 != value || world._44 != value)
+				return false;
+		for (MeshHandle mesh : snapshot.meshes)
+			if (mesh != (MeshHandle)snapshot.frameNumber)
+				return false;
+		return true;
+	}
+}
+
+TEST_CASE(ReaderGetsTheNewestPublishedFrame)
+{
+	FrameExchange exchange;
+	FillSnapshot(exchange.BeginWrite(), 1);
+	exchange.Publish();
+	FillSnapshot(exchange.BeginWrite(), 2);
+	exchange.Publish();
+
+	const FrameSnapshot& snapshot = exchange.AcquireRead();
+	CHECK(snapshot.frameNumber == 2);
+	CHECK(IsWhole(snapshot));
+	exchange.ReleaseRead();
+	CHECK(exchange.GetPublishedFrameCount() == 2);
+}
+
+TEST_CASE(WriterNeverGetsTheSnapshotBeingRead)
+{
+	FrameExchange exchange;
+	FillSnapshot(exchange.BeginWrite(), 1);
+	exchange.Publish();
+
+	const FrameSnapshot& reading = exchange.AcquireRead();
+	FrameSnapshot& writing = exchange.BeginWrite();
+	CHECK(&writing != &reading);
+	FillSnapshot(writing, 2);
+	exchange.Publish();
+
+	// Frame 1 is still held, so the next write has to wait for it
+	std::atomic<bool> wrote(false);
+	std::thread writer([&]()
+		{
+			FillSnapshot(exchange.BeginWrite(), 3);
+			wrote = true;
+			exchange.Publish();
+		});
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	CHECK(!wrote.load());
+	CHECK(reading.frameNumber == 1);
+	CHECK(IsWhole(reading));
+	exchange.ReleaseRead();
+	writer.join();
+	CHECK(wrote.load());
+}
+
+TEST_CASE(ConcurrentReaderNeverSeesATornFrame)
+{
+	const unsigned long long frames = 20000;
+	FrameExchange exchange;
+	std::atomic<bool> done(false);
+	std::thread writer([&]()
+		{
+			for (unsigned long long frame = 1; frame <= frames; frame++)
+			{
+				FillSnapshot(exchange.BeginWrite(), frame);
+				exchange.Publish();
+			}
+			done = true;
+		});
+
+	unsigned long long last = 0;
+	int torn = 0;
+	int backwards = 0;
+	while (!done.load() || last < frames)
+	{
+		const FrameSnapshot& snapshot = exchange.AcquireRead();
+		if (!IsWhole(snapshot))
+			torn++;
+		if (snapshot.frameNumber < last)
+			backwards++;
+		last = snapshot.frameNumber;
+		exchange.ReleaseRead();
+	}
+	writer.join();
+
+	CHECK(torn == 0);
+	CHECK(backwards == 0);
+	CHECK(last == frames);
+	CHECK(exchange.GetPublishedFrameCount() == frames);
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include "EntityRegistry.h"
+
+// --------------------------------------------------------
+// Everything the renderer needs to draw one simulated frame
+//
+// - Written by the simulation, read by the renderer, and never
+//    touched by both at once (see FrameExchange)
+// - Entity data is stored in the registry's dense order
+// --------------------------------------------------------
+struct FrameSnapshot
+{
+	unsigned long long frameNumber;
+	float totalTime;
+
+	// Camera
+	DirectX::XMFLOAT4X4 view;
+	DirectX::XMFLOAT4X4 projection;
+	DirectX::XMFLOAT4X4 viewProjection;
+
+	// Per entity
+	std::vector<DirectX::XMFLOAT4X4> worldMatrices;
+	std::vector<DirectX::XMFLOAT4X4> wvpMatrices;
+	std::vector<MeshHandle> meshes;
+	std::vector<MaterialHandle> materials;
+
+	// Dense indices of the entities to draw, in dense order
+	std::vector<unsigned int> visibleEntities;
+};
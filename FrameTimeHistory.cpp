@@ -0,0 +1,148 @@
+#include "FrameTimeHistory.h"
+#include <algorithm>
+#include <fstream>
+
+namespace
+{
+	// How quickly the hitch baseline follows the frame time
+	const double AverageWeight = 0.05;
+
+	// Nearest-rank percentile of a sample set, partially sorting it
+	float Percentile(std::vector<float>& samples, double percent)
+	{
+		size_t rank = (size_t)(percent / 100.0 * samples.size() + 0.999999);
+		if (rank < 1) rank = 1;
+		if (rank > samples.size()) rank = samples.size();
+
+		std::nth_element(samples.begin(), samples.begin() + (rank - 1), samples.end());
+		return samples[rank - 1];
+	}
+}
+
+FrameTimeHistory::FrameTimeHistory(size_t capacity, double hitchRatio, double minHitchMilliseconds) :
+	milliseconds(capacity > 0 ? capacity : 1, 0.0f),
+	hitches(capacity > 0 ? capacity : 1, 0),
+	next(0),
+	count(0),
+	hitchRatio(hitchRatio),
+	minHitchMilliseconds(minHitchMilliseconds),
+	averageMilliseconds(0),
+	totalFrames(0),
+	totalHitches(0)
+{
+	sortScratch.reserve(milliseconds.size());
+}
+
+FrameTimeHistory& FrameTimeHistory::Global()
+{
+	static FrameTimeHistory history;
+	return history;
+}
+
+// --------------------------------------------------------
+// Adds one frame, checking it against the average of the
+// frames before it
+// --------------------------------------------------------
+void FrameTimeHistory::Record(double seconds)
+{
+	double frameMilliseconds = seconds * 1000.0;
+	if (frameMilliseconds < 0) frameMilliseconds = 0;
+
+	bool hitch = count > 0 &&
+		frameMilliseconds >= minHitchMilliseconds &&
+		frameMilliseconds > averageMilliseconds * hitchRatio;
+
+	milliseconds[next] = (float)frameMilliseconds;
+	hitches[next] = hitch ? 1 : 0;
+	next = (next + 1) % milliseconds.size();
+	if (count < milliseconds.size()) count++;
+
+	// The baseline moves slowly, so a single stall barely shifts
+	// it but a lasting change in frame rate stops being a hitch
+	if (totalFrames == 0)
+		averageMilliseconds = frameMilliseconds;
+	else
+		averageMilliseconds += (frameMilliseconds - averageMilliseconds) * AverageWeight;
+
+	totalFrames++;
+	if (hitch) totalHitches++;
+}
+
+void FrameTimeHistory::Clear()
+{
+	next = 0;
+	count = 0;
+	averageMilliseconds = 0;
+	totalFrames = 0;
+	totalHitches = 0;
+}
+
+FrameTimeSummary FrameTimeHistory::Summarize()
+{
+	FrameTimeSummary summary = {};
+	summary.frameCount = count;
+	if (count == 0)
+		return summary;
+
+	double total = 0;
+	sortScratch.clear();
+	for (size_t age = 0; age < count; age++)
+	{
+		size_t i = RingIndex(age);
+		sortScratch.push_back(milliseconds[i]);
+		total += milliseconds[i];
+		summary.hitchCount += hitches[i];
+	}
+	summary.averageMilliseconds = total / count;
+	summary.maxMilliseconds = *std::max_element(sortScratch.begin(), sortScratch.end());
+
+	summary.p50Milliseconds = Percentile(sortScratch, 50.0);
+	summary.p95Milliseconds = Percentile(sortScratch, 95.0);
+	summary.p99Milliseconds = Percentile(sortScratch, 99.0);
+	return summary;
+}
+
+const float* FrameTimeHistory::GetSamples() const { return milliseconds.data(); }
+size_t FrameTimeHistory::GetCount() const { return count; }
+size_t FrameTimeHistory::GetOffset() const { return count < milliseconds.size() ? 0 : next; }
+size_t FrameTimeHistory::GetCapacity() const { return milliseconds.size(); }
+unsigned long long FrameTimeHistory::GetTotalFrameCount() const { return totalFrames; }
+unsigned long long FrameTimeHistory::GetTotalHitchCount() const { return totalHitches; }
+
+bool FrameTimeHistory::IsHitch(size_t age) const
+{
+	return age < count && hitches[RingIndex(age)] != 0;
+}
+
+double FrameTimeHistory::GetMilliseconds(size_t age) const
+{
+	return age < count ? milliseconds[RingIndex(age)] : 0.0;
+}
+
+void FrameTimeHistory::WriteCsv(std::ostream& stream) const
+{
+	stream << "frame,milliseconds,hitch\n";
+	unsigned long long firstFrame = totalFrames - count;
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t age = count - 1 - i;
+		stream << (firstFrame + i) << ',' << GetMilliseconds(age) << ',' << (IsHitch(age) ? 1 : 0) << '\n';
+	}
+}
+
+bool FrameTimeHistory::SaveCsv(const char* path) const
+{
+	std::ofstream file(path);
+	if (!file)
+		return false;
+
+	WriteCsv(file);
+	return file.good();
+}
+
+// Age 0 is the sample just before 'next'
+size_t FrameTimeHistory::RingIndex(size_t age) const
+{
+	size_t capacity = milliseconds.size();
+	return (next + capacity - 1 - age) % capacity;
+}
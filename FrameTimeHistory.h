@@ -0,0 +1,70 @@
+#pragma once
+#include <vector>
+#include <ostream>
+
+// Statistics over the frames currently held in a FrameTimeHistory
+struct FrameTimeSummary
+{
+	size_t frameCount;
+	double averageMilliseconds;
+	double p50Milliseconds;
+	double p95Milliseconds;
+	double p99Milliseconds;
+	double maxMilliseconds;
+	size_t hitchCount;			// Hitches still in the history
+};
+
+// --------------------------------------------------------
+// Remembers the duration of the most recent frames
+//
+// - Samples live in a fixed ring buffer, so recording never
+//    allocates; the oldest frame is overwritten once it is full
+// - A frame is a hitch when it takes hitchRatio times longer
+//    than the recent average and at least minHitchMilliseconds,
+//    so steady low frame rates are not reported as hitches
+// - No platform code; the caller supplies the frame times
+// --------------------------------------------------------
+class FrameTimeHistory
+{
+public:
+	FrameTimeHistory(size_t capacity = 1024, double hitchRatio = 2.0, double minHitchMilliseconds = 8.0);
+
+	static FrameTimeHistory& Global();
+
+	void Record(double seconds);
+	void Clear();
+
+	FrameTimeSummary Summarize();
+
+	// Raw ring access, for plotting without a copy: the oldest
+	// sample is at GetOffset() and the samples wrap around
+	const float* GetSamples() const;
+	size_t GetCount() const;
+	size_t GetOffset() const;
+	size_t GetCapacity() const;
+
+	bool IsHitch(size_t age) const;			// 0 is the newest frame
+	double GetMilliseconds(size_t age) const;
+	unsigned long long GetTotalFrameCount() const;
+	unsigned long long GetTotalHitchCount() const;
+
+	// One row per frame, oldest first
+	void WriteCsv(std::ostream& stream) const;
+	bool SaveCsv(const char* path) const;
+
+private:
+	std::vector<float> milliseconds;
+	std::vector<unsigned char> hitches;
+	std::vector<float> sortScratch;
+	size_t next;
+	size_t count;
+
+	double hitchRatio;
+	double minHitchMilliseconds;
+	double averageMilliseconds;		// Exponential moving average
+
+	unsigned long long totalFrames;
+	unsigned long long totalHitches;
+
+	size_t RingIndex(size_t age) const;
+};
@@ -0,0 +1,177 @@
+#include "FrameTimeHistory.h"
+#include "TestHarness.h"
+#include <sstream>
+
+TEST_CASE(PercentilesUseTheNearestRank)
+{
+	// 1 to 100 ms, recorded out of order
+	FrameTimeHistory history(100);
+	for (int i = 0; i < 100; i++)
+		history.Record(((i * 37) % 100 + 1) / 1000.0);
+
+	FrameTimeSummary summary = history.Summarize();
+	CHECK(summary.frameCount == 100);
+	CHECK_NEAR(summary.averageMilliseconds, 50.5, 1e-4);
+	CHECK_NEAR(summary.p50Milliseconds, 50.0, 1e-4);
+	CHECK_NEAR(summary.p95Milliseconds, 95.0, 1e-4);
+	CHECK_NEAR(summary.p99Milliseconds, 99.0, 1e-4);
+	CHECK_NEAR(summary.maxMilliseconds, 100.0, 1e-4);
+}
+
+TEST_CASE(PercentilesOfFewFrames)
+{
+	FrameTimeHistory history(16);
+	history.Record(0.010);
+	FrameTimeSummary one = history.Summarize();
+	CHECK_NEAR(one.p50Milliseconds, 10.0, 1e-4);
+	CHECK_NEAR(one.p99Milliseconds, 10.0, 1e-4);
+
+	history.Record(0.020);
+	history.Record(0.030);
+	FrameTimeSummary three = history.Summarize();
+	CHECK_NEAR(three.p50Milliseconds, 20.0, 1e-4);
+	CHECK_NEAR(three.p95Milliseconds, 30.0, 1e-4);
+}
+
+TEST_CASE(EmptyHistorySummarizesToZero)
+{
+	FrameTimeHistory history;
+	FrameTimeSummary summary = history.Summarize();
+	CHECK(summary.frameCount == 0);
+	CHECK(summary.maxMilliseconds == 0.0);
+	CHECK(history.GetMilliseconds(0) == 0.0);
+	CHECK(!history.IsHitch(0));
+}
+
+TEST_CASE(RingWrapsOverTheOldestFrames)
+{
+	FrameTimeHistory history(8);
+	for (int i = 1; i <= 21; i++)
+		history.Record(i / 1000.0);
+
+	CHECK(history.GetCount() == 8);
+	CHECK(history.GetCapacity() == 8);
+	CHECK(history.GetTotalFrameCount() == 21);
+	CHECK_NEAR(history.GetMilliseconds(0), 21.0, 1e-4);
+	CHECK_NEAR(history.GetMilliseconds(7), 14.0, 1e-4);
+	CHECK(history.GetMilliseconds(8) == 0.0);
+
+	// The raw ring starts at the oldest sample
+	const float* samples = history.GetSamples();
+	for (size_t i = 0; i < 8; i++)
+		CHECK_NEAR(samples[(history.GetOffset() + i) % 8], 14.0 + i, 1e-4);
+
+	// Only what's still held is summarized
+	FrameTimeSummary summary = history.Summarize();
+	CHECK(summary.frameCount == 8);
+	CHECK_NEAR(summary.averageMilliseconds, 17.5, 1e-4);
+	CHECK_NEAR(summary.maxMilliseconds, 21.0, 1e-4);
+}
+
+TEST_CASE(OffsetIsZeroUntilTheRingFills)
+{
+	FrameTimeHistory history(8);
+	for (int i = 0; i < 5; i++)
+		history.Record(0.016);
+	CHECK(history.GetOffset() == 0);
+	CHECK(history.GetCount() == 5);
+}
+
+TEST_CASE(SpikeAboveTheAverageIsAHitch)
+{
+	FrameTimeHistory history(64);
+	for (int i = 0; i < 20; i++)
+		history.Record(0.016);
+	history.Record(0.050);
+	history.Record(0.016);
+
+	CHECK(history.IsHitch(1));
+	CHECK(!history.IsHitch(0));
+	CHECK(!history.IsHitch(2));
+	CHECK(history.GetTotalHitchCount() == 1);
+	CHECK(history.Summarize().hitchCount == 1);
+}
+
+TEST_CASE(FirstFrameIsNeverAHitch)
+{
+	FrameTimeHistory history(8);
+	history.Record(0.5);
+	CHECK(!history.IsHitch(0));
+}
+
+TEST_CASE(SteadySlowFramesAreNotHitches)
+{
+	FrameTimeHistory history(64);
+	for (int i = 0; i < 50; i++)
+		history.Record(0.1);
+	CHECK(history.GetTotalHitchCount() == 0);
+}
+
+TEST_CASE(SpikesUnderTheMinimumAreNotHitches)
+{
+	// 1 ms to 5 ms is five times slower, but still far from a stutter
+	FrameTimeHistory history(64, 2.0, 8.0);
+	for (int i = 0; i < 20; i++)
+		history.Record(0.001);
+	history.Record(0.005);
+	CHECK(history.GetTotalHitchCount() == 0);
+}
+
+TEST_CASE(LastingSlowdownStopsBeingAHitch)
+{
+	// The baseline catches up with a new, slower frame rate
+	FrameTimeHistory history(256);
+	for (int i = 0; i < 30; i++)
+		history.Record(0.010);
+	for (int i = 0; i < 100; i++)
+		history.Record(0.030);
+	CHECK(history.GetTotalHitchCount() > 0);
+	CHECK(history.GetTotalHitchCount() < 30);
+	CHECK(!history.IsHitch(0));
+}
+
+TEST_CASE(HitchTotalsOutliveTheRing)
+{
+	FrameTimeHistory history(8);
+	for (int i = 0; i < 20; i++)
+		history.Record(0.016);
+	history.Record(0.100);
+	for (int i = 0; i < 20; i++)
+		history.Record(0.016);
+	CHECK(history.GetTotalHitchCount() == 1);
+	CHECK(history.Summarize().hitchCount == 0);
+}
+
+TEST_CASE(ClearForgetsEverything)
+{
+	FrameTimeHistory history(8);
+	for (int i = 0; i < 20; i++)
+		history.Record(0.016);
+	history.Record(0.100);
+	history.Clear();
+	CHECK(history.GetCount() == 0);
+	CHECK(history.GetTotalFrameCount() == 0);
+	CHECK(history.GetTotalHitchCount() == 0);
+
+	// No baseline left to compare against
+	history.Record(0.100);
+	CHECK(!history.IsHitch(0));
+}
+
+TEST_CASE(CsvListsHeldFramesOldestFirst)
+{
+	FrameTimeHistory history(4);
+	for (int i = 0; i < 20; i++)
+		history.Record(0.016);
+	history.Record(0.050);
+	history.Record(0.016);
+
+	std::ostringstream csv;
+	history.WriteCsv(csv);
+	CHECK(csv.str() ==
+		"frame,milliseconds,hitch\n"
+		"18,16,0\n"
+		"19,16,0\n"
+		"20,50,1\n"
+		"21,16,0\n");
+}
@@ -5,7 +5,13 @@
 #include "PathHelpers.h"
 #include "Window.h"
 #include "BufferStructs.h"
+#include "MatrixMath.h"
+#include "ProfilerView.h"
+#include "FrameTimeHistory.h"
+#include "ShaderLibrary.h"
 #include <DirectXMath.h>
+#include <thread>
+#include <algorithm>
 
 // This code assumes files are in "ImGui" subfolder!
 // Adjust as necessary for your own folder structure and project setup
@@ -27,39 +33,92 @@ using namespace DirectX;
 Game::Game()
 {
 	srand((unsigned int)time(0));
-	unsigned int vcbSize = sizeof(VertexShaderData);
-	vcbSize = (vcbSize + 15) / 16 * 16;
-
-	// Describe the constant buffer
-	D3D11_BUFFER_DESC vcbDesc = {}; // Sets struct to all zeros
-	vcbDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	vcbDesc.ByteWidth = vcbSize; // Must be a multiple of 16
-	vcbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	vcbDesc.Usage = D3D11_USAGE_DYNAMIC;
-	Graphics::Device->CreateBuffer(&vcbDesc, 0, vertexConstantBuffer.GetAddressOf());
-	Graphics::Context->VSSetConstantBuffers(
-		0, // Which slot (register) to bind the buffer to?
-		1, // How many are we setting right now?
-		vertexConstantBuffer.GetAddressOf()); // Array of buffers (or address of just one)
-	Graphics::Context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
-	unsigned int pcbSize = sizeof(PixelShaderData);
-	pcbSize = (pcbSize + 15) / 16 * 16;
-
-	D3D11_BUFFER_DESC pcbDesc = {};
-	pcbDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	pcbDesc.ByteWidth = pcbSize;
-	pcbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	pcbDesc.Usage = D3D11_USAGE_DYNAMIC;
-	Graphics::Device->CreateBuffer(&pcbDesc, 0, pixelConstantBuffer.GetAddressOf());
-	Graphics::Context->PSSetConstantBuffers(0, 1, pixelConstantBuffer.GetAddressOf());
-
-	MRed = std::make_shared<Material>(XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f), L"VertexShader.cso", L"PixelShader.cso");
-	MGreen = std::make_shared<Material>(XMFLOAT4(0.0f, 1.0f, 0.0f, 1.0f), L"VertexShader.cso", L"PixelShader.cso");
-	MBlue = std::make_shared<Material>(XMFLOAT4(0.0f, 0.0f, 1.0f, 1.0f), L"VertexShader.cso", L"PixelShader.cso");
+
+	// Worker threads for per-frame work - the main thread helps out
+	// whenever it waits, so leave one hardware thread for it
+	unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	CpuProfiler::Global().SetThreadName("Main");
+	jobSystem = std::make_shared<JobSystem>(hardwareThreads > 1 ? hardwareThreads - 1 : 0);
+	pipelinedSimulation = false;
+
+	// One deferred context per thread that can record draws
+	multithreadedRecording = false;
+	commandScheduler = CommandScheduler(jobSystem.get());
+	for (unsigned int i = 0; i < jobSystem->GetWorkerCount() + 1; i++)
+	{
+		deferredContexts.push_back(std::make_shared<DeferredDrawContext>(&frameRecordingState));
+	}
+
+	// Every per-draw constant buffer update for a frame is suballocated
+	// from this one ring, which grows if a frame ever overflows it,
+	// while the instances those draws cover share one StructuredBuffer
+	constantBufferRing = std::make_shared<ConstantBufferRing>(1024 * 1024);
+	instanceBuffer = std::make_shared<InstanceBuffer>();
+
+	// Camera matrices and time are shared by every draw, so they
+	// get their own buffer that is only written once per frame
+	D3D11_BUFFER_DESC frameDesc = {};
+	frameDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	frameDesc.ByteWidth = (sizeof(PerFrameData) + 15) / 16 * 16;
+	frameDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	frameDesc.Usage = D3D11_USAGE_DYNAMIC;
+	Graphics::Device->CreateBuffer(&frameDesc, 0, perFrameConstantBuffer.GetAddressOf());
+	bytesUploaded = 0;
+	droppedInstances = 0;
+	ringOverflowFrames = 0;
+	gpuProfiler = std::make_shared<GpuProfiler>();
+	profilerPaused = false;
+	frameTimeExportResult = 0;
+	traceFrameCount = 120;
+	traceFramesRemaining = 0;
+	traceResult = 0;
+
+	// Every permutation, precompiled into one mapped file by
+	// ShaderArchiveBuilder; without it the loose .cso files are used
+	ShaderLibrary::Global().OpenArchive(L"Shaders.shaderarchive");
+	LoadStartupAssets();
+
+	// The solid colors are all instances of one parent that owns the shaders
+	MSolid = std::make_shared<Material>(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), L"VertexShader.cso", L"PixelShader.cso");
+	MRed = std::make_shared<Material>(MSolid, XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f));
+	MGreen = std::make_shared<Material>(MSolid, XMFLOAT4(0.0f, 1.0f, 0.0f, 1.0f));
+	MBlue = std::make_shared<Material>(MSolid, XMFLOAT4(0.0f, 0.0f, 1.0f, 1.0f));
 	MDebugNormals = std::make_shared<Material>(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), L"VertexShader.cso", L"DebugNormalsPS.cso");
 	MDebugUVs = std::make_shared<Material>(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), L"VertexShader.cso", L"DebugUVsPS.cso");
 	MCustom = std::make_shared<Material>(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), L"VertexShader.cso", L"CustomPS.cso");
+	MCustom->SetFloat("tileCount", 4.0f);
+	MCustom->SetFloat2("scrollSpeed", XMFLOAT2(3.0f, 2.0f));
+	MLit = std::make_shared<Material>(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), L"VertexShader.cso", L"LitPS.cso");
+
+	materialList.push_back(MSolid);
+	materialList.push_back(MRed);
+	materialList.push_back(MGreen);
+	materialList.push_back(MBlue);
+	materialList.push_back(MDebugNormals);
+	materialList.push_back(MDebugUVs);
+	materialList.push_back(MCustom);
+	materialList.push_back(MLit);
+
+	// Watch the sources of every shader above, and the files they
+	// include (the debug shaders are PixelShader.hlsl with a define);
+	// they sit two folders above the executable, like the assets
+	shaderReloader = std::make_shared<ShaderReloader>(ShaderLibrary::CompileFromFile);
+	ShaderSource shaderSources[] =
+	{
+		{ FixPath("../../VertexShader.hlsl"), "main", "vs_5_0", L"VertexShader.cso" },
+		{ FixPath("../../PixelShader.hlsl"), "main", "ps_5_0", L"PixelShader.cso" },
+		{ FixPath("../../DebugNormalsPS.hlsl"), "main", "ps_5_0", L"DebugNormalsPS.cso" },
+		{ FixPath("../../DebugUVsPS.hlsl"), "main", "ps_5_0", L"DebugUVsPS.cso" },
+		{ FixPath("../../CustomPS.hlsl"), "main", "ps_5_0", L"CustomPS.cso" },
+		{ FixPath("../../LitPS.hlsl"), "main", "ps_5_0", L"LitPS.cso" },
+	};
+	for (ShaderSource& source : shaderSources)
+	{
+		source.includePaths = ShaderReloader::FindIncludes(source.sourcePath);
+		shaderReloader->Watch(source);
+	}
+	shaderHotReload = true;
+	shaderPollTimer = 0.0f;
 
 	// Initialize ImGui itself & platform/renderer backends
 	IMGUI_CHECKVERSION();
@@ -90,7 +149,19 @@ Game::Game()
 	demoVisible = false;
 	rainbowMode = false;
 	rainbowSpeed = 1.0f;
-	//shaderData.colorTint = XMFLOAT4{1.f,1.f,1.f,1.f};
+	frustumCulling = true;
+	scenePartitionType = 0;
+	occlusionCulling = true;
+	occluderCount = 0;
+	occludedEntityCount = 0;
+	selection = {};
+	selectionChanged = false;
+	useTriangleBVH = true;
+	visibleEntityCount = 0;
+
+	clusteredLighting = std::make_shared<ClusteredLighting>();
+	animateLights = true;
+	CreateLights(256);
 
 	CreateGeometry();
 }
@@ -104,6 +175,14 @@ Game::Game()
 // --------------------------------------------------------
 Game::~Game()
 {
+	// Let any in-flight simulation finish before tearing anything down
+	jobSystem->Wait(&simulationCounter);
+
+	// Cached shaders and states must go before the device does
+	PipelineStateCache::Global().Clear();
+	MaterialParameterBuffers::Global().Clear();
+	ShaderLibrary::Global().Clear();
+
 	// ImGui clean up
 	ImGui_ImplDX11_Shutdown();
 	ImGui_ImplWin32_Shutdown();
@@ -112,30 +191,100 @@ Game::~Game()
 
 
 // --------------------------------------------------------
-// Creates the geometry we're going to draw
+// Reads and creates every shader and mesh the scene starts
+// with, as a graph of jobs.  Device creation is free-threaded,
+// so they all overlap; materials made afterwards find their
+// shaders already waiting in the ShaderLibrary.
 // --------------------------------------------------------
-void Game::CreateGeometry()
+void Game::LoadStartupAssets()
 {
-	//Custom Meshes
+	PROFILE_SCOPE("Load Startup Assets");
+	startupTasks = std::make_shared<TaskGraph>();
+
+	const wchar_t* vertexShaders[] = { L"VertexShader.cso" };
+	for (const wchar_t* path : vertexShaders)
+	{
+		std::string name = WideToNarrow(path);
+		TaskGraph::TaskId read = startupTasks->Add(name, "Read Shader", [path]() { return ShaderLibrary::Global().GetBytecode(path) != nullptr; });
+		startupTasks->Add(name, "Create Shader", [path]() { return ShaderLibrary::Global().GetVertexShader(path) != nullptr; }, { read });
+		startupTasks->Add(name, "Input Layout", [path]() { return ShaderLibrary::Global().GetInputLayout(path) != nullptr; }, { read });
+	}
+
+	const wchar_t* pixelShaders[] = { L"PixelShader.cso", L"DebugNormalsPS.cso", L"DebugUVsPS.cso", L"CustomPS.cso", L"LitPS.cso" };
+	for (const wchar_t* path : pixelShaders)
+	{
+		std::string name = WideToNarrow(path);
+		TaskGraph::TaskId read = startupTasks->Add(name, "Read Shader", [path]() { return ShaderLibrary::Global().GetBytecode(path) != nullptr; });
+		startupTasks->Add(name, "Create Shader", [path]() { return ShaderLibrary::Global().GetPixelShader(path) != nullptr; }, { read });
+	}
+
+	// Parsing and buffer creation, one task per mesh, each
+	// writing only its own slot of the list
+	const char* meshFiles[] = { "sphere.obj", "quad.obj", "cylinder.obj", "helix.obj", "cube.obj", "torus.obj" };
+	meshList.resize(sizeof(meshFiles) / sizeof(meshFiles[0]));
+	for (size_t i = 0; i < meshList.size(); i++)
 	{
-		std::shared_ptr<Mesh> MSphere = std::make_shared<Mesh>(FixPath("../../Assets/Meshes/sphere.obj").c_str());
-		std::shared_ptr<Mesh> MQuad = std::make_shared<Mesh>(FixPath("../../Assets/Meshes/quad.obj").c_str());
-		std::shared_ptr<Mesh> MCylinder = std::make_shared<Mesh>(FixPath("../../Assets/Meshes/cylinder.obj").c_str());
-		std::shared_ptr<Mesh> MHelix = std::make_shared<Mesh>(FixPath("../../Assets/Meshes/helix.obj").c_str());
-		std::shared_ptr<Mesh> MCube = std::make_shared<Mesh>(FixPath("../../Assets/Meshes/cube.obj").c_str());
-		std::shared_ptr<Mesh> MTorus = std::make_shared<Mesh>(FixPath("../../Assets/Meshes/torus.obj").c_str());
+		std::string path = FixPath("../../Assets/Meshes/" + std::string(meshFiles[i]));
+		startupTasks->Add(meshFiles[i], "Mesh", [this, i, path]()
+		{
+			meshList[i] = std::make_shared<Mesh>(path.c_str());
+			return true;
+		});
+	}
+
+	if (startupTasks->Run(jobSystem.get()))
+		return;
+
+	// A missing mesh used to throw from here, so it still does
+	for (const TaskTiming& timing : startupTasks->GetTimings())
+	{
+		if (timing.status == TaskStatus::Failed && !timing.error.empty())
+			throw std::runtime_error(timing.name + ": " + timing.error);
+	}
+}
 
-		meshList.push_back(MSphere);
-		meshList.push_back(MQuad);
-		meshList.push_back(MCylinder);
-		meshList.push_back(MHelix);
-		meshList.push_back(MCube);
-		meshList.push_back(MTorus);
+// --------------------------------------------------------
+// Scatters a mix of colored point and spot lights through the
+// space in front of the rows of geometry
+// --------------------------------------------------------
+void Game::CreateLights(int count)
+{
+	lightCount = count;
+	lights.resize(count);
+	for (Light& light : lights)
+	{
+		light = {};
+		light.position = XMFLOAT3(-9.0f + rand() % 2000 / 100.0f, -8.0f + rand() % 1400 / 100.0f, 1.0f + rand() % 600 / 100.0f);
+		light.range = 1.5f + rand() % 300 / 100.0f;
+		light.color = XMFLOAT3(rand() % 100 / 100.0f, rand() % 100 / 100.0f, rand() % 100 / 100.0f);
+		light.intensity = 1.5f;
+		light.type = LightType::Point;
+		if (rand() % 4 == 0)
+		{
+			// Spots point back toward the geometry
+			light.type = LightType::Spot;
+			light.range *= 2.0f;
+			XMStoreFloat3(&light.direction, XMVector3Normalize(XMVectorSet(rand() % 100 / 50.0f - 1.0f, rand() % 100 / 50.0f - 1.0f, 1.0f, 0.0f)));
+			light.spotOuterCos = cosf(XMConvertToRadians(30.0f));
+			light.spotInnerCos = cosf(XMConvertToRadians(20.0f));
+		}
 	}
+}
 
+// --------------------------------------------------------
+// Creates the geometry we're going to draw
+// --------------------------------------------------------
+void Game::CreateGeometry()
+{
+	PROFILE_SCOPE("Create Geometry");
+
+	// The meshes themselves were loaded by LoadStartupAssets()
 	CreateRowOfGeometry(MDebugNormals, 3.f, -7.f, 5.f);
 	CreateRowOfGeometry(MDebugUVs, 0.f, -7.f, 5.f);
 	CreateRowOfGeometry(MCustom, -3.f, -7.f, 5.f);
+	CreateRowOfGeometry(MLit, -6.f, -7.f, 5.f);
+
+	BuildScenePartition();
 }
 
 void Game::NewFrame(float deltaTime)
@@ -161,41 +310,63 @@ void Game::NewFrame(float deltaTime)
 
 void Game::CreateRowOfGeometry(std::shared_ptr<Material> material, float y, float xOffset, float zOffset)
 {
+	// Mesh list order is sphere, quad, cylinder, helix, cube, torus
+	const MeshHandle rowMeshes[] = { 4, 2, 3, 0, 5, 1, 1 };
+	const char* rowNames[] = { "Cube", "Cylinder", "Helix", "Sphere", "Torus", "Quad", "Quad2" };
+
+	MaterialHandle materialHandle = GetMaterialHandle(material);
 	int randomID = rand() % 1000;
-	Actor cube = Actor(meshList[4], material, "Cube##" + std::to_string(randomID));
-	cube.GetTransform()->SetPosition(XMFLOAT3{ 0.f + xOffset, y, 0.f + zOffset });
-	cube.GetTransform()->SetRotation(0.f, XMConvertToRadians(90.f), 0.f);
-	actorList.push_back(std::make_shared<Actor>(cube));
-
-	Actor cylinder = Actor(meshList[2], material, "Cylinder##" + std::to_string(randomID));
-	cylinder.GetTransform()->SetPosition(XMFLOAT3{ 3.f + xOffset, y, 0.f + zOffset });
-	cylinder.GetTransform()->SetRotation(0.f, XMConvertToRadians(90.f), 0.f);
-	actorList.push_back(std::make_shared<Actor>(cylinder));
-
-	Actor helix = Actor(meshList[3], material, "Helix##" + std::to_string(randomID));
-	helix.GetTransform()->SetPosition(XMFLOAT3{ 6.f + xOffset, y, 0.f + zOffset });
-	helix.GetTransform()->SetRotation(0.f, XMConvertToRadians(90.f), 0.f);
-	actorList.push_back(std::make_shared<Actor>(helix));
-
-	Actor sphere = Actor(meshList[0], material, "Sphere##" + std::to_string(randomID));
-	sphere.GetTransform()->SetPosition(XMFLOAT3{ 9.f + xOffset, y, 0.f + zOffset });
-	sphere.GetTransform()->SetRotation(0.f, XMConvertToRadians(90.f), 0.f);
-	actorList.push_back(std::make_shared<Actor>(sphere));
-
-	Actor torus = Actor(meshList[5], material, "Torus##" + std::to_string(randomID));
-	torus.GetTransform()->SetPosition(XMFLOAT3{ 12.f + xOffset, y, 0.f + zOffset });
-	torus.GetTransform()->SetRotation(0.f, XMConvertToRadians(90.f), 0.f);
-	actorList.push_back(std::make_shared<Actor>(torus));
-
-	Actor quad = Actor(meshList[1], material, "Quad##" + std::to_string(randomID));
-	quad.GetTransform()->SetPosition(XMFLOAT3{ 15.f + xOffset, y, 0.f + zOffset });
-	quad.GetTransform()->SetRotation(0.f, XMConvertToRadians(90.f), 0.f);
-	actorList.push_back(std::make_shared<Actor>(quad));
-
-	Actor quad2 = Actor(meshList[1], material, "Quad2##" + std::to_string(randomID));
-	quad2.GetTransform()->SetPosition(XMFLOAT3{ 18.f + xOffset, y, 0.f + zOffset });
-	quad2.GetTransform()->SetRotation(0.f, XMConvertToRadians(90.f), 0.f);
-	actorList.push_back(std::make_shared<Actor>(quad2));
+	for (int i = 0; i < 7; i++)
+	{
+		Entity entity = entities.Create(rowMeshes[i], materialHandle, rowNames[i] + std::string("##") + std::to_string(randomID));
+		Transform* transform = entities.GetTransform(entity);
+		transform->SetPosition(XMFLOAT3{ 3.f * i + xOffset, y, 0.f + zOffset });
+		transform->SetRotation(0.f, XMConvertToRadians(90.f), 0.f);
+	}
+}
+
+// --------------------------------------------------------
+// Creates the scene partition picked in the UI and registers
+// every entity in it, by its stable index, at its current bounds
+// --------------------------------------------------------
+void Game::BuildScenePartition()
+{
+	if (scenePartitionType == 0)
+	{
+		scenePartition = std::make_shared<BoundingVolumeHierarchy>();
+	}
+	else
+	{
+		AABB world = { XMFLOAT3(-128.0f, -128.0f, -128.0f), XMFLOAT3(128.0f, 128.0f, 128.0f) };
+		scenePartition = std::make_shared<LooseOctree>(world);
+	}
+
+	std::vector<Transform>& transforms = entities.GetTransforms();
+	std::vector<MeshHandle>& meshes = entities.GetMeshes();
+	std::vector<Entity>& denseEntities = entities.GetEntities();
+	for (size_t i = 0; i < entities.Count(); i++)
+	{
+		unsigned int index = denseEntities[i].index;
+		if (index >= entityProxies.size())
+			entityProxies.resize(index + 1, SpatialPartition::NullProxy);
+
+		AABB bounds = Bounds::Transform(meshList[meshes[i]]->GetBounds(), transforms[i].GetWorldMatrix());
+		entityProxies[index] = scenePartition->Insert(bounds, index);
+	}
+
+	// Lets a BVH replace its insertion-order tree with an SAH build
+	scenePartition->Optimize();
+}
+
+MaterialHandle Game::GetMaterialHandle(std::shared_ptr<Material> material)
+{
+	for (size_t i = 0; i < materialList.size(); i++)
+	{
+		if (materialList[i] == material) return (MaterialHandle)i;
+	}
+
+	materialList.push_back(material);
+	return (MaterialHandle)(materialList.size() - 1);
 }
 
 
@@ -217,21 +388,66 @@ void Game::OnResize()
 // --------------------------------------------------------
 void Game::Update(float deltaTime, float totalTime)
 {
+	// Last frame's scopes are complete now
+	CaptureTraceFrame();
+
+	PROFILE_SCOPE("Update");
+
+	// A pipelined simulation from last frame may still be running,
+	// and it owns the entities until it finishes
+	{
+		PROFILE_SCOPE("Wait For Simulation");
+		jobSystem->Wait(&simulationCounter);
+	}
+
+	// Nothing is drawing now, so shaders can be swapped safely
+	UpdateShaderReload(deltaTime);
+
 	NewFrame(deltaTime);
-	for (std::shared_ptr<Actor> actor : actorList)
+
+	// Left click selects the actor under the cursor (Input ignores
+	// clicks ImGui captured), through the camera the frame was drawn with
+	if (Input::MouseLeftPress())
 	{
-		//actor->GetTransform()->SetPosition(sinf(totalTime) * 0.5f, actor->GetTransform()->GetPosition().y, actor->GetTransform()->GetPosition().z);
-		//actor->GetTransform()->Rotate(0.0f, 0.0f, deltaTime * 0.5f);
-		//actor->GetTransform()->SetScale(1.0f + 0.1f * sinf(totalTime * 2), 1.0f + 0.5f * sinf(totalTime), 1.0f);
+		PROFILE_SCOPE("Picking");
+		Ray ray = activeCamera->GetPickRay((float)Input::GetMouseX(), (float)Input::GetMouseY(), (float)Window::Width(), (float)Window::Height());
+		selection = Picking::PickEntity(ray, 1000.0f, *scenePartition, entities, meshList, useTriangleBVH);
+		selectionChanged = selection.hit;
 	}
 
 #pragma region UI
+	bool uiScope = CpuProfiler::Global().BeginScope("UI");
+
 	// Custom windows
 	ImGui::Begin("Details");
 	if(ImGui::TreeNode("App Details"))
 	{
 		ImGui::Text("Frame Rate: %.1f FPS", ImGui::GetIO().Framerate);
 		ImGui::Text("Window Size: %d x %d", Window::Width(), Window::Height());
+		ImGui::Text("Constant Data Uploaded: %u bytes/frame", bytesUploaded);
+		ImGui::Text("Constant Ring: %u KB, %u instances dropped (%u frames)",
+			constantBufferRing->GetSize() / 1024, droppedInstances, ringOverflowFrames);
+		ImGui::Text("Instance Buffer: %u instances", instanceBuffer->GetCapacity());
+
+		// Every recent frame, so single spikes stay visible
+		FrameTimeHistory& frameTimes = FrameTimeHistory::Global();
+		FrameTimeSummary summary = frameTimes.Summarize();
+		ImGui::PlotLines("##Frame Times", frameTimes.GetSamples(), (int)frameTimes.GetCount(), (int)frameTimes.GetOffset(),
+			"Frame Time (ms)", 0.0f, (float)summary.maxMilliseconds * 1.1f, ImVec2(0, 60));
+		ImGui::Text("Frame Time: p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms",
+			summary.p50Milliseconds, summary.p95Milliseconds, summary.p99Milliseconds, summary.maxMilliseconds);
+		ImGui::Text("Hitches: %d in the last %d frames (%llu total)",
+			(int)summary.hitchCount, (int)summary.frameCount, frameTimes.GetTotalHitchCount());
+		if (ImGui::Button("Export Frame Times"))
+			frameTimeExportResult = frameTimes.SaveCsv("FrameTimes.csv") ? 1 : -1;
+		ImGui::SameLine();
+		if (ImGui::Button("Reset"))
+			frameTimes.Clear();
+		if (frameTimeExportResult != 0)
+		{
+			ImGui::SameLine();
+			ImGui::Text(frameTimeExportResult > 0 ? "Saved FrameTimes.csv" : "Export failed");
+		}
 		ImGui::TreePop();
 	}
 	if (ImGui::TreeNode("Cameras"))
@@ -262,34 +478,40 @@ void Game::Update(float deltaTime, float totalTime)
 	}
 	if (ImGui::TreeNode("Actors"))
 	{
-		ImGui::Text("Actor Count: %d", actorList.size());
+		ImGui::Text("Actor Count: %d", (int)entities.Count());
+		std::vector<Transform>& transforms = entities.GetTransforms();
+		std::vector<MeshHandle>& meshes = entities.GetMeshes();
+		std::vector<std::string>& names = entities.GetNames();
 		// Use a counter to create unique labels for ImGui widgets in case they have the same name
 		int count = 0;
-		for (std::shared_ptr<Actor> actor : actorList)
+		for (size_t i = 0; i < entities.Count(); i++)
 		{
-			std::string label = actor->GetName().c_str() + std::to_string(count);
+			std::string label = names[i] + std::to_string(count);
+			if (selectionChanged && entities.GetDenseIndex(selection.entity) == i)
+				ImGui::SetNextItemOpen(true);
 			if (ImGui::TreeNode(label.c_str()))
 			{
-				XMFLOAT3 position = actor->GetTransform()->GetPosition();
-				XMFLOAT3 rotation = actor->GetTransform()->GetPitchYawRoll();
-				XMFLOAT3 scale = actor->GetTransform()->GetScale();
-				std::string posLabel = "Position##" + actor->GetName() + std::to_string(count);
-				std::string rotLabel = "Rotation##" + actor->GetName() + std::to_string(count);
-				std::string scaleLabel = "Scale##" + actor->GetName() + std::to_string(count);
+				Transform& transform = transforms[i];
+				XMFLOAT3 position = transform.GetPosition();
+				XMFLOAT3 rotation = transform.GetPitchYawRoll();
+				XMFLOAT3 scale = transform.GetScale();
+				std::string posLabel = "Position##" + names[i] + std::to_string(count);
+				std::string rotLabel = "Rotation##" + names[i] + std::to_string(count);
+				std::string scaleLabel = "Scale##" + names[i] + std::to_string(count);
 
-				ImGui::Text("Mesh: %s", actor->GetMesh()->GetName().c_str());
+				ImGui::Text("Mesh: %s", meshList[meshes[i]]->GetName().c_str());
 
 				if (ImGui::DragFloat3(posLabel.c_str(), (float*)&position, 0.01f))
 				{
-					actor->GetTransform()->SetPosition(position);
+					transform.SetPosition(position);
 				}
 				if (ImGui::DragFloat3(rotLabel.c_str(), (float*)&rotation, 0.01f))
 				{
-					actor->GetTransform()->SetRotation(rotation);
+					transform.SetRotation(rotation);
 				}
 				if (ImGui::DragFloat3(scaleLabel.c_str(), (float*)&scale, 0.01f))
 				{
-					actor->GetTransform()->SetScale(scale);
+					transform.SetScale(scale);
 				}
 				count++;
 				ImGui::TreePop();
@@ -297,15 +519,203 @@ void Game::Update(float deltaTime, float totalTime)
 		}
 		ImGui::TreePop();
 	}
+	if (ImGui::TreeNode("Picking"))
+	{
+		ImGui::Checkbox("Use Triangle BVH", &useTriangleBVH);
+		if (selection.hit && entities.IsAlive(selection.entity))
+		{
+			// Names carry an ImGui ID suffix
+			std::string name = entities.GetName(selection.entity);
+			ImGui::Text("Selected: %s", name.substr(0, name.find("##")).c_str());
+			ImGui::Text("Triangle: %u", selection.triangle);
+			ImGui::Text("Distance: %.2f", selection.distance);
+			ImGui::Text("Hit Point: (%.2f, %.2f, %.2f)", selection.position.x, selection.position.y, selection.position.z);
+		}
+		else
+		{
+			ImGui::Text("Left click an actor to select it");
+		}
+		ImGui::TreePop();
+	}
+	if (ImGui::TreeNode("Profiler"))
+	{
+		CpuProfiler& profiler = CpuProfiler::Global();
+		bool profilingEnabled = profiler.IsEnabled();
+		if (ImGui::Checkbox("Enabled", &profilingEnabled))
+			profiler.SetEnabled(profilingEnabled);
+		ImGui::SameLine();
+		if (ImGui::Checkbox("Pause", &profilerPaused) && profilerPaused)
+			pausedProfileFrame = profiler.GetLastFrame();
+
+		ProfilerView::DrawTimeline(profilerPaused ? pausedProfileFrame : profiler.GetLastFrame(), profiler.GetThreadNames(), gpuProfiler.get());
+		ImGui::Text("Dropped Scopes: %llu", profiler.GetDroppedEventCount());
+
+		// Writes the next few frames for chrome://tracing or Perfetto
+		if (traceFramesRemaining > 0)
+		{
+			ImGui::Text("Capturing Trace.json: %d frames left", traceFramesRemaining);
+		}
+		else
+		{
+			ImGui::SliderInt("Trace Frames", &traceFrameCount, 1, 600);
+			if (ImGui::Button("Capture Trace"))
+				BeginTraceCapture("Trace.json", traceFrameCount);
+			if (traceResult != 0)
+			{
+				ImGui::SameLine();
+				ImGui::Text(traceResult > 0 ? "Saved Trace.json" : "Trace capture failed");
+			}
+		}
+		if (ImGui::TreeNode("Pipeline Statistics"))
+		{
+			ProfilerView::DrawPipelineStatistics(*gpuProfiler);
+			ImGui::TreePop();
+		}
+		ImGui::TreePop();
+	}
+	if (ImGui::TreeNode("Startup"))
+	{
+		ImGui::Text("Assets: %.2f ms (%.2f ms of work, %.2f ms critical path)",
+			startupTasks->GetWallMilliseconds(), startupTasks->GetTotalTaskMilliseconds(), startupTasks->GetCriticalPathMilliseconds());
+		for (const TaskTiming& timing : startupTasks->GetTimings())
+		{
+			const char* status = timing.status == TaskStatus::Failed ? " (failed)" : timing.status == TaskStatus::Skipped ? " (skipped)" : "";
+			ImGui::Text("%-20s %-14s %7.2f ms at %7.2f ms%s", timing.name.c_str(), timing.category.c_str(),
+				timing.durationMilliseconds, timing.startMilliseconds, status);
+		}
+		ImGui::TreePop();
+	}
+	if (ImGui::TreeNode("Shaders"))
+	{
+		ShaderLibraryStats shaderStats = ShaderLibrary::Global().GetStats();
+		ImGui::Text("Shaders: %d created, %d input layouts, %d cbuffers reflected", shaderStats.shadersCreated, shaderStats.inputLayoutsCreated, shaderStats.layoutsReflected);
+		ImGui::Text("Requests: %d (%d cache hits)", shaderStats.requests, shaderStats.cacheHits);
+		ImGui::Text("Files Read: %d (%llu bytes)", shaderStats.filesRead, shaderStats.bytesRead);
+		ImGui::Text("Archive: %zu shaders, %d loaded from it, %d stale", ShaderLibrary::Global().GetArchiveShaderCount(), shaderStats.archiveLoads, shaderStats.archiveStale);
+
+		ImGui::Checkbox("Hot Reload", &shaderHotReload);
+		if (shaderReloader->IsCompiling())
+		{
+			ImGui::SameLine();
+			ImGui::Text("(compiling...)");
+		}
+		ImGui::Text("Reloads: %u, Failed: %u", shaderReloader->GetReloadCount(), shaderReloader->GetFailureCount());
+		std::string shaderError = shaderReloader->GetLastError();
+		if (!shaderError.empty())
+			ImGui::TextWrapped("%s", shaderError.c_str());
+		ImGui::TreePop();
+	}
+	if (ImGui::TreeNode("Lights"))
+	{
+		if (ImGui::SliderInt("Count", &lightCount, 0, 1024))
+			CreateLights(lightCount);
+		ImGui::Checkbox("Animate", &animateLights);
+
+		const LightClusterGrid& grid = clusteredLighting->GetGrid();
+		const LightClusterStats& lightStats = grid.GetStats();
+		ImGui::Text("Clusters: %u x %u tiles, %u slices", grid.GetTilesX(), grid.GetTilesY(), grid.GetSlices());
+		ImGui::Text("Visible Lights: %u of %d", lightStats.visibleLights, lightCount);
+		ImGui::Text("Occupied Clusters: %u of %u", lightStats.occupiedClusters, grid.GetClusterCount());
+		ImGui::Text("Light Indices: %u (at most %u in one cluster)", lightStats.indexCount, lightStats.maxLightsPerCluster);
+		ImGui::TreePop();
+	}
+	if (ImGui::TreeNode("Materials"))
+	{
+		PipelineStateCacheStats pipelineStats = PipelineStateCache::Global().GetStats();
+		ImGui::Text("Pipeline States: %d (%d state objects, %d released)", (int)PipelineStateCache::Global().GetPipelineStateCount(), pipelineStats.stateObjectsCreated, pipelineStats.pipelineStatesReleased);
+		ImGui::Text("Requests: %d (%d cache hits)", pipelineStats.requests, pipelineStats.cacheHits);
+		MaterialParameterBufferStats tableStats = MaterialParameterBuffers::Global().GetStats();
+		ImGui::Text("Material Tables: %u (%u materials in %u records, %u bytes uploaded)",
+			tableStats.tables, tableStats.liveMaterials, tableStats.records, tableStats.bytesUploaded);
+		for (size_t i = 0; i < materialList.size(); i++)
+		{
+			std::string label = "Material " + std::to_string(i);
+			if (ImGui::TreeNode(label.c_str()))
+			{
+				std::shared_ptr<const PipelineState> pipelineState = materialList[i]->GetPipelineState();
+				ImGui::Text("Pipeline State: %016llx", pipelineState ? pipelineState->GetHash() : 0ull);
+				if (materialList[i]->GetParameterTable())
+					ImGui::Text("Material ID: %u", materialList[i]->GetMaterialId());
+				std::shared_ptr<Material> parent = materialList[i]->GetParent();
+				if (parent)
+				{
+					const ParameterOverrides& overrides = materialList[i]->GetOverrides();
+					int parentIndex = (int)(std::find(materialList.begin(), materialList.end(), parent) - materialList.begin());
+					ImGui::Text("Instance of Material %d: %d overrides (%d bytes)", parentIndex,
+						(int)overrides.GetCount(), (int)overrides.GetByteCount());
+					if (overrides.GetCount() > 0 && ImGui::Button("Clear Overrides"))
+						materialList[i]->ClearOverrides();
+				}
+
+				// Every float parameter the pixel shader declares, by name
+				const ParameterBlock& parameters = materialList[i]->GetParameters();
+				std::shared_ptr<const ConstantBufferLayout> layout = parameters.GetLayout();
+				if (layout)
+				{
+					ImGui::Text("%s: %u bytes in b%u", layout->GetName().c_str(), layout->GetSize(), materialList[i]->GetParameterSlot());
+					for (const ShaderParameter& parameter : layout->GetParameters())
+					{
+						const ShaderParameterDesc& desc = parameter.desc;
+						if (desc.type != ShaderParameterType::Float || desc.rows != 1 || desc.elements != 0)
+							continue;
+
+						float values[4] = {};
+						parameters.Get(desc.name, values, desc.columns * sizeof(float));
+						bool edited = desc.name == "colorTint" && desc.columns == 4 ?
+							ImGui::ColorEdit4(desc.name.c_str(), values) :
+							ImGui::DragScalarN(desc.name.c_str(), ImGuiDataType_Float, values, desc.columns, 0.01f);
+						if (!edited)
+							continue;
+						switch (desc.columns)
+						{
+						case 1: materialList[i]->SetFloat(desc.name, values[0]); break;
+						case 2: materialList[i]->SetFloat2(desc.name, XMFLOAT2(values)); break;
+						case 3: materialList[i]->SetFloat3(desc.name, XMFLOAT3(values)); break;
+						case 4: materialList[i]->SetFloat4(desc.name, XMFLOAT4(values)); break;
+						}
+					}
+				}
+
+				// Instances draw with their parent's state
+				if (parent)
+				{
+					ImGui::TreePop();
+					continue;
+				}
+
+				FixedFunctionState state = materialList[i]->GetFixedFunctionState();
+				int fill = (int)state.fill;
+				int cull = (int)state.cull;
+				int blend = (int)state.blend;
+				int depth = (int)state.depth;
+				bool changed = false;
+				changed |= ImGui::Combo("Fill", &fill, "Solid\0Wireframe\0");
+				changed |= ImGui::Combo("Cull", &cull, "None\0Front\0Back\0");
+				changed |= ImGui::Combo("Blend", &blend, "Opaque\0Alpha Blend\0Additive\0");
+				changed |= ImGui::Combo("Depth", &depth, "Read/Write\0Read Only\0Disabled\0");
+				if (changed)
+				{
+					state.fill = (FillMode)fill;
+					state.cull = (CullMode)cull;
+					state.blend = (BlendMode)blend;
+					state.depth = (DepthMode)depth;
+					materialList[i]->SetFixedFunctionState(state);
+				}
+				ImGui::TreePop();
+			}
+		}
+		ImGui::TreePop();
+	}
 	if (ImGui::TreeNode("Meshes"))
 	{
 		for (int i = 0; i < meshList.size(); i++)
 		{
-			if (ImGui::TreeNode("Mesh: Sphere"))
+			std::string label = "Mesh: " + meshList[i]->GetName() + "##" + std::to_string(i);
+			if (ImGui::TreeNode(label.c_str()))
 			{
-				ImGui::Text("Triangles: %d", ASphere.GetMesh()->GetTriangleCount());
-				ImGui::Text("Vertices: %d", ASphere.GetMesh()->GetVertexCount());
-				ImGui::Text("Indices: %d", ASphere.GetMesh()->GetIndexCount());
+				ImGui::Text("Triangles: %d", meshList[i]->GetTriangleCount());
+				ImGui::Text("Vertices: %d", meshList[i]->GetVertexCount());
+				ImGui::Text("Indices: %d", meshList[i]->GetIndexCount());
 				ImGui::TreePop();
 			}
 		}
@@ -313,6 +723,26 @@ void Game::Update(float deltaTime, float totalTime)
 	}
 	if(ImGui::TreeNode("Customization"))
 	{
+		ImGui::Checkbox("Pipelined Simulation", &pipelinedSimulation);
+		ImGui::Checkbox("Frustum Culling", &frustumCulling);
+		ImGui::Checkbox("Occlusion Culling", &occlusionCulling);
+		ImGui::Text("Visible Actors: %d / %d", (int)visibleEntityCount, (int)entities.Count());
+		ImGui::Text("Draw Calls: %d", (int)drawList.size());
+		if (occlusionCulling)
+		{
+			ImGui::Text("Occluders: %d (%d triangles), %d actors hidden", (int)occluderCount,
+				(int)occlusionCuller.GetRasterizedTriangleCount(), (int)occludedEntityCount);
+		}
+		if (ImGui::Combo("Scene Partition", &scenePartitionType, "Dynamic BVH\0Loose Octree\0"))
+		{
+			BuildScenePartition();
+		}
+		ImGui::Checkbox("Multithreaded Recording", &multithreadedRecording);
+		if (multithreadedRecording)
+		{
+			ImGui::Text("Recording Partitions: %d", (int)commandScheduler.GetLastPartitionCount());
+			ImGui::Text("Job Workers: %u (%llu steals)", jobSystem->GetWorkerCount(), jobSystem->GetStealCount());
+		}
 		ImGui::Checkbox("Rainbow Mode", &rainbowMode);
 		if (rainbowMode) 
 		{
@@ -328,7 +758,6 @@ void Game::Update(float deltaTime, float totalTime)
 		{
 			ImGui::ColorEdit4("Background Color", backgroundColor);
 		}
-		//ImGui::ColorEdit4("Tint Color", (float*)&shaderData.colorTint);
 		ImGui::TreePop();
 	}
 	if (ImGui::Button("Toggle Demo Window"))
@@ -337,58 +766,446 @@ void Game::Update(float deltaTime, float totalTime)
 	}
 
 	ImGui::End();
+	selectionChanged = false;
+
+	if (uiScope)
+		CpuProfiler::Global().EndScope();
 #pragma endregion
 
 	activeCamera->Update(deltaTime);
 
+	// Capture what the simulation needs from objects the main thread owns
+	XMFLOAT4X4 view = activeCamera->GetViewMatrix();
+	XMFLOAT4X4 projection = activeCamera->GetProjectionMatrix();
+	XMFLOAT4X4 viewProjection = activeCamera->GetViewProjectionMatrix();
+
+	auto simulate = [this, deltaTime, totalTime, view, projection, viewProjection]()
+	{
+		FrameSnapshot& snapshot = frameExchange.BeginWrite();
+		snapshot.frameNumber = frameExchange.GetPublishedFrameCount() + 1;
+		snapshot.totalTime = totalTime;
+		snapshot.view = view;
+		snapshot.projection = projection;
+		snapshot.viewProjection = viewProjection;
+		Simulate(snapshot, deltaTime, totalTime);
+		frameExchange.Publish();
+	};
+
+	// Pipelined, this frame's simulation overlaps the draw of the last one
+	if (pipelinedSimulation)
+		jobSystem->Run(simulate, &simulationCounter);
+	else
+		simulate();
+
 	// Example input checking: Quit if the escape key is pressed
 	if (Input::KeyDown(VK_ESCAPE))
 		Window::Quit();
 }
 
 
+// --------------------------------------------------------
+// Advances every entity and writes its world and 
+// world-view-projection matrix into the snapshot, spread 
+// across the job system, then updates the scene partition
+// and culls whatever the camera can't see
+// 
+// Note: This may run on a worker thread while the previous
+//       frame is drawn, so it only touches entity data
+// --------------------------------------------------------
+void Game::Simulate(FrameSnapshot& snapshot, float deltaTime, float totalTime)
+{
+	PROFILE_SCOPE("Simulate");
+	size_t entityCount = entities.Count();
+	std::vector<Transform>& transforms = entities.GetTransforms();
+	snapshot.worldMatrices.resize(entityCount);
+	snapshot.wvpMatrices.resize(entityCount);
+	snapshot.meshes = entities.GetMeshes();
+	snapshot.materials = entities.GetMaterials();
+	std::vector<MeshHandle>& meshes = entities.GetMeshes();
+	entityBounds.resize(entityCount);
+
+	XMFLOAT4X4 viewProjection = snapshot.viewProjection;
+	jobSystem->ParallelFor(entityCount, 256, [&](size_t first, size_t last)
+	{
+		PROFILE_SCOPE("World Matrices");
+		for (size_t i = first; i < last; i++)
+		{
+			//transforms[i].SetPosition(sinf(totalTime) * 0.5f, transforms[i].GetPosition().y, transforms[i].GetPosition().z);
+			//transforms[i].Rotate(0.0f, 0.0f, deltaTime * 0.5f);
+			//transforms[i].SetScale(1.0f + 0.1f * sinf(totalTime * 2), 1.0f + 0.5f * sinf(totalTime), 1.0f);
+			snapshot.worldMatrices[i] = transforms[i].GetWorldMatrix();
+			entityBounds[i] = Bounds::Transform(meshList[meshes[i]]->GetBounds(), snapshot.worldMatrices[i]);
+		}
+		MatrixMath::ComposeWorldViewProjection(&snapshot.worldMatrices[first], &snapshot.wvpMatrices[first], last - first, viewProjection);
+	});
+
+	// Partition updates are serial, but most entities don't change
+	// the structure unless they move a fair distance
+	{
+		PROFILE_SCOPE("Partition Update");
+		std::vector<Entity>& denseEntities = entities.GetEntities();
+		bool partitionChanged = false;
+		for (size_t i = 0; i < entityCount; i++)
+		{
+			partitionChanged |= scenePartition->Update(entityProxies[denseEntities[i].index], entityBounds[i]);
+		}
+		if (partitionChanged)
+			scenePartition->Optimize();
+	}
+
+	std::vector<unsigned int>& visible = snapshot.visibleEntities;
+	visible.clear();
+	if (frustumCulling)
+	{
+		PROFILE_SCOPE("Frustum Culling");
+		scenePartition->QueryFrustum(Bounds::FrustumFromMatrix(viewProjection), visible);
+		for (unsigned int& index : visible)
+		{
+			index = entities.GetDenseIndex(index);
+		}
+
+		// Back into dense order, which keeps draws grouped by material
+		std::sort(visible.begin(), visible.end());
+	}
+	else
+	{
+		for (size_t i = 0; i < entityCount; i++)
+		{
+			visible.push_back((unsigned int)i);
+		}
+	}
+
+	if (occlusionCulling)
+		CullOccludedEntities(snapshot);
+}
+
+// --------------------------------------------------------
+// Checks the watched shader sources a few times a second and
+// swaps any freshly compiled shaders into the materials using
+// them; a failed compile leaves the old shader in place
+// --------------------------------------------------------
+void Game::UpdateShaderReload(float deltaTime)
+{
+	if (!shaderHotReload)
+		return;
+
+	shaderPollTimer += deltaTime;
+	if (shaderPollTimer >= 0.25f)
+	{
+		shaderPollTimer = 0.0f;
+		shaderReloader->Poll();
+	}
+
+	shaderReloader->ApplyCompleted([this](const ShaderSource& source, const std::vector<unsigned char>& bytecode)
+	{
+		bool vertexShader = source.target.compare(0, 3, "vs_") == 0;
+		if (!ShaderLibrary::Global().Reload(source.shaderKey, bytecode, vertexShader))
+			return false;
+
+		for (std::shared_ptr<Material>& material : materialList)
+		{
+			if (material->UsesShaderFile(source.shaderKey))
+				material->ReloadShaders();
+		}
+
+		// The states built on the replaced shaders are the last
+		// thing keeping them alive
+		PipelineStateCache::Global().ReleaseUnused();
+		return true;
+	});
+}
+
+// --------------------------------------------------------
+// Starts streaming the next frameCount profiled frames to a
+// Chrome trace file, including any scopes (like startup)
+// recorded before the first of them
+// --------------------------------------------------------
+bool Game::BeginTraceCapture(const char* path, int frameCount)
+{
+	if (frameCount <= 0 || !traceWriter.Open(path))
+	{
+		traceResult = -1;
+		return false;
+	}
+
+	traceFramesRemaining = frameCount;
+	return true;
+}
+
+void Game::CaptureTraceFrame()
+{
+	const ProfileFrame& frame = CpuProfiler::Global().GetLastFrame();
+	if (traceFramesRemaining <= 0 || frame.frameNumber == 0)
+		return;
+
+	traceWriter.WriteFrame(frame);
+	if (--traceFramesRemaining == 0)
+		traceResult = traceWriter.Close(CpuProfiler::Global().GetThreadNames()) ? 1 : -1;
+}
+
+// --------------------------------------------------------
+// Rasterizes the biggest visible entities into the software
+// depth buffer, then drops every visible entity whose bounds
+// are completely hidden behind them
+// --------------------------------------------------------
+void Game::CullOccludedEntities(FrameSnapshot& snapshot)
+{
+	PROFILE_SCOPE("Occlusion Culling");
+	const float MinOccluderScreenArea = 0.01f;
+	const size_t MaxOccluders = 16;
+	const size_t MaxOccluderTriangles = 16384;
+
+	std::vector<unsigned int>& visible = snapshot.visibleEntities;
+	std::vector<MeshHandle>& meshes = entities.GetMeshes();
+	occlusionCuller.BeginFrame(snapshot.viewProjection);
+
+	// The biggest things on screen make the best occluders
+	std::vector<std::pair<float, unsigned int>> candidates;
+	for (unsigned int i : visible)
+	{
+		float area = occlusionCuller.EstimateScreenArea(entityBounds[i]);
+		if (area >= MinOccluderScreenArea)
+			candidates.push_back(std::make_pair(area, i));
+	}
+	std::sort(candidates.begin(), candidates.end(),
+		[](const std::pair<float, unsigned int>& a, const std::pair<float, unsigned int>& b) { return a.first > b.first; });
+
+	occluderCount = 0;
+	size_t occluderTriangles = 0;
+	for (const std::pair<float, unsigned int>& candidate : candidates)
+	{
+		Mesh* mesh = meshList[meshes[candidate.second]].get();
+		if (occluderCount == MaxOccluders)
+			break;
+		if (mesh->GetVertices().empty() || occluderTriangles + mesh->GetTriangleCount() > MaxOccluderTriangles)
+			continue;
+
+		const std::vector<unsigned int>& indices = mesh->GetIndices();
+		occlusionCuller.RasterizeOccluder(&mesh->GetVertices()[0].Position, sizeof(Vertex),
+			indices.data(), indices.size(), snapshot.worldMatrices[candidate.second]);
+		occluderTriangles += mesh->GetTriangleCount();
+		occluderCount++;
+	}
+	occlusionCuller.FinishOccluders();
+
+	// Keep whatever can still be seen around or past the occluders
+	size_t kept = 0;
+	for (unsigned int i : visible)
+	{
+		if (occlusionCuller.IsVisible(entityBounds[i]))
+			visible[kept++] = i;
+	}
+	occludedEntityCount = visible.size() - kept;
+	visible.resize(kept);
+}
+
+
 // --------------------------------------------------------
 // Clear the screen, redraw everything, present to the user
 // --------------------------------------------------------
 void Game::Draw(float deltaTime, float totalTime)
 {
+	PROFILE_SCOPE("Draw");
+	gpuProfiler->BeginFrame();
+
 	// Frame START
 	// - These things should happen ONCE PER FRAME
 	// - At the beginning of Game::Draw() before drawing *anything*
 	{
 		// Clear the back buffer (erase what's on screen) and depth buffer
+		gpuProfiler->BeginScope("Clear");
 		Graphics::Context->ClearRenderTargetView(Graphics::BackBufferRTV.Get(),	backgroundColor);
 		Graphics::Context->ClearDepthStencilView(Graphics::DepthBufferDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+		gpuProfiler->EndScope();
 	}
 	
 
-	for(std::shared_ptr<Actor> actor : actorList)
-	{
-		VertexShaderData vsData = {};
-		vsData.matrix = actor->GetTransform()->GetWorldMatrix();
-		vsData.view = activeCamera->GetViewMatrix();
-		vsData.projection = activeCamera->GetProjectionMatrix();
+	bytesUploaded = 0;
 
-		PixelShaderData psData = {};
-		psData.colorTint = actor->GetMaterial()->GetColorTint();
-		psData.time = totalTime;
+	// Draw the newest finished simulation, which is never the one being written
+	const FrameSnapshot& snapshot = frameExchange.AcquireRead();
+	gpuProfiler->BeginScope("Scene");
+
+	// Per-frame data: camera and time, written once for every draw to share
+	{
+		PerFrameData frameData = {};
+		frameData.view = snapshot.view;
+		frameData.projection = snapshot.projection;
+		frameData.viewProjection = snapshot.viewProjection;
+		frameData.time = snapshot.totalTime;
 
 		D3D11_MAPPED_SUBRESOURCE mappedBuffer = {};
-		Graphics::Context->Map(vertexConstantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedBuffer);
-		memcpy(mappedBuffer.pData, &vsData, sizeof(vsData));
-		Graphics::Context->Unmap(vertexConstantBuffer.Get(), 0);
+		Graphics::Context->Map(perFrameConstantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedBuffer);
+		memcpy(mappedBuffer.pData, &frameData, sizeof(frameData));
+		Graphics::Context->Unmap(perFrameConstantBuffer.Get(), 0);
+		bytesUploaded += sizeof(frameData);
 
-		Graphics::Context->Map(pixelConstantBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedBuffer);
-		memcpy(mappedBuffer.pData, &psData, sizeof(psData));
-		Graphics::Context->Unmap(pixelConstantBuffer.Get(), 0);
+		Graphics::Context->VSSetConstantBuffers(0, 1, perFrameConstantBuffer.GetAddressOf());
+		Graphics::Context->PSSetConstantBuffers(0, 1, perFrameConstantBuffer.GetAddressOf());
+	}
 
-		actor->Draw();
+	// Lights: moved along their orbits, then culled into the
+	// camera's clusters and uploaded for LitPS to read
+	{
+		frameLights = lights;
+		if (animateLights)
+		{
+			for (size_t i = 0; i < frameLights.size(); i++)
+			{
+				float angle = snapshot.totalTime * (0.5f + 0.1f * (i % 5)) + i * 2.4f;
+				frameLights[i].position.x += cosf(angle) * 1.5f;
+				frameLights[i].position.y += sinf(angle * 0.7f) * 0.75f;
+				frameLights[i].position.z += sinf(angle) * 1.5f;
+			}
+		}
+		bytesUploaded += clusteredLighting->Update(Graphics::Context.Get(), frameLights, snapshot.view, snapshot.projection,
+			(float)Window::Width(), (float)Window::Height());
+		clusteredLighting->Bind(Graphics::Context.Get());
+	}
+
+	// Per-material data: each material's parameter block is only
+	// re-sent when something in it changed
+	for (size_t i = 0; i < materialList.size(); i++)
+	{
+		bytesUploaded += materialList[i]->UploadConstants();
+	}
+
+	// Table materials only wrote their records above; send
+	// whatever changed in each table in one go
+	bytesUploaded += MaterialParameterBuffers::Global().Upload(Graphics::Context.Get());
+
+	// Instances share their parent's pipeline state, so ordering the
+	// materials by state and then by parameter buffer turns every
+	// instance of a parent into one batch with a single state change.
+	// Table materials have no buffer of their own, so every one with
+	// the same state lands in the same batch.
+	materialOrder.resize(materialList.size());
+	for (size_t i = 0; i < materialList.size(); i++)
+	{
+		materialOrder[i] = (unsigned int)i;
+	}
+	auto batchOrder = [this](unsigned int a, unsigned int b)
+		{
+			const PipelineState* stateA = materialList[a]->GetPipelineState().get();
+			const PipelineState* stateB = materialList[b]->GetPipelineState().get();
+			if (stateA != stateB)
+				return stateA < stateB;
+			return materialList[a]->GetConstantBuffer().Get() < materialList[b]->GetConstantBuffer().Get();
+		};
+	std::sort(materialOrder.begin(), materialOrder.end(), batchOrder);
+	materialBatches.resize(materialList.size());
+	for (size_t i = 0, batch = 0; i < materialOrder.size(); i++)
+	{
+		if (i > 0 && batchOrder(materialOrder[i - 1], materialOrder[i]))
+			batch++;
+		materialBatches[materialOrder[i]] = (unsigned int)batch;
+	}
+
+	// Gather the visible entities, sorted so that ones which can be
+	// drawn together sit next to each other
+	const std::vector<unsigned int>& visible = snapshot.visibleEntities;
+	const std::vector<MeshHandle>& meshes = snapshot.meshes;
+	const std::vector<MaterialHandle>& materials = snapshot.materials;
+	visibleEntityCount = visible.size();
+	drawInstances.clear();
+	for (unsigned int i : visible)
+	{
+		// Raw pointers here - the lists own them and outlive the frame
+		DrawInstance instance = {};
+		instance.material = materialList[materials[i]].get();
+		instance.mesh = meshList[meshes[i]].get();
+		instance.entity = i;
+		instance.sortKey = ((unsigned long long)materialBatches[materials[i]] << 32) | meshes[i];
+		drawInstances.push_back(instance);
+	}
+	std::sort(drawInstances.begin(), drawInstances.end(), [](const DrawInstance& a, const DrawInstance& b) { return a.sortKey < b.sortKey; });
+
+	// Per-instance data: each run of equal keys becomes one instanced
+	// draw, its matrices (built in Simulate) and material IDs placed
+	// one after another in the instance buffer.  Each draw only puts
+	// where its instances start into the ring.
+	constantBufferRing->BeginFrame();
+	drawList.clear();
+	instanceData.clear();
+	droppedInstances = 0;
+	for (size_t first = 0, end = 0; first < drawInstances.size(); first = end)
+	{
+		end = first + 1;
+		while (end < drawInstances.size() && end - first < MaxInstancesPerDraw && drawInstances[end].sortKey == drawInstances[first].sortKey)
+			end++;
+
+		DrawItem item = {};
+		item.material = drawInstances[first].material;
+		item.mesh = drawInstances[first].mesh;
+		item.instanceCount = (unsigned int)(end - first);
+		PerDrawData drawData = {};
+		drawData.firstInstance = (unsigned int)instanceData.size();
+		if (!constantBufferRing->Allocate(&drawData, sizeof(drawData), &item.drawSlice))
+		{
+			// The ring grows next frame, until then these just aren't drawn
+			droppedInstances += item.instanceCount;
+			continue;
+		}
+
+		for (size_t d = first; d < end; d++)
+		{
+			PerInstanceData data = {};
+			data.world = snapshot.worldMatrices[drawInstances[d].entity];
+			data.worldViewProjection = snapshot.wvpMatrices[drawInstances[d].entity];
+			data.materialId = drawInstances[d].material->GetMaterialId();
+			instanceData.push_back(data);
+		}
+		bytesUploaded += sizeof(drawData);
+		drawList.push_back(item);
+	}
+	constantBufferRing->FinishWrites();
+	if (droppedInstances > 0)
+		ringOverflowFrames++;
+	bytesUploaded += instanceBuffer->Upload(Graphics::Context.Get(), instanceData.data(), (unsigned int)instanceData.size());
+	instanceBuffer->Bind(Graphics::Context.Get());
+
+	if (multithreadedRecording)
+	{
+		PROFILE_SCOPE("Draw Submission");
+
+		// Record partitions of the draw list on worker threads
+		frameRecordingState.drawList = &drawList;
+		frameRecordingState.constantBufferRing = constantBufferRing.get();
+		frameRecordingState.instanceBuffer = instanceBuffer.get();
+		frameRecordingState.perFrameConstantBuffer = perFrameConstantBuffer.Get();
+		frameRecordingState.lighting = clusteredLighting.get();
+		frameRecordingState.renderTarget = Graphics::BackBufferRTV.Get();
+		frameRecordingState.depthBuffer = Graphics::DepthBufferDSV.Get();
+		unsigned int viewportCount = 1;
+		Graphics::Context->RSGetViewports(&viewportCount, &frameRecordingState.viewport);
+
+		std::vector<CommandContext*> contexts;
+		for (const std::shared_ptr<DeferredDrawContext>& context : deferredContexts)
+		{
+			contexts.push_back(context.get());
+		}
+		commandScheduler.Submit(drawList.size(), contexts);
+
+		// Executing command lists clears the immediate context's state
+		Graphics::Context->OMSetRenderTargets(1, Graphics::BackBufferRTV.GetAddressOf(), Graphics::DepthBufferDSV.Get());
+		Graphics::Context->RSSetViewports(1, &frameRecordingState.viewport);
+	}
+	else
+	{
+		PROFILE_SCOPE("Draw Submission");
+		RecordDrawItems(Graphics::Context.Get(), constantBufferRing.get(), drawList.data(), drawList.size());
 	}
+	constantBufferRing->EndFrame();
+	frameExchange.ReleaseRead();
+	gpuProfiler->EndScope();
 
 	// ImGui Render
 	{
+		PROFILE_SCOPE("ImGui Render");
+		gpuProfiler->BeginScope("ImGui");
 		ImGui::Render(); // Turns this frames UI into renderable triangles
 		ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData()); // Draws it to the screen
+		gpuProfiler->EndScope();
 	}
 
 	// Frame END
@@ -396,6 +1213,8 @@ void Game::Draw(float deltaTime, float totalTime)
 	// - At the very end of the frame (after drawing *everything*)
 	{
 		// Present at the end of the frame
+		PROFILE_SCOPE("Present");
+		gpuProfiler->EndFrame();
 		bool vsync = Graphics::VsyncState();
 		Graphics::SwapChain->Present(
 			vsync ? 1 : 0,
@@ -7,10 +7,26 @@
 #include "BufferStructs.h"
 #include "Mesh.h"
 #include "TypeDefs.h"
-#include "Actor.h"
+#include "EntityRegistry.h"
 #include "Transform.h"
 #include <memory>
 #include "Camera.h"
+#include "ConstantBufferRing.h"
+#include "InstanceBuffer.h"
+#include "CommandScheduler.h"
+#include "JobSystem.h"
+#include "FrameExchange.h"
+#include "DrawRecording.h"
+#include "BoundingVolumeHierarchy.h"
+#include "LooseOctree.h"
+#include "Picking.h"
+#include "OcclusionCuller.h"
+#include "Profiler.h"
+#include "GpuProfiler.h"
+#include "ShaderReloader.h"
+#include "TaskGraph.h"
+#include "ChromeTrace.h"
+#include "ClusteredLighting.h"
 #include <vector>
 
 class Game
@@ -26,20 +42,52 @@ public:
 	void Update(float deltaTime, float totalTime);
 	void Draw(float deltaTime, float totalTime);
 	void OnResize();
+	bool BeginTraceCapture(const char* path, int frameCount);
 private:
 
 	// Initialization helper methods - feel free to customize, combine, remove, etc.
+	void LoadStartupAssets();
+	void CreateLights(int count);
 	void CreateGeometry();
 	void NewFrame(float deltaTime);
+	void Simulate(FrameSnapshot& snapshot, float deltaTime, float totalTime);
 	void CreateRowOfGeometry(std::shared_ptr<Material> material, float y, float xOffset, float zOffset);
+	void BuildScenePartition();
+	void CullOccludedEntities(FrameSnapshot& snapshot);
+	void CaptureTraceFrame();
+	void UpdateShaderReload(float deltaTime);
+	MaterialHandle GetMaterialHandle(std::shared_ptr<Material> material);
 
 	// Note the usage of ComPtr below
 	//  - This is a smart pointer for objects that abide by the
 	//     Component Object Model, which DirectX objects do
 	//  - More info here: https://github.com/Microsoft/DirectXTK/wiki/ComPtr
 
-	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexConstantBuffer;
-	Microsoft::WRL::ComPtr<ID3D11Buffer> pixelConstantBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> perFrameConstantBuffer;
+	unsigned int bytesUploaded;
+	unsigned int droppedInstances;			// Didn't fit in the ring last frame
+	unsigned int ringOverflowFrames;		// Frames that dropped any
+
+	std::shared_ptr<ConstantBufferRing> constantBufferRing;
+	std::vector<DrawInstance> drawInstances;
+	std::shared_ptr<InstanceBuffer> instanceBuffer;
+	std::vector<PerInstanceData> instanceData;		// The whole frame's, in draw order
+	std::vector<DrawItem> drawList;
+	std::vector<unsigned int> materialOrder;		// Material handles, in batch order
+	std::vector<unsigned int> materialBatches;		// Each material's place in that order
+
+	std::shared_ptr<JobSystem> jobSystem;
+
+	// Simulation -> render hand-off, optionally overlapped a frame apart
+	bool pipelinedSimulation;
+	JobCounter simulationCounter;
+	FrameExchange frameExchange;
+
+	// Optional parallel draw recording with deferred contexts
+	bool multithreadedRecording;
+	CommandScheduler commandScheduler;
+	FrameRecordingState frameRecordingState;
+	std::vector<std::shared_ptr<DeferredDrawContext>> deferredContexts;
 
 	std::vector<std::shared_ptr<Camera>> cameras;
 
@@ -50,23 +98,63 @@ private:
 	std::shared_ptr<Camera> camera2;
 	std::shared_ptr<Camera> camera3;
 
-	VertexShaderData shaderData;
-	std::vector<std::shared_ptr<Actor>> actorList;
+	EntityRegistry entities;
 	std::vector<std::shared_ptr<Mesh>> meshList;
 
-	//New Actors
-	Actor ASphere;
-	Actor AQuad;
-	Actor AHelix;
-	Actor ACylinder;
-	Actor ACube;
+	// Scene queries - one partition proxy per entity, indexed by Entity::index
+	std::shared_ptr<SpatialPartition> scenePartition;
+	int scenePartitionType;
+	std::vector<int> entityProxies;
+	std::vector<AABB> entityBounds;
+	bool frustumCulling;
+	size_t visibleEntityCount;
+
+	// Software occlusion culling, run by the simulation after frustum culling
+	OcclusionCuller occlusionCuller;
+	bool occlusionCulling;
+	size_t occluderCount;
+	size_t occludedEntityCount;
 
+	// Mouse picking
+	PickResult selection;
+	bool selectionChanged;
+	bool useTriangleBVH;
+
+	std::shared_ptr<Material> MSolid;
 	std::shared_ptr<Material> MRed;
 	std::shared_ptr<Material> MGreen;
 	std::shared_ptr<Material> MBlue;
 	std::shared_ptr<Material> MDebugNormals;
 	std::shared_ptr<Material> MDebugUVs;
 	std::shared_ptr<Material> MCustom;
+	std::shared_ptr<Material> MLit;
+	std::vector<std::shared_ptr<Material>> materialList;
+
+	// Profiling - the CPU profiler is global so any system can add scopes
+	std::shared_ptr<GpuProfiler> gpuProfiler;
+	bool profilerPaused;
+	ProfileFrame pausedProfileFrame;
+	int frameTimeExportResult;	// 0 until the first export, then 1 or -1
+	ChromeTraceWriter traceWriter;
+	int traceFrameCount;
+	int traceFramesRemaining;
+	int traceResult;			// 0 until the first capture, then 1 or -1
+
+	// Recompiles edited .hlsl files while the game runs
+	std::shared_ptr<ShaderReloader> shaderReloader;
+	bool shaderHotReload;
+	float shaderPollTimer;
+
+	// Point and spot lights, culled into view space clusters
+	// every frame for LitPS; frameLights are where they've moved to
+	std::vector<Light> lights;
+	std::vector<Light> frameLights;
+	std::shared_ptr<ClusteredLighting> clusteredLighting;
+	int lightCount;
+	bool animateLights;
+
+	// What each shader and mesh cost to create at startup
+	std::shared_ptr<TaskGraph> startupTasks;
 
 	// User controls
 	float backgroundColor[4];
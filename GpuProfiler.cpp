@@ -0,0 +1,164 @@
+#include "GpuProfiler.h"
+#include "Graphics.h"
+
+namespace
+{
+	// Stands in for a scope past MaxScopes, so EndScope() still pairs up
+	const unsigned int DroppedScope = (unsigned int)-1;
+}
+
+GpuProfiler::GpuProfiler() :
+	available(true),
+	frameIndex(0),
+	lastFrameMilliseconds(0.0f),
+	lastPipelineStatistics(),
+	skippedFrames(0),
+	droppedScopes(0)
+{
+	for (Frame& frame : frames)
+	{
+		frame.disjoint = CreateQuery(D3D11_QUERY_TIMESTAMP_DISJOINT);
+		frame.pipelineStatistics = CreateQuery(D3D11_QUERY_PIPELINE_STATISTICS);
+		frame.begin = CreateQuery(D3D11_QUERY_TIMESTAMP);
+		frame.end = CreateQuery(D3D11_QUERY_TIMESTAMP);
+		for (Scope& scope : frame.scopes)
+		{
+			scope.name = 0;
+			scope.depth = 0;
+			scope.begin = CreateQuery(D3D11_QUERY_TIMESTAMP);
+			scope.end = CreateQuery(D3D11_QUERY_TIMESTAMP);
+		}
+		frame.scopeCount = 0;
+		frame.pending = false;
+	}
+}
+
+void GpuProfiler::BeginFrame()
+{
+	if (!available)
+		return;
+
+	// This slot was last used FrameLatency frames ago
+	Frame& frame = frames[frameIndex];
+	if (frame.pending && !Resolve(frame))
+		skippedFrames++;
+
+	frame.pending = false;
+	frame.scopeCount = 0;
+	openScopes.clear();
+
+	Graphics::Context->Begin(frame.disjoint.Get());
+	Graphics::Context->Begin(frame.pipelineStatistics.Get());
+	Graphics::Context->End(frame.begin.Get());
+}
+
+void GpuProfiler::EndFrame()
+{
+	if (!available)
+		return;
+
+	Frame& frame = frames[frameIndex];
+	while (!openScopes.empty())
+	{
+		EndScope();
+	}
+
+	Graphics::Context->End(frame.end.Get());
+	Graphics::Context->End(frame.pipelineStatistics.Get());
+	Graphics::Context->End(frame.disjoint.Get());
+	frame.pending = true;
+	frameIndex = (frameIndex + 1) % FrameLatency;
+}
+
+void GpuProfiler::BeginScope(const char* name)
+{
+	if (!available)
+		return;
+
+	Frame& frame = frames[frameIndex];
+	if (frame.scopeCount == MaxScopes)
+	{
+		openScopes.push_back(DroppedScope);
+		droppedScopes++;
+		return;
+	}
+
+	Scope& scope = frame.scopes[frame.scopeCount];
+	scope.name = name;
+	scope.depth = (unsigned int)openScopes.size();
+	Graphics::Context->End(scope.begin.Get());
+	openScopes.push_back(frame.scopeCount++);
+}
+
+void GpuProfiler::EndScope()
+{
+	if (openScopes.empty())
+		return;
+
+	unsigned int index = openScopes.back();
+	openScopes.pop_back();
+	if (index != DroppedScope)
+		Graphics::Context->End(frames[frameIndex].scopes[index].end.Get());
+}
+
+bool GpuProfiler::IsAvailable() const { return available; }
+const std::vector<GpuScopeResult>& GpuProfiler::GetLastResults() const { return lastResults; }
+float GpuProfiler::GetLastFrameMilliseconds() const { return lastFrameMilliseconds; }
+const D3D11_QUERY_DATA_PIPELINE_STATISTICS& GpuProfiler::GetLastPipelineStatistics() const { return lastPipelineStatistics; }
+unsigned long long GpuProfiler::GetSkippedFrameCount() const { return skippedFrames; }
+unsigned long long GpuProfiler::GetDroppedScopeCount() const { return droppedScopes; }
+
+GpuProfiler::QueryPtr GpuProfiler::CreateQuery(D3D11_QUERY type)
+{
+	D3D11_QUERY_DESC desc = {};
+	desc.Query = type;
+	QueryPtr query;
+	if (FAILED(Graphics::Device->CreateQuery(&desc, query.GetAddressOf())))
+		available = false; // Profiling is optional - just stop issuing queries
+	return query;
+}
+
+// --------------------------------------------------------
+// Reads back a finished frame's queries without stalling,
+// returning false if any of them aren't ready or are invalid
+// --------------------------------------------------------
+bool GpuProfiler::Resolve(Frame& frame)
+{
+	const UINT flags = D3D11_ASYNC_GETDATA_DONOTFLUSH;
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint = {};
+	if (Graphics::Context->GetData(frame.disjoint.Get(), &disjoint, sizeof(disjoint), flags) != S_OK)
+		return false;
+
+	// The GPU clock changed frequency partway through - the timings are meaningless
+	if (disjoint.Disjoint || disjoint.Frequency == 0)
+		return false;
+
+	UINT64 frameBegin = 0, frameEnd = 0;
+	D3D11_QUERY_DATA_PIPELINE_STATISTICS statistics = {};
+	if (Graphics::Context->GetData(frame.begin.Get(), &frameBegin, sizeof(UINT64), flags) != S_OK ||
+		Graphics::Context->GetData(frame.end.Get(), &frameEnd, sizeof(UINT64), flags) != S_OK ||
+		Graphics::Context->GetData(frame.pipelineStatistics.Get(), &statistics, sizeof(statistics), flags) != S_OK)
+		return false;
+
+	double ticksToMilliseconds = 1000.0 / (double)disjoint.Frequency;
+	std::vector<GpuScopeResult> results;
+	for (unsigned int i = 0; i < frame.scopeCount; i++)
+	{
+		UINT64 scopeBegin = 0, scopeEnd = 0;
+		if (Graphics::Context->GetData(frame.scopes[i].begin.Get(), &scopeBegin, sizeof(UINT64), flags) != S_OK ||
+			Graphics::Context->GetData(frame.scopes[i].end.Get(), &scopeEnd, sizeof(UINT64), flags) != S_OK)
+			return false;
+
+		GpuScopeResult result = {};
+		result.name = frame.scopes[i].name;
+		result.depth = frame.scopes[i].depth;
+		result.startMilliseconds = (float)((scopeBegin - frameBegin) * ticksToMilliseconds);
+		result.durationMilliseconds = (float)((scopeEnd - scopeBegin) * ticksToMilliseconds);
+		results.push_back(result);
+	}
+
+	lastResults.swap(results);
+	lastFrameMilliseconds = (float)((frameEnd - frameBegin) * ticksToMilliseconds);
+	lastPipelineStatistics = statistics;
+	return true;
+}
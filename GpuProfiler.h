@@ -0,0 +1,80 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <vector>
+
+// GPU time spent in one named scope of a resolved frame
+struct GpuScopeResult
+{
+	const char* name;
+	float startMilliseconds;	// From the start of the frame
+	float durationMilliseconds;
+	unsigned int depth;
+};
+
+// --------------------------------------------------------
+// Times scopes of a frame on the GPU with timestamp queries
+// and counts the frame's work with a pipeline statistics query
+//
+// - Queries are read back FrameLatency frames later, so the
+//    CPU never waits on the GPU; frames whose results still
+//    aren't ready by then are skipped
+// - Scopes past MaxScopes in a frame are dropped and counted
+// - Everything runs on the immediate context
+// --------------------------------------------------------
+class GpuProfiler
+{
+public:
+	static const unsigned int FrameLatency = 4;
+	static const unsigned int MaxScopes = 32;
+
+	GpuProfiler();
+
+	void BeginFrame();
+	void EndFrame();
+	void BeginScope(const char* name);
+	void EndScope();
+
+	bool IsAvailable() const;
+	const std::vector<GpuScopeResult>& GetLastResults() const;
+	float GetLastFrameMilliseconds() const;
+	const D3D11_QUERY_DATA_PIPELINE_STATISTICS& GetLastPipelineStatistics() const;
+	unsigned long long GetSkippedFrameCount() const;
+	unsigned long long GetDroppedScopeCount() const;
+
+private:
+	typedef Microsoft::WRL::ComPtr<ID3D11Query> QueryPtr;
+
+	struct Scope
+	{
+		const char* name;
+		unsigned int depth;
+		QueryPtr begin;
+		QueryPtr end;
+	};
+
+	struct Frame
+	{
+		QueryPtr disjoint;
+		QueryPtr pipelineStatistics;
+		QueryPtr begin;
+		QueryPtr end;
+		Scope scopes[MaxScopes];
+		unsigned int scopeCount;
+		bool pending;
+	};
+
+	bool available;
+	Frame frames[FrameLatency];
+	unsigned int frameIndex;
+	std::vector<unsigned int> openScopes;	// Indices into the frame's scopes, innermost last
+
+	std::vector<GpuScopeResult> lastResults;
+	float lastFrameMilliseconds;
+	D3D11_QUERY_DATA_PIPELINE_STATISTICS lastPipelineStatistics;
+	unsigned long long skippedFrames;
+	unsigned long long droppedScopes;
+
+	QueryPtr CreateQuery(D3D11_QUERY type);
+	bool Resolve(Frame& frame);
+};
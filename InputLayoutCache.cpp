@@ -0,0 +1,61 @@
+#include "InputLayoutCache.h"
+#include "Graphics.h"
+
+namespace
+{
+	// Position, UV and normal from Vertex, plus the TIME input
+	// the vertex shader declares
+	const D3D11_INPUT_ELEMENT_DESC VertexElements[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TIME", 0, DXGI_FORMAT_R32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	};
+}
+
+const D3D11_INPUT_ELEMENT_DESC* InputLayoutCache::GetVertexElements(unsigned int* count)
+{
+	*count = ARRAYSIZE(VertexElements);
+	return VertexElements;
+}
+
+InputLayoutPtr InputLayoutCache::Get(const D3D11_INPUT_ELEMENT_DESC* elements, unsigned int count,
+	const void* shaderBytecode, size_t bytecodeSize, bool* cacheHit)
+{
+	if (count > D3D11_IA_VERTEX_INPUT_STRUCTURE_ELEMENT_COUNT)
+		return InputLayoutPtr();
+
+	VertexElement keyElements[D3D11_IA_VERTEX_INPUT_STRUCTURE_ELEMENT_COUNT] = {};
+	for (unsigned int i = 0; i < count; i++)
+	{
+		keyElements[i].semanticName = elements[i].SemanticName;
+		keyElements[i].semanticIndex = elements[i].SemanticIndex;
+		keyElements[i].format = elements[i].Format;
+		keyElements[i].inputSlot = elements[i].InputSlot;
+		keyElements[i].alignedByteOffset = elements[i].AlignedByteOffset;
+		keyElements[i].inputSlotClass = elements[i].InputSlotClass;
+		keyElements[i].instanceDataStepRate = elements[i].InstanceDataStepRate;
+	}
+	InputLayoutKey key = InputLayoutKeys::MakeKey(keyElements, count, shaderBytecode, bytecodeSize);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	InputLayoutPtr& layout = layouts[key];
+	if (cacheHit)
+		*cacheHit = layout.Get() != 0;
+	if (!layout)
+		Graphics::Device->CreateInputLayout(elements, count, shaderBytecode, bytecodeSize, layout.GetAddressOf());
+	return layout;
+}
+
+size_t InputLayoutCache::GetLayoutCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return layouts.size();
+}
+
+void InputLayoutCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	layouts.clear();
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <d3d11.h>
+#include <mutex>
+#include <unordered_map>
+#include "TypeDefs.h"
+#include "InputLayoutKey.h"
+
+// --------------------------------------------------------
+// Creates one input layout per (vertex format, vertex shader
+// input signature) pair and shares it with every caller
+// --------------------------------------------------------
+class InputLayoutCache
+{
+public:
+	// The description of our Vertex struct
+	static const D3D11_INPUT_ELEMENT_DESC* GetVertexElements(unsigned int* count);
+
+	InputLayoutPtr Get(const D3D11_INPUT_ELEMENT_DESC* elements, unsigned int count,
+		const void* shaderBytecode, size_t bytecodeSize, bool* cacheHit = 0);
+
+	size_t GetLayoutCount();
+	void Clear();
+
+private:
+	std::mutex mutex;
+	std::unordered_map<InputLayoutKey, InputLayoutPtr, InputLayoutKeyHasher> layouts;
+};
@@ -0,0 +1,112 @@
+#include "InputLayoutKey.h"
+#include <cstring>
+
+namespace
+{
+	const unsigned long long HashBasis = 14695981039346656037ull;
+	const unsigned long long HashPrime = 1099511628211ull;
+
+	// 64-bit FNV-1a, continuing from an existing hash
+	unsigned long long HashBytes(unsigned long long hash, const void* data, size_t size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= HashPrime;
+		}
+		return hash;
+	}
+
+	unsigned long long HashValue(unsigned long long hash, unsigned int value)
+	{
+		return HashBytes(hash, &value, sizeof(value));
+	}
+
+	// DXBC stores everything little-endian
+	unsigned int ReadUInt(const unsigned char* bytes)
+	{
+		return (unsigned int)bytes[0] | ((unsigned int)bytes[1] << 8) | ((unsigned int)bytes[2] << 16) | ((unsigned int)bytes[3] << 24);
+	}
+
+	// Magic, 16 byte checksum, version, total size, chunk count
+	const size_t ContainerHeaderSize = 32;
+	const size_t ChunkHeaderSize = 8;
+}
+
+unsigned long long InputLayoutKeys::HashElements(const VertexElement* elements, size_t count)
+{
+	unsigned long long hash = HashValue(HashBasis, (unsigned int)count);
+	for (size_t i = 0; i < count; i++)
+	{
+		const VertexElement& element = elements[i];
+		for (const char* c = element.semanticName; c && *c; c++)
+		{
+			unsigned char character = (unsigned char)*c;
+			if (character >= 'a' && character <= 'z')
+				character = (unsigned char)(character - 'a' + 'A');
+			hash = HashBytes(hash, &character, 1);
+		}
+
+		// The terminator keeps "AB"+"C" apart from "A"+"BC"
+		unsigned char terminator = 0;
+		hash = HashBytes(hash, &terminator, 1);
+
+		hash = HashValue(hash, element.semanticIndex);
+		hash = HashValue(hash, element.format);
+		hash = HashValue(hash, element.inputSlot);
+		hash = HashValue(hash, element.alignedByteOffset);
+		hash = HashValue(hash, element.inputSlotClass);
+		hash = HashValue(hash, element.instanceDataStepRate);
+	}
+	return hash;
+}
+
+bool InputLayoutKeys::FindInputSignature(const void* bytecode, size_t size, const void** signature, size_t* signatureSize)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(bytecode);
+	if (!bytes || size < ContainerHeaderSize || memcmp(bytes, "DXBC", 4) != 0)
+		return false;
+
+	unsigned int chunkCount = ReadUInt(bytes + 28);
+	if (chunkCount > (size - ContainerHeaderSize) / 4)
+		return false;
+
+	for (unsigned int i = 0; i < chunkCount; i++)
+	{
+		size_t offset = ReadUInt(bytes + ContainerHeaderSize + i * 4);
+		if (offset > size || size - offset < ChunkHeaderSize)
+			return false;
+
+		const unsigned char* chunk = bytes + offset;
+		size_t chunkSize = ReadUInt(chunk + 4);
+		if (chunkSize > size - offset - ChunkHeaderSize)
+			return false;
+
+		if (memcmp(chunk, "ISGN", 4) == 0 || memcmp(chunk, "ISG1", 4) == 0)
+		{
+			*signature = chunk + ChunkHeaderSize;
+			*signatureSize = chunkSize;
+			return true;
+		}
+	}
+	return false;
+}
+
+unsigned long long InputLayoutKeys::HashInputSignature(const void* bytecode, size_t size)
+{
+	const void* signature = 0;
+	size_t signatureSize = 0;
+	if (FindInputSignature(bytecode, size, &signature, &signatureSize))
+		return HashBytes(HashBasis, signature, signatureSize);
+
+	return HashBytes(HashBasis, bytecode, size);
+}
+
+InputLayoutKey InputLayoutKeys::MakeKey(const VertexElement* elements, size_t count, const void* bytecode, size_t size)
+{
+	InputLayoutKey key = {};
+	key.elementsHash = HashElements(elements, count);
+	key.signatureHash = HashInputSignature(bytecode, size);
+	return key;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+
+// Mirrors D3D11_INPUT_ELEMENT_DESC field for field, without
+// needing D3D headers
+struct VertexElement
+{
+	const char* semanticName;
+	unsigned int semanticIndex;
+	unsigned int format;				// DXGI_FORMAT
+	unsigned int inputSlot;
+	unsigned int alignedByteOffset;
+	unsigned int inputSlotClass;		// D3D11_INPUT_CLASSIFICATION
+	unsigned int instanceDataStepRate;
+};
+
+// --------------------------------------------------------
+// Identifies an input layout: which vertex format feeds
+// which vertex shader inputs
+//
+// - The signature hash covers only the shader's input
+//    signature chunk, so different shaders reading the same
+//    inputs share one layout
+// --------------------------------------------------------
+struct InputLayoutKey
+{
+	unsigned long long elementsHash;
+	unsigned long long signatureHash;
+
+	bool operator==(const InputLayoutKey& other) const
+	{
+		return elementsHash == other.elementsHash && signatureHash == other.signatureHash;
+	}
+};
+
+struct InputLayoutKeyHasher
+{
+	size_t operator()(const InputLayoutKey& key) const
+	{
+		return (size_t)(key.elementsHash ^ (key.signatureHash * 0x9E3779B97F4A7C15ull));
+	}
+};
+
+namespace InputLayoutKeys
+{
+	// Semantic names compare case-insensitively, like HLSL
+	unsigned long long HashElements(const VertexElement* elements, size_t count);
+
+	// Finds the input signature (ISGN or ISG1) chunk in a DXBC
+	// container; returns false if the bytecode isn't one
+	bool FindInputSignature(const void* bytecode, size_t size, const void** signature, size_t* signatureSize);
+
+	// Hashes the input signature, or all of the bytecode if no
+	// signature can be found
+	unsigned long long HashInputSignature(const void* bytecode, size_t size);
+
+	InputLayoutKey MakeKey(const VertexElement* elements, size_t count, const void* bytecode, size_t size);
+}
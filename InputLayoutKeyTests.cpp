@@ -0,0 +1,181 @@
+#include "InputLayoutKey.h"
+#include "TestHarness.h"
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+namespace
+{
+	const unsigned int FormatFloat3 = 6;	// DXGI_FORMAT_R32G32B32_FLOAT
+	const unsigned int FormatFloat2 = 16;	// DXGI_FORMAT_R32G32_FLOAT
+	const unsigned int AppendAligned = 0xffffffff;
+
+	void PutUInt(std::vector<unsigned char>& bytes, unsigned int value)
+	{
+		for (int i = 0; i < 4; i++)
+			bytes.push_back((unsigned char)(value >> (8 * i)));
+	}
+
+	void SetUInt(std::vector<unsigned char>& bytes, size_t offset, unsigned int value)
+	{
+		for (int i = 0; i < 4; i++)
+			bytes[offset + i] = (unsigned char)(value >> (8 * i));
+	}
+
+	unsigned int GetUInt(const std::vector<unsigned char>& bytes, size_t offset)
+	{
+		unsigned int value = 0;
+		for (int i = 0; i < 4; i++)
+			value |= (unsigned int)bytes[offset + i] << (8 * i);
+		return value;
+	}
+
+	// A DXBC container holding a shader chunk and then an input
+	// signature chunk, with the given contents
+	std::vector<unsigned char> MakeBytecode(const std::string& signature, const std::string& code, const char* signatureTag = "ISGN")
+	{
+		std::vector<unsigned char> bytes(4 + 16, 0x5A);
+		memcpy(bytes.data(), "DXBC", 4);
+		PutUInt(bytes, 1);			// Version
+		PutUInt(bytes, 0);			// Total size, filled in below
+		PutUInt(bytes, 2);			// Chunk count
+		PutUInt(bytes, 0);			// Chunk offsets, filled in below
+		PutUInt(bytes, 0);
+
+		SetUInt(bytes, 32, (unsigned int)bytes.size());
+		bytes.insert(bytes.end(), { 'S', 'H', 'E', 'X' });
+		PutUInt(bytes, (unsigned int)code.size());
+		bytes.insert(bytes.end(), code.begin(), code.end());
+
+		SetUInt(bytes, 36, (unsigned int)bytes.size());
+		bytes.insert(bytes.end(), signatureTag, signatureTag + 4);
+		PutUInt(bytes, (unsigned int)signature.size());
+		bytes.insert(bytes.end(), signature.begin(), signature.end());
+
+		SetUInt(bytes, 24, (unsigned int)bytes.size());
+		return bytes;
+	}
+
+	const VertexElement Elements[] =
+	{
+		{ "POSITION", 0, FormatFloat3, 0, AppendAligned, 0, 0 },
+		{ "TEXCOORD", 0, FormatFloat2, 0, AppendAligned, 0, 0 },
+	};
+}
+
+TEST_CASE(SemanticNamesCompareCaseInsensitively)
+{
+	VertexElement lower[] =
+	{
+		{ "position", 0, FormatFloat3, 0, AppendAligned, 0, 0 },
+		{ "TexCoord", 0, FormatFloat2, 0, AppendAligned, 0, 0 },
+	};
+	CHECK(InputLayoutKeys::HashElements(Elements, 2) == InputLayoutKeys::HashElements(lower, 2));
+}
+
+TEST_CASE(EveryElementFieldChangesTheHash)
+{
+	unsigned long long original = InputLayoutKeys::HashElements(Elements, 2);
+	for (int field = 0; field < 6; field++)
+	{
+		VertexElement changed[2] = { Elements[0], Elements[1] };
+		unsigned int* values[] = { &changed[1].semanticIndex, &changed[1].format, &changed[1].inputSlot,
+			&changed[1].alignedByteOffset, &changed[1].inputSlotClass, &changed[1].instanceDataStepRate };
+		*values[field] += 1;
+		CHECK(InputLayoutKeys::HashElements(changed, 2) != original);
+	}
+
+	VertexElement renamed[2] = { Elements[0], Elements[1] };
+	renamed[1].semanticName = "NORMAL";
+	CHECK(InputLayoutKeys::HashElements(renamed, 2) != original);
+}
+
+TEST_CASE(ElementCountAndOrderChangeTheHash)
+{
+	VertexElement swapped[2] = { Elements[1], Elements[0] };
+	CHECK(InputLayoutKeys::HashElements(Elements, 1) != InputLayoutKeys::HashElements(Elements, 2));
+	CHECK(InputLayoutKeys::HashElements(swapped, 2) != InputLayoutKeys::HashElements(Elements, 2));
+	CHECK(InputLayoutKeys::HashElements(Elements, 0) != InputLayoutKeys::HashElements(Elements, 1));
+}
+
+TEST_CASE(SemanticBoundariesChangeTheHash)
+{
+	// The same characters split differently between two names
+	VertexElement split[] =
+	{
+		{ "POSITIONT", 0, FormatFloat3, 0, AppendAligned, 0, 0 },
+		{ "EXCOORD", 0, FormatFloat2, 0, AppendAligned, 0, 0 },
+	};
+	CHECK(InputLayoutKeys::HashElements(split, 2) != InputLayoutKeys::HashElements(Elements, 2));
+}
+
+TEST_CASE(FindsTheInputSignatureChunk)
+{
+	std::vector<unsigned char> bytecode = MakeBytecode("signature", "code");
+	const void* signature = 0;
+	size_t signatureSize = 0;
+	REQUIRE(InputLayoutKeys::FindInputSignature(bytecode.data(), bytecode.size(), &signature, &signatureSize));
+	CHECK(signatureSize == 9);
+	CHECK(memcmp(signature, "signature", 9) == 0);
+
+	std::vector<unsigned char> newer = MakeBytecode("signature", "code", "ISG1");
+	CHECK(InputLayoutKeys::FindInputSignature(newer.data(), newer.size(), &signature, &signatureSize));
+}
+
+TEST_CASE(ShadersWithTheSameInputsShareAKey)
+{
+	std::vector<unsigned char> first = MakeBytecode("inputs", "one shader");
+	std::vector<unsigned char> second = MakeBytecode("inputs", "a different, longer shader");
+	std::vector<unsigned char> other = MakeBytecode("others", "one shader");
+
+	InputLayoutKey key = InputLayoutKeys::MakeKey(Elements, 2, first.data(), first.size());
+	CHECK(key == InputLayoutKeys::MakeKey(Elements, 2, second.data(), second.size()));
+	CHECK(!(key == InputLayoutKeys::MakeKey(Elements, 2, other.data(), other.size())));
+	CHECK(!(key == InputLayoutKeys::MakeKey(Elements, 1, first.data(), first.size())));
+}
+
+TEST_CASE(HasherSpreadsKeysThatDifferInOneHalf)
+{
+	// Swapping the two hashes mustn't collide, nor equal halves cancel out
+	InputLayoutKeyHasher hasher;
+	InputLayoutKey a = { 1, 2 };
+	InputLayoutKey b = { 2, 1 };
+	InputLayoutKey same = { 5, 5 };
+	CHECK(hasher(a) != hasher(b));
+	CHECK(hasher(same) != 0);
+	CHECK(hasher(a) == hasher(InputLayoutKey{ 1, 2 }));
+
+	std::unordered_map<InputLayoutKey, int, InputLayoutKeyHasher> layouts;
+	layouts[a] = 1;
+	layouts[b] = 2;
+	layouts[InputLayoutKey{ 1, 2 }] = 3;
+	CHECK(layouts.size() == 2);
+	CHECK(layouts[a] == 3);
+}
+
+TEST_CASE(MalformedBytecodeFallsBackToHashingEverything)
+{
+	std::vector<unsigned char> bytecode = MakeBytecode("inputs", "code");
+	const void* signature = 0;
+	size_t signatureSize = 0;
+
+	// Every truncation is rejected without reading past the end
+	for (size_t length = 0; length < bytecode.size(); length++)
+	{
+		CHECK(!InputLayoutKeys::FindInputSignature(bytecode.data(), length, &signature, &signatureSize));
+		InputLayoutKeys::HashInputSignature(bytecode.data(), length);
+	}
+
+	std::vector<unsigned char> tooManyChunks = bytecode;
+	SetUInt(tooManyChunks, 28, 0x7fffffff);
+	CHECK(!InputLayoutKeys::FindInputSignature(tooManyChunks.data(), tooManyChunks.size(), &signature, &signatureSize));
+
+	std::vector<unsigned char> hugeChunk = bytecode;
+	SetUInt(hugeChunk, GetUInt(hugeChunk, 32) + 4, 0x7fffffff);
+	CHECK(!InputLayoutKeys::FindInputSignature(hugeChunk.data(), hugeChunk.size(), &signature, &signatureSize));
+
+	const char notAShader[] = "not a shader at all, just text";
+	CHECK(!InputLayoutKeys::FindInputSignature(notAShader, sizeof(notAShader), &signature, &signatureSize));
+	CHECK(InputLayoutKeys::HashInputSignature(notAShader, sizeof(notAShader)) != InputLayoutKeys::HashInputSignature(bytecode.data(), bytecode.size()));
+	CHECK(InputLayoutKeys::HashInputSignature(0, 0) == InputLayoutKeys::HashInputSignature(notAShader, 0));
+}
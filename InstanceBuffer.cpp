@@ -0,0 +1,47 @@
+#include "InstanceBuffer.h"
+#include "Graphics.h"
+#include <cstring>
+
+unsigned int InstanceBuffer::Upload(ID3D11DeviceContext* context, const PerInstanceData* instances, unsigned int count)
+{
+	if (count > capacity)
+	{
+		capacity = capacity * 2 > count ? capacity * 2 : count;
+		if (capacity < MaxInstancesPerDraw)
+			capacity = MaxInstancesPerDraw;
+
+		D3D11_BUFFER_DESC desc = {};
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		desc.ByteWidth = capacity * sizeof(PerInstanceData);
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		desc.StructureByteStride = sizeof(PerInstanceData);
+		desc.Usage = D3D11_USAGE_DYNAMIC;
+		buffer.Reset();
+		shaderResourceView.Reset();
+		Graphics::Device->CreateBuffer(&desc, 0, buffer.GetAddressOf());
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc = {};
+		viewDesc.Format = DXGI_FORMAT_UNKNOWN;
+		viewDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		viewDesc.Buffer.FirstElement = 0;
+		viewDesc.Buffer.NumElements = capacity;
+		Graphics::Device->CreateShaderResourceView(buffer.Get(), &viewDesc, shaderResourceView.GetAddressOf());
+	}
+	if (count == 0)
+		return 0;
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	context->Map(buffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+	memcpy(mapped.pData, instances, (size_t)count * sizeof(PerInstanceData));
+	context->Unmap(buffer.Get(), 0);
+	return count * sizeof(PerInstanceData);
+}
+
+void InstanceBuffer::Bind(ID3D11DeviceContext* context) const
+{
+	ID3D11ShaderResourceView* view = shaderResourceView.Get();
+	context->VSSetShaderResources(Slot, 1, &view);
+}
+
+unsigned int InstanceBuffer::GetCapacity() const { return capacity; }
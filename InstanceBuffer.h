@@ -0,0 +1,30 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include "BufferStructs.h"
+
+// --------------------------------------------------------
+// Every instance drawn in a frame, in one dynamic
+// StructuredBuffer the vertex shader reads on t0
+//
+// - Rewritten whole each frame and grown by doubling when
+//    the frame's instances outgrow it
+// - Each draw finds its own instances through the offset in
+//    its PerDrawData, so the buffer is bound once per context
+// --------------------------------------------------------
+class InstanceBuffer
+{
+public:
+	// Returns bytes uploaded
+	unsigned int Upload(ID3D11DeviceContext* context, const PerInstanceData* instances, unsigned int count);
+	void Bind(ID3D11DeviceContext* context) const;
+
+	unsigned int GetCapacity() const;
+
+	static const unsigned int Slot = 0;
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shaderResourceView;
+	unsigned int capacity = 0;		// In instances
+};
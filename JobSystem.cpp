@@ -0,0 +1,227 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+
+namespace
+{
+	// Which pool (if any) the current thread works for, and its queue
+	thread_local JobSystem* currentSystem = 0;
+	thread_local unsigned int currentQueue = 0;
+}
+
+JobCounter::JobCounter() : pending(0) {}
+
+bool JobCounter::IsDone() { return pending.load() == 0; }
+
+
+JobSystem::JobSystem(unsigned int workerCount) :
+	running(true),
+	queuedJobs(0),
+	stealCount(0)
+{
+	for (unsigned int i = 0; i < workerCount + 1; i++)
+	{
+		queues.push_back(std::make_unique<WorkQueue>());
+	}
+
+	for (unsigned int i = 0; i < workerCount; i++)
+	{
+		workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		running = false;
+	}
+	wakeCondition.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+// --------------------------------------------------------
+// Schedules a job.  If a dependency is given, the job is held
+// back until every job counted by the dependency has finished.
+// --------------------------------------------------------
+void JobSystem::Run(std::function<void()> function, JobCounter* counter, JobCounter* dependency)
+{
+	Job job = {};
+	job.function = std::move(function);
+	job.counter = counter;
+	if (counter)
+		counter->pending++;
+
+	if (dependency)
+	{
+		std::lock_guard<std::mutex> lock(dependency->continuationMutex);
+		if (dependency->pending.load() > 0)
+		{
+			dependency->continuations.push_back(std::move(job));
+			return;
+		}
+	}
+
+	Enqueue(std::move(job));
+}
+
+// --------------------------------------------------------
+// Helps run jobs until everything on the counter is finished
+// --------------------------------------------------------
+void JobSystem::Wait(JobCounter* counter)
+{
+	while (counter->pending.load() > 0)
+	{
+		if (!TryRunOne())
+			std::this_thread::yield();
+	}
+
+	// Wait for the finishing thread to let go of the counter, since
+	// the caller is free to destroy it as soon as this returns
+	std::lock_guard<std::mutex> lock(counter->continuationMutex);
+}
+
+// --------------------------------------------------------
+// Calls function(first, last) over [0, count) in chunks of
+// grainSize and returns once every chunk is done
+// --------------------------------------------------------
+void JobSystem::ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t first, size_t last)>& function)
+{
+	if (count == 0)
+		return;
+	if (grainSize == 0)
+		grainSize = 1;
+
+	// Not worth the scheduling overhead for a single chunk
+	if (count <= grainSize)
+	{
+		function(0, count);
+		return;
+	}
+
+	JobCounter counter;
+	for (size_t first = 0; first < count; first += grainSize)
+	{
+		size_t last = first + grainSize < count ? first + grainSize : count;
+		Run([&function, first, last]() { function(first, last); }, &counter);
+	}
+	Wait(&counter);
+}
+
+unsigned int JobSystem::GetWorkerCount() { return (unsigned int)workers.size(); }
+unsigned long long JobSystem::GetStealCount() { return stealCount.load(); }
+
+void JobSystem::Enqueue(Job job)
+{
+	WorkQueue& queue = *queues[CurrentQueueIndex()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(std::move(job));
+	}
+	queuedJobs++;
+
+	// Taking the lock keeps a worker from missing the wake-up
+	// between checking for work and going to sleep
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	wakeCondition.notify_one();
+}
+
+void JobSystem::Execute(Job& job)
+{
+	job.function();
+
+	JobCounter* counter = job.counter;
+	if (!counter)
+		return;
+
+	// The decrement happens under the lock so a job can't be parked on
+	// this counter just after it hits zero, and so a waiter can't free
+	// the counter while this thread is still touching it (see Wait)
+	std::vector<Job> released;
+	{
+		std::lock_guard<std::mutex> lock(counter->continuationMutex);
+		if (counter->pending.fetch_sub(1) == 1)
+			released.swap(counter->continuations);
+	}
+
+	// Last job on this counter, so release anything waiting on it
+	for (Job& continuation : released)
+	{
+		Enqueue(std::move(continuation));
+	}
+}
+
+bool JobSystem::TryRunOne()
+{
+	unsigned int queueIndex = CurrentQueueIndex();
+	Job job;
+	if (PopLocal(queueIndex, job) || Steal(queueIndex, job))
+	{
+		Execute(job);
+		return true;
+	}
+	return false;
+}
+
+bool JobSystem::PopLocal(unsigned int queueIndex, Job& job)
+{
+	WorkQueue& queue = *queues[queueIndex];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.jobs.empty())
+		return false;
+
+	job = std::move(queue.jobs.back());
+	queue.jobs.pop_back();
+	queuedJobs--;
+	return true;
+}
+
+bool JobSystem::Steal(unsigned int thiefIndex, Job& job)
+{
+	unsigned int queueCount = (unsigned int)queues.size();
+	for (unsigned int i = 1; i < queueCount; i++)
+	{
+		WorkQueue& victim = *queues[(thiefIndex + i) % queueCount];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (victim.jobs.empty())
+			continue;
+
+		job = std::move(victim.jobs.front());
+		victim.jobs.pop_front();
+		queuedJobs--;
+		stealCount++;
+		return true;
+	}
+	return false;
+}
+
+unsigned int JobSystem::CurrentQueueIndex()
+{
+	// Threads outside the pool all share the last queue
+	if (currentSystem == this)
+		return currentQueue;
+	return (unsigned int)queues.size() - 1;
+}
+
+void JobSystem::WorkerLoop(unsigned int workerIndex)
+{
+	currentSystem = this;
+	currentQueue = workerIndex;
+	CpuProfiler::Global().SetThreadName("Worker " + std::to_string(workerIndex + 1));
+
+	while (true)
+	{
+		if (TryRunOne())
+			continue;
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		wakeCondition.wait(lock, [this]() { return !running || queuedJobs.load() > 0; });
+		if (!running)
+			return;
+	}
+}
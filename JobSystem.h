@@ -0,0 +1,89 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobCounter;
+
+struct Job
+{
+	std::function<void()> function;
+	JobCounter* counter;	// Decremented when the job finishes (optional)
+};
+
+// --------------------------------------------------------
+// Tracks a group of outstanding jobs
+//
+// - Every job run against a counter adds one to it and removes
+//    one when finished, so "done" means the count is back to zero
+// - Jobs that depend on a counter are parked here and released
+//    the moment it reaches zero
+// --------------------------------------------------------
+class JobCounter
+{
+public:
+	JobCounter();
+	bool IsDone();
+
+private:
+	friend class JobSystem;
+
+	std::atomic<int> pending;
+	std::mutex continuationMutex;
+	std::vector<Job> continuations;
+};
+
+// --------------------------------------------------------
+// A work-stealing thread pool for per-frame work
+//
+// - Each worker owns a deque: it pushes and pops its own jobs 
+//    at the back (newest first, cache-warm), and idle workers 
+//    steal from the front of other deques (oldest, biggest work)
+// - Threads waiting on a counter run jobs instead of blocking,
+//    so waiting from inside a job can't deadlock the pool
+// --------------------------------------------------------
+class JobSystem
+{
+public:
+	JobSystem(unsigned int workerCount);
+	~JobSystem();
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	void Run(std::function<void()> function, JobCounter* counter = 0, JobCounter* dependency = 0);
+	void Wait(JobCounter* counter);
+	void ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t first, size_t last)>& function);
+
+	unsigned int GetWorkerCount();
+	unsigned long long GetStealCount();
+
+private:
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	void Enqueue(Job job);
+	void Execute(Job& job);
+	bool TryRunOne();
+	bool PopLocal(unsigned int queueIndex, Job& job);
+	bool Steal(unsigned int thiefIndex, Job& job);
+	unsigned int CurrentQueueIndex();
+	void WorkerLoop(unsigned int workerIndex);
+
+	// One queue per worker, plus a final shared queue for outside threads
+	std::vector<std::unique_ptr<WorkQueue>> queues;
+	std::vector<std::thread> workers;
+
+	std::mutex sleepMutex;
+	std::condition_variable wakeCondition;
+	std::atomic<bool> running;
+	std::atomic<int> queuedJobs;
+	std::atomic<unsigned long long> stealCount;
+};
@@ -0,0 +1,169 @@
+#include "JobSystem.h"
+#include "TestHarness.h"
+#include <chrono>
+
+namespace
+{
+	unsigned int TestWorkers()
+	{
+		// At least a few, so there is contention even on small machines
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		return hardwareThreads > 4 ? hardwareThreads - 1 : 3;
+	}
+}
+
+TEST_CASE(ParallelForVisitsEveryIndexOnce)
+{
+	JobSystem jobs(TestWorkers());
+	const size_t grainSizes[] = { 1, 7, 64, 1000, 5000 };
+	for (size_t grainSize : grainSizes)
+	{
+		std::vector<std::atomic<int>> visits(4099);
+		for (std::atomic<int>& visit : visits)
+			visit = 0;
+
+		jobs.ParallelFor(visits.size(), grainSize, [&](size_t first, size_t last)
+			{
+				for (size_t i = first; i < last; i++)
+					visits[i]++;
+			});
+
+		bool once = true;
+		for (std::atomic<int>& visit : visits)
+			once &= visit.load() == 1;
+		CHECK(once);
+	}
+}
+
+TEST_CASE(ManyThreadsSubmittingAtOnce)
+{
+	// Outside threads all share the pool's last queue
+	JobSystem jobs(TestWorkers());
+	std::atomic<int> ran(0);
+	std::vector<std::thread> submitters;
+	for (int t = 0; t < 8; t++)
+	{
+		submitters.emplace_back([&]()
+			{
+				JobCounter counter;
+				for (int i = 0; i < 2000; i++)
+					jobs.Run([&]() { ran++; }, &counter);
+				jobs.Wait(&counter);
+			});
+	}
+	for (std::thread& submitter : submitters)
+		submitter.join();
+	CHECK(ran.load() == 8 * 2000);
+}
+
+TEST_CASE(DependentJobsWaitForTheirCounter)
+{
+	JobSystem jobs(TestWorkers());
+	for (int repeat = 0; repeat < 50; repeat++)
+	{
+		JobCounter first;
+		JobCounter second;
+		std::atomic<int> finished(0);
+		std::atomic<int> early(0);
+		for (int i = 0; i < 100; i++)
+		{
+			jobs.Run([&]()
+				{
+					std::this_thread::yield();
+					finished++;
+				}, &first);
+		}
+		for (int i = 0; i < 50; i++)
+		{
+			jobs.Run([&]()
+				{
+					if (finished.load() != 100)
+						early++;
+				}, &second, &first);
+		}
+		jobs.Wait(&second);
+		CHECK(first.IsDone());
+		CHECK(early.load() == 0);
+	}
+}
+
+TEST_CASE(DependingOnAFinishedCounterRunsImmediately)
+{
+	JobSystem jobs(TestWorkers());
+	JobCounter done;
+	JobCounter after;
+	std::atomic<bool> ran(false);
+	jobs.Run([&]() { ran = true; }, &after, &done);
+	jobs.Wait(&after);
+	CHECK(ran.load());
+}
+
+TEST_CASE(WaitingInsideJobsDoesNotDeadlock)
+{
+	// Every worker blocks in a nested ParallelFor at once
+	JobSystem jobs(TestWorkers());
+	for (int repeat = 0; repeat < 20; repeat++)
+	{
+		std::atomic<int> total(0);
+		JobCounter counter;
+		for (int i = 0; i < 32; i++)
+		{
+			jobs.Run([&]()
+				{
+					jobs.ParallelFor(1000, 10, [&](size_t first, size_t last) { total += (int)(last - first); });
+				}, &counter);
+		}
+		jobs.Wait(&counter);
+		CHECK(total.load() == 32 * 1000);
+	}
+}
+
+TEST_CASE(IdleWorkersStealQueuedJobs)
+{
+	// One job fans out from a worker's own queue, so the only way
+	// the others get any of it is by stealing.  The chunks sleep so
+	// the other workers get a turn even on a single core.
+	JobSystem jobs(TestWorkers());
+	JobCounter outer;
+	std::atomic<int> total(0);
+	jobs.Run([&]()
+		{
+			jobs.ParallelFor(20000, 100, [&](size_t first, size_t last)
+				{
+					std::this_thread::sleep_for(std::chrono::microseconds(100));
+					for (size_t i = first; i < last; i++)
+						total += (int)(i & 1);
+				});
+		}, &outer);
+	jobs.Wait(&outer);
+	CHECK(total.load() == 10000);
+	CHECK(jobs.GetStealCount() > 0);
+}
+
+TEST_CASE(NoWorkersRunsEverythingOnTheCaller)
+{
+	JobSystem jobs(0);
+	CHECK(jobs.GetWorkerCount() == 0);
+	std::thread::id caller = std::this_thread::get_id();
+	std::atomic<int> elsewhere(0);
+	std::atomic<int> total(0);
+	jobs.ParallelFor(100, 10, [&](size_t first, size_t last)
+		{
+			if (std::this_thread::get_id() != caller)
+				elsewhere++;
+			total += (int)(last - first);
+		});
+	CHECK(total.load() == 100);
+	CHECK(elsewhere.load() == 0);
+}
+
+TEST_CASE(ShutdownWithIdleWorkers)
+{
+	for (int repeat = 0; repeat < 20; repeat++)
+	{
+		JobSystem jobs(TestWorkers());
+		JobCounter counter;
+		jobs.Run([]() {}, &counter);
+		jobs.Wait(&counter);
+	}
+}
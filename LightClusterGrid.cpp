@@ -0,0 +1,225 @@
+#include "LightClusterGrid.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+LightClusterGrid::LightClusterGrid(unsigned int tilesX, unsigned int tilesY, unsigned int slices) :
+	tilesX(tilesX),
+	tilesY(tilesY),
+	slices(slices),
+	projection(),
+	nearPlane(0.0f),
+	farPlane(0.0f),
+	sliceScale(0.0f),
+	sliceBias(0.0f),
+	clusters(tilesX * tilesY * slices, LightCluster{ 0, 0 }),
+	stats()
+{
+}
+
+void LightClusterGrid::SetProjection(const XMFLOAT4X4& projection)
+{
+	if (!clusterBounds.empty() && memcmp(&projection, &this->projection, sizeof(projection)) == 0)
+		return;
+	this->projection = projection;
+
+	// Straight out of XMMatrixPerspectiveFovLH's depth terms
+	nearPlane = -projection._43 / projection._33;
+	farPlane = projection._43 / (1.0f - projection._33);
+	float logRatio = logf(farPlane / nearPlane);
+	sliceScale = slices / logRatio;
+	sliceBias = slices * logf(nearPlane) / logRatio;
+
+	// Tiles split NDC evenly, so each boundary is a plane through
+	// the eye at x = (ndc / xScale) * z
+	columnBoundaries.resize(tilesX + 1);
+	for (unsigned int i = 0; i <= tilesX; i++)
+	{
+		float slope = (-1.0f + 2.0f * i / tilesX) / projection._11;
+		columnBoundaries[i] = XMFLOAT2(slope, 1.0f / sqrtf(1.0f + slope * slope));
+	}
+	rowBoundaries.resize(tilesY + 1);
+	for (unsigned int i = 0; i <= tilesY; i++)
+	{
+		float slope = (-1.0f + 2.0f * i / tilesY) / projection._22;
+		rowBoundaries[i] = XMFLOAT2(slope, 1.0f / sqrtf(1.0f + slope * slope));
+	}
+
+	clusterBounds.resize(GetClusterCount());
+	for (unsigned int slice = 0; slice < slices; slice++)
+	{
+		float sliceNear = nearPlane * powf(farPlane / nearPlane, (float)slice / slices);
+		float sliceFar = nearPlane * powf(farPlane / nearPlane, (float)(slice + 1) / slices);
+		for (unsigned int row = 0; row < tilesY; row++)
+		{
+			unsigned int fromBottom = tilesY - 1 - row;
+			float bottom = rowBoundaries[fromBottom].x;
+			float top = rowBoundaries[fromBottom + 1].x;
+			for (unsigned int column = 0; column < tilesX; column++)
+			{
+				float left = columnBoundaries[column].x;
+				float right = columnBoundaries[column + 1].x;
+
+				// Either end of the slice can be the wider one, depending
+				// on which side of the view axis the tile is
+				AABB& box = clusterBounds[GetClusterIndex(column, row, slice)];
+				box.min = XMFLOAT3(
+					std::min(left * sliceNear, left * sliceFar),
+					std::min(bottom * sliceNear, bottom * sliceFar),
+					sliceNear);
+				box.max = XMFLOAT3(
+					std::max(right * sliceNear, right * sliceFar),
+					std::max(top * sliceNear, top * sliceFar),
+					sliceFar);
+			}
+		}
+	}
+}
+
+void LightClusterGrid::Assign(const Light* lights, size_t count, const XMFLOAT4X4& view)
+{
+	pairs.clear();
+	stats = {};
+
+	XMMATRIX viewMatrix = XMLoadFloat4x4(&view);
+	for (size_t i = 0; i < count && !clusterBounds.empty(); i++)
+	{
+		BoundingSphere sphere = GetBounds(lights[i]);
+		XMStoreFloat3(&sphere.center, XMVector3TransformCoord(XMLoadFloat3(&sphere.center), viewMatrix));
+		const XMFLOAT3& center = sphere.center;
+		if (center.z + sphere.radius < nearPlane || center.z - sphere.radius > farPlane)
+			continue;
+
+		unsigned int firstColumn = 0, lastColumn = 0, firstRow = 0, lastRow = 0;
+		if (!TileRange(columnBoundaries, center.x, center.z, sphere.radius, &firstColumn, &lastColumn) ||
+			!TileRange(rowBoundaries, center.y, center.z, sphere.radius, &firstRow, &lastRow))
+			continue;
+
+		// The ranges make a box of clusters; its corners often miss the sphere
+		bool visible = false;
+		unsigned int lastSlice = GetSlice(center.z + sphere.radius);
+		for (unsigned int slice = GetSlice(center.z - sphere.radius); slice <= lastSlice; slice++)
+		{
+			for (unsigned int fromBottom = firstRow; fromBottom <= lastRow; fromBottom++)
+			{
+				for (unsigned int column = firstColumn; column <= lastColumn; column++)
+				{
+					unsigned int cluster = GetClusterIndex(column, tilesY - 1 - fromBottom, slice);
+					if (!Bounds::Overlaps(clusterBounds[cluster], sphere))
+						continue;
+					pairs.push_back(((unsigned long long)cluster << 32) | i);
+					visible = true;
+				}
+			}
+		}
+		if (visible)
+			stats.visibleLights++;
+	}
+
+	// Counting sort by cluster; the pairs were made in light order,
+	// so every cluster's list comes out in light order too
+	clusters.assign(GetClusterCount(), LightCluster{ 0, 0 });
+	for (unsigned long long pair : pairs)
+	{
+		clusters[pair >> 32].count++;
+	}
+	unsigned int offset = 0;
+	for (LightCluster& cluster : clusters)
+	{
+		cluster.offset = offset;
+		offset += cluster.count;
+		if (cluster.count > 0)
+			stats.occupiedClusters++;
+		stats.maxLightsPerCluster = std::max(stats.maxLightsPerCluster, cluster.count);
+		cluster.count = 0;
+	}
+	lightIndices.resize(pairs.size());
+	for (unsigned long long pair : pairs)
+	{
+		LightCluster& cluster = clusters[pair >> 32];
+		lightIndices[cluster.offset + cluster.count++] = (unsigned int)(pair & 0xFFFFFFFF);
+	}
+	stats.indexCount = (unsigned int)lightIndices.size();
+}
+
+// A point light's sphere, or the smallest one around a spot light's cone
+BoundingSphere LightClusterGrid::GetBounds(const Light& light)
+{
+	if (light.type != LightType::Spot || light.spotOuterCos <= 0.0f)
+		return { light.position, light.range };
+
+	// Narrow cones fit a sphere through the tip and the far rim;
+	// wide ones are bounded by the rim itself
+	float cosAngle = light.spotOuterCos;
+	float distance = light.range * cosAngle;
+	float radius = light.range * sqrtf(1.0f - cosAngle * cosAngle);
+	if (cosAngle >= 0.70710678f)
+	{
+		distance = light.range / (2.0f * cosAngle);
+		radius = distance;
+	}
+
+	BoundingSphere sphere;
+	XMStoreFloat3(&sphere.center, XMLoadFloat3(&light.position) + XMLoadFloat3(&light.direction) * distance);
+	sphere.radius = radius;
+	return sphere;
+}
+
+bool LightClusterGrid::TileRange(const std::vector<XMFLOAT2>& boundaries, float lateral, float depth, float radius,
+	unsigned int* first, unsigned int* last)
+{
+	bool found = false;
+	for (unsigned int i = 0; i + 1 < boundaries.size(); i++)
+	{
+		// Signed distances from the tile's two sides, positive to the right
+		float fromLow = (lateral - boundaries[i].x * depth) * boundaries[i].y;
+		float fromHigh = (lateral - boundaries[i + 1].x * depth) * boundaries[i + 1].y;
+		if (fromLow < -radius || fromHigh > radius)
+			continue;
+
+		if (!found)
+			*first = i;
+		*last = i;
+		found = true;
+	}
+	return found;
+}
+
+unsigned int LightClusterGrid::GetTilesX() const { return tilesX; }
+unsigned int LightClusterGrid::GetTilesY() const { return tilesY; }
+unsigned int LightClusterGrid::GetSlices() const { return slices; }
+unsigned int LightClusterGrid::GetClusterCount() const { return tilesX * tilesY * slices; }
+const AABB& LightClusterGrid::GetClusterBounds(unsigned int cluster) const { return clusterBounds[cluster]; }
+const std::vector<LightCluster>& LightClusterGrid::GetClusters() const { return clusters; }
+const std::vector<unsigned int>& LightClusterGrid::GetLightIndices() const { return lightIndices; }
+const LightClusterStats& LightClusterGrid::GetStats() const { return stats; }
+
+unsigned int LightClusterGrid::GetClusterIndex(unsigned int column, unsigned int row, unsigned int slice) const
+{
+	return (slice * tilesY + row) * tilesX + column;
+}
+
+unsigned int LightClusterGrid::GetSlice(float viewDepth) const
+{
+	if (viewDepth <= nearPlane)
+		return 0;
+
+	float slice = floorf(logf(viewDepth) * sliceScale - sliceBias);
+	return (unsigned int)std::min(std::max(slice, 0.0f), (float)(slices - 1));
+}
+
+LightClusterData LightClusterGrid::GetShaderData(float screenWidth, float screenHeight, unsigned int lightCount) const
+{
+	LightClusterData data = {};
+	data.tilesX = tilesX;
+	data.tilesY = tilesY;
+	data.slices = slices;
+	data.lightCount = lightCount;
+	data.screenWidth = screenWidth;
+	data.screenHeight = screenHeight;
+	data.sliceScale = sliceScale;
+	data.sliceBias = sliceBias;
+	return data;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include "Bounds.h"
+#include "BufferStructs.h"
+
+struct LightClusterStats
+{
+	unsigned int visibleLights;			// Touching at least one cluster
+	unsigned int indexCount;			// Light-cluster pairs
+	unsigned int occupiedClusters;
+	unsigned int maxLightsPerCluster;
+};
+
+// --------------------------------------------------------
+// Splits the camera's view frustum into screen tiles and
+// exponentially spaced depth slices, and lists the lights
+// touching each of the resulting clusters
+//
+// - Each light's bounding sphere is narrowed to a range of
+//    columns, rows and slices with the tile planes, then
+//    tested against each of those clusters' view space boxes
+// - The lists are packed back to back in cluster order, so
+//    they upload as one index buffer plus an offset and count
+//    per cluster (see LitPS.hlsl for the lookup)
+// - Clusters are indexed (slice * tilesY + row) * tilesX +
+//    column, with row 0 at the top of the screen
+// - Pure math, so it runs (and is benchmarked) anywhere
+// --------------------------------------------------------
+class LightClusterGrid
+{
+public:
+	LightClusterGrid(unsigned int tilesX = 16, unsigned int tilesY = 9, unsigned int slices = 24);
+
+	// Expects a left-handed perspective projection, and only
+	// rebuilds the cluster bounds when it actually changes
+	void SetProjection(const DirectX::XMFLOAT4X4& projection);
+	void Assign(const Light* lights, size_t count, const DirectX::XMFLOAT4X4& view);
+
+	static BoundingSphere GetBounds(const Light& light);
+
+	unsigned int GetTilesX() const;
+	unsigned int GetTilesY() const;
+	unsigned int GetSlices() const;
+	unsigned int GetClusterCount() const;
+	unsigned int GetClusterIndex(unsigned int column, unsigned int row, unsigned int slice) const;
+	unsigned int GetSlice(float viewDepth) const;
+	const AABB& GetClusterBounds(unsigned int cluster) const;
+
+	const std::vector<LightCluster>& GetClusters() const;
+	const std::vector<unsigned int>& GetLightIndices() const;
+	const LightClusterStats& GetStats() const;
+	LightClusterData GetShaderData(float screenWidth, float screenHeight, unsigned int lightCount) const;
+
+private:
+	// Inclusive range of the tiles between boundary planes x = slope * z
+	// (sorted left to right) that a sphere at (lateral, depth) touches
+	static bool TileRange(const std::vector<DirectX::XMFLOAT2>& boundaries, float lateral, float depth, float radius,
+		unsigned int* first, unsigned int* last);
+
+	unsigned int tilesX;
+	unsigned int tilesY;
+	unsigned int slices;
+	DirectX::XMFLOAT4X4 projection;
+	float nearPlane;
+	float farPlane;
+	float sliceScale;
+	float sliceBias;
+
+	// Slope and 1 / length of each boundary plane's normal
+	std::vector<DirectX::XMFLOAT2> columnBoundaries;
+	std::vector<DirectX::XMFLOAT2> rowBoundaries;		// Bottom to top
+	std::vector<AABB> clusterBounds;
+
+	std::vector<unsigned long long> pairs;			// Cluster << 32 | light
+	std::vector<LightCluster> clusters;
+	std::vector<unsigned int> lightIndices;
+	LightClusterStats stats;
+};
@@ -0,0 +1,361 @@
+#include "LightClusterGrid.h"
+#include "TestHarness.h"
+#include <algorithm>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	const float Width = 1280.0f;
+	const float Height = 720.0f;
+	const float NearPlane = 0.01f;
+	const float FarPlane = 1000.0f;
+
+	XMFLOAT4X4 MakeProjection()
+	{
+		XMFLOAT4X4 projection;
+		XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XMConvertToRadians(60.0f), Width / Height, NearPlane, FarPlane));
+		return projection;
+	}
+
+	XMFLOAT4X4 MakeView()
+	{
+		XMFLOAT4X4 view;
+		XMStoreFloat4x4(&view, XMMatrixLookToLH(XMVectorSet(3, 2, -10, 0), XMVector3Normalize(XMVectorSet(0.2f, -0.1f, 1, 0)), XMVectorSet(0, 1, 0, 0)));
+		return view;
+	}
+
+	XMFLOAT4X4 Identity()
+	{
+		XMFLOAT4X4 identity;
+		XMStoreFloat4x4(&identity, XMMatrixIdentity());
+		return identity;
+	}
+
+	Light PointLight(XMFLOAT3 position, float range)
+	{
+		Light light = {};
+		light.position = position;
+		light.range = range;
+		light.color = XMFLOAT3(1, 1, 1);
+		light.intensity = 1.0f;
+		light.type = LightType::Point;
+		return light;
+	}
+
+	Light SpotLight(XMFLOAT3 position, XMFLOAT3 direction, float range, float outerCos)
+	{
+		Light light = PointLight(position, range);
+		light.type = LightType::Spot;
+		XMStoreFloat3(&light.direction, XMVector3Normalize(XMLoadFloat3(&direction)));
+		light.spotOuterCos = outerCos;
+		light.spotInnerCos = std::min(outerCos + 0.02f, 1.0f);
+		return light;
+	}
+
+	// The same spread of point and spot lights the game scatters, wider
+	std::vector<Light> RandomLights(size_t count, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::vector<Light> lights;
+		for (size_t i = 0; i < count; i++)
+		{
+			XMFLOAT3 position(unit(random) * 60 - 30, unit(random) * 20 - 10, unit(random) * 80 - 10);
+			float range = 1 + unit(random) * 6;
+			if (unit(random) < 0.3f)
+				lights.push_back(SpotLight(position, XMFLOAT3(unit(random) - 0.5f, unit(random) - 0.5f, unit(random) - 0.5f), range, 0.2f + unit(random) * 0.75f));
+			else
+				lights.push_back(PointLight(position, range));
+		}
+		return lights;
+	}
+
+	bool ClusterHasLight(const LightClusterGrid& grid, unsigned int cluster, unsigned int light)
+	{
+		const LightCluster& range = grid.GetClusters()[cluster];
+		for (unsigned int i = 0; i < range.count; i++)
+		{
+			if (grid.GetLightIndices()[range.offset + i] == light)
+				return true;
+		}
+		return false;
+	}
+
+	bool Contains(const BoundingSphere& sphere, XMVECTOR point)
+	{
+		XMVECTOR offset = point - XMLoadFloat3(&sphere.center);
+		return sqrtf(XMVectorGetX(XMVector3Dot(offset, offset))) <= sphere.radius * 1.0001f;
+	}
+}
+
+TEST_CASE(SlicesAreSpacedExponentially)
+{
+	LightClusterGrid grid(16, 9, 24);
+	grid.SetProjection(MakeProjection());
+
+	// Each slice covers the same ratio of depths, and starts where
+	// the last one ended
+	const AABB& first = grid.GetClusterBounds(grid.GetClusterIndex(0, 0, 0));
+	float ratio = first.max.z / first.min.z;
+	CHECK_NEAR(first.min.z, NearPlane, NearPlane * 0.001f);
+	for (unsigned int slice = 0; slice < 24; slice++)
+	{
+		const AABB& bounds = grid.GetClusterBounds(grid.GetClusterIndex(0, 0, slice));
+		CHECK_NEAR(bounds.max.z / bounds.min.z, ratio, ratio * 0.001f);
+		if (slice > 0)
+			CHECK(bounds.min.z == grid.GetClusterBounds(grid.GetClusterIndex(0, 0, slice - 1)).max.z);
+
+		CHECK(grid.GetSlice(bounds.min.z * 1.01f) == slice);
+		CHECK(grid.GetSlice(bounds.max.z * 0.99f) == slice);
+	}
+
+	// The far plane comes back out of the projection a little short
+	const AABB& last = grid.GetClusterBounds(grid.GetClusterIndex(0, 0, 23));
+	CHECK_NEAR(last.max.z, FarPlane, FarPlane * 0.005f);
+
+	// Outside the depth range clamps to the first and last slices
+	CHECK(grid.GetSlice(0.0f) == 0);
+	CHECK(grid.GetSlice(-5.0f) == 0);
+	CHECK(grid.GetSlice(FarPlane * 10.0f) == 23);
+}
+
+TEST_CASE(ShaderDataMatchesTheSliceMapping)
+{
+	LightClusterGrid grid(16, 9, 24);
+	grid.SetProjection(MakeProjection());
+	LightClusterData data = grid.GetShaderData(Width, Height, 7);
+	CHECK(data.tilesX == 16 && data.tilesY == 9 && data.slices == 24);
+	CHECK(data.lightCount == 7);
+	CHECK(data.screenWidth == Width && data.screenHeight == Height);
+
+	// LitPS.hlsl's lookup gives the same slice as GetSlice()
+	for (float depth = 0.02f; depth < FarPlane; depth *= 1.37f)
+	{
+		float slice = floorf(logf(depth) * data.sliceScale - data.sliceBias);
+		unsigned int clamped = (unsigned int)std::min(std::max(slice, 0.0f), (float)(data.slices - 1));
+		CHECK(clamped == grid.GetSlice(depth));
+	}
+}
+
+TEST_CASE(ClustersAreIndexedSliceRowColumn)
+{
+	LightClusterGrid grid(4, 3, 2);
+	CHECK(grid.GetClusterCount() == 24);
+	CHECK(grid.GetClusterIndex(0, 0, 0) == 0);
+	CHECK(grid.GetClusterIndex(3, 0, 0) == 3);
+	CHECK(grid.GetClusterIndex(0, 1, 0) == 4);
+	CHECK(grid.GetClusterIndex(0, 0, 1) == 12);
+	CHECK(grid.GetClusterIndex(3, 2, 1) == 23);
+
+	// Row 0 is the top of the screen, column 0 the left
+	grid.SetProjection(MakeProjection());
+	const AABB& topLeft = grid.GetClusterBounds(grid.GetClusterIndex(0, 0, 1));
+	const AABB& bottomRight = grid.GetClusterBounds(grid.GetClusterIndex(3, 2, 1));
+	CHECK(topLeft.max.x < 0.0f && topLeft.min.y > 0.0f);
+	CHECK(bottomRight.min.x > 0.0f && bottomRight.max.y < 0.0f);
+}
+
+TEST_CASE(PointBoundsAreTheLightsRange)
+{
+	Light light = PointLight(XMFLOAT3(1, 2, 3), 4.0f);
+	BoundingSphere sphere = LightClusterGrid::GetBounds(light);
+	CHECK(sphere.center.x == 1 && sphere.center.y == 2 && sphere.center.z == 3);
+	CHECK(sphere.radius == 4.0f);
+
+	// A spot past 90 degrees is treated as a point light
+	Light wide = SpotLight(XMFLOAT3(1, 2, 3), XMFLOAT3(0, 0, 1), 4.0f, -0.1f);
+	CHECK(LightClusterGrid::GetBounds(wide).radius == 4.0f);
+}
+
+TEST_CASE(SpotBoundsHoldTheWholeCone)
+{
+	XMFLOAT3 position(2, -1, 5);
+	XMFLOAT3 direction(0.3f, 0.5f, -0.8f);
+	for (float outerCos = 0.05f; outerCos < 1.0f; outerCos += 0.05f)
+	{
+		Light light = SpotLight(position, direction, 6.0f, outerCos);
+		BoundingSphere sphere = LightClusterGrid::GetBounds(light);
+
+		// Never bigger than the point light it would otherwise be
+		CHECK(sphere.radius <= light.range);
+		CHECK(Contains(sphere, XMLoadFloat3(&position)));
+
+		// Every direction on the outer cone, out to the full range
+		const XMFLOAT3& d = light.direction;
+		XMVECTOR axis = XMLoadFloat3(&d);
+		XMVECTOR side = XMVector3Normalize(XMVectorSet(-d.z, 0, d.x, 0));
+		XMFLOAT3 s;
+		XMStoreFloat3(&s, side);
+		XMVECTOR up = XMVectorSet(s.y * d.z - s.z * d.y, s.z * d.x - s.x * d.z, s.x * d.y - s.y * d.x, 0);
+		float sinAngle = sqrtf(1.0f - outerCos * outerCos);
+		bool holdsCone = true;
+		for (int step = 0; step < 32; step++)
+		{
+			float around = XM_2PI * step / 32;
+			XMVECTOR rim = axis * outerCos + (side * cosf(around) + up * sinf(around)) * sinAngle;
+			for (float distance = 0.5f; distance <= light.range; distance += 0.5f)
+				holdsCone &= Contains(sphere, XMLoadFloat3(&position) + rim * distance);
+			holdsCone &= Contains(sphere, XMLoadFloat3(&position) + axis * light.range);
+		}
+		CHECK(holdsCone);
+	}
+
+	// A narrow cone's sphere is much smaller than its range
+	Light narrow = SpotLight(position, direction, 6.0f, cosf(XMConvertToRadians(15.0f)));
+	CHECK(LightClusterGrid::GetBounds(narrow).radius < 3.2f);
+}
+
+TEST_CASE(LightsOnlyGoInClustersTheirSpheresTouch)
+{
+	std::mt19937 random(3);
+	std::vector<Light> lights = RandomLights(1000, random);
+	XMFLOAT4X4 view = MakeView();
+	LightClusterGrid grid(16, 9, 24);
+	grid.SetProjection(MakeProjection());
+	grid.Assign(lights.data(), lights.size(), view);
+
+	// Against every cluster's box, by brute force
+	XMMATRIX viewMatrix = XMLoadFloat4x4(&view);
+	std::vector<BoundingSphere> spheres;
+	for (const Light& light : lights)
+	{
+		BoundingSphere sphere = LightClusterGrid::GetBounds(light);
+		XMStoreFloat3(&sphere.center, XMVector3TransformCoord(XMLoadFloat3(&sphere.center), viewMatrix));
+		spheres.push_back(sphere);
+	}
+
+	bool onlyOverlapping = true;
+	bool inLightOrder = true;
+	for (unsigned int cluster = 0; cluster < grid.GetClusterCount(); cluster++)
+	{
+		const LightCluster& range = grid.GetClusters()[cluster];
+		for (unsigned int i = 0; i < range.count; i++)
+		{
+			unsigned int light = grid.GetLightIndices()[range.offset + i];
+			onlyOverlapping &= Bounds::Overlaps(grid.GetClusterBounds(cluster), spheres[light]);
+			inLightOrder &= i == 0 || light > grid.GetLightIndices()[range.offset + i - 1];
+		}
+	}
+	CHECK(onlyOverlapping);
+	CHECK(inLightOrder);
+
+	// Every light whose center is inside the frustum is in that center's cluster
+	XMFLOAT4X4 projectionValues = MakeProjection();
+	XMMATRIX projection = XMLoadFloat4x4(&projectionValues);
+	size_t checked = 0;
+	bool centersFound = true;
+	for (unsigned int i = 0; i < spheres.size(); i++)
+	{
+		XMVECTOR clip = XMVector4Transform(XMVectorSetW(XMLoadFloat3(&spheres[i].center), 1.0f), projection);
+		float w = XMVectorGetW(clip);
+		float x = XMVectorGetX(clip) / w;
+		float y = XMVectorGetY(clip) / w;
+		if (w <= NearPlane || fabsf(x) >= 1.0f || fabsf(y) >= 1.0f || spheres[i].center.z >= FarPlane)
+			continue;
+
+		unsigned int column = (unsigned int)((x * 0.5f + 0.5f) * 16);
+		unsigned int row = (unsigned int)((0.5f - y * 0.5f) * 9);
+		centersFound &= ClusterHasLight(grid, grid.GetClusterIndex(column, row, grid.GetSlice(spheres[i].center.z)), i);
+		checked++;
+	}
+	CHECK(checked > 100);
+	CHECK(centersFound);
+}
+
+TEST_CASE(LitPointsFindTheirLights)
+{
+	// What LitPS.hlsl does per pixel: any point a light reaches must
+	// have that light in the cluster it lands in
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::vector<Light> lights = RandomLights(500, random);
+	XMFLOAT4X4 view = MakeView();
+	XMFLOAT4X4 projection = MakeProjection();
+	LightClusterGrid grid(16, 9, 24);
+	grid.SetProjection(projection);
+	grid.Assign(lights.data(), lights.size(), view);
+	LightClusterData data = grid.GetShaderData(Width, Height, (unsigned int)lights.size());
+
+	XMMATRIX viewMatrix = XMLoadFloat4x4(&view);
+	XMMATRIX viewProjection = viewMatrix * XMLoadFloat4x4(&projection);
+	size_t checked = 0;
+	bool allFound = true;
+	for (int sample = 0; sample < 50000; sample++)
+	{
+		unsigned int index = random() % lights.size();
+		const Light& light = lights[index];
+		XMVECTOR direction = XMVector3Normalize(XMVectorSet(unit(random) - 0.5f, unit(random) - 0.5f, unit(random) - 0.5f, 0));
+		XMVECTOR point = XMLoadFloat3(&light.position) + direction * (light.range * unit(random));
+		if (light.type == LightType::Spot && XMVectorGetX(XMVector3Dot(direction, XMLoadFloat3(&light.direction))) < light.spotOuterCos)
+			continue;
+
+		XMVECTOR clip = XMVector4Transform(XMVectorSetW(point, 1.0f), viewProjection);
+		float w = XMVectorGetW(clip);
+		if (w <= NearPlane)
+			continue;
+		float x = XMVectorGetX(clip) / w;
+		float y = XMVectorGetY(clip) / w;
+		float z = XMVectorGetZ(clip) / w;
+		if (fabsf(x) >= 1.0f || fabsf(y) >= 1.0f || z < 0.0f || z > 1.0f)
+			continue;
+
+		unsigned int column = (unsigned int)((x * 0.5f + 0.5f) * Width * data.tilesX / data.screenWidth);
+		unsigned int row = (unsigned int)((0.5f - y * 0.5f) * Height * data.tilesY / data.screenHeight);
+		float viewDepth = XMVectorGetZ(XMVector3TransformCoord(point, viewMatrix));
+		allFound &= ClusterHasLight(grid, grid.GetClusterIndex(column, row, grid.GetSlice(viewDepth)), index);
+		checked++;
+	}
+	CHECK(checked > 1000);
+	CHECK(allFound);
+}
+
+TEST_CASE(ListsArePackedBackToBack)
+{
+	std::mt19937 random(11);
+	std::vector<Light> lights = RandomLights(300, random);
+	LightClusterGrid grid(16, 9, 24);
+	grid.SetProjection(MakeProjection());
+	grid.Assign(lights.data(), lights.size(), MakeView());
+
+	const LightClusterStats& stats = grid.GetStats();
+	unsigned int offset = 0;
+	unsigned int occupied = 0;
+	unsigned int most = 0;
+	for (const LightCluster& cluster : grid.GetClusters())
+	{
+		CHECK(cluster.offset == offset);
+		offset += cluster.count;
+		occupied += cluster.count > 0;
+		most = std::max(most, cluster.count);
+	}
+	CHECK(offset == grid.GetLightIndices().size());
+	CHECK(stats.indexCount == offset);
+	CHECK(stats.occupiedClusters == occupied);
+	CHECK(stats.maxLightsPerCluster == most);
+	CHECK(stats.visibleLights > 0 && stats.visibleLights <= lights.size());
+}
+
+TEST_CASE(LightsOutsideTheFrustumAreSkipped)
+{
+	LightClusterGrid grid(16, 9, 24);
+	grid.SetProjection(MakeProjection());
+	Light lights[] =
+	{
+		PointLight(XMFLOAT3(0, 0, -5), 2.0f),			// Behind the camera
+		PointLight(XMFLOAT3(0, 0, FarPlane + 10), 5.0f),	// Past the far plane
+		PointLight(XMFLOAT3(500, 0, 10), 5.0f),			// Far off to the side
+		SpotLight(XMFLOAT3(0, 0, -1), XMFLOAT3(0, 0, -1), 5.0f, 0.9f),	// Pointing away
+		PointLight(XMFLOAT3(0, 0, 10), 1.0f),			// The one that's visible
+	};
+	grid.Assign(lights, 5, Identity());
+	CHECK(grid.GetStats().visibleLights == 1);
+	for (unsigned int light : grid.GetLightIndices())
+		CHECK(light == 4);
+
+	// Nothing is assigned before there's a projection
+	LightClusterGrid unset(16, 9, 24);
+	unset.Assign(lights, 5, Identity());
+	CHECK(unset.GetLightIndices().empty());
+	CHECK(unset.GetStats().visibleLights == 0);
+}
@@ -0,0 +1,120 @@
+cbuffer PerFrame : register(b0)
+{
+    matrix view;
+    matrix projection;
+    matrix viewProjection;
+    float time;
+}
+
+// Every material drawn with this shader, indexed by the
+// material ID each instance carries
+struct MaterialParameters
+{
+    float4 colorTint;
+};
+
+StructuredBuffer<MaterialParameters> materials : register(t0);
+
+// Matches Light in BufferStructs.h
+struct Light
+{
+    float3 position;
+    float range;
+    float3 color;
+    float intensity;
+    float3 direction;
+    uint type;
+    float spotInnerCos;
+    float spotOuterCos;
+    float2 padding;
+};
+
+#define LIGHT_TYPE_SPOT 1
+
+// Culled on the CPU (see LightClusterGrid): each cluster of the
+// view frustum has an offset and count into the index list
+StructuredBuffer<Light> lights : register(t1);
+StructuredBuffer<uint2> lightClusters : register(t2);
+StructuredBuffer<uint> lightIndices : register(t3);
+
+cbuffer LightClusterData : register(b2)
+{
+    uint tilesX;
+    uint tilesY;
+    uint slices;
+    uint lightCount;
+    float2 screenSize;
+    float sliceScale;
+    float sliceBias;
+}
+
+static const float3 ambientColor = float3(0.08f, 0.08f, 0.1f);
+
+// Struct representing the data we expect to receive from earlier pipeline stages
+// - Should match the output of our corresponding vertex shader
+// - The name of the struct itself is unimportant
+// - The variable names don't have to match other shaders (just the semantics)
+// - Each variable must have a semantic, which defines its usage
+struct VertexToPixel
+{
+	// Data type
+	//  |
+	//  |   Name          Semantic
+	//  |    |                |
+	//  v    v                v
+	float4 screenPosition	: SV_POSITION;
+    float2 uv				: TEXCOORD;
+	float3 normal			: NORMAL;
+	nointerpolation uint materialId : MATERIAL;
+	float3 worldPosition	: POSITION;
+	float3 worldNormal		: WORLDNORMAL;
+};
+
+// Which cluster a pixel falls in - the same split LightClusterGrid makes
+uint GetCluster(float2 pixel, float viewDepth)
+{
+    uint2 tile = min(uint2(pixel * float2(tilesX, tilesY) / screenSize), uint2(tilesX - 1, tilesY - 1));
+    uint slice = (uint)clamp(floor(log(viewDepth) * sliceScale - sliceBias), 0.0f, slices - 1.0f);
+    return (slice * tilesY + tile.y) * tilesX + tile.x;
+}
+
+// Diffuse only, fading smoothly to nothing at the light's range
+float3 ShadeLight(Light light, float3 position, float3 normal)
+{
+    float3 toLight = light.position - position;
+    float distance = length(toLight);
+    float3 direction = toLight / max(distance, 0.0001f);
+
+    float attenuation = saturate(1.0f - distance / light.range);
+    attenuation *= attenuation;
+    if (light.type == LIGHT_TYPE_SPOT)
+        attenuation *= smoothstep(light.spotOuterCos, light.spotInnerCos, dot(-direction, light.direction));
+
+    return light.color * light.intensity * saturate(dot(normal, direction)) * attenuation;
+}
+
+// --------------------------------------------------------
+// The entry point (main method) for our pixel shader
+// 
+// - Input is the data coming down the pipeline (defined by the struct)
+// - Output is a single color (float4)
+// - Has a special semantic (SV_TARGET), which means 
+//    "put the output of this into the current render target"
+// - Named "main" because that's the default the shader compiler looks for
+// --------------------------------------------------------
+float4 main(VertexToPixel input) : SV_TARGET
+{
+    float3 normal = normalize(input.worldNormal);
+    float viewDepth = mul(view, float4(input.worldPosition, 1.0f)).z;
+    uint2 cluster = lightClusters[GetCluster(input.screenPosition.xy, viewDepth)];
+
+    // Only the lights the CPU found touching this cluster
+    float3 lighting = ambientColor;
+    for (uint i = 0; i < cluster.y; i++)
+    {
+        lighting += ShadeLight(lights[lightIndices[cluster.x + i]], input.worldPosition, normal);
+    }
+
+    float4 tint = materials[input.materialId].colorTint;
+    return float4(tint.rgb * lighting, tint.a);
+}
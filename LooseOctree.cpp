@@ -0,0 +1,286 @@
+#include "LooseOctree.h"
+#include <cmath>
+
+using namespace DirectX;
+
+LooseOctree::LooseOctree(const AABB& worldBounds, int maxDepth) :
+	proxyCount(0),
+	worldBounds(worldBounds),
+	maxDepth(maxDepth)
+{
+	Clear();
+}
+
+int LooseOctree::Insert(const AABB& bounds, unsigned int userData)
+{
+	int proxy;
+	if (!freeProxies.empty())
+	{
+		proxy = freeProxies.back();
+		freeProxies.pop_back();
+	}
+	else
+	{
+		proxy = (int)proxies.size();
+		proxies.push_back(Proxy());
+	}
+
+	proxies[proxy].bounds = bounds;
+	proxies[proxy].userData = userData;
+	Link(proxy, FindNode(bounds));
+	proxyCount++;
+	return proxy;
+}
+
+void LooseOctree::Remove(int proxy)
+{
+	Unlink(proxy);
+	proxies[proxy].node = NullProxy;
+	freeProxies.push_back(proxy);
+	proxyCount--;
+}
+
+// --------------------------------------------------------
+// Stores an object's new bounds, moving it to another node
+// only if it no longer belongs in its current one
+// --------------------------------------------------------
+bool LooseOctree::Update(int proxy, const AABB& bounds)
+{
+	proxies[proxy].bounds = bounds;
+	if (BelongsIn(proxies[proxy].node, bounds))
+		return false;
+
+	int node = FindNode(bounds);
+	if (node == proxies[proxy].node)
+		return false;
+
+	Unlink(proxy);
+	Link(proxy, node);
+	return true;
+}
+
+void LooseOctree::Clear()
+{
+	nodes.clear();
+	proxies.clear();
+	freeProxies.clear();
+	proxyCount = 0;
+
+	// The root is a cube around the world bounds
+	XMFLOAT3 center = Bounds::Center(worldBounds);
+	float halfSize = fmaxf(worldBounds.max.x - worldBounds.min.x,
+		fmaxf(worldBounds.max.y - worldBounds.min.y, worldBounds.max.z - worldBounds.min.z)) * 0.5f;
+	CreateNode(center, halfSize, NullProxy, 0);
+
+	// The root also holds whatever falls outside the world, so it
+	// can never be culled on its own bounds
+	nodes[0].looseBounds.min = XMFLOAT3(-1e30f, -1e30f, -1e30f);
+	nodes[0].looseBounds.max = XMFLOAT3(1e30f, 1e30f, 1e30f);
+}
+
+void LooseOctree::QueryFrustum(const Frustum& frustum, std::vector<unsigned int>& results) const
+{
+	std::vector<int> stack;
+	stack.push_back(0);
+	while (!stack.empty())
+	{
+		const Node& node = nodes[stack.back()];
+		int index = stack.back();
+		stack.pop_back();
+		if (node.subtreeCount == 0)
+			continue;
+
+		FrustumTest test = Bounds::TestFrustum(frustum, node.looseBounds);
+		if (test == FrustumTest::Outside)
+			continue;
+
+		// Everything under a fully visible node is visible too
+		if (test == FrustumTest::Inside)
+		{
+			CollectSubtree(index, results);
+			continue;
+		}
+
+		for (int proxy : node.proxies)
+		{
+			if (Bounds::TestFrustum(frustum, proxies[proxy].bounds) != FrustumTest::Outside)
+				results.push_back(proxies[proxy].userData);
+		}
+		for (int child : node.children)
+		{
+			if (child != NullProxy) stack.push_back(child);
+		}
+	}
+}
+
+void LooseOctree::QueryAABB(const AABB& bounds, std::vector<unsigned int>& results) const
+{
+	QueryObjects([&bounds](const AABB& box) { return Bounds::Overlaps(box, bounds); }, results);
+}
+
+void LooseOctree::QuerySphere(const BoundingSphere& sphere, std::vector<unsigned int>& results) const
+{
+	QueryObjects([&sphere](const AABB& box) { return Bounds::Overlaps(box, sphere); }, results);
+}
+
+void LooseOctree::QueryRay(const Ray& ray, float maxDistance, std::vector<unsigned int>& results) const
+{
+	QueryObjects([&ray, maxDistance](const AABB& box) { return Bounds::IntersectRay(ray, box, maxDistance, 0); }, results);
+}
+
+template<typename Test>
+void LooseOctree::QueryObjects(const Test& overlaps, std::vector<unsigned int>& results) const
+{
+	std::vector<int> stack;
+	stack.push_back(0);
+	while (!stack.empty())
+	{
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+		if (node.subtreeCount == 0 || !overlaps(node.looseBounds))
+			continue;
+
+		for (int proxy : node.proxies)
+		{
+			if (overlaps(proxies[proxy].bounds))
+				results.push_back(proxies[proxy].userData);
+		}
+		for (int child : node.children)
+		{
+			if (child != NullProxy) stack.push_back(child);
+		}
+	}
+}
+
+size_t LooseOctree::GetProxyCount() const { return proxyCount; }
+const char* LooseOctree::GetName() const { return "Loose Octree"; }
+size_t LooseOctree::GetNodeCount() const { return nodes.size(); }
+
+int LooseOctree::CreateNode(const XMFLOAT3& center, float halfSize, int parent, int depth)
+{
+	Node node = {};
+	node.center = center;
+	node.halfSize = halfSize;
+	node.looseBounds.min = XMFLOAT3(center.x - 2 * halfSize, center.y - 2 * halfSize, center.z - 2 * halfSize);
+	node.looseBounds.max = XMFLOAT3(center.x + 2 * halfSize, center.y + 2 * halfSize, center.z + 2 * halfSize);
+	node.parent = parent;
+	node.depth = depth;
+	for (int& child : node.children) child = NullProxy;
+
+	nodes.push_back(node);
+	return (int)nodes.size() - 1;
+}
+
+// --------------------------------------------------------
+// Walks down from the root to the deepest node that can hold
+// the bounds, creating nodes along the way
+// --------------------------------------------------------
+int LooseOctree::FindNode(const AABB& bounds)
+{
+	XMFLOAT3 center = Bounds::Center(bounds);
+	float radius = fmaxf(bounds.max.x - bounds.min.x,
+		fmaxf(bounds.max.y - bounds.min.y, bounds.max.z - bounds.min.z)) * 0.5f;
+
+	// Anything whose center is outside the world stays in the root
+	const Node& root = nodes[0];
+	if (fabsf(center.x - root.center.x) > root.halfSize ||
+		fabsf(center.y - root.center.y) > root.halfSize ||
+		fabsf(center.z - root.center.z) > root.halfSize)
+		return 0;
+
+	int index = 0;
+	while (nodes[index].depth < maxDepth)
+	{
+		// A child's loose bounds reach half its cell past the edges,
+		// so it can hold anything no wider than its own cell
+		float childHalfSize = nodes[index].halfSize * 0.5f;
+		if (radius > childHalfSize)
+			break;
+
+		XMFLOAT3 nodeCenter = nodes[index].center;
+		int octant =
+			(center.x >= nodeCenter.x ? 1 : 0) |
+			(center.y >= nodeCenter.y ? 2 : 0) |
+			(center.z >= nodeCenter.z ? 4 : 0);
+
+		if (nodes[index].children[octant] == NullProxy)
+		{
+			XMFLOAT3 childCenter(
+				nodeCenter.x + (octant & 1 ? childHalfSize : -childHalfSize),
+				nodeCenter.y + (octant & 2 ? childHalfSize : -childHalfSize),
+				nodeCenter.z + (octant & 4 ? childHalfSize : -childHalfSize));
+			int child = CreateNode(childCenter, childHalfSize, index, nodes[index].depth + 1);
+			nodes[index].children[octant] = child;
+		}
+		index = nodes[index].children[octant];
+	}
+	return index;
+}
+
+// --------------------------------------------------------
+// True if the bounds still fit the node's loose bounds and
+// are too big to move any deeper
+// --------------------------------------------------------
+bool LooseOctree::BelongsIn(int index, const AABB& bounds) const
+{
+	const Node& node = nodes[index];
+	if (index == 0 || !Bounds::Contains(node.looseBounds, bounds))
+		return false;
+
+	if (node.depth == maxDepth)
+		return true;
+
+	float radius = fmaxf(bounds.max.x - bounds.min.x,
+		fmaxf(bounds.max.y - bounds.min.y, bounds.max.z - bounds.min.z)) * 0.5f;
+	return radius > node.halfSize * 0.5f;
+}
+
+void LooseOctree::Link(int proxy, int node)
+{
+	proxies[proxy].node = node;
+	proxies[proxy].slot = nodes[node].proxies.size();
+	nodes[node].proxies.push_back(proxy);
+
+	for (int index = node; index != NullProxy; index = nodes[index].parent)
+	{
+		nodes[index].subtreeCount++;
+	}
+}
+
+void LooseOctree::Unlink(int proxy)
+{
+	// Swap the last proxy in the node into this one's slot
+	int node = proxies[proxy].node;
+	std::vector<int>& list = nodes[node].proxies;
+	size_t slot = proxies[proxy].slot;
+	list[slot] = list.back();
+	proxies[list[slot]].slot = slot;
+	list.pop_back();
+
+	for (int index = node; index != NullProxy; index = nodes[index].parent)
+	{
+		nodes[index].subtreeCount--;
+	}
+}
+
+void LooseOctree::CollectSubtree(int node, std::vector<unsigned int>& results) const
+{
+	std::vector<int> stack;
+	stack.push_back(node);
+	while (!stack.empty())
+	{
+		const Node& current = nodes[stack.back()];
+		stack.pop_back();
+		if (current.subtreeCount == 0)
+			continue;
+
+		for (int proxy : current.proxies)
+		{
+			results.push_back(proxies[proxy].userData);
+		}
+		for (int child : current.children)
+		{
+			if (child != NullProxy) stack.push_back(child);
+		}
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <vector>
+#include "SpatialPartition.h"
+
+// --------------------------------------------------------
+// A loose octree for scenes full of moving objects
+//
+// - Every node's bounds are its cell doubled in size, so an
+//    object lives in the deepest node big enough for it whose
+//    cell holds its center - no object ever straddles nodes
+// - An object only relinks when it leaves its node's loose
+//    bounds or shrinks enough to fit a level deeper, so most
+//    movement is a single containment test
+// - Nodes are created on demand; objects outside the world
+//    bounds stay in the root
+// --------------------------------------------------------
+class LooseOctree : public SpatialPartition
+{
+public:
+	LooseOctree(const AABB& worldBounds, int maxDepth = 6);
+
+	int Insert(const AABB& bounds, unsigned int userData) override;
+	void Remove(int proxy) override;
+	bool Update(int proxy, const AABB& bounds) override;
+	void Clear() override;
+
+	void QueryFrustum(const Frustum& frustum, std::vector<unsigned int>& results) const override;
+	void QueryAABB(const AABB& bounds, std::vector<unsigned int>& results) const override;
+	void QuerySphere(const BoundingSphere& sphere, std::vector<unsigned int>& results) const override;
+	void QueryRay(const Ray& ray, float maxDistance, std::vector<unsigned int>& results) const override;
+
+	size_t GetProxyCount() const override;
+	const char* GetName() const override;
+
+	size_t GetNodeCount() const;
+
+private:
+	struct Node
+	{
+		DirectX::XMFLOAT3 center;
+		float halfSize;			// Of the cell - the loose bounds are twice this
+		AABB looseBounds;
+		int parent;
+		int children[8];
+		int depth;
+		size_t subtreeCount;	// Objects in this node and everything below it
+		std::vector<int> proxies;
+	};
+
+	struct Proxy
+	{
+		AABB bounds;
+		unsigned int userData;
+		int node;				// NullProxy while free
+		size_t slot;			// Position in the node's proxy list
+	};
+
+	std::vector<Node> nodes;
+	std::vector<Proxy> proxies;
+	std::vector<int> freeProxies;
+	size_t proxyCount;
+	AABB worldBounds;
+	int maxDepth;
+
+	int CreateNode(const DirectX::XMFLOAT3& center, float halfSize, int parent, int depth);
+	int FindNode(const AABB& bounds);
+	bool BelongsIn(int node, const AABB& bounds) const;
+	void Link(int proxy, int node);
+	void Unlink(int proxy);
+	void CollectSubtree(int node, std::vector<unsigned int>& results) const;
+
+	// Shared traversal for the overlap queries
+	template<typename Test> void QueryObjects(const Test& overlaps, std::vector<unsigned int>& results) const;
+};
@@ -0,0 +1,285 @@
+#include "LooseOctree.h"
+#include "TestHarness.h"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	// A 128 unit cube, so the deepest cells (depth 6) are 2 units wide
+	const AABB World = { XMFLOAT3(-64, -64, -64), XMFLOAT3(64, 64, 64) };
+
+	AABB MakeBox(float x, float y, float z, float halfSize)
+	{
+		return { XMFLOAT3(x - halfSize, y - halfSize, z - halfSize), XMFLOAT3(x + halfSize, y + halfSize, z + halfSize) };
+	}
+
+	// Some fall partly or entirely outside the world
+	AABB RandomBox(std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> position(-80.0f, 80.0f);
+		std::uniform_real_distribution<float> size(0.1f, 6.0f);
+		return MakeBox(position(random), position(random), position(random), size(random));
+	}
+
+	std::vector<unsigned int> Sorted(std::vector<unsigned int> values)
+	{
+		std::sort(values.begin(), values.end());
+		return values;
+	}
+
+	// An octree put through a random mix of inserts, moves and
+	// removes, alongside the bounds each live object should have
+	struct RandomScene
+	{
+		std::unique_ptr<SpatialPartition> partition;
+		std::vector<int> proxies;		// By userData, NullProxy once removed
+		std::vector<AABB> bounds;
+		unsigned int removed;
+
+		RandomScene(size_t steps, unsigned int seed) :
+			partition(std::make_unique<LooseOctree>(World)),
+			removed(0)
+		{
+			std::mt19937 random(seed);
+			std::uniform_int_distribution<int> action(0, 9);
+			std::uniform_real_distribution<float> nudge(-1.5f, 1.5f);
+			for (size_t step = 0; step < steps; step++)
+			{
+				int choice = action(random);
+				size_t live = FindLive(random);
+				if (choice < 4 || live == proxies.size())
+				{
+					bounds.push_back(RandomBox(random));
+					proxies.push_back(partition->Insert(bounds.back(), (unsigned int)proxies.size()));
+				}
+				else if (choice < 6)
+				{
+					bounds[live] = RandomBox(random);
+					partition->Update(proxies[live], bounds[live]);
+				}
+				else if (choice < 9)
+				{
+					// Small moves, most of which stay in the same node
+					AABB& box = bounds[live];
+					float x = nudge(random), y = nudge(random), z = nudge(random);
+					box = { XMFLOAT3(box.min.x + x, box.min.y + y, box.min.z + z), XMFLOAT3(box.max.x + x, box.max.y + y, box.max.z + z) };
+					partition->Update(proxies[live], box);
+				}
+				else
+				{
+					partition->Remove(proxies[live]);
+					proxies[live] = SpatialPartition::NullProxy;
+					removed++;
+				}
+			}
+		}
+
+		// A random live object, or proxies.size() if there are none
+		size_t FindLive(std::mt19937& random) const
+		{
+			if (proxies.empty())
+				return proxies.size();
+			size_t start = random() % proxies.size();
+			for (size_t i = 0; i < proxies.size(); i++)
+			{
+				size_t index = (start + i) % proxies.size();
+				if (proxies[index] != SpatialPartition::NullProxy)
+					return index;
+			}
+			return proxies.size();
+		}
+
+		size_t GetLiveCount() const
+		{
+			return proxies.size() - removed;
+		}
+
+		// What a linear scan over the live objects finds
+		template<typename Test>
+		std::vector<unsigned int> BruteForce(const Test& overlaps) const
+		{
+			std::vector<unsigned int> results;
+			for (size_t i = 0; i < proxies.size(); i++)
+			{
+				if (proxies[i] != SpatialPartition::NullProxy && overlaps(bounds[i]))
+					results.push_back((unsigned int)i);
+			}
+			return results;
+		}
+	};
+}
+
+TEST_CASE(QueriesMatchABruteForceScan)
+{
+	RandomScene scene(5000, 7);
+	CHECK(scene.partition->GetProxyCount() == scene.GetLiveCount());
+	CHECK(scene.removed > 0);
+
+	std::mt19937 random(99);
+	for (int query = 0; query < 100; query++)
+	{
+		AABB box = Bounds::Expand(RandomBox(random), 8.0f);
+		std::vector<unsigned int> found;
+		scene.partition->QueryAABB(box, found);
+		CHECK(Sorted(found) == scene.BruteForce([&](const AABB& bounds) { return Bounds::Overlaps(bounds, box); }));
+
+		BoundingSphere sphere = { Bounds::Center(box), 12.0f };
+		found.clear();
+		scene.partition->QuerySphere(sphere, found);
+		CHECK(Sorted(found) == scene.BruteForce([&](const AABB& bounds) { return Bounds::Overlaps(bounds, sphere); }));
+	}
+}
+
+TEST_CASE(RayQueriesMatchABruteForceScan)
+{
+	RandomScene scene(3000, 13);
+	std::mt19937 random(5);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	size_t hits = 0;
+	for (int cast = 0; cast < 100; cast++)
+	{
+		XMFLOAT3 direction(unit(random), unit(random), unit(random));
+		XMStoreFloat3(&direction, XMVector3Normalize(XMLoadFloat3(&direction)));
+		Ray ray = { XMFLOAT3(unit(random) * 70.0f, unit(random) * 70.0f, unit(random) * 70.0f), direction };
+		float maxDistance = 20.0f + 100.0f * (cast % 2);
+
+		std::vector<unsigned int> found;
+		scene.partition->QueryRay(ray, maxDistance, found);
+		std::vector<unsigned int> expected = scene.BruteForce([&](const AABB& bounds) { return Bounds::IntersectRay(ray, bounds, maxDistance, 0); });
+		CHECK(Sorted(found) == expected);
+		hits += expected.size();
+	}
+	CHECK(hits > 0);
+}
+
+TEST_CASE(FrustumCullMatchesABruteForceScan)
+{
+	RandomScene scene(5000, 11);
+	for (float yaw = 0.0f; yaw < XM_2PI; yaw += 0.5f)
+	{
+		XMMATRIX view = XMMatrixLookToLH(XMVectorSet(0, 0, 0, 0), XMVectorSet(sinf(yaw), 0.2f, cosf(yaw), 0), XMVectorSet(0, 1, 0, 0));
+		XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, 1.5f, 0.1f, 100.0f);
+		XMFLOAT4X4 viewProjection;
+		XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(view, projection));
+		Frustum frustum = Bounds::FrustumFromMatrix(viewProjection);
+
+		std::vector<unsigned int> found;
+		scene.partition->QueryFrustum(frustum, found);
+		std::vector<unsigned int> expected = scene.BruteForce([&](const AABB& bounds) { return Bounds::TestFrustum(frustum, bounds) != FrustumTest::Outside; });
+		CHECK(!expected.empty());
+		CHECK(Sorted(found) == expected);
+	}
+}
+
+TEST_CASE(ObjectsOnlyMoveWhenTheyLeaveTheLooseCell)
+{
+	LooseOctree octree(World);
+	SpatialPartition& partition = octree;
+
+	// Small enough for a 2 unit cell at depth 6, which spans
+	// [0, 2] with loose bounds of [-1, 3]
+	int proxy = partition.Insert(MakeBox(1.0f, 1.0f, 1.0f, 0.75f), 1);
+	size_t nodes = octree.GetNodeCount();
+	CHECK(nodes == 7);
+
+	// Crossing the cell's edge at 2 is fine while it's inside the loose bounds
+	CHECK(!partition.Update(proxy, MakeBox(1.5f, 1.0f, 1.0f, 0.75f)));
+	CHECK(!partition.Update(proxy, MakeBox(2.2f, 1.0f, 1.0f, 0.75f)));
+	CHECK(!partition.Update(proxy, MakeBox(0.0f, 0.0f, 1.0f, 0.75f)));
+	CHECK(octree.GetNodeCount() == nodes);
+
+	// Sticking out past 3 finally moves it, into the next cell over
+	CHECK(partition.Update(proxy, MakeBox(2.3f, 1.0f, 1.0f, 0.75f)));
+	CHECK(octree.GetNodeCount() == nodes + 1);
+	CHECK(!partition.Update(proxy, MakeBox(3.0f, 1.0f, 1.0f, 0.75f)));
+
+	// Growing past the loose bounds moves it up a level
+	CHECK(partition.Update(proxy, MakeBox(3.0f, 1.0f, 1.0f, 2.5f)));
+
+	// Queries see it wherever it's been put
+	std::vector<unsigned int> found;
+	partition.QueryAABB(MakeBox(3.0f, 1.0f, 1.0f, 0.1f), found);
+	CHECK(found == std::vector<unsigned int>{ 1 });
+	found.clear();
+	partition.QueryAABB(MakeBox(-1.0f, 1.0f, 1.0f, 0.1f), found);
+	CHECK(found.empty());
+}
+
+TEST_CASE(ObjectsOutsideTheWorldAreStillFound)
+{
+	LooseOctree octree(World);
+	SpatialPartition& partition = octree;
+	partition.Insert(MakeBox(500.0f, 0.0f, 0.0f, 1.0f), 1);			// Entirely outside
+	partition.Insert(MakeBox(63.0f, 0.0f, 0.0f, 4.0f), 2);			// Partly outside
+	partition.Insert(MakeBox(0.0f, -70.0f, 0.0f, 10.0f), 3);		// Centered outside, reaching in
+	int moving = partition.Insert(MakeBox(10.0f, 10.0f, 10.0f, 1.0f), 4);
+	CHECK(partition.GetProxyCount() == 4);
+
+	std::vector<unsigned int> found;
+	partition.QueryAABB(MakeBox(500.0f, 0.0f, 0.0f, 0.5f), found);
+	CHECK(found == std::vector<unsigned int>{ 1 });
+	found.clear();
+	partition.QueryAABB(MakeBox(66.5f, 0.0f, 0.0f, 0.1f), found);
+	CHECK(found == std::vector<unsigned int>{ 2 });
+	found.clear();
+	partition.QuerySphere({ XMFLOAT3(0.0f, -62.0f, 0.0f), 1.0f }, found);
+	CHECK(found == std::vector<unsigned int>{ 3 });
+	found.clear();
+	partition.QueryRay({ XMFLOAT3(400.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 0.0f, 0.0f) }, 200.0f, found);
+	CHECK(found == std::vector<unsigned int>{ 1 });
+
+	// Moving out of the world and back in again
+	CHECK(partition.Update(moving, MakeBox(-200.0f, 10.0f, 10.0f, 1.0f)));
+	found.clear();
+	partition.QueryAABB(MakeBox(-200.0f, 10.0f, 10.0f, 0.5f), found);
+	CHECK(found == std::vector<unsigned int>{ 4 });
+	CHECK(partition.Update(moving, MakeBox(10.0f, 10.0f, 10.0f, 1.0f)));
+	found.clear();
+	partition.QueryAABB(MakeBox(-200.0f, 10.0f, 10.0f, 0.5f), found);
+	CHECK(found.empty());
+
+	// A frustum looking out along +x sees both of those there
+	XMMATRIX view = XMMatrixLookToLH(XMVectorSet(0, 0, 0, 0), XMVectorSet(1, 0, 0, 0), XMVectorSet(0, 1, 0, 0));
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(view, XMMatrixPerspectiveFovLH(XM_PIDIV4, 1.0f, 0.1f, 1000.0f)));
+	found.clear();
+	partition.QueryFrustum(Bounds::FrustumFromMatrix(viewProjection), found);
+	CHECK(Sorted(found) == (std::vector<unsigned int>{ 1, 2 }));
+}
+
+TEST_CASE(RemovedProxiesAreNeverReported)
+{
+	LooseOctree octree(World);
+	SpatialPartition& partition = octree;
+	std::vector<int> proxies;
+	for (unsigned int i = 0; i < 64; i++)
+		proxies.push_back(partition.Insert(MakeBox((float)(i % 8) * 4.0f, (float)(i / 8) * 4.0f, 0.0f, 1.0f), i));
+	for (unsigned int i = 0; i < 64; i += 2)
+		partition.Remove(proxies[i]);
+	CHECK(partition.GetProxyCount() == 32);
+
+	// Freed slots are reused for new objects, which report their own data
+	for (unsigned int i = 0; i < 8; i++)
+		partition.Insert(MakeBox(100.0f + i, 0.0f, 0.0f, 0.25f), 1000 + i);
+
+	std::vector<unsigned int> found;
+	partition.QueryAABB(MakeBox(0.0f, 0.0f, 0.0f, 1000.0f), found);
+	CHECK(found.size() == 40);
+	for (unsigned int userData : found)
+		CHECK(userData >= 1000 || userData % 2 == 1);
+
+	found.clear();
+	partition.QuerySphere({ XMFLOAT3(0.0f, 0.0f, 0.0f), 2.0f }, found);
+	CHECK(found.empty());
+
+	partition.Clear();
+	CHECK(partition.GetProxyCount() == 0);
+	found.clear();
+	partition.QueryAABB(MakeBox(0.0f, 0.0f, 0.0f, 1000.0f), found);
+	CHECK(found.empty());
+	CHECK(octree.GetNodeCount() == 1);
+}
@@ -1,11 +1,15 @@
 
 #include <Windows.h>
 #include <crtdbg.h>
+#include <cstring>
+#include <cstdlib>
 
 #include "Window.h"
 #include "Graphics.h"
 #include "Game.h"
 #include "Input.h"
+#include "Profiler.h"
+#include "FrameTimeHistory.h"
 
 // Annonymous namespace to hold variables
 // only accessible in this file
@@ -81,6 +85,14 @@ int WINAPI WinMain(
 	// Now the main application object itself can be initialzied
 	game = new Game();
 
+	// "-trace [frames]" captures startup and the first frames
+	const char* traceArgument = lpCmdLine ? strstr(lpCmdLine, "-trace") : 0;
+	if (traceArgument)
+	{
+		int traceFrames = atoi(traceArgument + strlen("-trace"));
+		game->BeginTraceCapture("Trace.json", traceFrames > 0 ? traceFrames : 120);
+	}
+
 	// Time tracking
 	LARGE_INTEGER perfFreq{};
 	double perfSeconds = 0;
@@ -115,17 +127,20 @@ int WINAPI WinMain(
 			QueryPerformanceCounter((LARGE_INTEGER*)&currentTime);
 			float deltaTime = max((float)((currentTime - previousTime) * perfSeconds), 0.0f);
 			float totalTime = (float)((currentTime - startTime) * perfSeconds);
+			FrameTimeHistory::Global().Record((currentTime - previousTime) * perfSeconds);
 			previousTime = currentTime;
 
-			// Calculate basic fps
+			// Frame time stats for the title bar
 			Window::UpdateStats(totalTime);
 
 			// Input updating
 			Input::Update();
 
-			// Update and draw
+			// Update and draw, profiled as one frame
+			CpuProfiler::Global().BeginFrame();
 			game->Update(deltaTime, totalTime);
 			game->Draw(deltaTime, totalTime);
+			CpuProfiler::Global().EndFrame();
 
 			// Notify Input system about end of frame
 			Input::EndOfFrame();
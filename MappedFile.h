@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+
+// --------------------------------------------------------
+// A whole file mapped read-only into memory
+//
+// - Pages are read in by the OS as they're touched, so
+//    opening a large file costs nothing up front
+// - The view stays valid until Close() or destruction
+// --------------------------------------------------------
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::wstring& path);
+	void Close();
+
+	const unsigned char* GetData() const;
+	size_t GetSize() const;
+
+private:
+	void* file;			// Windows HANDLEs, kept out of the header
+	void* mapping;
+	const unsigned char* view;
+	size_t size;
+};
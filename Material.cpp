@@ -1,7 +1,6 @@
 #include "Material.h"
-#include "PathHelpers.h"
 #include "Graphics.h"
-#include <d3dcompiler.h>
+#include "ShaderLibrary.h"
 
 using namespace DirectX;
 
@@ -10,7 +9,7 @@ Material::Material() : Material(DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), Verte
 Material::Material(DirectX::XMFLOAT4 colorTint) : Material(colorTint, VertexShaderPtr(), PixelShaderPtr()) {}
 
 Material::Material(const wchar_t* vertexShaderFilePath, const wchar_t* pixelShaderFilePath)
-	: colorTint(DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f))
+	: colorTint(DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f)), parameters(std::make_shared<MaterialParameters>()), parameterSlot(0), materialId(0)
 {
 	CreateVertShaderFromFile(vertexShaderFilePath);
 	CreatePixelShaderFromFile(pixelShaderFilePath);
@@ -19,76 +18,309 @@ Material::Material(const wchar_t* vertexShaderFilePath, const wchar_t* pixelShad
 Material::Material(DirectX::XMFLOAT4 colorTint, const wchar_t* vertexShaderFilePath, const wchar_t* pixelShaderFilePath) :
 	Material(vertexShaderFilePath, pixelShaderFilePath)
 {
-	this->colorTint = colorTint;
+	SetColorTint(colorTint);
 }
 
 Material::Material(DirectX::XMFLOAT4 colorTint, VertexShaderPtr vertexShader, PixelShaderPtr pixelShader)
-	: colorTint(colorTint), vertexShader(vertexShader), pixelShader(pixelShader){}
+	: colorTint(colorTint), vertexShader(vertexShader), pixelShader(pixelShader), parameters(std::make_shared<MaterialParameters>()), parameterSlot(0), materialId(0)
+{
+	UpdatePipelineState();
+}
+
+Material::Material(std::shared_ptr<Material> parent)
+	: colorTint(parent->GetColorTint()), parameters(std::make_shared<MaterialParameters>(parent->parameters)), parameterSlot(0), materialId(0),
+	parent(parent->parent ? parent->parent : parent)
+{
+}
+
+Material::Material(std::shared_ptr<Material> parent, DirectX::XMFLOAT4 colorTint) : Material(parent)
+{
+	SetColorTint(colorTint);
+}
+
+Material::~Material()
+{
+	UseParameterTable(0);
+}
+
+DirectX::XMFLOAT4 Material::GetColorTint()
+{
+	// The block wins, since its colorTint can be set by name too
+	XMFLOAT4 tint = colorTint;
+	parameters->GetBlock().Get("colorTint", &tint, sizeof(tint));
+	return tint;
+}
+VertexShaderPtr Material::GetVertexShader() { return parent ? parent->vertexShader : vertexShader; }
+PixelShaderPtr Material::GetPixelShader() { return parent ? parent->pixelShader : pixelShader; }
+InputLayoutPtr Material::GetInputLayout() { return parent ? parent->inputLayout : inputLayout; }
+unsigned int Material::GetParameterSlot() { return parent ? parent->parameterSlot : parameterSlot; }
+FixedFunctionState Material::GetFixedFunctionState() { return parent ? parent->fixedFunctionState : fixedFunctionState; }
+std::shared_ptr<const PipelineState> Material::GetPipelineState() { return parent ? parent->pipelineState : pipelineState; }
+std::shared_ptr<Material> Material::GetParent() { return parent; }
+const ParameterOverrides& Material::GetOverrides() { return parameters->GetOverrides(); }
+
+// An instance with nothing of its own draws with its parent's buffer
+ConstantBufferPtr Material::GetConstantBuffer()
+{
+	if (parameters->IsShared())
+		return parent->constantBuffer;
+	return constantBuffer;
+}
+
+const ParameterBlock& Material::GetParameters()
+{
+	return parameters->GetBlock();
+}
+
+MaterialParameterBuffer* Material::GetParameterTable()
+{
+	if (parameters->IsShared())
+		return parent->parameterTable.get();
+	return parameterTable.get();
+}
+
+unsigned int Material::GetMaterialId()
+{
+	if (parameters->IsShared())
+		return parent->materialId;
+	return materialId;
+}
 
-DirectX::XMFLOAT4 Material::GetColorTint() { return colorTint; }
-VertexShaderPtr Material::GetVertexShader() { return vertexShader; }
-PixelShaderPtr Material::GetPixelShader() { return pixelShader; }
+void Material::ClearOverrides()
+{
+	parameters->ClearOverrides();
+}
 
-void Material::SetColorTint(DirectX::XMFLOAT4 colorTint) { this->colorTint = colorTint; }
-void Material::SetVertexShader(VertexShaderPtr vertexShader) { this->vertexShader = vertexShader; }
-void Material::SetPixelShader(PixelShaderPtr pixelShader) { this->pixelShader = pixelShader; }
+void Material::SetColorTint(DirectX::XMFLOAT4 colorTint)
+{
+	this->colorTint = colorTint;
+	SetFloat4("colorTint", colorTint);
+}
 
+bool Material::SetFloat(const std::string& name, float value)
+{
+	return parameters->SetFloat(name, value);
+}
+bool Material::SetFloat2(const std::string& name, DirectX::XMFLOAT2 value)
+{
+	return parameters->SetFloat2(name, &value.x);
+}
+bool Material::SetFloat3(const std::string& name, DirectX::XMFLOAT3 value)
+{
+	return parameters->SetFloat3(name, &value.x);
+}
+bool Material::SetFloat4(const std::string& name, DirectX::XMFLOAT4 value)
+{
+	return parameters->SetFloat4(name, &value.x);
+}
+bool Material::SetInt(const std::string& name, int value)
+{
+	return parameters->SetInt(name, value);
+}
+
+// Takes the top-left rows x columns of the matrix the shader declares
+bool Material::SetMatrix(const std::string& name, const DirectX::XMFLOAT4X4& value)
+{
+	std::shared_ptr<const ConstantBufferLayout> layout = parameters->GetBlock().GetLayout();
+	const ShaderParameter* parameter = layout ? layout->Find(name) : 0;
+	if (!parameter)
+		return false;
+
+	float values[16] = {};
+	unsigned int columns = parameter->desc.columns;
+	for (unsigned int row = 0; row < parameter->desc.rows && row < 4; row++)
+	{
+		for (unsigned int column = 0; column < columns && column < 4; column++)
+			values[row * columns + column] = value.m[row][column];
+	}
+	return parameters->SetMatrix(name, values);
+}
+void Material::SetVertexShader(VertexShaderPtr vertexShader)
+{
+	if (parent)
+		return;
+	this->vertexShader = vertexShader;
+	vertexShaderPath.clear();
+	UpdatePipelineState();
+}
+void Material::SetPixelShader(PixelShaderPtr pixelShader)
+{
+	if (parent)
+		return;
+	this->pixelShader = pixelShader;
+	pixelShaderPath.clear();
+	UpdateParameters();
+	UpdatePipelineState();
+}
+void Material::SetFixedFunctionState(const FixedFunctionState& state)
+{
+	if (parent)
+		return;
+	fixedFunctionState = state;
+	UpdatePipelineState();
+}
+
+// --------------------------------------------------------
+// Shaders and layouts come from the shader library, so every
+// material using the same file shares the same objects
+// --------------------------------------------------------
 void Material::CreateVertShaderFromFile(const wchar_t* filePath)
 {
-	ID3DBlob* vertexShaderBlob;
-	D3DReadFileToBlob(FixPath(filePath).c_str(), &vertexShaderBlob);
-	Graphics::Device->CreateVertexShader(
-		vertexShaderBlob->GetBufferPointer(), // Pointer to start of binary data
-		vertexShaderBlob->GetBufferSize(), // How big is that data?
-		0, // No classes in this shader
-		vertexShader.GetAddressOf()); // ID3D11VertexShader**
-
-	// Create an input layout 
-	//  - This describes the layout of data sent to a vertex shader
-	//  - In other words, it describes how to interpret data (numbers) in a vertex buffer
-	//  - Doing this NOW because it requires a vertex shader's byte code to verify against!
-	//  - Luckily, we already have that loaded (the vertex shader blob above)
-
-	D3D11_INPUT_ELEMENT_DESC inputElements[4] = {};
-
-	// Set up the first element - a position, which is 3 float values
-	inputElements[0].Format = DXGI_FORMAT_R32G32B32_FLOAT;				// Most formats are described as color channels; really it just means "Three 32-bit floats"
-	inputElements[0].SemanticName = "POSITION";							// This is "POSITION" - needs to match the semantics in our vertex shader input!
-	inputElements[0].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;	// How far into the vertex is this?  Assume it's after the previous element
-
-	// Set up the second element - a color, which is 4 more float values
-	inputElements[1].Format = DXGI_FORMAT_R32G32_FLOAT;			// 2x 32-bit floats
-	inputElements[1].SemanticName = "TEXCOORD";							// Match our vertex shader input!
-	inputElements[1].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;	// After the previous element
-
-	// Set up the second element - a color, which is 4 more float values
-	inputElements[2].Format = DXGI_FORMAT_R32G32B32_FLOAT;			// 3x 32-bit floats
-	inputElements[2].SemanticName = "NORMAL";							// Match our vertex shader input!
-	inputElements[2].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;	// After the previous element
-
-	// Set up the second element - a color, which is 4 more float values
-	inputElements[3].Format = DXGI_FORMAT_R32_FLOAT;			// 3x 32-bit floats
-	inputElements[3].SemanticName = "TIME";							// Match our vertex shader input!
-	inputElements[3].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;	// After the previous element
-
-	// Create the input layout, verifying our description against actual shader code
-	Graphics::Device->CreateInputLayout(
-		inputElements,							// An array of descriptions
-		4,										// How many elements in that array?
-		vertexShaderBlob->GetBufferPointer(),	// Pointer to the code of a shader that uses this layout
-		vertexShaderBlob->GetBufferSize(),		// Size of the shader code that uses this layout
-		inputLayout.GetAddressOf());			// Address of the resulting ID3D11InputLayout pointer
-
-	Graphics::Context->IASetInputLayout(inputLayout.Get());
+	if (parent)
+		return;
+	vertexShaderPath = filePath;
+	vertexShader = ShaderLibrary::Global().GetVertexShader(vertexShaderPath);
+	inputLayout = ShaderLibrary::Global().GetInputLayout(vertexShaderPath);
+	UpdatePipelineState();
 }
 
 void Material::CreatePixelShaderFromFile(const wchar_t* filePath)
 {
-	ID3DBlob* pixelShaderBlob;
-	D3DReadFileToBlob(FixPath(filePath).c_str(), &pixelShaderBlob);
-	Graphics::Device->CreatePixelShader(
-		pixelShaderBlob->GetBufferPointer(), // Pointer to start of binary data
-		pixelShaderBlob->GetBufferSize(), // How big is that data?
-		0, // No classes in this shader
-		pixelShader.GetAddressOf()); // ID3D11PixelShader**
+	if (parent)
+		return;
+	pixelShaderPath = filePath;
+	pixelShader = ShaderLibrary::Global().GetPixelShader(pixelShaderPath);
+	UpdateParameters();
+	UpdatePipelineState();
+}
+
+bool Material::UsesShaderFile(const std::wstring& filePath)
+{
+	// Instances pick up their parent's reload on their own
+	if (parent)
+		return false;
+	return filePath == vertexShaderPath || filePath == pixelShaderPath;
+}
+
+// Picks up whatever the shader library now holds for our files
+void Material::ReloadShaders()
+{
+	if (parent)
+		return;
+	if (!vertexShaderPath.empty())
+	{
+		vertexShader = ShaderLibrary::Global().GetVertexShader(vertexShaderPath);
+		inputLayout = ShaderLibrary::Global().GetInputLayout(vertexShaderPath);
+	}
+	if (!pixelShaderPath.empty())
+		pixelShader = ShaderLibrary::Global().GetPixelShader(pixelShaderPath);
+	UpdateParameters();
+	UpdatePipelineState();
+}
+
+// --------------------------------------------------------
+// Swaps in the cached pipeline state for the current shaders
+// and settings; a material missing a shader has none
+// --------------------------------------------------------
+void Material::UpdatePipelineState()
+{
+	if (!vertexShader || !pixelShader)
+	{
+		pipelineState.reset();
+		return;
+	}
+	pipelineState = PipelineStateCache::Global().Get(vertexShader, pixelShader, inputLayout, fixedFunctionState);
+}
+
+// --------------------------------------------------------
+// Lays the parameters out to match the pixel shader's
+// PerMaterial cbuffer (or failing that, the element of its
+// materials StructuredBuffer), carrying over any values the
+// old and new layouts share.  Shaders set directly have no
+// bytecode to reflect, so they get no parameters.
+// --------------------------------------------------------
+void Material::UpdateParameters()
+{
+	std::shared_ptr<const ConstantBufferLayout> layout;
+	unsigned int slot = 0;
+	if (!pixelShaderPath.empty())
+	{
+		layout = ShaderLibrary::Global().GetConstantBufferLayout(pixelShaderPath, "PerMaterial", &slot);
+		if (!layout)
+			layout = ShaderLibrary::Global().GetStructuredBufferLayout(pixelShaderPath, "materials", &slot);
+	}
+	if (layout == parameters->GetBlock().GetLayout())
+		return;
+
+	colorTint = GetColorTint();
+	parameters->SetLayout(layout);
+	parameters->SetFloat4("colorTint", &colorTint.x);
+	parameterSlot = slot;
+
+	bool structured = layout && layout->GetPacking() == LayoutPacking::Structured;
+	UseParameterTable(structured ? MaterialParameterBuffers::Global().Get(layout) : 0);
+}
+
+// --------------------------------------------------------
+// Moves this material's record to another table (or out of
+// any), writing its current parameters into the new one
+// --------------------------------------------------------
+void Material::UseParameterTable(std::shared_ptr<MaterialParameterBuffer> table)
+{
+	if (table == parameterTable)
+		return;
+
+	if (parameterTable)
+		parameterTable->GetTable().Release(materialId);
+	parameterTable = table;
+	materialId = 0;
+	if (!parameterTable)
+		return;
+
+	materialId = parameterTable->GetTable().Acquire();
+	parameterTable->GetTable().Write(materialId, parameters->GetBlock());
+	parameters->GetMutableBlock().ClearDirty();
+}
+
+// --------------------------------------------------------
+// Pushes this material's parameters to its constant buffer (or
+// table record) if they changed since the last upload.
+// Returns bytes uploaded.
+// --------------------------------------------------------
+unsigned int Material::UploadConstants()
+{
+	ParameterBlock& block = parameters->GetMutableBlock();
+	bool shared = parameters->IsShared();
+
+	// Table records are only written here; the table uploads every
+	// changed record at once.  Instances take a record of their
+	// own once they override something.
+	std::shared_ptr<MaterialParameterBuffer> table = parent ? parent->parameterTable : parameterTable;
+	UseParameterTable(shared ? 0 : table);
+	if (table)
+	{
+		constantBuffer.Reset();
+		if (parameterTable && block.IsDirty())
+		{
+			parameterTable->GetTable().Write(materialId, block);
+			block.ClearDirty();
+		}
+		return 0;
+	}
+
+	if (block.GetSize() == 0 || shared)
+	{
+		constantBuffer.Reset();
+		return 0;
+	}
+
+	// A reloaded shader can change the size
+	D3D11_BUFFER_DESC desc = {};
+	if (constantBuffer)
+		constantBuffer->GetDesc(&desc);
+	if (desc.ByteWidth != block.GetSize())
+	{
+		desc = {};
+		desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		desc.ByteWidth = block.GetSize();
+		desc.Usage = D3D11_USAGE_DEFAULT;
+		constantBuffer.Reset();
+		Graphics::Device->CreateBuffer(&desc, 0, constantBuffer.GetAddressOf());
+	}
+	else if (!block.IsDirty())
+		return 0;
+
+	Graphics::Context->UpdateSubresource(constantBuffer.Get(), 0, 0, block.GetData(), 0, 0);
+	block.ClearDirty();
+	return block.GetSize();
 }
\ No newline at end of file
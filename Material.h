@@ -1,14 +1,54 @@
 #pragma once
 #include <DirectXMath.h>
 #include "TypeDefs.h"
+#include "PipelineStateCache.h"
+#include "MaterialParameters.h"
+#include "MaterialParameterBuffer.h"
+#include <memory>
+#include <string>
 
+// --------------------------------------------------------
+// Shaders, pipeline state and the parameters they read
+//
+// A material made from a parent is an instance: it draws with
+// the parent's shaders and state and only keeps the parameters
+// it overrides.  Instances without overrides share the parent's
+// constant buffer too.
+//
+// If the pixel shader reads its parameters from a "materials"
+// StructuredBuffer instead of a PerMaterial cbuffer, they live
+// in a record of a table shared by every such material, found
+// by material ID, so draws with different materials can be
+// instanced together.
+// --------------------------------------------------------
 class Material
 {
 private:
-	DirectX::XMFLOAT4 colorTint;
+	DirectX::XMFLOAT4 colorTint;		// Kept even when the pixel shader has no colorTint
 	VertexShaderPtr vertexShader;
 	PixelShaderPtr pixelShader;
 	InputLayoutPtr inputLayout;
+	ConstantBufferPtr constantBuffer;
+
+	// The pixel shader's PerMaterial cbuffer, laid out from reflection;
+	// an instance's are resolved against its parent's
+	std::shared_ptr<MaterialParameters> parameters;
+	unsigned int parameterSlot;
+
+	// Set instead of constantBuffer for StructuredBuffer parameters
+	std::shared_ptr<MaterialParameterBuffer> parameterTable;
+	unsigned int materialId;
+
+	// Rebuilt whenever a shader or the fixed-function state changes
+	FixedFunctionState fixedFunctionState;
+	std::shared_ptr<const PipelineState> pipelineState;
+
+	// Where the shaders came from, empty if they were set directly
+	std::wstring vertexShaderPath;
+	std::wstring pixelShaderPath;
+
+	// Only set for instances
+	std::shared_ptr<Material> parent;
 
 public:
 	Material();
@@ -16,16 +56,59 @@ public:
 	Material(const wchar_t* vertexShaderFilePath, const wchar_t* pixelShaderFilePath);
 	Material(DirectX::XMFLOAT4 colorTint, const wchar_t* vertexShaderFilePath, const wchar_t* pixelShaderFilePath);
 	Material(DirectX::XMFLOAT4 colorTint, VertexShaderPtr vertexShader, PixelShaderPtr pixelShader);
+	~Material();
+
+	// Instances - an instance of an instance shares the same root
+	// parent and starts with a copy of its overrides
+	Material(std::shared_ptr<Material> parent);
+	Material(std::shared_ptr<Material> parent, DirectX::XMFLOAT4 colorTint);
+	std::shared_ptr<Material> GetParent();
+	const ParameterOverrides& GetOverrides();
+	void ClearOverrides();
 
 	DirectX::XMFLOAT4 GetColorTint();
 	VertexShaderPtr GetVertexShader();
 	PixelShaderPtr GetPixelShader();
+	InputLayoutPtr GetInputLayout();
+	ConstantBufferPtr GetConstantBuffer();
+	unsigned int GetParameterSlot();
+	const ParameterBlock& GetParameters();
+
+	// Null unless the parameters live in a table; the ID is then
+	// the material's record (or the parent's, for an instance
+	// without overrides) and 0 otherwise
+	MaterialParameterBuffer* GetParameterTable();
+	unsigned int GetMaterialId();
 
 	void SetColorTint(DirectX::XMFLOAT4 colorTint);
+
+	// Named parameters; false if the pixel shader has no such
+	// parameter of that shape
+	bool SetFloat(const std::string& name, float value);
+	bool SetFloat2(const std::string& name, DirectX::XMFLOAT2 value);
+	bool SetFloat3(const std::string& name, DirectX::XMFLOAT3 value);
+	bool SetFloat4(const std::string& name, DirectX::XMFLOAT4 value);
+	bool SetInt(const std::string& name, int value);
+	bool SetMatrix(const std::string& name, const DirectX::XMFLOAT4X4& value);
+
+	// Shaders and fixed-function state belong to the parent, so
+	// these do nothing on an instance
 	void SetVertexShader(VertexShaderPtr vertexShader);
 	void SetPixelShader(PixelShaderPtr pixelShader);
+	FixedFunctionState GetFixedFunctionState();
+	void SetFixedFunctionState(const FixedFunctionState& state);
+	std::shared_ptr<const PipelineState> GetPipelineState();
 
 	void CreateVertShaderFromFile(const wchar_t* filePath);
 	void CreatePixelShaderFromFile(const wchar_t* filePath);
+	bool UsesShaderFile(const std::wstring& filePath);
+	void ReloadShaders();
+
+	unsigned int UploadConstants();
+
+private:
+	void UpdatePipelineState();
+	void UpdateParameters();
+	void UseParameterTable(std::shared_ptr<MaterialParameterBuffer> table);
 };
 
@@ -0,0 +1,117 @@
+#include "MaterialParameterBuffer.h"
+#include "Graphics.h"
+#include "Profiler.h"
+
+MaterialParameterBuffer::MaterialParameterBuffer(std::shared_ptr<const ConstantBufferLayout> layout) :
+	table(layout),
+	capacity(0)
+{
+}
+
+MaterialTable& MaterialParameterBuffer::GetTable() { return table; }
+ID3D11ShaderResourceView* MaterialParameterBuffer::GetShaderResourceView() { return shaderResourceView.Get(); }
+
+unsigned int MaterialParameterBuffer::Upload(ID3D11DeviceContext* context)
+{
+	unsigned int stride = table.GetStride();
+	unsigned int recordCount = table.GetRecordCount();
+	if (stride == 0 || recordCount == 0)
+		return 0;
+
+	unsigned int first = 0;
+	unsigned int count = 0;
+	if (recordCount > capacity)
+	{
+		// Doubling keeps a growing table from recreating every frame
+		capacity = capacity * 2 > recordCount ? capacity * 2 : recordCount;
+		if (capacity < 16)
+			capacity = 16;
+
+		D3D11_BUFFER_DESC desc = {};
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		desc.ByteWidth = capacity * stride;
+		desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		desc.StructureByteStride = stride;
+		desc.Usage = D3D11_USAGE_DEFAULT;
+		buffer.Reset();
+		shaderResourceView.Reset();
+		Graphics::Device->CreateBuffer(&desc, 0, buffer.GetAddressOf());
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc = {};
+		viewDesc.Format = DXGI_FORMAT_UNKNOWN;
+		viewDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		viewDesc.Buffer.FirstElement = 0;
+		viewDesc.Buffer.NumElements = capacity;
+		Graphics::Device->CreateShaderResourceView(buffer.Get(), &viewDesc, shaderResourceView.GetAddressOf());
+
+		// A new buffer starts out empty
+		count = recordCount;
+	}
+	else if (!table.GetDirtyRange(&first, &count))
+		return 0;
+
+	D3D11_BOX box = {};
+	box.left = first * stride;
+	box.right = (first + count) * stride;
+	box.bottom = 1;
+	box.back = 1;
+	context->UpdateSubresource(buffer.Get(), 0, &box, table.GetData() + (size_t)first * stride, 0, 0);
+	table.ClearDirty();
+	return count * stride;
+}
+
+MaterialParameterBuffers& MaterialParameterBuffers::Global()
+{
+	static MaterialParameterBuffers buffers;
+	return buffers;
+}
+
+std::shared_ptr<MaterialParameterBuffer> MaterialParameterBuffers::Get(std::shared_ptr<const ConstantBufferLayout> layout)
+{
+	if (!layout)
+		return 0;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	std::shared_ptr<MaterialParameterBuffer>& buffer = buffers[layout.get()];
+	if (!buffer)
+		buffer = std::make_shared<MaterialParameterBuffer>(layout);
+	return buffer;
+}
+
+unsigned int MaterialParameterBuffers::Upload(ID3D11DeviceContext* context)
+{
+	PROFILE_SCOPE("Upload Material Tables");
+	std::lock_guard<std::mutex> lock(mutex);
+
+	stats = {};
+	for (auto it = buffers.begin(); it != buffers.end();)
+	{
+		// Nothing but this map holds it any more
+		if (it->second.use_count() == 1)
+		{
+			it = buffers.erase(it);
+			continue;
+		}
+
+		MaterialTable& table = it->second->GetTable();
+		stats.bytesUploaded += it->second->Upload(context);
+		stats.tables++;
+		stats.liveMaterials += table.GetLiveCount();
+		stats.records += table.GetRecordCount();
+		++it;
+	}
+	return stats.bytesUploaded;
+}
+
+MaterialParameterBufferStats MaterialParameterBuffers::GetStats()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+void MaterialParameterBuffers::Clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	buffers.clear();
+	stats = {};
+}
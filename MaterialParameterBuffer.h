@@ -0,0 +1,67 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "MaterialTable.h"
+
+// --------------------------------------------------------
+// A MaterialTable and the StructuredBuffer it is uploaded to
+//
+// - Only the dirty range of records is re-sent each frame
+// - The buffer grows (and is re-sent whole) when the table
+//    outgrows it, so its view can change between frames
+// --------------------------------------------------------
+class MaterialParameterBuffer
+{
+public:
+	MaterialParameterBuffer(std::shared_ptr<const ConstantBufferLayout> layout);
+
+	MaterialTable& GetTable();
+	ID3D11ShaderResourceView* GetShaderResourceView();
+
+	// Returns bytes uploaded
+	unsigned int Upload(ID3D11DeviceContext* context);
+
+private:
+	MaterialTable table;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shaderResourceView;
+	unsigned int capacity;		// In records
+};
+
+struct MaterialParameterBufferStats
+{
+	unsigned int tables;
+	unsigned int liveMaterials;
+	unsigned int records;
+	unsigned int bytesUploaded;		// Last Upload() only
+};
+
+// --------------------------------------------------------
+// One parameter buffer per StructuredBuffer layout, so every
+// material whose pixel shader declares the same element type
+// writes into the same table and can be drawn in one call
+// --------------------------------------------------------
+class MaterialParameterBuffers
+{
+public:
+	static MaterialParameterBuffers& Global();
+
+	std::shared_ptr<MaterialParameterBuffer> Get(std::shared_ptr<const ConstantBufferLayout> layout);
+
+	// Uploads every table's dirty records, dropping tables no
+	// material holds any more.  Returns bytes uploaded.
+	unsigned int Upload(ID3D11DeviceContext* context);
+
+	MaterialParameterBufferStats GetStats();
+
+	// Releases every buffer - call before the device goes away
+	void Clear();
+
+private:
+	std::mutex mutex;
+	std::unordered_map<const ConstantBufferLayout*, std::shared_ptr<MaterialParameterBuffer>> buffers;
+	MaterialParameterBufferStats stats = {};
+};
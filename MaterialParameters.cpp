@@ -0,0 +1,117 @@
+#include "MaterialParameters.h"
+
+MaterialParameters::MaterialParameters(std::shared_ptr<const ConstantBufferLayout> layout) :
+	block(layout),
+	resolvedParentVersion(0)
+{
+}
+
+MaterialParameters::MaterialParameters(std::shared_ptr<const MaterialParameters> parent) :
+	parent(parent),
+	resolvedParentVersion(0)
+{
+	if (parent->parent)
+	{
+		this->parent = parent->parent;
+		overrides = parent->overrides;
+	}
+	Resolve();
+}
+
+// --------------------------------------------------------
+// Lays the block out again, carrying over every value the old
+// and new layouts share
+// --------------------------------------------------------
+void MaterialParameters::SetLayout(std::shared_ptr<const ConstantBufferLayout> layout)
+{
+	if (parent || layout == block.GetLayout())
+		return;
+
+	ParameterBlock updated(layout);
+	updated.CopyMatching(block);
+	block = updated;
+}
+
+bool MaterialParameters::SetFloat(const std::string& name, float value)
+{
+	Resolve();
+	return Override(name, block.SetFloat(name, value));
+}
+bool MaterialParameters::SetFloat2(const std::string& name, const float* values)
+{
+	Resolve();
+	return Override(name, block.SetFloat2(name, values));
+}
+bool MaterialParameters::SetFloat3(const std::string& name, const float* values)
+{
+	Resolve();
+	return Override(name, block.SetFloat3(name, values));
+}
+bool MaterialParameters::SetFloat4(const std::string& name, const float* values)
+{
+	Resolve();
+	return Override(name, block.SetFloat4(name, values));
+}
+bool MaterialParameters::SetInt(const std::string& name, int value)
+{
+	Resolve();
+	return Override(name, block.SetInt(name, value));
+}
+bool MaterialParameters::SetMatrix(const std::string& name, const float* values)
+{
+	Resolve();
+	return Override(name, block.SetMatrix(name, values));
+}
+
+void MaterialParameters::ClearOverrides()
+{
+	if (!parent)
+		return;
+	overrides.Clear();
+	block.CopyFrom(parent->block);
+	resolvedParentVersion = parent->block.GetVersion();
+}
+
+// --------------------------------------------------------
+// Brings an instance's block up to date with its parent (whose
+// values or layout may have changed since) and then lays its
+// own overrides back over them
+// --------------------------------------------------------
+bool MaterialParameters::Resolve()
+{
+	if (!parent)
+		return false;
+
+	const ParameterBlock& parentBlock = parent->block;
+	if (block.GetLayout() == parentBlock.GetLayout() && resolvedParentVersion == parentBlock.GetVersion())
+		return false;
+
+	block.CopyFrom(parentBlock);
+	overrides.Apply(block);
+	resolvedParentVersion = parentBlock.GetVersion();
+	return true;
+}
+
+const ParameterBlock& MaterialParameters::GetBlock()
+{
+	Resolve();
+	return block;
+}
+
+ParameterBlock& MaterialParameters::GetMutableBlock()
+{
+	Resolve();
+	return block;
+}
+
+std::shared_ptr<const MaterialParameters> MaterialParameters::GetParent() const { return parent; }
+const ParameterOverrides& MaterialParameters::GetOverrides() const { return overrides; }
+bool MaterialParameters::IsShared() const { return parent && overrides.GetCount() == 0; }
+
+// Remembers a parameter an instance just set
+bool MaterialParameters::Override(const std::string& name, bool set)
+{
+	if (set && parent)
+		overrides.Capture(block, name);
+	return set;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <memory>
+#include <string>
+#include "ConstantBufferLayout.h"
+
+// --------------------------------------------------------
+// The parameter half of a Material
+//
+// - A root owns its values, laid out however its pixel shader
+//    says (SetLayout keeps whatever the old and new layouts share)
+// - An instance made from a parent keeps only the values it
+//    sets, as overrides.  Its block holds the parent's values
+//    with those written over them, and is brought up to date
+//    whenever the parent's values or layout change.
+// - Contains no graphics API code so it can be tested anywhere
+// --------------------------------------------------------
+class MaterialParameters
+{
+public:
+	MaterialParameters(std::shared_ptr<const ConstantBufferLayout> layout = std::shared_ptr<const ConstantBufferLayout>());
+
+	// An instance of an instance shares the same root parent and
+	// starts with a copy of its overrides
+	MaterialParameters(std::shared_ptr<const MaterialParameters> parent);
+
+	// Roots only
+	void SetLayout(std::shared_ptr<const ConstantBufferLayout> layout);
+
+	// Setters return false if the layout has no such parameter of
+	// that shape; on an instance, what they set becomes an override
+	bool SetFloat(const std::string& name, float value);
+	bool SetFloat2(const std::string& name, const float* values);
+	bool SetFloat3(const std::string& name, const float* values);
+	bool SetFloat4(const std::string& name, const float* values);
+	bool SetInt(const std::string& name, int value);
+	bool SetMatrix(const std::string& name, const float* values);
+	void ClearOverrides();
+
+	// Re-resolves an instance against its parent if the parent
+	// changed since; true if it did
+	bool Resolve();
+
+	// The resolved values.  Writing to the block directly doesn't
+	// record overrides, so it's only for clearing the dirty flag.
+	const ParameterBlock& GetBlock();
+	ParameterBlock& GetMutableBlock();
+
+	std::shared_ptr<const MaterialParameters> GetParent() const;
+	const ParameterOverrides& GetOverrides() const;
+
+	// An instance with no overrides, whose values are its parent's
+	bool IsShared() const;
+
+private:
+	bool Override(const std::string& name, bool set);
+
+	ParameterBlock block;
+	std::shared_ptr<const MaterialParameters> parent;
+	ParameterOverrides overrides;
+	unsigned int resolvedParentVersion;
+};
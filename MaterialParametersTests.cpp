@@ -0,0 +1,88 @@
+#include "MaterialParameters.h"
+#include "TestHarness.h"
+
+namespace
+{
+	std::shared_ptr<const ConstantBufferLayout> MakeLayout(bool withRoughness = true)
+	{
+		std::shared_ptr<ConstantBufferLayout> layout = std::make_shared<ConstantBufferLayout>("PerMaterial");
+		layout->Add({ "colorTint", ShaderParameterType::Float, ShaderParameterClass::Vector, 1, 4, 0 });
+		if (withRoughness)
+			layout->Add({ "roughness", ShaderParameterType::Float, ShaderParameterClass::Scalar, 1, 1, 0 });
+		return layout;
+	}
+
+	float GetFloat(MaterialParameters& parameters, const char* name)
+	{
+		float value = -1.0f;
+		parameters.GetBlock().Get(name, &value, sizeof(value));
+		return value;
+	}
+}
+
+TEST_CASE(InstancesFollowTheirParentUntilTheyOverride)
+{
+	std::shared_ptr<MaterialParameters> parent = std::make_shared<MaterialParameters>(MakeLayout());
+	parent->SetFloat("roughness", 0.25f);
+	MaterialParameters instance(parent);
+	CHECK(instance.IsShared());
+	CHECK(GetFloat(instance, "roughness") == 0.25f);
+
+	parent->SetFloat("roughness", 0.5f);
+	CHECK(GetFloat(instance, "roughness") == 0.5f);
+
+	CHECK(instance.SetFloat("roughness", 0.75f));
+	CHECK(!instance.IsShared());
+	parent->SetFloat("roughness", 0.1f);
+	CHECK(GetFloat(instance, "roughness") == 0.75f);
+	CHECK(GetFloat(*parent, "roughness") == 0.1f);
+}
+
+TEST_CASE(ResolveOnlyWhenTheParentChanged)
+{
+	std::shared_ptr<MaterialParameters> parent = std::make_shared<MaterialParameters>(MakeLayout());
+	MaterialParameters instance(parent);
+	CHECK(!instance.Resolve());
+	parent->SetFloat("roughness", 1.0f);
+	CHECK(instance.Resolve());
+	CHECK(!instance.Resolve());
+}
+
+TEST_CASE(OverridesSurviveTheParentsLayoutChanging)
+{
+	std::shared_ptr<MaterialParameters> parent = std::make_shared<MaterialParameters>(MakeLayout(false));
+	MaterialParameters instance(parent);
+	float red[4] = { 1.0f, 0.0f, 0.0f, 1.0f };
+	CHECK(instance.SetFloat4("colorTint", red));
+	CHECK(!instance.SetFloat("roughness", 0.5f));
+
+	// A reloaded shader adds a parameter; the tint carries over
+	parent->SetLayout(MakeLayout(true));
+	CHECK(instance.GetBlock().GetLayout() == parent->GetBlock().GetLayout());
+	float tint[4] = {};
+	instance.GetBlock().Get("colorTint", tint, sizeof(tint));
+	CHECK(tint[0] == 1.0f && tint[1] == 0.0f);
+	CHECK(instance.SetFloat("roughness", 0.5f));
+}
+
+TEST_CASE(InstancesOfInstancesShareTheRoot)
+{
+	std::shared_ptr<MaterialParameters> root = std::make_shared<MaterialParameters>(MakeLayout());
+	std::shared_ptr<MaterialParameters> child = std::make_shared<MaterialParameters>(root);
+	child->SetFloat("roughness", 0.3f);
+	MaterialParameters grandchild(child);
+	CHECK(grandchild.GetParent() == root);
+	CHECK(grandchild.GetOverrides().IsOverridden("roughness"));
+	CHECK(GetFloat(grandchild, "roughness") == 0.3f);
+}
+
+TEST_CASE(ClearingOverridesRevertsToTheParent)
+{
+	std::shared_ptr<MaterialParameters> parent = std::make_shared<MaterialParameters>(MakeLayout());
+	parent->SetFloat("roughness", 0.2f);
+	MaterialParameters instance(parent);
+	instance.SetFloat("roughness", 0.9f);
+	instance.ClearOverrides();
+	CHECK(instance.IsShared());
+	CHECK(GetFloat(instance, "roughness") == 0.2f);
+}
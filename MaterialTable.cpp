@@ -0,0 +1,120 @@
+#include "MaterialTable.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+MaterialTable::MaterialTable(std::shared_ptr<const ConstantBufferLayout> layout) :
+	layout(layout),
+	stride(layout ? layout->GetSize() : 0),
+	liveCount(0),
+	dirtyFirst(0),
+	dirtyEnd(0)
+{
+}
+
+unsigned int MaterialTable::Acquire()
+{
+	unsigned int id;
+	if (!freeIds.empty())
+	{
+		id = freeIds.back();
+		freeIds.pop_back();
+		memset(records.data() + (size_t)id * stride, 0, stride);
+		live[id] = true;
+	}
+	else
+	{
+		id = (unsigned int)live.size();
+		records.resize(records.size() + stride, 0);
+		live.push_back(true);
+	}
+
+	// Even a zeroed record has to reach the GPU once
+	liveCount++;
+	MarkDirty(id);
+	return id;
+}
+
+bool MaterialTable::Release(unsigned int id)
+{
+	if (!IsLive(id))
+		return false;
+
+	live[id] = false;
+	liveCount--;
+
+	// Lowest first keeps the live records packed at the front
+	freeIds.insert(std::upper_bound(freeIds.begin(), freeIds.end(), id, std::greater<unsigned int>()), id);
+	return true;
+}
+
+bool MaterialTable::IsLive(unsigned int id) const
+{
+	return id < live.size() && live[id];
+}
+
+bool MaterialTable::Write(unsigned int id, const ParameterBlock& block)
+{
+	if (!IsLive(id) || !layout)
+		return false;
+
+	unsigned char* record = records.data() + (size_t)id * stride;
+	std::shared_ptr<const ConstantBufferLayout> blockLayout = block.GetLayout();
+	if (blockLayout == layout)
+	{
+		if (memcmp(record, block.GetData(), stride) != 0)
+		{
+			memcpy(record, block.GetData(), stride);
+			MarkDirty(id);
+		}
+		return true;
+	}
+
+	bool changed = false;
+	if (blockLayout)
+		ConstantBufferLayout::Repack(*layout, record, *blockLayout, block.GetData(), &changed);
+	if (changed)
+		MarkDirty(id);
+	return true;
+}
+
+const unsigned char* MaterialTable::GetRecord(unsigned int id) const
+{
+	if (!IsLive(id))
+		return 0;
+	return records.data() + (size_t)id * stride;
+}
+
+std::shared_ptr<const ConstantBufferLayout> MaterialTable::GetLayout() const { return layout; }
+const unsigned char* MaterialTable::GetData() const { return records.data(); }
+unsigned int MaterialTable::GetStride() const { return stride; }
+unsigned int MaterialTable::GetRecordCount() const { return (unsigned int)live.size(); }
+unsigned int MaterialTable::GetLiveCount() const { return liveCount; }
+
+bool MaterialTable::GetDirtyRange(unsigned int* first, unsigned int* count) const
+{
+	if (dirtyEnd <= dirtyFirst)
+		return false;
+
+	*first = dirtyFirst;
+	*count = dirtyEnd - dirtyFirst;
+	return true;
+}
+
+void MaterialTable::ClearDirty()
+{
+	dirtyFirst = 0;
+	dirtyEnd = 0;
+}
+
+void MaterialTable::MarkDirty(unsigned int id)
+{
+	if (dirtyEnd <= dirtyFirst)
+	{
+		dirtyFirst = id;
+		dirtyEnd = id + 1;
+		return;
+	}
+	if (id < dirtyFirst) dirtyFirst = id;
+	if (id + 1 > dirtyEnd) dirtyEnd = id + 1;
+}
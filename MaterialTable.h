@@ -0,0 +1,57 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "ConstantBufferLayout.h"
+
+// --------------------------------------------------------
+// CPU-side table of material parameters, one fixed-size
+// record per material ID, laid out to be uploaded whole as a
+// StructuredBuffer that shaders index by ID
+//
+// - IDs are dense and handed back out once released, so the
+//    table only grows to the most materials alive at once
+// - Write() packs a parameter block into a record by name,
+//    so blocks laid out as cbuffers fit too
+// - Records are only dirty if a write changed their bytes;
+//    the dirty ones are tracked as a single range to upload
+// - Contains no graphics API code so it can be tested anywhere
+// --------------------------------------------------------
+class MaterialTable
+{
+public:
+	static constexpr unsigned int InvalidId = 0xFFFFFFFF;
+
+	MaterialTable(std::shared_ptr<const ConstantBufferLayout> layout);
+
+	// A zeroed record, reusing the lowest released ID first
+	unsigned int Acquire();
+	bool Release(unsigned int id);
+	bool IsLive(unsigned int id) const;
+
+	// False if the ID isn't live
+	bool Write(unsigned int id, const ParameterBlock& block);
+	const unsigned char* GetRecord(unsigned int id) const;
+
+	std::shared_ptr<const ConstantBufferLayout> GetLayout() const;
+	const unsigned char* GetData() const;
+	unsigned int GetStride() const;
+	unsigned int GetRecordCount() const;	// Including released ones
+	unsigned int GetLiveCount() const;
+
+	// The records written since ClearDirty(); false if none were
+	bool GetDirtyRange(unsigned int* first, unsigned int* count) const;
+	void ClearDirty();
+
+private:
+	std::shared_ptr<const ConstantBufferLayout> layout;
+	unsigned int stride;
+	std::vector<unsigned char> records;
+	std::vector<bool> live;
+	std::vector<unsigned int> freeIds;		// Kept sorted, highest first
+	unsigned int liveCount;
+
+	unsigned int dirtyFirst;
+	unsigned int dirtyEnd;		// One past the last dirty record
+
+	void MarkDirty(unsigned int id);
+};
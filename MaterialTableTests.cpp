@@ -0,0 +1,179 @@
+#include "MaterialTable.h"
+#include "TestHarness.h"
+#include <cstring>
+
+namespace
+{
+	ShaderParameterDesc Float(const char* name, ShaderParameterClass parameterClass, unsigned int rows, unsigned int columns, unsigned int elements = 0)
+	{
+		return { name, ShaderParameterType::Float, parameterClass, rows, columns, elements };
+	}
+
+	// The same parameters as a cbuffer and as a StructuredBuffer element
+	std::shared_ptr<ConstantBufferLayout> MakeLayout(LayoutPacking packing)
+	{
+		std::shared_ptr<ConstantBufferLayout> layout = std::make_shared<ConstantBufferLayout>("Material", packing);
+		layout->Add(Float("uvScale", ShaderParameterClass::Vector, 1, 2));
+		layout->Add(Float("colorTint", ShaderParameterClass::Vector, 1, 3));
+		layout->Add(Float("uvTransform", ShaderParameterClass::MatrixColumns, 3, 3));
+		layout->Add(Float("weights", ShaderParameterClass::Scalar, 1, 1, 3));
+		return layout;
+	}
+
+	ParameterBlock MakeBlock(std::shared_ptr<ConstantBufferLayout> layout, float tint)
+	{
+		ParameterBlock block(layout);
+		float uvScale[2] = { 1, 2 };
+		float colorTint[3] = { tint, 4, 5 };
+		float uvTransform[9] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+		float weight = 7;
+		block.SetFloat2("uvScale", uvScale);
+		block.SetFloat3("colorTint", colorTint);
+		block.SetMatrix("uvTransform", uvTransform);
+		block.Set("weights", &weight, sizeof(weight), 2);
+		return block;
+	}
+}
+
+TEST_CASE(RecordsUseTheStructuredLayout)
+{
+	std::shared_ptr<ConstantBufferLayout> layout = MakeLayout(LayoutPacking::Structured);
+	CHECK(layout->GetSize() == 68);
+
+	MaterialTable table(layout);
+	CHECK(table.GetStride() == 68);
+	CHECK(table.GetLayout() == layout);
+	CHECK(table.GetRecordCount() == 0);
+}
+
+TEST_CASE(IdsAreDenseAndReused)
+{
+	MaterialTable table(MakeLayout(LayoutPacking::Structured));
+	CHECK(table.Acquire() == 0);
+	CHECK(table.Acquire() == 1);
+	CHECK(table.Acquire() == 2);
+	CHECK(table.Acquire() == 3);
+	CHECK(table.GetLiveCount() == 4);
+
+	CHECK(table.Release(2));
+	CHECK(table.Release(0));
+	CHECK(!table.Release(0));
+	CHECK(!table.Release(99));
+	CHECK(!table.IsLive(0));
+	CHECK(table.IsLive(1));
+	CHECK(table.GetLiveCount() == 2);
+	CHECK(table.GetRecordCount() == 4);
+
+	// Lowest released ID first, then new ones
+	CHECK(table.Acquire() == 0);
+	CHECK(table.Acquire() == 2);
+	CHECK(table.Acquire() == 4);
+	CHECK(table.GetRecordCount() == 5);
+}
+
+TEST_CASE(ReusedRecordsStartZeroed)
+{
+	std::shared_ptr<ConstantBufferLayout> layout = MakeLayout(LayoutPacking::Structured);
+	MaterialTable table(layout);
+	unsigned int id = table.Acquire();
+	REQUIRE(table.Write(id, MakeBlock(layout, 3)));
+	table.Release(id);
+	CHECK(table.GetRecord(id) == 0);
+
+	REQUIRE(table.Acquire() == id);
+	const unsigned char* record = table.GetRecord(id);
+	for (unsigned int i = 0; i < table.GetStride(); i++)
+		CHECK(record[i] == 0);
+}
+
+TEST_CASE(CbufferBlocksArePackedTightly)
+{
+	// A block laid out as a cbuffer lands in the record member by member
+	std::shared_ptr<ConstantBufferLayout> structured = MakeLayout(LayoutPacking::Structured);
+	std::shared_ptr<ConstantBufferLayout> cbuffer = MakeLayout(LayoutPacking::ConstantBuffer);
+	MaterialTable table(structured);
+	table.Acquire();
+	unsigned int id = table.Acquire();
+	REQUIRE(table.Write(id, MakeBlock(cbuffer, 3)));
+
+	const float* record = (const float*)table.GetRecord(id);
+	CHECK(record[0] == 1 && record[1] == 2);
+	CHECK(record[2] == 3 && record[3] == 4 && record[4] == 5);
+
+	// The column_major matrix keeps its columns, now three floats apart
+	CHECK(record[5] == 1 && record[6] == 4 && record[7] == 7);
+	CHECK(record[8] == 2 && record[11] == 3);
+	CHECK(record[14] == 0 && record[16] == 7);
+
+	// A block in the table's own layout is copied straight in
+	unsigned int same = table.Acquire();
+	REQUIRE(table.Write(same, MakeBlock(structured, 3)));
+	CHECK(memcmp(table.GetRecord(same), table.GetRecord(id), table.GetStride()) == 0);
+}
+
+TEST_CASE(OnlyChangedRecordsAreDirty)
+{
+	std::shared_ptr<ConstantBufferLayout> layout = MakeLayout(LayoutPacking::Structured);
+	MaterialTable table(layout);
+	for (int i = 0; i < 8; i++)
+		table.Acquire();
+
+	// New records need uploading even while still zero
+	unsigned int first = 0, count = 0;
+	REQUIRE(table.GetDirtyRange(&first, &count));
+	CHECK(first == 0 && count == 8);
+	table.ClearDirty();
+	CHECK(!table.GetDirtyRange(&first, &count));
+
+	// Writing the same values again changes nothing
+	table.Write(1, ParameterBlock(layout));
+	CHECK(!table.GetDirtyRange(&first, &count));
+
+	table.Write(5, MakeBlock(layout, 3));
+	REQUIRE(table.GetDirtyRange(&first, &count));
+	CHECK(first == 5 && count == 1);
+
+	// One range covers every dirty record, and the ones between
+	table.Write(2, MakeBlock(MakeLayout(LayoutPacking::ConstantBuffer), 3));
+	REQUIRE(table.GetDirtyRange(&first, &count));
+	CHECK(first == 2 && count == 4);
+	table.ClearDirty();
+
+	table.Write(5, MakeBlock(layout, 3));
+	CHECK(!table.GetDirtyRange(&first, &count));
+	table.Write(5, MakeBlock(layout, 6));
+	CHECK(table.GetDirtyRange(&first, &count));
+}
+
+TEST_CASE(ReleasedIdsCantBeWritten)
+{
+	std::shared_ptr<ConstantBufferLayout> layout = MakeLayout(LayoutPacking::Structured);
+	MaterialTable table(layout);
+	unsigned int id = table.Acquire();
+	table.Release(id);
+	CHECK(!table.Write(id, MakeBlock(layout, 3)));
+	CHECK(!table.Write(MaterialTable::InvalidId, MakeBlock(layout, 3)));
+
+	// A block with nothing in common is accepted but changes nothing
+	id = table.Acquire();
+	table.ClearDirty();
+	std::shared_ptr<ConstantBufferLayout> unrelated = std::make_shared<ConstantBufferLayout>();
+	unrelated->Add(Float("roughness", ShaderParameterClass::Scalar, 1, 1));
+	ParameterBlock other(unrelated);
+	other.SetFloat("roughness", 0.5f);
+	CHECK(table.Write(id, other));
+	unsigned int first = 0, count = 0;
+	CHECK(!table.GetDirtyRange(&first, &count));
+}
+
+TEST_CASE(RecordsRoundTripBackToCbuffers)
+{
+	std::shared_ptr<ConstantBufferLayout> structured = MakeLayout(LayoutPacking::Structured);
+	std::shared_ptr<ConstantBufferLayout> cbuffer = MakeLayout(LayoutPacking::ConstantBuffer);
+	ParameterBlock original = MakeBlock(cbuffer, 3);
+	ParameterBlock record(structured);
+	ParameterBlock back(cbuffer);
+	CHECK(record.CopyMatching(original) == 4);
+	CHECK(back.CopyMatching(record) == 4);
+	CHECK(memcmp(back.GetData(), original.GetData(), cbuffer->GetSize()) == 0);
+}
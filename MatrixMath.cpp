@@ -0,0 +1,23 @@
+#include "MatrixMath.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Composes each object's world matrix with the camera's shared
+// view-projection once on the CPU, so the vertex shader only 
+// needs a single matrix-vector multiply per vertex
+// --------------------------------------------------------
+void MatrixMath::ComposeWorldViewProjection(
+	const XMFLOAT4X4* worldMatrices,
+	XMFLOAT4X4* wvpMatrices,
+	size_t count,
+	const XMFLOAT4X4& viewProjection)
+{
+	// Loaded once and kept in registers for the whole batch
+	XMMATRIX vp = XMLoadFloat4x4(&viewProjection);
+	for (size_t i = 0; i < count; i++)
+	{
+		XMMATRIX world = XMLoadFloat4x4(&worldMatrices[i]);
+		XMStoreFloat4x4(&wvpMatrices[i], XMMatrixMultiply(world, vp));
+	}
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstddef>
+
+// Batched matrix helpers for building per-object shader data
+namespace MatrixMath
+{
+	// wvp[i] = world[i] * viewProjection for every object in the batch
+	void ComposeWorldViewProjection(
+		const DirectX::XMFLOAT4X4* worldMatrices,
+		DirectX::XMFLOAT4X4* wvpMatrices,
+		size_t count,
+		const DirectX::XMFLOAT4X4& viewProjection);
+}
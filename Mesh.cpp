@@ -3,9 +3,12 @@
 #include "Mesh.h"
 #include <string>
 #include <memory>
+#include "Profiler.h"
 
 Mesh::Mesh(const char* filePath)
 {
+	PROFILE_SCOPE("Load Mesh");
+
 	// This mesh loader is from the tinyobjloader documentation with adjustments to fit current architecture
 	tinyobj::attrib_t attrib;
 	std::vector<tinyobj::shape_t> shapes;
@@ -14,6 +17,11 @@ Mesh::Mesh(const char* filePath)
 
 	bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &err, filePath, nullptr, true);
 
+	// Name the mesh after its file, minus the folders and extension
+	name = filePath;
+	name = name.substr(name.find_last_of("/\\") + 1);
+	name = name.substr(0, name.find_last_of('.'));
+
 	if (!ret)
 	{
 		throw std::runtime_error(err);
@@ -69,6 +77,7 @@ Mesh::Mesh(const char* filePath)
 	vertexCount = static_cast<int>(vertices.size());
 	indexCount = static_cast<int>(indices.size());
 	triangleCount = indexCount / 3;
+	CalculateBounds(vertices.data(), vertexCount);
 
 	// Create vertex buffer
 	D3D11_BUFFER_DESC vbd = {};
@@ -94,6 +103,8 @@ Mesh::Mesh(unsigned int indexCount, unsigned int* indices, unsigned int vertexCo
 	this->indexCount = indexCount;
 	this->vertexCount = vertexCount;
 	this->name = meshName;
+	this->vertices.assign(vertices, vertices + vertexCount);
+	this->indices.assign(indices, indices + indexCount);
 	D3D11_BUFFER_DESC vbd = {};
 	vbd.Usage = D3D11_USAGE_IMMUTABLE;
 	vbd.ByteWidth = vertexCount * sizeof(Vertex);
@@ -119,6 +130,7 @@ Mesh::Mesh(unsigned int indexCount, unsigned int* indices, unsigned int vertexCo
 
 	Graphics::Device->CreateBuffer(&ibd, &initialIndexData, indexBuffer.GetAddressOf());
 	triangleCount = indexCount / 3;
+	CalculateBounds(vertices, vertexCount);
 }
 
 
@@ -129,6 +141,7 @@ Mesh::Mesh()
 	vertexBuffer = ComPtrBuf();
 	indexBuffer = ComPtrBuf();
 	triangleCount = 1;
+	localBounds = {};
 }
 
 Mesh::~Mesh()
@@ -166,11 +179,95 @@ int Mesh::GetTriangleCount()
 	return triangleCount;
 }
 
+const AABB& Mesh::GetBounds()
+{
+	return localBounds;
+}
+
+const std::vector<Vertex>& Mesh::GetVertices()
+{
+	return vertices;
+}
+
+const std::vector<unsigned int>& Mesh::GetIndices()
+{
+	return indices;
+}
+
+const TriangleBVH& Mesh::GetTriangleBVH()
+{
+	if (!triangleBVH)
+	{
+		const DirectX::XMFLOAT3* positions = vertices.empty() ? 0 : &vertices[0].Position;
+		triangleBVH = std::make_shared<TriangleBVH>(positions, sizeof(Vertex), indices.data(), indices.size());
+	}
+	return *triangleBVH;
+}
+
+// --------------------------------------------------------
+// Closest hit between a local-space ray and this mesh's
+// triangles, either through its triangle BVH or by testing
+// every triangle
+// --------------------------------------------------------
+bool Mesh::Raycast(const Ray& localRay, float maxDistance, bool useTriangleBVH, TriangleHit* hit)
+{
+	if (useTriangleBVH)
+		return GetTriangleBVH().Raycast(localRay, maxDistance, hit);
+
+	bool found = false;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		float distance, u, v;
+		if (Bounds::IntersectTriangle(localRay, vertices[indices[i]].Position, vertices[indices[i + 1]].Position, vertices[indices[i + 2]].Position,
+			maxDistance, &distance, &u, &v))
+		{
+			maxDistance = distance;
+			found = true;
+			if (hit)
+			{
+				hit->distance = distance;
+				hit->triangle = (unsigned int)(i / 3);
+				hit->u = u;
+				hit->v = v;
+			}
+		}
+	}
+	return found;
+}
+
+void Mesh::CalculateBounds(const Vertex* vertices, unsigned int vertexCount)
+{
+	localBounds = {};
+	if (vertexCount == 0)
+		return;
+
+	localBounds = Bounds::Empty();
+	for (unsigned int i = 0; i < vertexCount; i++)
+	{
+		AABB point = { vertices[i].Position, vertices[i].Position };
+		localBounds = Bounds::Union(localBounds, point);
+	}
+}
+
 void Mesh::Draw()
+{
+	Draw(Graphics::Context.Get());
+}
+
+void Mesh::Draw(ID3D11DeviceContext* context)
+{
+	UINT stride = sizeof(Vertex);
+	UINT offset = 0;
+	context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
+	context->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+	context->DrawIndexed(indexCount, 0, 0);
+}
+
+void Mesh::DrawInstanced(ID3D11DeviceContext* context, unsigned int instanceCount)
 {
 	UINT stride = sizeof(Vertex);
 	UINT offset = 0;
-	Graphics::Context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
-	Graphics::Context->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
-	Graphics::Context->DrawIndexed(indexCount, 0, 0);
+	context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
+	context->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+	context->DrawIndexedInstanced(indexCount, instanceCount, 0, 0, 0);
 }
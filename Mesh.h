@@ -7,6 +7,9 @@
 #include <DirectXMath.h>
 #include <vector>
 #include "Vertex.h"
+#include "Bounds.h"
+#include "TriangleBVH.h"
+#include <memory>
 
 typedef Microsoft::WRL::ComPtr<ID3D11Buffer> ComPtrBuf;
 
@@ -31,6 +34,10 @@ class Mesh
 
 	std::vector<Vertex> vertices;
 	std::vector<unsigned int> indices;
+	AABB localBounds;
+	std::shared_ptr<TriangleBVH> triangleBVH;	// Built on first use
+
+	void CalculateBounds(const Vertex* vertices, unsigned int vertexCount);
 
 public:
 	Mesh(const char* filePath);
@@ -43,6 +50,13 @@ public:
 	std::string GetName();
 	int GetVertexCount();
 	int GetTriangleCount();
+	const AABB& GetBounds();
+	const std::vector<Vertex>& GetVertices();
+	const std::vector<unsigned int>& GetIndices();
+	const TriangleBVH& GetTriangleBVH();
+	bool Raycast(const Ray& localRay, float maxDistance, bool useTriangleBVH, TriangleHit* hit);
 	void Draw();
+	void Draw(ID3D11DeviceContext* context);
+	void DrawInstanced(ID3D11DeviceContext* context, unsigned int instanceCount);
 };
 
@@ -0,0 +1,373 @@
+#include "OcclusionCuller.h"
+#include <emmintrin.h>
+#include <cmath>
+#include <algorithm>
+
+using namespace DirectX;
+
+namespace
+{
+	XMFLOAT4 TransformPoint(const XMFLOAT3& p, const XMFLOAT4X4& m)
+	{
+		return XMFLOAT4(
+			p.x * m._11 + p.y * m._21 + p.z * m._31 + m._41,
+			p.x * m._12 + p.y * m._22 + p.z * m._32 + m._42,
+			p.x * m._13 + p.y * m._23 + p.z * m._33 + m._43,
+			p.x * m._14 + p.y * m._24 + p.z * m._34 + m._44);
+	}
+
+	XMFLOAT4X4 Multiply(const XMFLOAT4X4& a, const XMFLOAT4X4& b)
+	{
+		XMFLOAT4X4 result = {};
+		for (int row = 0; row < 4; row++)
+		{
+			for (int col = 0; col < 4; col++)
+			{
+				result.m[row][col] =
+					a.m[row][0] * b.m[0][col] + a.m[row][1] * b.m[1][col] +
+					a.m[row][2] * b.m[2][col] + a.m[row][3] * b.m[3][col];
+			}
+		}
+		return result;
+	}
+
+	XMFLOAT4 Lerp(const XMFLOAT4& a, const XMFLOAT4& b, float t)
+	{
+		return XMFLOAT4(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t);
+	}
+}
+
+OcclusionCuller::OcclusionCuller(unsigned int width, unsigned int height) :
+	viewProjection(),
+	rasterizedTriangles(0)
+{
+	// Whole tiles only, which also keeps rows a multiple of 4 pixels
+	this->width = (width + TileSize - 1) / TileSize * TileSize;
+	this->height = (height + TileSize - 1) / TileSize * TileSize;
+	tilesX = this->width / TileSize;
+	tilesY = this->height / TileSize;
+	depth.resize(this->width * this->height, 1.0f);
+
+	unsigned int levelWidth = tilesX;
+	unsigned int levelHeight = tilesY;
+	while (true)
+	{
+		hierarchy.push_back({ levelWidth, levelHeight, std::vector<float>(levelWidth * levelHeight, 1.0f) });
+		if (levelWidth == 1 && levelHeight == 1)
+			break;
+		levelWidth = (levelWidth + 1) / 2;
+		levelHeight = (levelHeight + 1) / 2;
+	}
+}
+
+void OcclusionCuller::BeginFrame(const XMFLOAT4X4& viewProjection)
+{
+	this->viewProjection = viewProjection;
+	std::fill(depth.begin(), depth.end(), 1.0f);
+	for (DepthLevel& level : hierarchy)
+		std::fill(level.maxDepth.begin(), level.maxDepth.end(), 1.0f);
+	rasterizedTriangles = 0;
+}
+
+void OcclusionCuller::RasterizeOccluder(const XMFLOAT3* positions, size_t positionStride,
+	const unsigned int* indices, size_t indexCount, const XMFLOAT4X4& world)
+{
+	XMFLOAT4X4 worldViewProjection = Multiply(world, viewProjection);
+	const char* base = reinterpret_cast<const char*>(positions);
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		XMFLOAT4 clip[3];
+		for (int v = 0; v < 3; v++)
+		{
+			const XMFLOAT3& position = *reinterpret_cast<const XMFLOAT3*>(base + indices[i + v] * positionStride);
+			clip[v] = TransformPoint(position, worldViewProjection);
+		}
+		RasterizeClipTriangle(clip);
+	}
+}
+
+// --------------------------------------------------------
+// Rebuilds the max-depth hierarchy once every occluder has
+// been rasterized
+// --------------------------------------------------------
+void OcclusionCuller::FinishOccluders()
+{
+	std::vector<float>& tileMaxDepth = hierarchy[0].maxDepth;
+	for (unsigned int tileY = 0; tileY < tilesY; tileY++)
+	{
+		for (unsigned int tileX = 0; tileX < tilesX; tileX++)
+		{
+			__m128 farthest = _mm_setzero_ps();
+			for (unsigned int y = 0; y < TileSize; y++)
+			{
+				const float* row = &depth[(tileY * TileSize + y) * width + tileX * TileSize];
+				for (unsigned int x = 0; x < TileSize; x += 4)
+				{
+					farthest = _mm_max_ps(farthest, _mm_loadu_ps(row + x));
+				}
+			}
+
+			float lanes[4];
+			_mm_storeu_ps(lanes, farthest);
+			tileMaxDepth[tileY * tilesX + tileX] = fmaxf(fmaxf(lanes[0], lanes[1]), fmaxf(lanes[2], lanes[3]));
+		}
+	}
+
+	// Each cell above covers up to 2x2 cells below - any missing
+	// at an odd edge are off screen, so they don't count
+	for (size_t level = 1; level < hierarchy.size(); level++)
+	{
+		const DepthLevel& below = hierarchy[level - 1];
+		DepthLevel& cells = hierarchy[level];
+		for (unsigned int y = 0; y < cells.height; y++)
+		{
+			for (unsigned int x = 0; x < cells.width; x++)
+			{
+				float farthest = 0.0f;
+				for (unsigned int childY = y * 2; childY < std::min(y * 2 + 2, below.height); childY++)
+				{
+					for (unsigned int childX = x * 2; childX < std::min(x * 2 + 2, below.width); childX++)
+					{
+						farthest = fmaxf(farthest, below.maxDepth[childY * below.width + childX]);
+					}
+				}
+				cells.maxDepth[y * cells.width + x] = farthest;
+			}
+		}
+	}
+}
+
+bool OcclusionCuller::IsVisible(const AABB& worldBounds) const
+{
+	float screenMin[2], screenMax[2], nearestDepth;
+	if (!ProjectBounds(worldBounds, screenMin, screenMax, &nearestDepth))
+		return true; // Crosses the near plane
+
+	// Off screen entirely - leave that to frustum culling
+	if (screenMax[0] <= 0.0f || screenMax[1] <= 0.0f || screenMin[0] >= width || screenMin[1] >= height)
+		return true;
+
+	int minX = (int)fmaxf(floorf(screenMin[0]), 0.0f);
+	int minY = (int)fmaxf(floorf(screenMin[1]), 0.0f);
+	int maxX = (int)fminf(ceilf(screenMax[0]), (float)width) - 1;
+	int maxY = (int)fminf(ceilf(screenMax[1]), (float)height) - 1;
+
+	int pixelRect[4] = { minX, minY, maxX, maxY };
+	return IsRegionVisible((unsigned int)hierarchy.size() - 1, 0, 0, pixelRect, nearestDepth);
+}
+
+// --------------------------------------------------------
+// Fraction of the screen covered by the bounds' projection,
+// used to pick the occluders worth rasterizing
+// --------------------------------------------------------
+float OcclusionCuller::EstimateScreenArea(const AABB& worldBounds) const
+{
+	float screenMin[2], screenMax[2], nearestDepth;
+	if (!ProjectBounds(worldBounds, screenMin, screenMax, &nearestDepth))
+		return 1.0f;
+
+	float x = fminf(screenMax[0], (float)width) - fmaxf(screenMin[0], 0.0f);
+	float y = fminf(screenMax[1], (float)height) - fmaxf(screenMin[1], 0.0f);
+	if (x <= 0.0f || y <= 0.0f)
+		return 0.0f;
+	return x * y / (width * height);
+}
+
+unsigned int OcclusionCuller::GetWidth() const { return width; }
+unsigned int OcclusionCuller::GetHeight() const { return height; }
+float OcclusionCuller::GetDepth(unsigned int x, unsigned int y) const { return depth[y * width + x]; }
+size_t OcclusionCuller::GetRasterizedTriangleCount() const { return rasterizedTriangles; }
+size_t OcclusionCuller::GetHierarchyLevelCount() const { return hierarchy.size(); }
+
+float OcclusionCuller::GetTileMaxDepth(unsigned int level, unsigned int x, unsigned int y) const
+{
+	const DepthLevel& cells = hierarchy[level];
+	return cells.maxDepth[y * cells.width + x];
+}
+
+// --------------------------------------------------------
+// Walks down the hierarchy through the cells a box's pixel
+// rectangle (min x, min y, max x, max y) touches, skipping any
+// whose farthest depth is still in front of the box - true as
+// soon as one pixel could see past the occluders
+// --------------------------------------------------------
+bool OcclusionCuller::IsRegionVisible(unsigned int level, unsigned int cellX, unsigned int cellY, const int* pixelRect, float nearestDepth) const
+{
+	const DepthLevel& cells = hierarchy[level];
+	if (cellX >= cells.width || cellY >= cells.height)
+		return false;
+
+	// The cell's pixels, clipped to the rectangle
+	int cellSize = (int)(TileSize << level);
+	int startX = std::max((int)cellX * cellSize, pixelRect[0]);
+	int startY = std::max((int)cellY * cellSize, pixelRect[1]);
+	int endX = std::min((int)(cellX + 1) * cellSize - 1, pixelRect[2]);
+	int endY = std::min((int)(cellY + 1) * cellSize - 1, pixelRect[3]);
+	if (startX > endX || startY > endY)
+		return false;
+
+	// Everything in the cell is in front of the box
+	if (cells.maxDepth[cellY * cells.width + cellX] < nearestDepth)
+		return false;
+
+	if (level > 0)
+	{
+		for (unsigned int child = 0; child < 4; child++)
+		{
+			if (IsRegionVisible(level - 1, cellX * 2 + (child & 1), cellY * 2 + (child >> 1), pixelRect, nearestDepth))
+				return true;
+		}
+		return false;
+	}
+
+	// A tile with something behind the box - look for the pixel
+	for (int y = startY; y <= endY; y++)
+	{
+		for (int x = startX; x <= endX; x++)
+		{
+			if (depth[y * width + x] >= nearestDepth)
+				return true;
+		}
+	}
+	return false;
+}
+
+// --------------------------------------------------------
+// Clips a clip-space triangle against the near plane (z >= 0),
+// then rasterizes the remaining fan in screen space
+// --------------------------------------------------------
+void OcclusionCuller::RasterizeClipTriangle(const XMFLOAT4* clip)
+{
+	XMFLOAT4 polygon[4];
+	int count = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		const XMFLOAT4& current = clip[i];
+		const XMFLOAT4& next = clip[(i + 1) % 3];
+		if (current.z >= 0.0f)
+			polygon[count++] = current;
+		if ((current.z >= 0.0f) != (next.z >= 0.0f))
+			polygon[count++] = Lerp(current, next, current.z / (current.z - next.z));
+	}
+	if (count < 3)
+		return;
+
+	XMFLOAT3 screen[4];
+	for (int i = 0; i < count; i++)
+	{
+		float inverseW = 1.0f / polygon[i].w;
+		screen[i].x = (polygon[i].x * inverseW * 0.5f + 0.5f) * width;
+		screen[i].y = (0.5f - polygon[i].y * inverseW * 0.5f) * height;
+		screen[i].z = polygon[i].z * inverseW;
+	}
+
+	for (int i = 1; i + 1 < count; i++)
+	{
+		XMFLOAT3 triangle[3] = { screen[0], screen[i], screen[i + 1] };
+		RasterizeScreenTriangle(triangle);
+	}
+}
+
+// --------------------------------------------------------
+// Writes the nearer of the existing and triangle depth for
+// every pixel center inside the triangle, 4 pixels at a time
+// --------------------------------------------------------
+void OcclusionCuller::RasterizeScreenTriangle(const XMFLOAT3* v)
+{
+	// Edge functions e = a*x + b*y + c, positive inside
+	float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+	if (fabsf(area) < 1e-6f)
+		return;
+
+	float sign = area > 0.0f ? 1.0f : -1.0f;
+	float edgeA[3], edgeB[3], edgeC[3];
+	for (int i = 0; i < 3; i++)
+	{
+		const XMFLOAT3& from = v[(i + 1) % 3];
+		const XMFLOAT3& to = v[(i + 2) % 3];
+		edgeA[i] = (from.y - to.y) * sign;
+		edgeB[i] = (to.x - from.x) * sign;
+		edgeC[i] = (from.x * to.y - from.y * to.x) * sign;
+	}
+
+	// Depth is linear in screen space: z = zA*x + zB*y + zC
+	float inverseArea = 1.0f / (area * sign);
+	float zA = (edgeA[0] * v[0].z + edgeA[1] * v[1].z + edgeA[2] * v[2].z) * inverseArea;
+	float zB = (edgeB[0] * v[0].z + edgeB[1] * v[1].z + edgeB[2] * v[2].z) * inverseArea;
+	float zC = (edgeC[0] * v[0].z + edgeC[1] * v[1].z + edgeC[2] * v[2].z) * inverseArea;
+
+	float minXf = fminf(v[0].x, fminf(v[1].x, v[2].x));
+	float maxXf = fmaxf(v[0].x, fmaxf(v[1].x, v[2].x));
+	float minYf = fminf(v[0].y, fminf(v[1].y, v[2].y));
+	float maxYf = fmaxf(v[0].y, fmaxf(v[1].y, v[2].y));
+	if (maxXf < 0.0f || maxYf < 0.0f || minXf >= width || minYf >= height)
+		return;
+
+	// Start on a 4 pixel boundary so every store is a whole group
+	int minX = (int)fmaxf(minXf, 0.0f) & ~3;
+	int minY = (int)fmaxf(minYf, 0.0f);
+	int maxX = (int)fminf(maxXf, (float)(width - 1));
+	int maxY = (int)fminf(maxYf, (float)(height - 1));
+	rasterizedTriangles++;
+
+	const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero = _mm_setzero_ps();
+	__m128 a0 = _mm_set1_ps(edgeA[0]), a1 = _mm_set1_ps(edgeA[1]), a2 = _mm_set1_ps(edgeA[2]);
+	__m128 za = _mm_set1_ps(zA);
+	for (int y = minY; y <= maxY; y++)
+	{
+		float pixelY = y + 0.5f;
+		__m128 rowE0 = _mm_set1_ps(edgeB[0] * pixelY + edgeC[0]);
+		__m128 rowE1 = _mm_set1_ps(edgeB[1] * pixelY + edgeC[1]);
+		__m128 rowE2 = _mm_set1_ps(edgeB[2] * pixelY + edgeC[2]);
+		__m128 rowZ = _mm_set1_ps(zB * pixelY + zC);
+
+		float* row = &depth[y * width];
+		for (int x = minX; x <= maxX; x += 4)
+		{
+			__m128 pixelX = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+			__m128 e0 = _mm_add_ps(_mm_mul_ps(a0, pixelX), rowE0);
+			__m128 e1 = _mm_add_ps(_mm_mul_ps(a1, pixelX), rowE1);
+			__m128 e2 = _mm_add_ps(_mm_mul_ps(a2, pixelX), rowE2);
+			__m128 inside = _mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_and_ps(_mm_cmpge_ps(e1, zero), _mm_cmpge_ps(e2, zero)));
+			if (_mm_movemask_ps(inside) == 0)
+				continue;
+
+			__m128 triangleDepth = _mm_add_ps(_mm_mul_ps(za, pixelX), rowZ);
+			__m128 existing = _mm_loadu_ps(row + x);
+			__m128 nearest = _mm_min_ps(existing, triangleDepth);
+			_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, existing)));
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Screen-space rectangle and nearest depth of a world box, 
+// or false if any corner is behind the near plane
+// --------------------------------------------------------
+bool OcclusionCuller::ProjectBounds(const AABB& worldBounds, float* screenMin, float* screenMax, float* nearestDepth) const
+{
+	screenMin[0] = screenMin[1] = 3.4e38f;
+	screenMax[0] = screenMax[1] = -3.4e38f;
+	*nearestDepth = 1.0f;
+	for (int corner = 0; corner < 8; corner++)
+	{
+		XMFLOAT3 point(
+			corner & 1 ? worldBounds.max.x : worldBounds.min.x,
+			corner & 2 ? worldBounds.max.y : worldBounds.min.y,
+			corner & 4 ? worldBounds.max.z : worldBounds.min.z);
+		XMFLOAT4 clip = TransformPoint(point, viewProjection);
+		if (clip.z < 0.0f || clip.w <= 0.0f)
+			return false;
+
+		float inverseW = 1.0f / clip.w;
+		float x = (clip.x * inverseW * 0.5f + 0.5f) * width;
+		float y = (0.5f - clip.y * inverseW * 0.5f) * height;
+		screenMin[0] = fminf(screenMin[0], x);
+		screenMin[1] = fminf(screenMin[1], y);
+		screenMax[0] = fmaxf(screenMax[0], x);
+		screenMax[1] = fmaxf(screenMax[1], y);
+		*nearestDepth = fminf(*nearestDepth, clip.z * inverseW);
+	}
+	return true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include "Bounds.h"
+
+// --------------------------------------------------------
+// Software occlusion culling on the CPU
+//
+// - Big occluders are rasterized (4 pixels at a time with SSE)
+//    into a small depth buffer from the camera's point of view
+// - The farthest depth of each 8x8 tile, then of each 2x2 block
+//    of those and so on up to the whole screen, forms a max-depth
+//    hierarchy; tests walk down it from the top, so anything
+//    behind a wall is usually rejected without touching a pixel
+// - An object is only culled if every pixel its screen-space
+//    bounds cover is closer than the nearest point of its box,
+//    so the results are always conservative
+// --------------------------------------------------------
+class OcclusionCuller
+{
+public:
+	static const unsigned int TileSize = 8;
+
+	OcclusionCuller(unsigned int width = 256, unsigned int height = 144);
+
+	void BeginFrame(const DirectX::XMFLOAT4X4& viewProjection);
+	void RasterizeOccluder(const DirectX::XMFLOAT3* positions, size_t positionStride,
+		const unsigned int* indices, size_t indexCount, const DirectX::XMFLOAT4X4& world);
+	void FinishOccluders();
+
+	bool IsVisible(const AABB& worldBounds) const;
+	float EstimateScreenArea(const AABB& worldBounds) const;
+
+	unsigned int GetWidth() const;
+	unsigned int GetHeight() const;
+	float GetDepth(unsigned int x, unsigned int y) const;
+	size_t GetRasterizedTriangleCount() const;
+	size_t GetHierarchyLevelCount() const;
+	float GetTileMaxDepth(unsigned int level, unsigned int x, unsigned int y) const;
+
+private:
+	unsigned int width;
+	unsigned int height;
+	unsigned int tilesX;
+	unsigned int tilesY;
+	DirectX::XMFLOAT4X4 viewProjection;
+
+	// One level of the max-depth hierarchy: level 0 has a value
+	// per tile, and each level above halves both dimensions
+	struct DepthLevel
+	{
+		unsigned int width;
+		unsigned int height;
+		std::vector<float> maxDepth;
+	};
+
+	std::vector<float> depth;			// 0 at the near plane, 1 at the far plane
+	std::vector<DepthLevel> hierarchy;	// Level 0 first, ending with a single value
+	size_t rasterizedTriangles;
+
+	void RasterizeClipTriangle(const DirectX::XMFLOAT4* clip);
+	void RasterizeScreenTriangle(const DirectX::XMFLOAT3* screen);
+	bool IsRegionVisible(unsigned int level, unsigned int cellX, unsigned int cellY, const int* pixelRect, float nearestDepth) const;
+	bool ProjectBounds(const AABB& worldBounds, float* screenMin, float* screenMax, float* nearestDepth) const;
+};
@@ -0,0 +1,232 @@
+#include "OcclusionCuller.h"
+#include "TestHarness.h"
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	// A camera at the origin looking down +Z, so world z is view depth
+	XMFLOAT4X4 MakeViewProjection()
+	{
+		XMFLOAT4X4 viewProjection;
+		XMStoreFloat4x4(&viewProjection, XMMatrixPerspectiveFovLH(XM_PIDIV2, 16.0f / 9.0f, 1.0f, 100.0f));
+		return viewProjection;
+	}
+
+	XMFLOAT4X4 Identity()
+	{
+		XMFLOAT4X4 identity;
+		XMStoreFloat4x4(&identity, XMMatrixIdentity());
+		return identity;
+	}
+
+	AABB MakeBox(float x, float y, float z, float halfSize)
+	{
+		return { XMFLOAT3(x - halfSize, y - halfSize, z - halfSize), XMFLOAT3(x + halfSize, y + halfSize, z + halfSize) };
+	}
+
+	// A square facing the camera, from (x0, y0) to (x1, y1) at depth z
+	void RasterizeWall(OcclusionCuller& culler, float x0, float y0, float x1, float y1, float z)
+	{
+		XMFLOAT3 corners[] = { XMFLOAT3(x0, y0, z), XMFLOAT3(x0, y1, z), XMFLOAT3(x1, y1, z), XMFLOAT3(x1, y0, z) };
+		unsigned int indices[] = { 0, 1, 2, 0, 2, 3 };
+		culler.RasterizeOccluder(corners, sizeof(XMFLOAT3), indices, 6, Identity());
+	}
+
+	// What the hierarchy must agree with: every pixel under the box's
+	// screen rectangle, checked one at a time.  Mirrors IsVisible's
+	// projection, which the tests can't reach directly.
+	bool IsVisibleFlat(const OcclusionCuller& culler, const XMFLOAT4X4& viewProjection, const AABB& box)
+	{
+		float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f, nearest = 1.0f;
+		for (int corner = 0; corner < 8; corner++)
+		{
+			XMFLOAT3 p(corner & 1 ? box.max.x : box.min.x, corner & 2 ? box.max.y : box.min.y, corner & 4 ? box.max.z : box.min.z);
+			const XMFLOAT4X4& m = viewProjection;
+			float x = p.x * m._11 + p.y * m._21 + p.z * m._31 + m._41;
+			float y = p.x * m._12 + p.y * m._22 + p.z * m._32 + m._42;
+			float z = p.x * m._13 + p.y * m._23 + p.z * m._33 + m._43;
+			float w = p.x * m._14 + p.y * m._24 + p.z * m._34 + m._44;
+			if (z < 0.0f || w <= 0.0f)
+				return true;
+			minX = fminf(minX, (x / w * 0.5f + 0.5f) * culler.GetWidth());
+			maxX = fmaxf(maxX, (x / w * 0.5f + 0.5f) * culler.GetWidth());
+			minY = fminf(minY, (0.5f - y / w * 0.5f) * culler.GetHeight());
+			maxY = fmaxf(maxY, (0.5f - y / w * 0.5f) * culler.GetHeight());
+			nearest = fminf(nearest, z / w);
+		}
+		if (maxX <= 0.0f || maxY <= 0.0f || minX >= culler.GetWidth() || minY >= culler.GetHeight())
+			return true;
+
+		for (int y = (int)fmaxf(floorf(minY), 0.0f); y < (int)fminf(ceilf(maxY), (float)culler.GetHeight()); y++)
+			for (int x = (int)fmaxf(floorf(minX), 0.0f); x < (int)fminf(ceilf(maxX), (float)culler.GetWidth()); x++)
+				if (culler.GetDepth(x, y) >= nearest)
+					return true;
+		return false;
+	}
+}
+
+TEST_CASE(SizeRoundsUpToWholeTiles)
+{
+	OcclusionCuller culler(250, 140);
+	CHECK(culler.GetWidth() == 256);
+	CHECK(culler.GetHeight() == 144);
+
+	// 32x18 tiles, then 16x9, 8x5, 4x3, 2x2 and 1x1
+	CHECK(culler.GetHierarchyLevelCount() == 6);
+}
+
+TEST_CASE(EmptyBufferHidesNothing)
+{
+	OcclusionCuller culler;
+	XMFLOAT4X4 viewProjection = MakeViewProjection();
+	culler.BeginFrame(viewProjection);
+	culler.FinishOccluders();
+	CHECK(culler.IsVisible(MakeBox(0.0f, 0.0f, 50.0f, 1.0f)));
+	CHECK(culler.GetRasterizedTriangleCount() == 0);
+}
+
+TEST_CASE(WallHidesWhatIsBehindIt)
+{
+	OcclusionCuller culler;
+	XMFLOAT4X4 viewProjection = MakeViewProjection();
+	culler.BeginFrame(viewProjection);
+	RasterizeWall(culler, -20.0f, -20.0f, 20.0f, 20.0f, 10.0f);
+	culler.FinishOccluders();
+	CHECK(culler.GetRasterizedTriangleCount() == 2);
+
+	CHECK(!culler.IsVisible(MakeBox(0.0f, 0.0f, 30.0f, 2.0f)));
+	CHECK(culler.IsVisible(MakeBox(0.0f, 0.0f, 5.0f, 1.0f)));		// In front
+	CHECK(culler.IsVisible(MakeBox(0.0f, 0.0f, 10.0f, 1.0f)));		// Through it
+}
+
+TEST_CASE(PartlyCoveredBoxesStayVisible)
+{
+	OcclusionCuller culler;
+	XMFLOAT4X4 viewProjection = MakeViewProjection();
+	culler.BeginFrame(viewProjection);
+	RasterizeWall(culler, -20.0f, -20.0f, 0.0f, 20.0f, 10.0f);
+	culler.FinishOccluders();
+
+	CHECK(!culler.IsVisible(MakeBox(-10.0f, 0.0f, 30.0f, 2.0f)));
+	CHECK(culler.IsVisible(MakeBox(0.0f, 0.0f, 30.0f, 2.0f)));		// Straddles the edge
+	CHECK(culler.IsVisible(MakeBox(10.0f, 0.0f, 30.0f, 2.0f)));
+}
+
+TEST_CASE(OneUncoveredPixelIsEnough)
+{
+	// Two walls with a sliver between them: the tiles over the gap
+	// have far depth, so only the pixel test can tell
+	OcclusionCuller culler;
+	XMFLOAT4X4 viewProjection = MakeViewProjection();
+	culler.BeginFrame(viewProjection);
+	RasterizeWall(culler, -20.0f, -20.0f, -0.2f, 20.0f, 10.0f);
+	RasterizeWall(culler, 0.2f, -20.0f, 20.0f, 20.0f, 10.0f);
+	culler.FinishOccluders();
+
+	CHECK(culler.IsVisible(MakeBox(0.0f, 0.0f, 30.0f, 2.0f)));
+	CHECK(!culler.IsVisible(MakeBox(-8.0f, 0.0f, 30.0f, 2.0f)));
+}
+
+TEST_CASE(RasterizedDepthMatchesTheProjection)
+{
+	OcclusionCuller culler;
+	XMFLOAT4X4 viewProjection = MakeViewProjection();
+	culler.BeginFrame(viewProjection);
+	RasterizeWall(culler, -100.0f, -100.0f, 100.0f, 100.0f, 10.0f);
+	culler.FinishOccluders();
+
+	// Post-projection depth of z = 10 with near 1, far 100
+	float expected = (100.0f / 99.0f) * (1.0f - 1.0f / 10.0f);
+	CHECK_NEAR(culler.GetDepth(0, 0), expected, 1e-4f);
+	CHECK_NEAR(culler.GetDepth(culler.GetWidth() / 2, culler.GetHeight() / 2), expected, 1e-4f);
+	CHECK_NEAR(culler.GetDepth(culler.GetWidth() - 1, culler.GetHeight() - 1), expected, 1e-4f);
+
+	// Every level of the hierarchy agrees with the full-screen wall
+	for (unsigned int level = 0; level < culler.GetHierarchyLevelCount(); level++)
+		CHECK_NEAR(culler.GetTileMaxDepth(level, 0, 0), expected, 1e-4f);
+}
+
+TEST_CASE(NearerOccludersWin)
+{
+	OcclusionCuller culler;
+	XMFLOAT4X4 viewProjection = MakeViewProjection();
+	culler.BeginFrame(viewProjection);
+	RasterizeWall(culler, -100.0f, -100.0f, 100.0f, 100.0f, 50.0f);
+	RasterizeWall(culler, -100.0f, -100.0f, 100.0f, 100.0f, 10.0f);
+	RasterizeWall(culler, -100.0f, -100.0f, 100.0f, 100.0f, 30.0f);
+	culler.FinishOccluders();
+	CHECK_NEAR(culler.GetDepth(10, 10), (100.0f / 99.0f) * (1.0f - 1.0f / 10.0f), 1e-4f);
+}
+
+TEST_CASE(TrianglesCrossingTheNearPlaneAreClipped)
+{
+	OcclusionCuller culler;
+	XMFLOAT4X4 viewProjection = MakeViewProjection();
+	culler.BeginFrame(viewProjection);
+
+	// A floor running from behind the camera into the distance
+	XMFLOAT3 corners[] = { XMFLOAT3(-50.0f, -2.0f, -10.0f), XMFLOAT3(-50.0f, -2.0f, 90.0f), XMFLOAT3(50.0f, -2.0f, 90.0f), XMFLOAT3(50.0f, -2.0f, -10.0f) };
+	unsigned int indices[] = { 0, 1, 2, 0, 2, 3 };
+	culler.RasterizeOccluder(corners, sizeof(XMFLOAT3), indices, 6, Identity());
+	culler.FinishOccluders();
+	CHECK(culler.GetRasterizedTriangleCount() > 0);
+
+	// Written below the horizon, untouched above it
+	float floorDepth = culler.GetDepth(culler.GetWidth() / 2, culler.GetHeight() - 1);
+	CHECK(floorDepth >= 0.0f && floorDepth < 1.0f);
+	CHECK(culler.GetDepth(culler.GetWidth() / 2, 0) == 1.0f);
+}
+
+TEST_CASE(BoxesCrossingTheNearPlaneOrOffScreenAreVisible)
+{
+	OcclusionCuller culler;
+	XMFLOAT4X4 viewProjection = MakeViewProjection();
+	culler.BeginFrame(viewProjection);
+	RasterizeWall(culler, -100.0f, -100.0f, 100.0f, 100.0f, 10.0f);
+	culler.FinishOccluders();
+	CHECK(culler.IsVisible(MakeBox(0.0f, 0.0f, 0.0f, 2.0f)));
+	CHECK(culler.IsVisible(MakeBox(0.0f, 0.0f, -30.0f, 2.0f)));
+	CHECK(culler.IsVisible(MakeBox(500.0f, 0.0f, 30.0f, 2.0f)));
+}
+
+TEST_CASE(HierarchyAgreesWithAFlatPixelScan)
+{
+	std::mt19937 random(8);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	OcclusionCuller culler(250, 140);
+	XMFLOAT4X4 viewProjection = MakeViewProjection();
+	for (int frame = 0; frame < 10; frame++)
+	{
+		culler.BeginFrame(viewProjection);
+		for (int wall = 0; wall < 12; wall++)
+		{
+			float x = unit(random) * 60.0f - 30.0f;
+			float y = unit(random) * 30.0f - 15.0f;
+			float size = 2.0f + unit(random) * 10.0f;
+			RasterizeWall(culler, x, y, x + size, y + size * 0.5f, 5.0f + unit(random) * 20.0f);
+		}
+		culler.FinishOccluders();
+
+		int hidden = 0;
+		for (int test = 0; test < 500; test++)
+		{
+			AABB box = MakeBox(unit(random) * 80.0f - 40.0f, unit(random) * 40.0f - 20.0f, 8.0f + unit(random) * 50.0f, 0.2f + unit(random) * 2.0f);
+			bool visible = culler.IsVisible(box);
+			REQUIRE(visible == IsVisibleFlat(culler, viewProjection, box));
+			hidden += visible ? 0 : 1;
+		}
+		CHECK(hidden > 0);
+	}
+}
+
+TEST_CASE(ScreenAreaOfCoveringAndOffScreenBoxes)
+{
+	OcclusionCuller culler;
+	culler.BeginFrame(MakeViewProjection());
+	CHECK_NEAR(culler.EstimateScreenArea(MakeBox(0.0f, 0.0f, 20.0f, 100.0f)), 1.0f, 1e-6f);	// Crosses the near plane
+	CHECK(culler.EstimateScreenArea(MakeBox(500.0f, 0.0f, 20.0f, 1.0f)) == 0.0f);
+	float small = culler.EstimateScreenArea(MakeBox(0.0f, 0.0f, 50.0f, 1.0f));
+	CHECK(small > 0.0f && small < 0.01f);
+}
@@ -0,0 +1,44 @@
+#include "Picking.h"
+
+using namespace DirectX;
+
+PickResult Picking::PickEntity(const Ray& worldRay, float maxDistance, const SpatialPartition& partition,
+	EntityRegistry& entities, const std::vector<std::shared_ptr<Mesh>>& meshes, bool useTriangleBVH)
+{
+	PickResult result = {};
+	std::vector<Transform>& transforms = entities.GetTransforms();
+	std::vector<MeshHandle>& meshHandles = entities.GetMeshes();
+	std::vector<Entity>& denseEntities = entities.GetEntities();
+
+	auto intersectEntity = [&](unsigned int entityIndex, float maxHitDistance)
+	{
+		unsigned int dense = entities.GetDenseIndex(entityIndex);
+		if (dense == EntityRegistry::InvalidIndex)
+			return -1.0f;
+
+		// Bring the ray into the mesh's space - the direction isn't
+		// renormalized, so distances along it match the world ray's
+		XMFLOAT4X4 world = transforms[dense].GetWorldMatrix();
+		XMMATRIX inverseWorld = XMMatrixInverse(0, XMLoadFloat4x4(&world));
+		Ray localRay = {};
+		XMStoreFloat3(&localRay.origin, XMVector3TransformCoord(XMLoadFloat3(&worldRay.origin), inverseWorld));
+		XMStoreFloat3(&localRay.direction, XMVector3TransformNormal(XMLoadFloat3(&worldRay.direction), inverseWorld));
+
+		TriangleHit hit = {};
+		if (!meshes[meshHandles[dense]]->Raycast(localRay, maxHitDistance, useTriangleBVH, &hit))
+			return -1.0f;
+
+		// Only ever hits closer than every earlier candidate
+		result.entity = denseEntities[dense];
+		result.triangle = hit.triangle;
+		return hit.distance;
+	};
+
+	result.hit = partition.Raycast(worldRay, maxDistance, intersectEntity, &result.distance, 0);
+	if (result.hit)
+	{
+		XMVECTOR position = XMLoadFloat3(&worldRay.origin) + XMLoadFloat3(&worldRay.direction) * result.distance;
+		XMStoreFloat3(&result.position, position);
+	}
+	return result;
+}
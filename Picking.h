@@ -0,0 +1,25 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "Bounds.h"
+#include "EntityRegistry.h"
+#include "SpatialPartition.h"
+#include "Mesh.h"
+
+// The nearest entity under a ray
+struct PickResult
+{
+	bool hit;
+	Entity entity;
+	unsigned int triangle;		// In the entity's mesh
+	float distance;				// Along the world-space ray
+	DirectX::XMFLOAT3 position;	// World-space hit point
+};
+
+namespace Picking
+{
+	// Broad phase against the partition's bounds, narrow phase against
+	// each candidate's triangles, nearest hit first
+	PickResult PickEntity(const Ray& worldRay, float maxDistance, const SpatialPartition& partition,
+		EntityRegistry& entities, const std::vector<std::shared_ptr<Mesh>>& meshes, bool useTriangleBVH);
+}
@@ -0,0 +1,59 @@
+#include "PipelineState.h"
+#include <cstddef>
+
+namespace
+{
+	const unsigned long long HashBasis = 14695981039346656037ull;
+	const unsigned long long HashPrime = 1099511628211ull;
+
+	// 64-bit FNV-1a, continuing from an existing hash
+	unsigned long long HashValue(unsigned long long hash, unsigned long long value)
+	{
+		for (int i = 0; i < 8; i++)
+		{
+			hash ^= (value >> (i * 8)) & 0xFF;
+			hash *= HashPrime;
+		}
+		return hash;
+	}
+}
+
+unsigned long long PipelineStates::Hash(const PipelineStateDesc& desc)
+{
+	// Field by field rather than over the struct, so padding never
+	// leaks into the hash
+	unsigned long long hash = HashBasis;
+	hash = HashValue(hash, (unsigned long long)(size_t)desc.vertexShader);
+	hash = HashValue(hash, (unsigned long long)(size_t)desc.pixelShader);
+	hash = HashValue(hash, (unsigned long long)(size_t)desc.inputLayout);
+	hash = HashValue(hash, (unsigned long long)desc.state.fill);
+	hash = HashValue(hash, (unsigned long long)desc.state.cull);
+	hash = HashValue(hash, (unsigned long long)desc.state.blend);
+	hash = HashValue(hash, (unsigned long long)desc.state.depth);
+	hash = HashValue(hash, (unsigned long long)desc.state.topology);
+	return hash;
+}
+
+unsigned int PipelineStates::Diff(const PipelineStateDesc* bound, const PipelineStateDesc& next)
+{
+	if (!bound)
+		return PipelineChangeAll;
+
+	unsigned int changes = PipelineChangeNone;
+	if (bound->vertexShader != next.vertexShader) changes |= PipelineChangeVertexShader;
+	if (bound->pixelShader != next.pixelShader) changes |= PipelineChangePixelShader;
+	if (bound->inputLayout != next.inputLayout) changes |= PipelineChangeInputLayout;
+	if (bound->state.fill != next.state.fill || bound->state.cull != next.state.cull) changes |= PipelineChangeRasterizer;
+	if (bound->state.blend != next.state.blend) changes |= PipelineChangeBlend;
+	if (bound->state.depth != next.state.depth) changes |= PipelineChangeDepthStencil;
+	if (bound->state.topology != next.state.topology) changes |= PipelineChangeTopology;
+	return changes;
+}
+
+unsigned int PipelineStates::CountChanges(unsigned int changes)
+{
+	unsigned int count = 0;
+	for (; changes; changes &= changes - 1)
+		count++;
+	return count;
+}
@@ -0,0 +1,146 @@
+#pragma once
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Fixed-function settings, kept as small enums so they hash
+// and compare without any D3D headers
+enum class FillMode : unsigned char { Solid, Wireframe };
+enum class CullMode : unsigned char { None, Front, Back };
+enum class BlendMode : unsigned char { Opaque, AlphaBlend, Additive };
+enum class DepthMode : unsigned char { ReadWrite, ReadOnly, Disabled };
+enum class PrimitiveTopology : unsigned char { TriangleList, TriangleStrip, LineList, LineStrip, PointList };
+
+struct FixedFunctionState
+{
+	FillMode fill = FillMode::Solid;
+	CullMode cull = CullMode::Back;
+	BlendMode blend = BlendMode::Opaque;
+	DepthMode depth = DepthMode::ReadWrite;
+	PrimitiveTopology topology = PrimitiveTopology::TriangleList;
+
+	bool operator==(const FixedFunctionState& other) const
+	{
+		return fill == other.fill && cull == other.cull && blend == other.blend &&
+			depth == other.depth && topology == other.topology;
+	}
+	bool operator!=(const FixedFunctionState& other) const { return !(*this == other); }
+};
+
+// --------------------------------------------------------
+// Everything a pipeline state is made of.  The shaders and
+// layout are only compared by address - they come from the
+// shader library, so equal objects are the same object.
+// --------------------------------------------------------
+struct PipelineStateDesc
+{
+	const void* vertexShader = 0;
+	const void* pixelShader = 0;
+	const void* inputLayout = 0;
+	FixedFunctionState state;
+
+	bool operator==(const PipelineStateDesc& other) const
+	{
+		return vertexShader == other.vertexShader && pixelShader == other.pixelShader &&
+			inputLayout == other.inputLayout && state == other.state;
+	}
+};
+
+// Which parts of the pipeline have to be rebound
+enum PipelineStateChange : unsigned int
+{
+	PipelineChangeNone = 0,
+	PipelineChangeVertexShader = 1 << 0,
+	PipelineChangePixelShader = 1 << 1,
+	PipelineChangeInputLayout = 1 << 2,
+	PipelineChangeRasterizer = 1 << 3,
+	PipelineChangeBlend = 1 << 4,
+	PipelineChangeDepthStencil = 1 << 5,
+	PipelineChangeTopology = 1 << 6,
+	PipelineChangeAll = (1 << 7) - 1,
+};
+
+namespace PipelineStates
+{
+	unsigned long long Hash(const PipelineStateDesc& desc);
+
+	// What has to change to go from bound to next; everything
+	// if nothing is bound yet
+	unsigned int Diff(const PipelineStateDesc* bound, const PipelineStateDesc& next);
+
+	// How many of the change bits are set
+	unsigned int CountChanges(unsigned int changes);
+}
+
+// --------------------------------------------------------
+// Pipeline states bucketed by the hash of their desc, as
+// PipelineStateCache keeps them.  State just needs GetDesc(),
+// so this builds (and is tested) without D3D.
+//
+// - Not locked; the cache holds its own mutex around it
+// - Descs key on shader addresses, so each hot reload leaves
+//    states for the replaced shaders behind.  ReleaseUnused()
+//    drops any state only the table still references, and
+//    with it the last hold on those old shaders.
+// --------------------------------------------------------
+template<typename State>
+class PipelineStateTable
+{
+public:
+	std::shared_ptr<const State> Find(const PipelineStateDesc& desc, unsigned long long hash) const
+	{
+		auto bucket = buckets.find(hash);
+		if (bucket == buckets.end())
+			return nullptr;
+		for (const std::shared_ptr<const State>& state : bucket->second)
+		{
+			if (state->GetDesc() == desc)
+				return state;
+		}
+		return nullptr;
+	}
+
+	void Add(unsigned long long hash, std::shared_ptr<const State> state)
+	{
+		buckets[hash].push_back(std::move(state));
+		count++;
+	}
+
+	// Returns how many states were released
+	size_t ReleaseUnused()
+	{
+		size_t released = 0;
+		for (auto bucket = buckets.begin(); bucket != buckets.end();)
+		{
+			std::vector<std::shared_ptr<const State>>& states = bucket->second;
+			for (size_t i = 0; i < states.size();)
+			{
+				if (states[i].use_count() == 1)
+				{
+					states[i] = states.back();
+					states.pop_back();
+					released++;
+				}
+				else
+				{
+					i++;
+				}
+			}
+			bucket = states.empty() ? buckets.erase(bucket) : std::next(bucket);
+		}
+		count -= released;
+		return released;
+	}
+
+	size_t GetCount() const { return count; }
+
+	void Clear()
+	{
+		buckets.clear();
+		count = 0;
+	}
+
+private:
+	std::unordered_map<unsigned long long, std::vector<std::shared_ptr<const State>>> buckets;
+	size_t count = 0;
+};
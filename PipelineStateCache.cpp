@@ -0,0 +1,171 @@
+#include "PipelineStateCache.h"
+#include "Graphics.h"
+#include "Profiler.h"
+
+namespace
+{
+	D3D11_PRIMITIVE_TOPOLOGY ToD3D(PrimitiveTopology topology)
+	{
+		switch (topology)
+		{
+		case PrimitiveTopology::TriangleStrip: return D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP;
+		case PrimitiveTopology::LineList: return D3D11_PRIMITIVE_TOPOLOGY_LINELIST;
+		case PrimitiveTopology::LineStrip: return D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP;
+		case PrimitiveTopology::PointList: return D3D11_PRIMITIVE_TOPOLOGY_POINTLIST;
+		default: return D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+		}
+	}
+}
+
+const PipelineStateDesc& PipelineState::GetDesc() const { return desc; }
+unsigned long long PipelineState::GetHash() const { return hash; }
+
+unsigned int PipelineState::Apply(ID3D11DeviceContext* context, const PipelineState* bound) const
+{
+	unsigned int changes = PipelineStates::Diff(bound ? &bound->desc : 0, desc);
+	if (changes & PipelineChangeVertexShader)
+		context->VSSetShader(vertexShader.Get(), 0, 0);
+	if (changes & PipelineChangePixelShader)
+		context->PSSetShader(pixelShader.Get(), 0, 0);
+	if (changes & PipelineChangeInputLayout)
+		context->IASetInputLayout(inputLayout.Get());
+	if (changes & PipelineChangeRasterizer)
+		context->RSSetState(rasterizerState.Get());
+	if (changes & PipelineChangeBlend)
+		context->OMSetBlendState(blendState.Get(), 0, 0xFFFFFFFF);
+	if (changes & PipelineChangeDepthStencil)
+		context->OMSetDepthStencilState(depthStencilState.Get(), 0);
+	if (changes & PipelineChangeTopology)
+		context->IASetPrimitiveTopology(topology);
+	return changes;
+}
+
+PipelineStateCache& PipelineStateCache::Global()
+{
+	static PipelineStateCache cache;
+	return cache;
+}
+
+std::shared_ptr<const PipelineState> PipelineStateCache::Get(VertexShaderPtr vertexShader, PixelShaderPtr pixelShader,
+	InputLayoutPtr inputLayout, const FixedFunctionState& state)
+{
+	PipelineStateDesc desc;
+	desc.vertexShader = vertexShader.Get();
+	desc.pixelShader = pixelShader.Get();
+	desc.inputLayout = inputLayout.Get();
+	desc.state = state;
+	unsigned long long hash = PipelineStates::Hash(desc);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	stats.requests++;
+
+	std::shared_ptr<const PipelineState> existing = pipelineStates.Find(desc, hash);
+	if (existing)
+	{
+		stats.cacheHits++;
+		return existing;
+	}
+
+	PROFILE_SCOPE("Create Pipeline State");
+	std::shared_ptr<PipelineState> pipelineState = std::make_shared<PipelineState>();
+	pipelineState->desc = desc;
+	pipelineState->hash = hash;
+	pipelineState->vertexShader = vertexShader;
+	pipelineState->pixelShader = pixelShader;
+	pipelineState->inputLayout = inputLayout;
+	pipelineState->rasterizerState = GetRasterizerState(state.fill, state.cull);
+	pipelineState->blendState = GetBlendState(state.blend);
+	pipelineState->depthStencilState = GetDepthStencilState(state.depth);
+	pipelineState->topology = ToD3D(state.topology);
+	pipelineStates.Add(hash, pipelineState);
+	stats.pipelineStatesCreated++;
+	return pipelineState;
+}
+
+PipelineStateCacheStats PipelineStateCache::GetStats()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+size_t PipelineStateCache::GetPipelineStateCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return pipelineStates.GetCount();
+}
+
+size_t PipelineStateCache::ReleaseUnused()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	size_t released = pipelineStates.ReleaseUnused();
+	stats.pipelineStatesReleased += (unsigned int)released;
+	return released;
+}
+
+void PipelineStateCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	pipelineStates.Clear();
+	for (auto& fillStates : rasterizerStates)
+	{
+		for (auto& rasterizerState : fillStates)
+			rasterizerState.Reset();
+	}
+	for (auto& blendState : blendStates)
+		blendState.Reset();
+	for (auto& depthStencilState : depthStencilStates)
+		depthStencilState.Reset();
+}
+
+// The getters below expect the mutex to be held
+
+ID3D11RasterizerState* PipelineStateCache::GetRasterizerState(FillMode fill, CullMode cull)
+{
+	Microsoft::WRL::ComPtr<ID3D11RasterizerState>& rasterizerState = rasterizerStates[(int)fill][(int)cull];
+	if (!rasterizerState)
+	{
+		D3D11_RASTERIZER_DESC rasterizerDesc = {};
+		rasterizerDesc.FillMode = fill == FillMode::Wireframe ? D3D11_FILL_WIREFRAME : D3D11_FILL_SOLID;
+		rasterizerDesc.CullMode = cull == CullMode::None ? D3D11_CULL_NONE : (cull == CullMode::Front ? D3D11_CULL_FRONT : D3D11_CULL_BACK);
+		rasterizerDesc.DepthClipEnable = TRUE;
+		Graphics::Device->CreateRasterizerState(&rasterizerDesc, rasterizerState.GetAddressOf());
+		stats.stateObjectsCreated++;
+	}
+	return rasterizerState.Get();
+}
+
+ID3D11BlendState* PipelineStateCache::GetBlendState(BlendMode blend)
+{
+	Microsoft::WRL::ComPtr<ID3D11BlendState>& blendState = blendStates[(int)blend];
+	if (!blendState)
+	{
+		D3D11_BLEND_DESC blendDesc = {};
+		D3D11_RENDER_TARGET_BLEND_DESC& target = blendDesc.RenderTarget[0];
+		target.BlendEnable = blend != BlendMode::Opaque;
+		target.SrcBlend = blend == BlendMode::AlphaBlend ? D3D11_BLEND_SRC_ALPHA : D3D11_BLEND_ONE;
+		target.DestBlend = blend == BlendMode::AlphaBlend ? D3D11_BLEND_INV_SRC_ALPHA : (blend == BlendMode::Additive ? D3D11_BLEND_ONE : D3D11_BLEND_ZERO);
+		target.BlendOp = D3D11_BLEND_OP_ADD;
+		target.SrcBlendAlpha = D3D11_BLEND_ONE;
+		target.DestBlendAlpha = blend == BlendMode::AlphaBlend ? D3D11_BLEND_INV_SRC_ALPHA : (blend == BlendMode::Additive ? D3D11_BLEND_ONE : D3D11_BLEND_ZERO);
+		target.BlendOpAlpha = D3D11_BLEND_OP_ADD;
+		target.RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+		Graphics::Device->CreateBlendState(&blendDesc, blendState.GetAddressOf());
+		stats.stateObjectsCreated++;
+	}
+	return blendState.Get();
+}
+
+ID3D11DepthStencilState* PipelineStateCache::GetDepthStencilState(DepthMode depth)
+{
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState>& depthStencilState = depthStencilStates[(int)depth];
+	if (!depthStencilState)
+	{
+		D3D11_DEPTH_STENCIL_DESC depthDesc = {};
+		depthDesc.DepthEnable = depth != DepthMode::Disabled;
+		depthDesc.DepthWriteMask = depth == DepthMode::ReadWrite ? D3D11_DEPTH_WRITE_MASK_ALL : D3D11_DEPTH_WRITE_MASK_ZERO;
+		depthDesc.DepthFunc = D3D11_COMPARISON_LESS;
+		Graphics::Device->CreateDepthStencilState(&depthDesc, depthStencilState.GetAddressOf());
+		stats.stateObjectsCreated++;
+	}
+	return depthStencilState.Get();
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <d3d11.h>
+#include <memory>
+#include <mutex>
+#include "TypeDefs.h"
+#include "PipelineState.h"
+
+// --------------------------------------------------------
+// An immutable bundle of everything a draw binds besides its
+// buffers: shaders, input layout, rasterizer, blend,
+// depth-stencil and topology
+//
+// - Only made by PipelineStateCache, so two materials with
+//    the same settings share one object
+// - Apply() diffs against whatever is bound and only sets
+//    the parts that differ
+// --------------------------------------------------------
+class PipelineState
+{
+public:
+	const PipelineStateDesc& GetDesc() const;
+	unsigned long long GetHash() const;
+
+	// Binds this state over bound (which may be null, in which
+	// case everything is set); returns the PipelineStateChange bits
+	unsigned int Apply(ID3D11DeviceContext* context, const PipelineState* bound) const;
+
+private:
+	friend class PipelineStateCache;
+
+	PipelineStateDesc desc;
+	unsigned long long hash;
+
+	VertexShaderPtr vertexShader;
+	PixelShaderPtr pixelShader;
+	InputLayoutPtr inputLayout;
+	Microsoft::WRL::ComPtr<ID3D11RasterizerState> rasterizerState;
+	Microsoft::WRL::ComPtr<ID3D11BlendState> blendState;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> depthStencilState;
+	D3D11_PRIMITIVE_TOPOLOGY topology;
+};
+
+struct PipelineStateCacheStats
+{
+	unsigned int requests;
+	unsigned int cacheHits;
+	unsigned int pipelineStatesCreated;
+	unsigned int stateObjectsCreated;		// Rasterizer, blend and depth-stencil
+	unsigned int pipelineStatesReleased;	// Left over from shader reloads
+};
+
+// --------------------------------------------------------
+// Creates each pipeline state once and hands out shared
+// references to it.  Safe to call from any thread.
+// --------------------------------------------------------
+class PipelineStateCache
+{
+public:
+	static PipelineStateCache& Global();
+
+	std::shared_ptr<const PipelineState> Get(VertexShaderPtr vertexShader, PixelShaderPtr pixelShader,
+		InputLayoutPtr inputLayout, const FixedFunctionState& state);
+
+	PipelineStateCacheStats GetStats();
+	size_t GetPipelineStateCount();
+
+	// Drops states no material uses any more (e.g. ones built
+	// on shaders a reload replaced) - call after swapping them
+	size_t ReleaseUnused();
+
+	// Releases every cached object - call before the device goes away
+	void Clear();
+
+private:
+	std::mutex mutex;
+
+	PipelineStateTable<PipelineState> pipelineStates;
+
+	// The fixed-function objects, one per setting
+	Microsoft::WRL::ComPtr<ID3D11RasterizerState> rasterizerStates[2][3];
+	Microsoft::WRL::ComPtr<ID3D11BlendState> blendStates[3];
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> depthStencilStates[3];
+	PipelineStateCacheStats stats = {};
+
+	ID3D11RasterizerState* GetRasterizerState(FillMode fill, CullMode cull);
+	ID3D11BlendState* GetBlendState(BlendMode blend);
+	ID3D11DepthStencilState* GetDepthStencilState(DepthMode depth);
+};
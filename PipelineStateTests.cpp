@@ -0,0 +1,226 @@
+#include "PipelineState.h"
+#include "TestHarness.h"
+#include <unordered_set>
+
+namespace
+{
+	// Stand-ins for shader library objects, compared by address
+	int vertexShaderA, vertexShaderB;
+	int pixelShaderA, pixelShaderB;
+	int inputLayoutA, inputLayoutB;
+
+	PipelineStateDesc MakeDesc()
+	{
+		PipelineStateDesc desc;
+		desc.vertexShader = &vertexShaderA;
+		desc.pixelShader = &pixelShaderA;
+		desc.inputLayout = &inputLayoutA;
+		return desc;
+	}
+
+	// Stands in for a PipelineState: it holds its shaders like the
+	// real one holds ComPtrs to them
+	struct MockPipelineState
+	{
+		PipelineStateDesc desc;
+		std::shared_ptr<int> vertexShader;
+		std::shared_ptr<int> pixelShader;
+
+		const PipelineStateDesc& GetDesc() const { return desc; }
+	};
+
+	std::shared_ptr<const MockPipelineState> Get(PipelineStateTable<MockPipelineState>& table,
+		std::shared_ptr<int> vertexShader, std::shared_ptr<int> pixelShader)
+	{
+		PipelineStateDesc desc = MakeDesc();
+		desc.vertexShader = vertexShader.get();
+		desc.pixelShader = pixelShader.get();
+		unsigned long long hash = PipelineStates::Hash(desc);
+		std::shared_ptr<const MockPipelineState> state = table.Find(desc, hash);
+		if (!state)
+		{
+			state = std::make_shared<MockPipelineState>(MockPipelineState{ desc, vertexShader, pixelShader });
+			table.Add(hash, state);
+		}
+		return state;
+	}
+}
+
+TEST_CASE(EqualDescsHashAndCompareEqual)
+{
+	PipelineStateDesc a = MakeDesc();
+	PipelineStateDesc b = MakeDesc();
+	CHECK(a == b);
+	CHECK(PipelineStates::Hash(a) == PipelineStates::Hash(b));
+	CHECK(PipelineStates::Diff(&a, b) == PipelineChangeNone);
+}
+
+TEST_CASE(DefaultStateIsSolidBackCulledOpaque)
+{
+	FixedFunctionState state;
+	CHECK(state.fill == FillMode::Solid);
+	CHECK(state.cull == CullMode::Back);
+	CHECK(state.blend == BlendMode::Opaque);
+	CHECK(state.depth == DepthMode::ReadWrite);
+	CHECK(state.topology == PrimitiveTopology::TriangleList);
+	CHECK(state == FixedFunctionState());
+}
+
+TEST_CASE(EachFieldChangesEqualityHashAndDiff)
+{
+	const PipelineStateDesc original = MakeDesc();
+	PipelineStateDesc changed[7] = { original, original, original, original, original, original, original };
+	changed[0].vertexShader = &vertexShaderB;
+	changed[1].pixelShader = &pixelShaderB;
+	changed[2].inputLayout = &inputLayoutB;
+	changed[3].state.cull = CullMode::None;
+	changed[4].state.blend = BlendMode::AlphaBlend;
+	changed[5].state.depth = DepthMode::ReadOnly;
+	changed[6].state.topology = PrimitiveTopology::LineList;
+	const unsigned int expected[7] =
+	{
+		PipelineChangeVertexShader, PipelineChangePixelShader, PipelineChangeInputLayout,
+		PipelineChangeRasterizer, PipelineChangeBlend, PipelineChangeDepthStencil, PipelineChangeTopology,
+	};
+
+	for (int i = 0; i < 7; i++)
+	{
+		CHECK(!(changed[i] == original));
+		CHECK(PipelineStates::Hash(changed[i]) != PipelineStates::Hash(original));
+		CHECK(PipelineStates::Diff(&original, changed[i]) == expected[i]);
+		CHECK(PipelineStates::Diff(&changed[i], original) == expected[i]);
+	}
+
+	// Fill and cull mode share the one rasterizer state
+	PipelineStateDesc wireframe = original;
+	wireframe.state.fill = FillMode::Wireframe;
+	CHECK(PipelineStates::Diff(&original, wireframe) == PipelineChangeRasterizer);
+	CHECK(wireframe.state != original.state);
+}
+
+TEST_CASE(SeveralChangesAreCombined)
+{
+	PipelineStateDesc bound = MakeDesc();
+	PipelineStateDesc next = bound;
+	next.pixelShader = &pixelShaderB;
+	next.state.fill = FillMode::Wireframe;
+	next.state.cull = CullMode::Front;
+	next.state.blend = BlendMode::Additive;
+
+	unsigned int changes = PipelineStates::Diff(&bound, next);
+	CHECK(changes == (PipelineChangePixelShader | PipelineChangeRasterizer | PipelineChangeBlend));
+	CHECK(PipelineStates::CountChanges(changes) == 3);
+}
+
+TEST_CASE(NothingBoundChangesEverything)
+{
+	PipelineStateDesc desc = MakeDesc();
+	CHECK(PipelineStates::Diff(0, desc) == PipelineChangeAll);
+	CHECK(PipelineStates::CountChanges(PipelineChangeAll) == 7);
+	CHECK(PipelineStates::CountChanges(PipelineChangeNone) == 0);
+}
+
+TEST_CASE(ShadersAreComparedByAddressOnly)
+{
+	// Swapping which slot holds which object is still a change
+	PipelineStateDesc a = MakeDesc();
+	PipelineStateDesc b = a;
+	b.vertexShader = a.pixelShader;
+	b.pixelShader = a.vertexShader;
+	CHECK(!(a == b));
+	CHECK(PipelineStates::Hash(a) != PipelineStates::Hash(b));
+	CHECK(PipelineStates::Diff(&a, b) == (PipelineChangeVertexShader | PipelineChangePixelShader));
+}
+
+TEST_CASE(EveryFixedFunctionCombinationHashesUniquely)
+{
+	// Materials that differ only in settings mustn't share a bucket
+	std::unordered_set<unsigned long long> hashes;
+	size_t combinations = 0;
+	for (int fill = 0; fill < 2; fill++)
+		for (int cull = 0; cull < 3; cull++)
+			for (int blend = 0; blend < 3; blend++)
+				for (int depth = 0; depth < 3; depth++)
+					for (int topology = 0; topology < 5; topology++)
+					{
+						PipelineStateDesc desc = MakeDesc();
+						desc.state.fill = (FillMode)fill;
+						desc.state.cull = (CullMode)cull;
+						desc.state.blend = (BlendMode)blend;
+						desc.state.depth = (DepthMode)depth;
+						desc.state.topology = (PrimitiveTopology)topology;
+						hashes.insert(PipelineStates::Hash(desc));
+						combinations++;
+					}
+	CHECK(combinations == 270);
+	CHECK(hashes.size() == combinations);
+}
+
+TEST_CASE(TableFindsStatesByDesc)
+{
+	PipelineStateTable<MockPipelineState> table;
+	std::shared_ptr<int> vertexShader = std::make_shared<int>(0);
+	std::shared_ptr<int> pixelShader = std::make_shared<int>(0);
+	std::shared_ptr<const MockPipelineState> state = Get(table, vertexShader, pixelShader);
+	CHECK(Get(table, vertexShader, pixelShader) == state);
+	CHECK(table.GetCount() == 1);
+
+	PipelineStateDesc other = state->desc;
+	other.state.cull = CullMode::None;
+	CHECK(table.Find(other, PipelineStates::Hash(other)) == nullptr);
+
+	table.Clear();
+	CHECK(table.GetCount() == 0);
+	CHECK(table.Find(state->desc, PipelineStates::Hash(state->desc)) == nullptr);
+}
+
+TEST_CASE(ReloadedShadersStatesAreReleased)
+{
+	PipelineStateTable<MockPipelineState> table;
+	std::shared_ptr<int> vertexShader = std::make_shared<int>(0);
+	std::shared_ptr<int> pixelShader = std::make_shared<int>(0);
+	std::shared_ptr<int> otherPixelShader = std::make_shared<int>(0);
+
+	// Two materials on the same shaders, one on another
+	std::shared_ptr<const MockPipelineState> materialA = Get(table, vertexShader, pixelShader);
+	std::shared_ptr<const MockPipelineState> materialB = Get(table, vertexShader, pixelShader);
+	std::shared_ptr<const MockPipelineState> materialC = Get(table, vertexShader, otherPixelShader);
+	CHECK(table.GetCount() == 2);
+	CHECK(table.ReleaseUnused() == 0);
+
+	// A reload: the library swaps in a new pixel shader and drops
+	// the old one, then the materials move over to it
+	PipelineStateDesc staleDesc = materialA->desc;
+	std::weak_ptr<int> oldPixelShader = pixelShader;
+	pixelShader = std::make_shared<int>(0);
+	materialA = Get(table, vertexShader, pixelShader);
+	CHECK(table.GetCount() == 3);
+	CHECK(table.ReleaseUnused() == 0);		// B still uses the stale state
+	materialB = Get(table, vertexShader, pixelShader);
+
+	// Only the stale state goes, and with it the old shader
+	CHECK(!oldPixelShader.expired());
+	CHECK(table.ReleaseUnused() == 1);
+	CHECK(oldPixelShader.expired());
+	CHECK(table.GetCount() == 2);
+	CHECK(table.Find(staleDesc, PipelineStates::Hash(staleDesc)) == nullptr);
+	CHECK(Get(table, vertexShader, pixelShader) == materialA);
+	CHECK(Get(table, vertexShader, otherPixelShader) == materialC);
+
+	// Repeated edit-and-reload cycles don't grow the table
+	for (int reload = 0; reload < 20; reload++)
+	{
+		pixelShader = std::make_shared<int>(0);
+		materialA = Get(table, vertexShader, pixelShader);
+		materialB = materialA;
+		table.ReleaseUnused();
+		CHECK(table.GetCount() == 2);
+	}
+
+	// Nothing left using them at all
+	materialA.reset();
+	materialB.reset();
+	materialC.reset();
+	CHECK(table.ReleaseUnused() == 2);
+	CHECK(table.GetCount() == 0);
+}
@@ -1,12 +1,20 @@
-cbuffer ExternalData : register(b0)
+cbuffer PerFrame : register(b0)
 {
-    float4 colorTint;
-    float2 uv;
-    float2 padding;
-    float3 normal;
+    matrix view;
+    matrix projection;
+    matrix viewProjection;
     float time;
 }
 
+// Every material drawn with this shader, indexed by the
+// material ID each instance carries
+struct MaterialParameters
+{
+    float4 colorTint;
+};
+
+StructuredBuffer<MaterialParameters> materials : register(t0);
+
 // Struct representing the data we expect to receive from earlier pipeline stages
 // - Should match the output of our corresponding vertex shader
 // - The name of the struct itself is unimportant
@@ -22,6 +30,7 @@ struct VertexToPixel
 	float4 screenPosition	: SV_POSITION;
     float2 uv				: TEXCOORD;
 	float3 normal			: NORMAL;
+	nointerpolation uint materialId : MATERIAL;
 };
 
 // --------------------------------------------------------
@@ -35,9 +44,17 @@ struct VertexToPixel
 // --------------------------------------------------------
 float4 main(VertexToPixel input) : SV_TARGET
 {
+	// The debug views are permutations of this same shader,
+	// built with one of these defined (see ShaderPermutations.txt)
+#if defined(DEBUG_NORMALS)
+    return float4(input.normal, 1.0f);
+#elif defined(DEBUG_UVS)
+    return float4(input.uv, 0.0f, 1.0f);
+#else
 	// Just return the input color
 	// - This color (like most values passing through the rasterizer) is 
 	//   interpolated for each pixel between the corresponding vertices 
 	//   of the triangle we're rendering
-    return colorTint;
+    return materials[input.materialId].colorTint;
+#endif
 }
\ No newline at end of file
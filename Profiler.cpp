@@ -0,0 +1,178 @@
+#include "Profiler.h"
+#include <chrono>
+#include <algorithm>
+
+namespace
+{
+	std::atomic<unsigned long long> nextProfilerId(1);
+
+	// Each thread's buffer for each profiler it has recorded into
+	struct ThreadBufferSlot
+	{
+		unsigned long long profilerId;
+		void* buffer;
+	};
+	thread_local std::vector<ThreadBufferSlot> threadBufferSlots;
+
+	const size_t ClosedScope = (size_t)-1;
+}
+
+CpuProfiler::CpuProfiler(size_t maxEventsPerThread) :
+	id(nextProfilerId++),
+	maxEventsPerThread(maxEventsPerThread),
+	enabled(true),
+	droppedEvents(0),
+	frameStart(Now()),
+	frameNumber(0)
+{
+	lastFrame.frameNumber = 0;
+	lastFrame.start = frameStart;
+	lastFrame.end = frameStart;
+}
+
+CpuProfiler& CpuProfiler::Global()
+{
+	static CpuProfiler profiler;
+	return profiler;
+}
+
+long long CpuProfiler::Now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void CpuProfiler::SetEnabled(bool enabled) { this->enabled = enabled; }
+bool CpuProfiler::IsEnabled() const { return enabled; }
+
+void CpuProfiler::BeginFrame()
+{
+	frameStart = Now();
+}
+
+// --------------------------------------------------------
+// Moves every finished scope out of the thread buffers and
+// into the last frame; scopes still open stay behind
+// --------------------------------------------------------
+void CpuProfiler::EndFrame()
+{
+	ProfileFrame frame;
+	frame.frameNumber = ++frameNumber;
+	frame.start = frameStart;
+	frame.end = Now();
+	frame.events.swap(lastFrame.events);
+	frame.events.clear();
+
+	std::lock_guard<std::mutex> threadsLock(threadsMutex);
+	for (const std::unique_ptr<ThreadBuffer>& thread : threads)
+	{
+		std::lock_guard<std::mutex> lock(thread->mutex);
+		std::vector<ProfileEvent>& events = thread->events;
+
+		size_t kept = 0;
+		size_t nextOpen = 0;
+		for (size_t i = 0; i < events.size(); i++)
+		{
+			if (events[i].end != 0)
+			{
+				frame.events.push_back(events[i]);
+				continue;
+			}
+
+			// Still open - slide it down and fix up its index
+			while (nextOpen < thread->openScopes.size() && thread->openScopes[nextOpen] != i)
+				nextOpen++;
+			if (nextOpen < thread->openScopes.size())
+				thread->openScopes[nextOpen] = kept;
+			events[kept++] = events[i];
+		}
+		events.resize(kept);
+	}
+
+	std::sort(frame.events.begin(), frame.events.end(), [](const ProfileEvent& a, const ProfileEvent& b)
+	{
+		return a.threadIndex != b.threadIndex ? a.threadIndex < b.threadIndex : a.start < b.start;
+	});
+	lastFrame = std::move(frame);
+}
+
+bool CpuProfiler::BeginScope(const char* name)
+{
+	if (!enabled)
+		return false;
+
+	ThreadBuffer* thread = GetThreadBuffer();
+	std::lock_guard<std::mutex> lock(thread->mutex);
+	if (thread->events.size() >= maxEventsPerThread)
+	{
+		// Still track the nesting so the matching EndScope() lines up
+		thread->openScopes.push_back(ClosedScope);
+		droppedEvents++;
+		return true;
+	}
+
+	ProfileEvent event = {};
+	event.name = name;
+	event.start = Now();
+	event.threadIndex = thread->threadIndex;
+	event.depth = (unsigned int)thread->openScopes.size();
+	thread->openScopes.push_back(thread->events.size());
+	thread->events.push_back(event);
+	return true;
+}
+
+void CpuProfiler::EndScope()
+{
+	long long end = Now();
+	ThreadBuffer* thread = GetThreadBuffer();
+	std::lock_guard<std::mutex> lock(thread->mutex);
+	if (thread->openScopes.empty())
+		return;
+
+	size_t index = thread->openScopes.back();
+	thread->openScopes.pop_back();
+	if (index != ClosedScope)
+		thread->events[index].end = end;
+}
+
+void CpuProfiler::SetThreadName(const std::string& name)
+{
+	ThreadBuffer* thread = GetThreadBuffer();
+	std::lock_guard<std::mutex> lock(thread->mutex);
+	thread->name = name;
+}
+
+std::vector<std::string> CpuProfiler::GetThreadNames()
+{
+	std::vector<std::string> names;
+	std::lock_guard<std::mutex> threadsLock(threadsMutex);
+	for (const std::unique_ptr<ThreadBuffer>& thread : threads)
+	{
+		std::lock_guard<std::mutex> lock(thread->mutex);
+		names.push_back(thread->name.empty() ? "Thread " + std::to_string(thread->threadIndex) : thread->name);
+	}
+	return names;
+}
+
+const ProfileFrame& CpuProfiler::GetLastFrame() const { return lastFrame; }
+unsigned long long CpuProfiler::GetDroppedEventCount() const { return droppedEvents; }
+
+CpuProfiler::ThreadBuffer* CpuProfiler::GetThreadBuffer()
+{
+	for (const ThreadBufferSlot& slot : threadBufferSlots)
+	{
+		if (slot.profilerId == id)
+			return static_cast<ThreadBuffer*>(slot.buffer);
+	}
+
+	// First scope from this thread - give it a buffer of its own
+	std::lock_guard<std::mutex> threadsLock(threadsMutex);
+	threads.push_back(std::make_unique<ThreadBuffer>());
+	ThreadBuffer* thread = threads.back().get();
+	thread->events.reserve(maxEventsPerThread);
+	thread->threadIndex = (unsigned int)threads.size() - 1;
+
+	ThreadBufferSlot slot = { id, thread };
+	threadBufferSlots.push_back(slot);
+	return thread;
+}
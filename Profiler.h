@@ -0,0 +1,103 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <mutex>
+#include <memory>
+#include <atomic>
+
+// One timed scope on one thread
+struct ProfileEvent
+{
+	const char* name;			// Must outlive the profiler - normally a string literal
+	long long start;			// Nanoseconds on CpuProfiler::Now()'s clock
+	long long end;
+	unsigned int threadIndex;	// Threads are numbered in the order they first record
+	unsigned int depth;			// Nesting level on its thread
+};
+
+// Every scope that finished during one frame
+struct ProfileFrame
+{
+	unsigned long long frameNumber;
+	long long start;
+	long long end;
+	std::vector<ProfileEvent> events;	// Sorted by thread, then start time
+};
+
+// --------------------------------------------------------
+// Collects hierarchical CPU timing scopes from any thread
+//
+// - Each thread records into its own buffer, so the lock taken
+//    per scope is only ever contended while a frame is closed
+// - Buffers are allocated up front; scopes past the per-thread
+//    limit are dropped and counted rather than growing memory
+// - EndFrame() gathers every finished scope into a frame that
+//    can be read until the next EndFrame()
+// --------------------------------------------------------
+class CpuProfiler
+{
+public:
+	CpuProfiler(size_t maxEventsPerThread = 8192);
+
+	static CpuProfiler& Global();
+	static long long Now();
+
+	void SetEnabled(bool enabled);
+	bool IsEnabled() const;
+
+	void BeginFrame();
+	void EndFrame();
+
+	// BeginScope() returns false if nothing was recorded, in which
+	// case EndScope() must not be called for it
+	bool BeginScope(const char* name);
+	void EndScope();
+
+	void SetThreadName(const std::string& name);
+	std::vector<std::string> GetThreadNames();
+
+	const ProfileFrame& GetLastFrame() const;
+	unsigned long long GetDroppedEventCount() const;
+
+private:
+	struct ThreadBuffer
+	{
+		std::mutex mutex;
+		std::vector<ProfileEvent> events;
+		std::vector<size_t> openScopes;	// Indices into events, innermost last
+		unsigned int threadIndex;
+		std::string name;
+	};
+
+	unsigned long long id;
+	size_t maxEventsPerThread;
+	std::atomic<bool> enabled;
+	std::atomic<unsigned long long> droppedEvents;
+
+	std::mutex threadsMutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> threads;
+
+	long long frameStart;
+	unsigned long long frameNumber;
+	ProfileFrame lastFrame;
+
+	ThreadBuffer* GetThreadBuffer();
+};
+
+// Times the enclosing block
+class ProfileScope
+{
+public:
+	ProfileScope(CpuProfiler& profiler, const char* name) : profiler(profiler), active(profiler.BeginScope(name)) {}
+	~ProfileScope() { if (active) profiler.EndScope(); }
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	CpuProfiler& profiler;
+	bool active;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(CpuProfiler::Global(), name)
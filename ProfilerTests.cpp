@@ -0,0 +1,207 @@
+#include "Profiler.h"
+#include "TestHarness.h"
+#include <cstring>
+#include <thread>
+
+namespace
+{
+	const ProfileEvent* FindEvent(const ProfileFrame& frame, const char* name)
+	{
+		for (const ProfileEvent& event : frame.events)
+			if (strcmp(event.name, name) == 0)
+				return &event;
+		return 0;
+	}
+}
+
+TEST_CASE(NestedScopesRecordDepthAndContainment)
+{
+	CpuProfiler profiler;
+	profiler.BeginFrame();
+	{
+		ProfileScope outer(profiler, "Outer");
+		{
+			ProfileScope inner(profiler, "Inner");
+		}
+		ProfileScope sibling(profiler, "Sibling");
+	}
+	profiler.EndFrame();
+
+	const ProfileFrame& frame = profiler.GetLastFrame();
+	CHECK(frame.frameNumber == 1);
+	REQUIRE(frame.events.size() == 3);
+	const ProfileEvent* outer = FindEvent(frame, "Outer");
+	const ProfileEvent* inner = FindEvent(frame, "Inner");
+	const ProfileEvent* sibling = FindEvent(frame, "Sibling");
+	REQUIRE(outer && inner && sibling);
+	CHECK(outer->depth == 0);
+	CHECK(inner->depth == 1);
+	CHECK(sibling->depth == 1);
+	CHECK(outer->start <= inner->start && inner->end <= outer->end);
+	CHECK(inner->end <= sibling->start);
+	CHECK(frame.start <= outer->start && outer->end <= frame.end);
+
+	// Sorted by start time on the one thread
+	CHECK(frame.events[0].start <= frame.events[1].start);
+	CHECK(frame.events[1].start <= frame.events[2].start);
+}
+
+TEST_CASE(OpenScopesCarryIntoTheNextFrame)
+{
+	CpuProfiler profiler;
+	profiler.BeginFrame();
+	REQUIRE(profiler.BeginScope("Long"));
+	{
+		ProfileScope done(profiler, "Done");
+	}
+	profiler.EndFrame();
+	CHECK(profiler.GetLastFrame().events.size() == 1);
+	CHECK(FindEvent(profiler.GetLastFrame(), "Done") != 0);
+
+	profiler.BeginFrame();
+	REQUIRE(profiler.BeginScope("Nested"));
+	profiler.EndScope();
+	profiler.EndScope();
+	profiler.EndFrame();
+
+	const ProfileFrame& frame = profiler.GetLastFrame();
+	CHECK(frame.frameNumber == 2);
+	REQUIRE(frame.events.size() == 2);
+	const ProfileEvent* longScope = FindEvent(frame, "Long");
+	const ProfileEvent* nested = FindEvent(frame, "Nested");
+	REQUIRE(longScope && nested);
+	CHECK(nested->depth == 1);
+	CHECK(longScope->end >= nested->end);
+}
+
+TEST_CASE(ScopesPastTheLimitAreDroppedButStillPair)
+{
+	CpuProfiler profiler(2);
+	profiler.BeginFrame();
+	REQUIRE(profiler.BeginScope("A"));
+	REQUIRE(profiler.BeginScope("B"));
+	REQUIRE(profiler.BeginScope("Dropped"));
+	REQUIRE(profiler.BeginScope("AlsoDropped"));
+	profiler.EndScope();
+	profiler.EndScope();
+
+	// These must close B and A, not the dropped scopes' slots
+	profiler.EndScope();
+	profiler.EndScope();
+	profiler.EndFrame();
+
+	const ProfileFrame& frame = profiler.GetLastFrame();
+	CHECK(profiler.GetDroppedEventCount() == 2);
+	REQUIRE(frame.events.size() == 2);
+	CHECK(FindEvent(frame, "A") != 0);
+	CHECK(FindEvent(frame, "B") != 0);
+	CHECK(FindEvent(frame, "Dropped") == 0);
+
+	// The buffer is free again once the frame has been collected
+	profiler.BeginFrame();
+	REQUIRE(profiler.BeginScope("C"));
+	profiler.EndScope();
+	profiler.EndFrame();
+	CHECK(profiler.GetLastFrame().events.size() == 1);
+	CHECK(profiler.GetDroppedEventCount() == 2);
+}
+
+TEST_CASE(DisabledProfilerRecordsNothing)
+{
+	CpuProfiler profiler;
+	profiler.SetEnabled(false);
+	CHECK(!profiler.IsEnabled());
+	profiler.BeginFrame();
+	CHECK(!profiler.BeginScope("Ignored"));
+	{
+		ProfileScope scope(profiler, "AlsoIgnored");
+	}
+	profiler.EndFrame();
+	CHECK(profiler.GetLastFrame().events.empty());
+}
+
+TEST_CASE(EachThreadGetsItsOwnIndexAndName)
+{
+	CpuProfiler profiler;
+	profiler.SetThreadName("Main");
+	profiler.BeginFrame();
+	{
+		ProfileScope scope(profiler, "MainWork");
+	}
+	std::thread worker([&]()
+		{
+			profiler.SetThreadName("Worker");
+			ProfileScope scope(profiler, "WorkerWork");
+		});
+	worker.join();
+	profiler.EndFrame();
+
+	const ProfileFrame& frame = profiler.GetLastFrame();
+	REQUIRE(frame.events.size() == 2);
+	CHECK(frame.events[0].threadIndex == 0);
+	CHECK(strcmp(frame.events[0].name, "MainWork") == 0);
+	CHECK(frame.events[1].threadIndex == 1);
+	CHECK(frame.events[1].depth == 0);
+
+	std::vector<std::string> names = profiler.GetThreadNames();
+	REQUIRE(names.size() == 2);
+	CHECK(names[0] == "Main");
+	CHECK(names[1] == "Worker");
+}
+
+TEST_CASE(ProfilersDontShareThreadBuffers)
+{
+	CpuProfiler first;
+	CpuProfiler second;
+	first.BeginFrame();
+	second.BeginFrame();
+	{
+		ProfileScope a(first, "First");
+		ProfileScope b(second, "Second");
+	}
+	first.EndFrame();
+	second.EndFrame();
+	REQUIRE(first.GetLastFrame().events.size() == 1);
+	REQUIRE(second.GetLastFrame().events.size() == 1);
+	CHECK(strcmp(first.GetLastFrame().events[0].name, "First") == 0);
+	CHECK(strcmp(second.GetLastFrame().events[0].name, "Second") == 0);
+}
+
+TEST_CASE(FramesCloseWhileOtherThreadsRecord)
+{
+	// Every scope ends up in exactly one frame
+	CpuProfiler profiler;
+	std::atomic<bool> done(false);
+	const int ScopesPerThread = 20000;
+	std::vector<std::thread> recorders;
+	for (int t = 0; t < 3; t++)
+	{
+		recorders.emplace_back([&]()
+			{
+				for (int i = 0; i < ScopesPerThread; i++)
+				{
+					ProfileScope outer(profiler, "Outer");
+					ProfileScope inner(profiler, "Inner");
+				}
+			});
+	}
+
+	size_t collected = 0;
+	std::thread collector([&]()
+		{
+			while (!done.load())
+			{
+				profiler.BeginFrame();
+				profiler.EndFrame();
+				collected += profiler.GetLastFrame().events.size();
+			}
+		});
+	for (std::thread& recorder : recorders)
+		recorder.join();
+	done = true;
+	collector.join();
+	profiler.EndFrame();
+	collected += profiler.GetLastFrame().events.size();
+
+	CHECK(collected + profiler.GetDroppedEventCount() == 3 * ScopesPerThread * 2);
+}
@@ -0,0 +1,114 @@
+#include "ProfilerView.h"
+#include "ImGui/imgui.h"
+
+namespace
+{
+	const float LaneHeight = 18.0f;
+	const float LabelWidth = 80.0f;
+
+	// A stable color per scope name, so a scope is easy to follow between frames
+	ImU32 ScopeColor(const char* name)
+	{
+		unsigned int hash = 2166136261u;
+		for (const char* c = name; *c; c++)
+		{
+			hash = (hash ^ (unsigned char)*c) * 16777619u;
+		}
+		return IM_COL32(80 + (hash & 0x7F), 80 + ((hash >> 8) & 0x7F), 80 + ((hash >> 16) & 0x7F), 255);
+	}
+
+	// Draws one bar, clipped to the frame, with its name if it fits
+	void DrawBar(ImDrawList* drawList, ImVec2 origin, float width, float frameMilliseconds,
+		float startMilliseconds, float durationMilliseconds, unsigned int depth, const char* name)
+	{
+		float scale = width / frameMilliseconds;
+		float x0 = origin.x + (startMilliseconds < 0.0f ? 0.0f : startMilliseconds) * scale;
+		float x1 = origin.x + (startMilliseconds + durationMilliseconds) * scale;
+		if (x1 > origin.x + width) x1 = origin.x + width;
+		if (x1 - x0 < 1.0f) x1 = x0 + 1.0f;
+
+		ImVec2 min(x0, origin.y + depth * LaneHeight);
+		ImVec2 max(x1, min.y + LaneHeight - 1.0f);
+		drawList->AddRectFilled(min, max, ScopeColor(name));
+		if (ImGui::CalcTextSize(name).x < max.x - min.x - 4.0f)
+			drawList->AddText(ImVec2(min.x + 2.0f, min.y + 2.0f), IM_COL32(0, 0, 0, 255), name);
+
+		if (ImGui::IsMouseHoveringRect(min, max))
+			ImGui::SetTooltip("%s\n%.3f ms (starts at %.3f ms)", name, durationMilliseconds, startMilliseconds);
+	}
+}
+
+void ProfilerView::DrawTimeline(const ProfileFrame& frame, const std::vector<std::string>& threadNames, const GpuProfiler* gpuProfiler)
+{
+	float frameMilliseconds = (frame.end - frame.start) / 1000000.0f;
+	ImGui::Text("CPU Frame %llu: %.3f ms", frame.frameNumber, frameMilliseconds);
+	if (frameMilliseconds <= 0.0f)
+		return;
+
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+	float width = ImGui::GetContentRegionAvail().x - LabelWidth;
+	if (width < 50.0f) width = 50.0f;
+
+	// Events are sorted by thread, so each thread's lane is one run
+	size_t first = 0;
+	while (first < frame.events.size())
+	{
+		unsigned int thread = frame.events[first].threadIndex;
+		size_t last = first;
+		unsigned int maxDepth = 0;
+		while (last < frame.events.size() && frame.events[last].threadIndex == thread)
+		{
+			if (frame.events[last].depth > maxDepth) maxDepth = frame.events[last].depth;
+			last++;
+		}
+
+		ImVec2 cursor = ImGui::GetCursorScreenPos();
+		const char* label = thread < threadNames.size() ? threadNames[thread].c_str() : "Thread";
+		drawList->AddText(cursor, IM_COL32(255, 255, 255, 255), label);
+
+		ImVec2 origin(cursor.x + LabelWidth, cursor.y);
+		for (size_t i = first; i < last; i++)
+		{
+			const ProfileEvent& event = frame.events[i];
+			DrawBar(drawList, origin, width, frameMilliseconds,
+				(event.start - frame.start) / 1000000.0f, (event.end - event.start) / 1000000.0f, event.depth, event.name);
+		}
+		ImGui::Dummy(ImVec2(LabelWidth + width, (maxDepth + 1) * LaneHeight + 4.0f));
+		first = last;
+	}
+
+	if (!gpuProfiler || !gpuProfiler->IsAvailable())
+		return;
+
+	// The GPU frame is a few frames older, but shares the CPU frame's scale
+	const std::vector<GpuScopeResult>& results = gpuProfiler->GetLastResults();
+	ImGui::Text("GPU Frame: %.3f ms (%llu frames skipped, %llu scopes dropped)",
+		gpuProfiler->GetLastFrameMilliseconds(), gpuProfiler->GetSkippedFrameCount(), gpuProfiler->GetDroppedScopeCount());
+	ImVec2 cursor = ImGui::GetCursorScreenPos();
+	drawList->AddText(cursor, IM_COL32(255, 255, 255, 255), "GPU");
+	unsigned int maxDepth = 0;
+	for (const GpuScopeResult& result : results)
+	{
+		DrawBar(drawList, ImVec2(cursor.x + LabelWidth, cursor.y), width, frameMilliseconds,
+			result.startMilliseconds, result.durationMilliseconds, result.depth, result.name);
+		if (result.depth > maxDepth) maxDepth = result.depth;
+	}
+	ImGui::Dummy(ImVec2(LabelWidth + width, (maxDepth + 1) * LaneHeight + 4.0f));
+}
+
+void ProfilerView::DrawPipelineStatistics(const GpuProfiler& gpuProfiler)
+{
+	if (!gpuProfiler.IsAvailable())
+	{
+		ImGui::Text("GPU queries unavailable");
+		return;
+	}
+
+	const D3D11_QUERY_DATA_PIPELINE_STATISTICS& statistics = gpuProfiler.GetLastPipelineStatistics();
+	ImGui::Text("Input Vertices: %llu", statistics.IAVertices);
+	ImGui::Text("Input Primitives: %llu", statistics.IAPrimitives);
+	ImGui::Text("Vertex Shader Invocations: %llu", statistics.VSInvocations);
+	ImGui::Text("Rasterized Primitives: %llu", statistics.CInvocations);
+	ImGui::Text("Rendered Primitives: %llu", statistics.CPrimitives);
+	ImGui::Text("Pixel Shader Invocations: %llu", statistics.PSInvocations);
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Profiler.h"
+#include "GpuProfiler.h"
+
+// ImGui views of the profilers' last frame
+namespace ProfilerView
+{
+	// One lane per thread with scopes stacked by depth, then the GPU
+	// scopes on their own lane - hover a bar for its timing
+	void DrawTimeline(const ProfileFrame& frame, const std::vector<std::string>& threadNames, const GpuProfiler* gpuProfiler);
+
+	void DrawPipelineStatistics(const GpuProfiler& gpuProfiler);
+}
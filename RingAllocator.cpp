@@ -0,0 +1,118 @@
+#include "RingAllocator.h"
+
+RingAllocator::RingAllocator(unsigned int capacity, unsigned int alignment) :
+	alignment(alignment),
+	head(0),
+	tail(0),
+	usedBytes(0),
+	frameBytes(0),
+	currentFrame(0),
+	frameOpen(false)
+{
+	// Capacity must hold a whole number of aligned blocks
+	this->capacity = capacity / alignment * alignment;
+}
+
+void RingAllocator::BeginFrame(unsigned long long frameIndex)
+{
+	currentFrame = frameIndex;
+	frameBytes = 0;
+	frameOpen = true;
+}
+
+// --------------------------------------------------------
+// Returns the offset of a new block of at least 'size' bytes,
+// or InvalidOffset if the ring is too full to fit it
+// --------------------------------------------------------
+unsigned int RingAllocator::Allocate(unsigned int size)
+{
+	unsigned int alignedSize = AlignSize(size);
+	if (!frameOpen || alignedSize == 0 || alignedSize > capacity)
+		return InvalidOffset;
+
+	// Nothing in flight, so start over from the beginning
+	if (usedBytes == 0)
+	{
+		head = 0;
+		tail = 0;
+	}
+
+	unsigned int offset = InvalidOffset;
+	if (head >= tail && !(usedBytes > 0 && head == tail))
+	{
+		// Free space is [head, capacity) and [0, tail)
+		if (head + alignedSize <= capacity)
+		{
+			offset = head;
+		}
+		else if (alignedSize <= tail)
+		{
+			// Wrap around, wasting the end of the buffer
+			unsigned int padding = capacity - head;
+			usedBytes += padding;
+			frameBytes += padding;
+			offset = 0;
+		}
+	}
+	else if (head + alignedSize <= tail)
+	{
+		// Already wrapped, free space is [head, tail)
+		offset = head;
+	}
+
+	if (offset == InvalidOffset)
+		return InvalidOffset;
+
+	head = offset + alignedSize;
+	if (head == capacity) head = 0;
+	usedBytes += alignedSize;
+	frameBytes += alignedSize;
+	return offset;
+}
+
+void RingAllocator::EndFrame()
+{
+	if (!frameOpen)
+		return;
+
+	FrameMarker marker = {};
+	marker.frameIndex = currentFrame;
+	marker.endOffset = head;
+	marker.size = frameBytes;
+	inFlightFrames.push_back(marker);
+	frameOpen = false;
+}
+
+// --------------------------------------------------------
+// Reclaims the space of every frame the GPU has finished with
+// --------------------------------------------------------
+void RingAllocator::ReleaseFramesUpTo(unsigned long long completedFrameIndex)
+{
+	while (!inFlightFrames.empty() && inFlightFrames.front().frameIndex <= completedFrameIndex)
+	{
+		FrameMarker& marker = inFlightFrames.front();
+		tail = marker.endOffset;
+		usedBytes -= marker.size;
+		inFlightFrames.pop_front();
+	}
+}
+
+void RingAllocator::Reset()
+{
+	head = 0;
+	tail = 0;
+	usedBytes = 0;
+	frameBytes = 0;
+	inFlightFrames.clear();
+}
+
+unsigned int RingAllocator::GetCapacity() { return capacity; }
+unsigned int RingAllocator::GetAlignment() { return alignment; }
+unsigned int RingAllocator::GetUsedBytes() { return usedBytes; }
+unsigned int RingAllocator::GetFrameBytes() { return frameBytes; }
+unsigned int RingAllocator::GetFramesInFlight() { return (unsigned int)inFlightFrames.size(); }
+
+unsigned int RingAllocator::AlignSize(unsigned int size)
+{
+	return (size + alignment - 1) / alignment * alignment;
+}
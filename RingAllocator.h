@@ -0,0 +1,52 @@
+#pragma once
+#include <deque>
+
+// --------------------------------------------------------
+// CPU-side suballocator for a circular GPU buffer
+//
+// - Hands out aligned offsets into a buffer of fixed capacity
+// - Allocations made between BeginFrame() and EndFrame() are
+//    tagged with that frame's index
+// - Space is only reclaimed once ReleaseFramesUpTo() says the
+//    GPU has finished with a frame (the "fence")
+// - Contains no graphics API code so it can be tested anywhere
+// --------------------------------------------------------
+class RingAllocator
+{
+public:
+	static constexpr unsigned int InvalidOffset = 0xFFFFFFFF;
+
+	RingAllocator(unsigned int capacity, unsigned int alignment);
+
+	void BeginFrame(unsigned long long frameIndex);
+	unsigned int Allocate(unsigned int size);
+	void EndFrame();
+	void ReleaseFramesUpTo(unsigned long long completedFrameIndex);
+	void Reset();
+
+	unsigned int GetCapacity();
+	unsigned int GetAlignment();
+	unsigned int GetUsedBytes();
+	unsigned int GetFrameBytes();
+	unsigned int GetFramesInFlight();
+	unsigned int AlignSize(unsigned int size);
+
+private:
+	struct FrameMarker
+	{
+		unsigned long long frameIndex;
+		unsigned int endOffset;		// Head position when the frame ended
+		unsigned int size;			// Bytes consumed by the frame, including wrap padding
+	};
+
+	unsigned int capacity;
+	unsigned int alignment;
+	unsigned int head;				// Next free byte
+	unsigned int tail;				// Oldest byte still in use by the GPU
+	unsigned int usedBytes;
+	unsigned int frameBytes;
+	unsigned long long currentFrame;
+	bool frameOpen;
+
+	std::deque<FrameMarker> inFlightFrames;
+};
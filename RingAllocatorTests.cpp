@@ -0,0 +1,187 @@
+#include "RingAllocator.h"
+#include "TestHarness.h"
+
+TEST_CASE(AllocationsAreAligned)
+{
+	RingAllocator ring(4096, 256);
+	ring.BeginFrame(1);
+	CHECK(ring.Allocate(1) == 0);
+	CHECK(ring.Allocate(10) == 256);
+	CHECK(ring.Allocate(256) == 512);
+	CHECK(ring.Allocate(257) == 768);
+	CHECK(ring.GetFrameBytes() == 256 * 5);
+	CHECK(ring.AlignSize(0) == 0);
+	CHECK(ring.AlignSize(300) == 512);
+	ring.EndFrame();
+}
+
+TEST_CASE(CapacityRoundsDownToAlignment)
+{
+	RingAllocator ring(1000, 256);
+	CHECK(ring.GetCapacity() == 768);
+}
+
+TEST_CASE(RejectsImpossibleAllocations)
+{
+	RingAllocator ring(1024, 256);
+	CHECK(ring.Allocate(16) == RingAllocator::InvalidOffset);	// No frame open
+
+	ring.BeginFrame(1);
+	CHECK(ring.Allocate(0) == RingAllocator::InvalidOffset);
+	CHECK(ring.Allocate(1025) == RingAllocator::InvalidOffset);
+	CHECK(ring.Allocate(1024) == 0);
+	CHECK(ring.Allocate(1) == RingAllocator::InvalidOffset);
+	ring.EndFrame();
+}
+
+TEST_CASE(FullRingWaitsForTheFence)
+{
+	RingAllocator ring(1024, 256);
+	ring.BeginFrame(1);
+	CHECK(ring.Allocate(512) == 0);
+	ring.EndFrame();
+	ring.BeginFrame(2);
+	CHECK(ring.Allocate(512) == 512);
+	CHECK(ring.Allocate(1) == RingAllocator::InvalidOffset);
+	ring.EndFrame();
+	CHECK(ring.GetFramesInFlight() == 2);
+
+	// Nothing is reused until the GPU says frame 1 is done
+	ring.BeginFrame(3);
+	CHECK(ring.Allocate(256) == RingAllocator::InvalidOffset);
+	ring.ReleaseFramesUpTo(1);
+	CHECK(ring.GetFramesInFlight() == 1);
+	CHECK(ring.GetUsedBytes() == 512);
+	CHECK(ring.Allocate(512) == 0);
+	CHECK(ring.Allocate(1) == RingAllocator::InvalidOffset);
+	ring.EndFrame();
+}
+
+TEST_CASE(WrapsPastTheEndWithPadding)
+{
+	RingAllocator ring(1024, 256);
+	ring.BeginFrame(1);
+	CHECK(ring.Allocate(512) == 0);
+	ring.EndFrame();
+	ring.BeginFrame(2);
+	CHECK(ring.Allocate(256) == 512);
+	ring.EndFrame();
+	ring.ReleaseFramesUpTo(1);
+
+	// 256 bytes left at the end, so a 512 byte block wraps to the front
+	// and the skipped tail is charged to this frame
+	ring.BeginFrame(3);
+	CHECK(ring.Allocate(512) == 0);
+	CHECK(ring.GetFrameBytes() == 768);
+	CHECK(ring.GetUsedBytes() == 1024);
+	CHECK(ring.Allocate(1) == RingAllocator::InvalidOffset);
+	ring.EndFrame();
+
+	// Releasing the frame also releases its padding
+	ring.ReleaseFramesUpTo(2);
+	CHECK(ring.GetUsedBytes() == 768);
+	ring.ReleaseFramesUpTo(3);
+	CHECK(ring.GetUsedBytes() == 0);
+}
+
+TEST_CASE(AfterWrappingOnlyTheGapIsFree)
+{
+	RingAllocator ring(1024, 256);
+	ring.BeginFrame(1);
+	CHECK(ring.Allocate(768) == 0);
+	ring.EndFrame();
+	ring.BeginFrame(2);
+	CHECK(ring.Allocate(256) == 768);
+	ring.EndFrame();
+	ring.ReleaseFramesUpTo(1);
+
+	// Head wrapped to 0, tail is at 768: [0, 768) is free, nothing past it
+	ring.BeginFrame(3);
+	CHECK(ring.Allocate(512) == 0);
+	CHECK(ring.Allocate(256) == 512);
+	CHECK(ring.Allocate(256) == RingAllocator::InvalidOffset);
+	ring.EndFrame();
+}
+
+TEST_CASE(ReleasesFramesInOrderUpToTheFence)
+{
+	RingAllocator ring(4096, 256);
+	for (unsigned long long frame = 1; frame <= 4; frame++)
+	{
+		ring.BeginFrame(frame);
+		ring.Allocate(256);
+		ring.EndFrame();
+	}
+	ring.ReleaseFramesUpTo(2);
+	CHECK(ring.GetFramesInFlight() == 2);
+	CHECK(ring.GetUsedBytes() == 512);
+
+	// A fence older than everything in flight releases nothing
+	ring.ReleaseFramesUpTo(1);
+	CHECK(ring.GetFramesInFlight() == 2);
+
+	ring.ReleaseFramesUpTo(4);
+	CHECK(ring.GetFramesInFlight() == 0);
+	CHECK(ring.GetUsedBytes() == 0);
+
+	// Empty again, so allocation restarts at the front
+	ring.BeginFrame(5);
+	CHECK(ring.Allocate(256) == 0);
+	ring.EndFrame();
+}
+
+TEST_CASE(SteadyStateNeverOverlapsInFlightFrames)
+{
+	// Three frames in flight, odd sizes, many laps of the ring
+	RingAllocator ring(64 * 256, 256);
+	struct Block { unsigned long long frame; unsigned int offset; unsigned int size; };
+	std::vector<Block> live;
+	unsigned int seed = 12345;
+	for (unsigned long long frame = 1; frame <= 500; frame++)
+	{
+		ring.BeginFrame(frame);
+		unsigned int count = 1 + frame % 7;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			seed = seed * 1103515245 + 12345;
+			unsigned int size = 1 + (seed >> 16) % 1000;
+			unsigned int offset = ring.Allocate(size);
+			REQUIRE(offset != RingAllocator::InvalidOffset);
+			REQUIRE(offset % 256 == 0);
+			REQUIRE(offset + ring.AlignSize(size) <= ring.GetCapacity());
+			for (const Block& block : live)
+			{
+				bool apart = offset + ring.AlignSize(size) <= block.offset || block.offset + block.size <= offset;
+				REQUIRE(apart);
+			}
+			live.push_back({ frame, offset, ring.AlignSize(size) });
+		}
+		ring.EndFrame();
+
+		if (frame >= 3)
+		{
+			ring.ReleaseFramesUpTo(frame - 2);
+			std::vector<Block> stillLive;
+			for (const Block& block : live)
+			{
+				if (block.frame > frame - 2)
+					stillLive.push_back(block);
+			}
+			live = stillLive;
+		}
+	}
+}
+
+TEST_CASE(ResetForgetsEverything)
+{
+	RingAllocator ring(1024, 256);
+	ring.BeginFrame(1);
+	ring.Allocate(1024);
+	ring.EndFrame();
+	ring.Reset();
+	CHECK(ring.GetUsedBytes() == 0);
+	CHECK(ring.GetFramesInFlight() == 0);
+	ring.BeginFrame(2);
+	CHECK(ring.Allocate(1024) == 0);
+	ring.EndFrame();
+}
@@ -0,0 +1,1161 @@
+#include <DirectXMath.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "EntityRegistry.h"
+#include "Vertex.h"
+#include "Bounds.h"
+#include "BufferStructs.h"
+#include "MatrixMath.h"
+#include "BoundingVolumeHierarchy.h"
+#include "LooseOctree.h"
+#include "OcclusionCuller.h"
+#include "ConstantBufferLayout.h"
+#include "MaterialParameters.h"
+#include "MaterialTable.h"
+#include "LightClusterGrid.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "TriangleBVH.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Headless benchmark of the per-frame CPU scene work
+//
+// Builds synthetic scenes out of the same pieces Game uses
+// (Transform, EntityRegistry, mesh bounds from CPU vertex data,
+// material handles, the spatial partitions) and times each
+// stage of a frame separately, with no window or device.  The
+// default sizes go up to 100k entities.  Frustum culling is also
+// timed as a linear scan over every entity's box, and world-view-
+// projection composition the old way (two multiplies per entity),
+// for comparison.  Occlusion culling is timed as two phases:
+// rasterizing the biggest visible entities (items are triangles)
+// and testing every visible entity against them.
+//
+// Entity storage is also timed on its own at each size: insertion,
+// iteration over the dense arrays and deletion in random order
+//
+// Simulate's parallel work on the largest scene is then timed on
+// the job system with 1 up to --threads threads (all of them by
+// default), to show how it scales with cores
+//
+// A second, smaller scene times material instances: resolving
+// thousands of instances against their parents' parameters,
+// packing them into a material table and batching their draws
+// by parent
+//
+// A third assigns moving point and spot lights to the clusters
+// of a camera's frustum, as Game does for LitPS each frame
+//
+// Finally, picking rays are cast at a dense mesh, against every
+// triangle and through its TriangleBVH, to give rays per second,
+// and the CPU profiler's own cost is measured per scope
+//
+// Usage: SceneBenchmark [--sizes 1000,10000] [--frames 120]
+//                       [--instances 10000] [--lights 1000]
+//                       [--rays 10000] [--threads 8]
+//                       [--format json|csv] [--output file]
+// --------------------------------------------------------
+
+namespace
+{
+	const unsigned int MaterialCount = 8;
+	const float WorldExtent = 200.0f;
+	const size_t WarmupFrames = 10;
+
+	// The first of BuildScene's meshes; the rest are boxes
+	const MeshHandle SphereMesh = 0;
+
+	// Game's occluder budget
+	const size_t MaxOccluders = 16;
+	const float MinOccluderScreenArea = 0.01f;
+
+	// Matches the ring's minimum constant buffer alignment
+	const size_t ConstantAlignment = 256;
+
+	struct Options
+	{
+		std::vector<size_t> sizes = { 1000, 10000, 100000 };
+		size_t frames = 120;
+		size_t instances = 10000;
+		size_t lights = 1000;
+		size_t rays = 10000;
+		size_t maxThreads = std::thread::hardware_concurrency();
+		bool csv = false;
+		const char* outputPath = 0;
+	};
+
+	struct PhaseResult
+	{
+		const char* phase;
+		size_t entities;
+		size_t threads;
+		size_t itemsPerFrame;	// Average work items, e.g. visible entities for packing
+		size_t stateChanges;	// Pipeline state changes per frame, for batching phases
+		double medianMilliseconds;
+		double p95Milliseconds;
+		double minMilliseconds;
+	};
+
+	// Per-frame timings for one phase
+	struct PhaseTimer
+	{
+		const char* phase;
+		std::vector<double> milliseconds;
+		size_t totalItems = 0;
+		size_t stateChanges = 0;
+	};
+
+	double NowMilliseconds()
+	{
+		return std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// --------------------------------------------------------
+	// Stand-ins for loaded meshes - only their vertex positions
+	// matter, since the CPU side just needs local bounds
+	// --------------------------------------------------------
+	std::vector<Vertex> MakeSphereVertices(float radius, int slices, int stacks)
+	{
+		std::vector<Vertex> vertices;
+		for (int stack = 0; stack <= stacks; stack++)
+		{
+			float phi = XM_PI * stack / stacks;
+			for (int slice = 0; slice <= slices; slice++)
+			{
+				float theta = XM_2PI * slice / slices;
+				Vertex vertex = {};
+				vertex.normal = XMFLOAT3(sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta));
+				vertex.Position = XMFLOAT3(vertex.normal.x * radius, vertex.normal.y * radius, vertex.normal.z * radius);
+				vertex.uv = XMFLOAT2((float)slice / slices, (float)stack / stacks);
+				vertices.push_back(vertex);
+			}
+		}
+		return vertices;
+	}
+
+	// Two triangles per quad of MakeSphereVertices' grid
+	std::vector<unsigned int> MakeSphereIndices(int slices, int stacks)
+	{
+		std::vector<unsigned int> indices;
+		for (int stack = 0; stack < stacks; stack++)
+		{
+			for (int slice = 0; slice < slices; slice++)
+			{
+				unsigned int corner = stack * (slices + 1) + slice;
+				unsigned int below = corner + slices + 1;
+				indices.insert(indices.end(), { corner, below, corner + 1, corner + 1, below, below + 1 });
+			}
+		}
+		return indices;
+	}
+
+	std::vector<Vertex> MakeBoxVertices(float width, float height, float depth)
+	{
+		std::vector<Vertex> vertices;
+		for (int corner = 0; corner < 8; corner++)
+		{
+			Vertex vertex = {};
+			vertex.Position = XMFLOAT3(
+				(corner & 1 ? 0.5f : -0.5f) * width,
+				(corner & 2 ? 0.5f : -0.5f) * height,
+				(corner & 4 ? 0.5f : -0.5f) * depth);
+			vertices.push_back(vertex);
+		}
+		return vertices;
+	}
+
+	AABB CalculateBounds(const std::vector<Vertex>& vertices)
+	{
+		AABB bounds = Bounds::Empty();
+		for (const Vertex& vertex : vertices)
+		{
+			AABB point = { vertex.Position, vertex.Position };
+			bounds = Bounds::Union(bounds, point);
+		}
+		return bounds;
+	}
+
+	// Everything one scene size needs, reused across frames
+	struct Scene
+	{
+		EntityRegistry entities;
+		std::vector<AABB> meshBounds;
+		std::vector<XMFLOAT3> spin;
+
+		std::vector<XMFLOAT4X4> worldMatrices;
+		std::vector<XMFLOAT4X4> wvpMatrices;
+		std::vector<AABB> worldBounds;
+		std::vector<int> bvhProxies;
+		std::vector<int> octreeProxies;
+		std::vector<unsigned int> visible;
+		std::vector<unsigned long long> drawKeys;
+		std::vector<unsigned char> constantData;
+		std::vector<PerInstanceData> instanceData;
+
+		std::unique_ptr<BoundingVolumeHierarchy> bvh;
+		std::unique_ptr<LooseOctree> octree;
+		OcclusionCuller occlusionCuller;
+		std::vector<std::pair<float, unsigned int>> occluders;
+		size_t occludedCount = 0;
+
+		XMFLOAT4X4 view;
+		XMFLOAT4X4 projection;
+		XMFLOAT4X4 viewProjection;
+		Frustum frustum;
+	};
+
+	void BuildScene(Scene& scene, size_t entityCount)
+	{
+		// Same seed every run, so results are comparable
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> position(-WorldExtent, WorldExtent);
+		std::uniform_real_distribution<float> angle(-XM_PI, XM_PI);
+		std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+		std::uniform_real_distribution<float> speed(-1.0f, 1.0f);
+
+		scene.meshBounds.push_back(CalculateBounds(MakeSphereVertices(0.5f, 32, 16)));
+		scene.meshBounds.push_back(CalculateBounds(MakeBoxVertices(1.0f, 1.0f, 1.0f)));
+		scene.meshBounds.push_back(CalculateBounds(MakeBoxVertices(1.0f, 2.0f, 1.0f)));
+		scene.meshBounds.push_back(CalculateBounds(MakeBoxVertices(3.0f, 0.1f, 3.0f)));
+
+		scene.entities.Reserve(entityCount);
+		for (size_t i = 0; i < entityCount; i++)
+		{
+			MeshHandle mesh = (MeshHandle)(random() % scene.meshBounds.size());
+			MaterialHandle material = (MaterialHandle)(random() % MaterialCount);
+			Entity entity = scene.entities.Create(mesh, material, "Entity");
+
+			Transform* transform = scene.entities.GetTransform(entity);
+			transform->SetPosition(position(random), position(random) * 0.25f, position(random));
+			transform->SetRotation(angle(random), angle(random), angle(random));
+			float uniformScale = scale(random);
+			transform->SetScale(uniformScale, uniformScale, uniformScale);
+			scene.spin.push_back(XMFLOAT3(speed(random), speed(random), 0.0f));
+		}
+
+		scene.worldMatrices.resize(entityCount);
+		scene.wvpMatrices.resize(entityCount);
+		scene.worldBounds.resize(entityCount);
+		scene.drawKeys.reserve(entityCount);
+		scene.visible.reserve(entityCount);
+		scene.constantData.resize(entityCount * ConstantAlignment);
+		scene.instanceData.resize(entityCount);
+
+		// A wide camera in the middle of the scene looking down +Z
+		XMMATRIX view = XMMatrixLookToLH(XMVectorSet(0, 5, -WorldExtent * 0.5f, 0), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0));
+		XMMATRIX projection = XMMatrixPerspectiveFovLH(XMConvertToRadians(60.0f), 16.0f / 9.0f, 0.1f, WorldExtent * 2.0f);
+		XMStoreFloat4x4(&scene.view, view);
+		XMStoreFloat4x4(&scene.projection, projection);
+		XMStoreFloat4x4(&scene.viewProjection, XMMatrixMultiply(view, projection));
+		scene.frustum = Bounds::FrustumFromMatrix(scene.viewProjection);
+
+		// Partitions start from the initial bounds, like Game's
+		std::vector<Transform>& transforms = scene.entities.GetTransforms();
+		std::vector<MeshHandle>& meshes = scene.entities.GetMeshes();
+		scene.bvh = std::make_unique<BoundingVolumeHierarchy>();
+		scene.octree = std::make_unique<LooseOctree>(AABB{ XMFLOAT3(-WorldExtent, -WorldExtent, -WorldExtent), XMFLOAT3(WorldExtent, WorldExtent, WorldExtent) });
+		for (size_t i = 0; i < entityCount; i++)
+		{
+			AABB bounds = Bounds::Transform(scene.meshBounds[meshes[i]], transforms[i].GetWorldMatrix());
+			scene.bvhProxies.push_back(scene.bvh->Insert(bounds, (unsigned int)i));
+			scene.octreeProxies.push_back(scene.octree->Insert(bounds, (unsigned int)i));
+		}
+		scene.bvh->Optimize();
+	}
+
+	// --------------------------------------------------------
+	// The frame stages, kept in the same order as Game::Simulate
+	// and Game::Draw; each returns how many items it processed
+	// --------------------------------------------------------
+	size_t UpdateTransforms(Scene& scene, float deltaTime)
+	{
+		std::vector<Transform>& transforms = scene.entities.GetTransforms();
+		std::vector<MeshHandle>& meshes = scene.entities.GetMeshes();
+		for (size_t i = 0; i < transforms.size(); i++)
+		{
+			transforms[i].Rotate(scene.spin[i].x * deltaTime, scene.spin[i].y * deltaTime, 0.0f);
+			transforms[i].MoveAbsolute(0.0f, scene.spin[i].x * deltaTime, 0.0f);
+			scene.worldMatrices[i] = transforms[i].GetWorldMatrix();
+			scene.worldBounds[i] = Bounds::Transform(scene.meshBounds[meshes[i]], scene.worldMatrices[i]);
+		}
+		return transforms.size();
+	}
+
+	size_t UpdatePartition(SpatialPartition& partition, const std::vector<int>& proxies, const std::vector<AABB>& bounds)
+	{
+		bool changed = false;
+		for (size_t i = 0; i < proxies.size(); i++)
+		{
+			changed |= partition.Update(proxies[i], bounds[i]);
+		}
+		if (changed)
+			partition.Optimize();
+		return proxies.size();
+	}
+
+	size_t CullFrustum(Scene& scene, const SpatialPartition& partition)
+	{
+		scene.visible.clear();
+		partition.QueryFrustum(scene.frustum, scene.visible);
+		return scene.visible.size();
+	}
+
+	// What the partitions save: every entity's box against the frustum
+	size_t CullFrustumBruteForce(Scene& scene)
+	{
+		scene.visible.clear();
+		for (size_t i = 0; i < scene.worldBounds.size(); i++)
+		{
+			if (Bounds::TestFrustum(scene.frustum, scene.worldBounds[i]) != FrustumTest::Outside)
+				scene.visible.push_back((unsigned int)i);
+		}
+		return scene.visible.size();
+	}
+
+	// --------------------------------------------------------
+	// Game's occlusion pass over the frustum culling results: the
+	// biggest visible entities rasterized, then every visible entity
+	// tested against them.  Only the box meshes can occlude, since
+	// their local bounds are their real shape - the sphere's would
+	// hide things the sphere doesn't.
+	// --------------------------------------------------------
+	size_t RasterizeOccluders(Scene& scene)
+	{
+		static const unsigned int BoxIndices[] =
+		{
+			0, 2, 3, 0, 3, 1,	4, 5, 7, 4, 7, 6,	0, 1, 5, 0, 5, 4,
+			2, 6, 7, 2, 7, 3,	0, 4, 6, 0, 6, 2,	1, 3, 7, 1, 7, 5,
+		};
+
+		OcclusionCuller& culler = scene.occlusionCuller;
+		std::vector<MeshHandle>& meshes = scene.entities.GetMeshes();
+		culler.BeginFrame(scene.viewProjection);
+		scene.occluders.clear();
+		for (unsigned int index : scene.visible)
+		{
+			if (meshes[index] == SphereMesh)
+				continue;
+
+			float area = culler.EstimateScreenArea(scene.worldBounds[index]);
+			if (area >= MinOccluderScreenArea)
+				scene.occluders.push_back(std::make_pair(area, index));
+		}
+		size_t count = std::min(scene.occluders.size(), MaxOccluders);
+		std::partial_sort(scene.occluders.begin(), scene.occluders.begin() + count, scene.occluders.end(),
+			[](const std::pair<float, unsigned int>& a, const std::pair<float, unsigned int>& b) { return a.first > b.first; });
+
+		for (size_t i = 0; i < count; i++)
+		{
+			unsigned int index = scene.occluders[i].second;
+			const AABB& box = scene.meshBounds[meshes[index]];
+			XMFLOAT3 corners[8];
+			for (int corner = 0; corner < 8; corner++)
+			{
+				corners[corner] = XMFLOAT3(
+					corner & 1 ? box.max.x : box.min.x,
+					corner & 2 ? box.max.y : box.min.y,
+					corner & 4 ? box.max.z : box.min.z);
+			}
+			culler.RasterizeOccluder(corners, sizeof(XMFLOAT3), BoxIndices, 36, scene.worldMatrices[index]);
+		}
+		culler.FinishOccluders();
+		return culler.GetRasterizedTriangleCount();
+	}
+
+	size_t TestOccludees(Scene& scene)
+	{
+		scene.occludedCount = 0;
+		for (unsigned int index : scene.visible)
+		{
+			if (!scene.occlusionCuller.IsVisible(scene.worldBounds[index]))
+				scene.occludedCount++;
+		}
+		return scene.visible.size();
+	}
+
+	// Material first, then mesh, so state changes are grouped
+	size_t SortDraws(Scene& scene)
+	{
+		std::vector<MeshHandle>& meshes = scene.entities.GetMeshes();
+		std::vector<MaterialHandle>& materials = scene.entities.GetMaterials();
+		scene.drawKeys.clear();
+		for (unsigned int index : scene.visible)
+		{
+			scene.drawKeys.push_back(
+				((unsigned long long)materials[index] << 48) |
+				((unsigned long long)(meshes[index] & 0xFFFF) << 32) |
+				index);
+		}
+		std::sort(scene.drawKeys.begin(), scene.drawKeys.end());
+		return scene.drawKeys.size();
+	}
+
+	// Every entity's world matrix times the camera's cached
+	// view-projection, as Simulate does each frame
+	size_t ComposeMatrices(Scene& scene)
+	{
+		MatrixMath::ComposeWorldViewProjection(scene.worldMatrices.data(), scene.wvpMatrices.data(), scene.worldMatrices.size(), scene.viewProjection);
+		return scene.worldMatrices.size();
+	}
+
+	// The same result the way it was done before view-projection was
+	// cached: world, then view, then projection, for every entity
+	size_t ComposeMatricesSeparately(Scene& scene)
+	{
+		XMMATRIX view = XMLoadFloat4x4(&scene.view);
+		XMMATRIX projection = XMLoadFloat4x4(&scene.projection);
+		for (size_t i = 0; i < scene.worldMatrices.size(); i++)
+		{
+			XMMATRIX world = XMLoadFloat4x4(&scene.worldMatrices[i]);
+			XMStoreFloat4x4(&scene.wvpMatrices[i], XMMatrixMultiply(XMMatrixMultiply(world, view), projection));
+		}
+		return scene.worldMatrices.size();
+	}
+
+	// What Draw writes each frame: each run of draws with the same
+	// material and mesh becomes one draw, its instances appended to
+	// the instance buffer and where they start put in the ring
+	size_t PackConstants(Scene& scene)
+	{
+		const std::vector<unsigned long long>& keys = scene.drawKeys;
+		size_t offset = 0;
+		size_t instanceCount = 0;
+		for (size_t first = 0, end = 0; first < keys.size(); first = end)
+		{
+			end = first + 1;
+			while (end < keys.size() && end - first < MaxInstancesPerDraw && keys[end] >> 32 == keys[first] >> 32)
+				end++;
+
+			PerDrawData drawData = {};
+			drawData.firstInstance = (unsigned int)instanceCount;
+			memcpy(&scene.constantData[offset], &drawData, sizeof(drawData));
+			offset += ConstantAlignment;
+
+			for (size_t d = first; d < end; d++)
+			{
+				unsigned int index = (unsigned int)(keys[d] & 0xFFFFFFFF);
+				PerInstanceData& instanceData = scene.instanceData[instanceCount++];
+				instanceData = {};
+				instanceData.world = scene.worldMatrices[index];
+				instanceData.worldViewProjection = scene.wvpMatrices[index];
+				instanceData.materialId = (unsigned int)(keys[d] >> 48);
+			}
+		}
+		return scene.drawKeys.size();
+	}
+
+	template<typename Stage>
+	void Time(PhaseTimer& timer, bool record, Stage stage)
+	{
+		double start = NowMilliseconds();
+		size_t items = stage();
+		double elapsed = NowMilliseconds() - start;
+		if (!record)
+			return;
+
+		timer.milliseconds.push_back(elapsed);
+		timer.totalItems += items;
+	}
+
+	PhaseResult Summarize(PhaseTimer& timer, size_t entityCount)
+	{
+		std::vector<double>& times = timer.milliseconds;
+		std::sort(times.begin(), times.end());
+
+		PhaseResult result = {};
+		result.phase = timer.phase;
+		result.entities = entityCount;
+		result.threads = 1;
+		if (times.empty())
+			return result;
+
+		result.itemsPerFrame = timer.totalItems / times.size();
+		result.medianMilliseconds = times[times.size() / 2];
+		result.p95Milliseconds = times[std::min(times.size() - 1, (times.size() * 95 + 99) / 100 - 1)];
+		result.minMilliseconds = times.front();
+		result.stateChanges = timer.stateChanges;
+		return result;
+	}
+
+	void RunScene(size_t entityCount, size_t frames, std::vector<PhaseResult>& results)
+	{
+		Scene scene;
+		BuildScene(scene, entityCount);
+
+		PhaseTimer timers[] =
+		{
+			{ "transform_update", {}, 0 },
+			{ "brute_force_frustum_cull", {}, 0 },
+			{ "bvh_update", {}, 0 },
+			{ "bvh_frustum_cull", {}, 0 },
+			{ "octree_update", {}, 0 },
+			{ "octree_frustum_cull", {}, 0 },
+			{ "occlusion_rasterize", {}, 0 },
+			{ "occlusion_test", {}, 0 },
+			{ "draw_sort", {}, 0 },
+			{ "wvp_compose_separate", {}, 0 },
+			{ "wvp_compose", {}, 0 },
+			{ "constant_packing", {}, 0 },
+		};
+
+		const float deltaTime = 1.0f / 60.0f;
+		for (size_t frame = 0; frame < WarmupFrames + frames; frame++)
+		{
+			bool record = frame >= WarmupFrames;
+			Time(timers[0], record, [&]() { return UpdateTransforms(scene, deltaTime); });
+			Time(timers[1], record, [&]() { return CullFrustumBruteForce(scene); });
+			Time(timers[2], record, [&]() { return UpdatePartition(*scene.bvh, scene.bvhProxies, scene.worldBounds); });
+			Time(timers[3], record, [&]() { return CullFrustum(scene, *scene.bvh); });
+			Time(timers[4], record, [&]() { return UpdatePartition(*scene.octree, scene.octreeProxies, scene.worldBounds); });
+			Time(timers[5], record, [&]() { return CullFrustum(scene, *scene.octree); });
+			Time(timers[6], record, [&]() { return RasterizeOccluders(scene); });
+			Time(timers[7], record, [&]() { return TestOccludees(scene); });
+			Time(timers[8], record, [&]() { return SortDraws(scene); });
+			Time(timers[9], record, [&]() { return ComposeMatricesSeparately(scene); });
+			Time(timers[10], record, [&]() { return ComposeMatrices(scene); });
+			Time(timers[11], record, [&]() { return PackConstants(scene); });
+		}
+		fprintf(stderr, "  %zu of %zu visible entities occluded in the last frame\n", scene.occludedCount, scene.visible.size());
+
+		for (PhaseTimer& timer : timers)
+		{
+			results.push_back(Summarize(timer, entityCount));
+		}
+	}
+
+	// --------------------------------------------------------
+	// Simulate's parallel half - world matrices, world bounds and
+	// world-view-projection for every entity - on the job system
+	// with 1 to maxThreads threads (the calling thread counts, as
+	// it helps out while it waits)
+	// --------------------------------------------------------
+	void RunJobScaling(size_t entityCount, size_t maxThreads, size_t frames, std::vector<PhaseResult>& results)
+	{
+		Scene scene;
+		BuildScene(scene, entityCount);
+		std::vector<Transform>& transforms = scene.entities.GetTransforms();
+		std::vector<MeshHandle>& meshes = scene.entities.GetMeshes();
+
+		for (size_t threads = 1; threads <= maxThreads; threads++)
+		{
+			JobSystem jobs((unsigned int)threads - 1);
+			PhaseTimer timer = { "job_simulate", {}, 0 };
+			const float deltaTime = 1.0f / 60.0f;
+			for (size_t frame = 0; frame < WarmupFrames + frames; frame++)
+			{
+				Time(timer, frame >= WarmupFrames, [&]()
+					{
+						jobs.ParallelFor(entityCount, 256, [&](size_t first, size_t last)
+							{
+								for (size_t i = first; i < last; i++)
+								{
+									transforms[i].Rotate(scene.spin[i].x * deltaTime, scene.spin[i].y * deltaTime, 0.0f);
+									scene.worldMatrices[i] = transforms[i].GetWorldMatrix();
+									scene.worldBounds[i] = Bounds::Transform(scene.meshBounds[meshes[i]], scene.worldMatrices[i]);
+								}
+								MatrixMath::ComposeWorldViewProjection(&scene.worldMatrices[first], &scene.wvpMatrices[first], last - first, scene.viewProjection);
+							});
+						return entityCount;
+					});
+			}
+
+			PhaseResult result = Summarize(timer, entityCount);
+			result.threads = threads;
+			results.push_back(result);
+			fprintf(stderr, "  %zu threads: %.3f ms (%llu steals)\n", threads, result.medianMilliseconds, jobs.GetStealCount());
+		}
+	}
+
+	// --------------------------------------------------------
+	// Entity storage on its own: filling a registry, walking its
+	// dense arrays and emptying it again in random order, which
+	// exercises the swap-with-last removal and slot reuse
+	// --------------------------------------------------------
+	void RunEntities(size_t entityCount, size_t frames, std::vector<PhaseResult>& results)
+	{
+		EntityRegistry registry;
+		registry.Reserve(entityCount);
+		std::vector<Entity> handles(entityCount);
+		std::vector<size_t> order(entityCount);
+		for (size_t i = 0; i < entityCount; i++)
+		{
+			order[i] = i;
+		}
+		std::mt19937 random(1234);
+
+		PhaseTimer timers[] =
+		{
+			{ "entity_insert", {}, 0 },
+			{ "entity_iterate", {}, 0 },
+			{ "entity_delete", {}, 0 },
+		};
+
+		float checksum = 0.0f;
+		for (size_t frame = 0; frame < WarmupFrames + frames; frame++)
+		{
+			bool record = frame >= WarmupFrames;
+			std::shuffle(order.begin(), order.end(), random);
+			Time(timers[0], record, [&]()
+				{
+					for (size_t i = 0; i < entityCount; i++)
+					{
+						handles[i] = registry.Create((MeshHandle)(i & 3), (MaterialHandle)(i % MaterialCount), std::string());
+					}
+					return entityCount;
+				});
+			Time(timers[1], record, [&]()
+				{
+					std::vector<Transform>& transforms = registry.GetTransforms();
+					std::vector<MeshHandle>& meshes = registry.GetMeshes();
+					std::vector<MaterialHandle>& materials = registry.GetMaterials();
+					for (size_t i = 0; i < transforms.size(); i++)
+					{
+						checksum += transforms[i].GetPosition().x + meshes[i] + materials[i];
+					}
+					return transforms.size();
+				});
+			Time(timers[2], record, [&]()
+				{
+					for (size_t i : order)
+					{
+						registry.Destroy(handles[i]);
+					}
+					return entityCount;
+				});
+		}
+
+		for (PhaseTimer& timer : timers)
+		{
+			results.push_back(Summarize(timer, entityCount));
+		}
+		if (checksum < 0.0f)
+			fprintf(stderr, "  (checksum %f)\n", checksum);
+	}
+
+	// --------------------------------------------------------
+	// Material instances, through the same MaterialParameters a
+	// Material keeps: a parent owns a parameter block, an instance
+	// keeps a resolved copy plus just the values it overrides
+	// --------------------------------------------------------
+	struct InstanceScene
+	{
+		std::vector<std::shared_ptr<MaterialParameters>> parents;
+		std::vector<std::shared_ptr<MaterialParameters>> instances;
+		std::vector<unsigned int> instanceParents;
+		std::vector<unsigned int> drawInstances;	// One draw per entry, in scene order
+		std::vector<unsigned long long> drawKeys;
+		size_t parameterBinds;
+		size_t instancedDraws;		// Had every instance a record in the table
+
+		// Every instance's parameters, repacked as StructuredBuffer records
+		std::shared_ptr<MaterialTable> table;
+		std::vector<unsigned int> materialIds;
+	};
+
+	std::shared_ptr<ConstantBufferLayout> MakeMaterialLayout(LayoutPacking packing = LayoutPacking::ConstantBuffer)
+	{
+		std::shared_ptr<ConstantBufferLayout> layout = std::make_shared<ConstantBufferLayout>("PerMaterial", packing);
+		layout->Add({ "colorTint", ShaderParameterType::Float, ShaderParameterClass::Vector, 1, 4, 0 });
+		layout->Add({ "roughness", ShaderParameterType::Float, ShaderParameterClass::Scalar, 1, 1, 0 });
+		layout->Add({ "uvScale", ShaderParameterType::Float, ShaderParameterClass::Vector, 1, 2, 0 });
+		layout->Add({ "emissive", ShaderParameterType::Float, ShaderParameterClass::Vector, 1, 3, 0 });
+		layout->Add({ "uvTransform", ShaderParameterType::Float, ShaderParameterClass::MatrixColumns, 3, 3, 0 });
+		return layout;
+	}
+
+	void BuildInstanceScene(InstanceScene& scene, size_t instanceCount)
+	{
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		std::shared_ptr<const ConstantBufferLayout> layout = MakeMaterialLayout();
+		for (unsigned int p = 0; p < MaterialCount; p++)
+		{
+			std::shared_ptr<MaterialParameters> parent = std::make_shared<MaterialParameters>(layout);
+			float white[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+			parent->SetFloat4("colorTint", white);
+			parent->SetFloat("roughness", 0.5f);
+			scene.parents.push_back(parent);
+		}
+
+		// Every instance overrides its tint; every fourth its roughness too
+		for (size_t i = 0; i < instanceCount; i++)
+		{
+			unsigned int parent = (unsigned int)(i % MaterialCount);
+			std::shared_ptr<MaterialParameters> instance = std::make_shared<MaterialParameters>(scene.parents[parent]);
+			float tint[4] = { unit(random), unit(random), unit(random), 1.0f };
+			instance->SetFloat4("colorTint", tint);
+			if (i % 4 == 0)
+				instance->SetFloat("roughness", unit(random));
+			scene.instances.push_back(instance);
+			scene.instanceParents.push_back(parent);
+		}
+
+		// Draws arrive in scene order, not grouped by material
+		for (size_t i = 0; i < instanceCount; i++)
+		{
+			scene.drawInstances.push_back((unsigned int)i);
+		}
+		std::shuffle(scene.drawInstances.begin(), scene.drawInstances.end(), random);
+		scene.drawKeys.reserve(instanceCount);
+		scene.parameterBinds = 0;
+		scene.instancedDraws = 0;
+
+		scene.table = std::make_shared<MaterialTable>(MakeMaterialLayout(LayoutPacking::Structured));
+		for (size_t i = 0; i < instanceCount; i++)
+		{
+			scene.materialIds.push_back(scene.table->Acquire());
+		}
+	}
+
+	// A parent edit (here, every frame) leaves each instance to
+	// pick up the parent's values under its own overrides
+	size_t ResolveInstances(InstanceScene& scene, size_t frame)
+	{
+		for (std::shared_ptr<MaterialParameters>& parent : scene.parents)
+		{
+			float scale[2] = { 1.0f + (frame % 8) * 0.125f, 1.0f };
+			parent->SetFloat2("uvScale", scale);
+		}
+
+		size_t resolved = 0;
+		for (std::shared_ptr<MaterialParameters>& instance : scene.instances)
+		{
+			if (instance->Resolve())
+				resolved++;
+		}
+		return resolved;
+	}
+
+	// What Material::UploadConstants does for table materials:
+	// repack each changed block into its record
+	size_t PackMaterialTable(InstanceScene& scene)
+	{
+		size_t written = 0;
+		for (size_t i = 0; i < scene.instances.size(); i++)
+		{
+			ParameterBlock& parameters = scene.instances[i]->GetMutableBlock();
+			if (!parameters.IsDirty())
+				continue;
+
+			scene.table->Write(scene.materialIds[i], parameters);
+			parameters.ClearDirty();
+			written++;
+		}
+
+		unsigned int first = 0;
+		unsigned int count = 0;
+		scene.table->GetDirtyRange(&first, &count);
+		scene.table->ClearDirty();
+		return written;
+	}
+
+	// Parent first, then instance, like Game's draw sort; returns
+	// the pipeline state changes the sorted list needs
+	size_t BatchInstanceDraws(InstanceScene& scene)
+	{
+		scene.drawKeys.clear();
+		for (unsigned int index : scene.drawInstances)
+		{
+			scene.drawKeys.push_back(((unsigned long long)scene.instanceParents[index] << 32) | index);
+		}
+		std::sort(scene.drawKeys.begin(), scene.drawKeys.end());
+
+		// With a table, instances only split a draw at a new parent
+		// or a full instance array
+		size_t stateChanges = 0;
+		size_t instancesInDraw = 0;
+		scene.parameterBinds = 0;
+		scene.instancedDraws = 0;
+		unsigned long long boundParent = ~0ull;
+		unsigned long long boundInstance = ~0ull;
+		for (unsigned long long key : scene.drawKeys)
+		{
+			if (key >> 32 != boundParent)
+			{
+				boundParent = key >> 32;
+				stateChanges++;
+				instancesInDraw = 0;
+			}
+			if (instancesInDraw++ % MaxInstancesPerDraw == 0)
+				scene.instancedDraws++;
+			if ((key & 0xFFFFFFFF) != boundInstance)
+			{
+				boundInstance = key & 0xFFFFFFFF;
+				scene.parameterBinds++;
+			}
+		}
+		return stateChanges;
+	}
+
+	void RunInstances(size_t instanceCount, size_t frames, std::vector<PhaseResult>& results)
+	{
+		InstanceScene scene;
+		BuildInstanceScene(scene, instanceCount);
+
+		PhaseTimer timers[] =
+		{
+			{ "instance_resolve", {}, 0 },
+			{ "material_table_pack", {}, 0 },
+			{ "instance_batch_sort", {}, 0 },
+		};
+
+		for (size_t frame = 0; frame < WarmupFrames + frames; frame++)
+		{
+			bool record = frame >= WarmupFrames;
+			Time(timers[0], record, [&]() { return ResolveInstances(scene, frame); });
+			Time(timers[1], record, [&]() { return PackMaterialTable(scene); });
+			Time(timers[2], record, [&]()
+				{
+					timers[2].stateChanges = BatchInstanceDraws(scene);
+					return scene.drawKeys.size();
+				});
+		}
+
+		for (PhaseTimer& timer : timers)
+		{
+			results.push_back(Summarize(timer, instanceCount));
+		}
+
+		size_t overrideBytes = 0;
+		for (const std::shared_ptr<MaterialParameters>& instance : scene.instances)
+		{
+			overrideBytes += instance->GetOverrides().GetByteCount();
+		}
+		fprintf(stderr, "  %zu instances of %u parents: %zu pipeline state changes and %zu parameter binds per frame "
+			"(%zu instanced draws from a %u byte/record table), %zu override bytes (%zu as full blocks)\n",
+			instanceCount, MaterialCount, timers[2].stateChanges, scene.parameterBinds, scene.instancedDraws,
+			scene.table->GetStride(), overrideBytes, instanceCount * scene.parents[0]->GetBlock().GetSize());
+	}
+
+	void RunLights(size_t lightCount, size_t frames, std::vector<PhaseResult>& results)
+	{
+		// Game's default camera, looking down +Z into the lights
+		XMFLOAT4X4 view;
+		XMFLOAT4X4 projection;
+		XMStoreFloat4x4(&view, XMMatrixLookToLH(XMVectorSet(0.0f, 0.0f, -5.0f, 0.0f), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+		XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XMConvertToRadians(90.0f), 16.0f / 9.0f, 0.1f, 200.0f));
+
+		std::mt19937 random(7);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::vector<Light> lights(lightCount);
+		for (Light& light : lights)
+		{
+			light = {};
+			light.position = XMFLOAT3(unit(random) * 80.0f - 40.0f, unit(random) * 20.0f - 10.0f, unit(random) * 120.0f);
+			light.range = 2.0f + unit(random) * 6.0f;
+			light.type = unit(random) < 0.25f ? LightType::Spot : LightType::Point;
+			XMStoreFloat3(&light.direction, XMVector3Normalize(XMVectorSet(unit(random) - 0.5f, unit(random) - 0.5f, unit(random) - 0.5f, 0.0f)));
+			light.spotOuterCos = 0.8f;
+			light.spotInnerCos = 0.9f;
+		}
+
+		LightClusterGrid grid;
+		PhaseTimer timer = { "light_cluster_assign", {}, 0 };
+		std::vector<Light> moved = lights;
+		for (size_t frame = 0; frame < WarmupFrames + frames; frame++)
+		{
+			for (size_t i = 0; i < lights.size(); i++)
+			{
+				moved[i].position.x = lights[i].position.x + sinf(frame * 0.05f + i) * 2.0f;
+			}
+			Time(timer, frame >= WarmupFrames, [&]()
+				{
+					grid.SetProjection(projection);
+					grid.Assign(moved.data(), moved.size(), view);
+					return moved.size();
+				});
+		}
+		results.push_back(Summarize(timer, lightCount));
+
+		const LightClusterStats& stats = grid.GetStats();
+		fprintf(stderr, "  %zu lights: %u visible, %u light indices over %u of %u clusters (at most %u in one)\n",
+			lightCount, stats.visibleLights, stats.indexCount, stats.occupiedClusters, grid.GetClusterCount(), stats.maxLightsPerCluster);
+	}
+
+	// --------------------------------------------------------
+	// Closest-hit rays against one dense mesh, the narrow phase of
+	// Picking, with and without the mesh's triangle BVH; about
+	// half the rays hit
+	// --------------------------------------------------------
+	void RunRays(size_t rayCount, size_t frames, std::vector<PhaseResult>& results)
+	{
+		std::vector<Vertex> vertices = MakeSphereVertices(1.0f, 128, 64);
+		std::vector<unsigned int> indices = MakeSphereIndices(128, 64);
+		size_t triangleCount = indices.size() / 3;
+
+		double buildStart = NowMilliseconds();
+		TriangleBVH bvh(&vertices[0].Position, sizeof(Vertex), indices.data(), indices.size());
+		double buildMilliseconds = NowMilliseconds() - buildStart;
+
+		std::mt19937 random(11);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::vector<Ray> rays(rayCount);
+		for (Ray& ray : rays)
+		{
+			XMVECTOR origin = XMVector3Normalize(XMVectorSet(unit(random), unit(random), unit(random), 0.0f)) * 5.0f;
+			XMVECTOR target = XMVectorSet(unit(random), unit(random), unit(random), 0.0f) * 1.5f;
+			XMStoreFloat3(&ray.origin, origin);
+			XMStoreFloat3(&ray.direction, XMVector3Normalize(target - origin));
+		}
+
+		auto castBruteForce = [&](const Ray& ray)
+			{
+				float maxDistance = 100.0f;
+				bool found = false;
+				for (size_t i = 0; i + 2 < indices.size(); i += 3)
+				{
+					float distance, u, v;
+					if (Bounds::IntersectTriangle(ray, vertices[indices[i]].Position, vertices[indices[i + 1]].Position, vertices[indices[i + 2]].Position,
+						maxDistance, &distance, &u, &v))
+					{
+						maxDistance = distance;
+						found = true;
+					}
+				}
+				return found;
+			};
+
+		// Every triangle is slow, so it gets fewer rays
+		size_t bruteForceRays = std::max<size_t>(1, rayCount / 50);
+		PhaseTimer timers[] =
+		{
+			{ "ray_mesh_brute_force", {}, 0 },
+			{ "ray_mesh_bvh", {}, 0 },
+		};
+		size_t hits = 0;
+		for (size_t frame = 0; frame < WarmupFrames + frames; frame++)
+		{
+			bool record = frame >= WarmupFrames;
+			Time(timers[0], record, [&]()
+				{
+					for (size_t i = 0; i < bruteForceRays; i++)
+						castBruteForce(rays[i]);
+					return bruteForceRays;
+				});
+			Time(timers[1], record, [&]()
+				{
+					hits = 0;
+					TriangleHit hit;
+					for (const Ray& ray : rays)
+						hits += bvh.Raycast(ray, 100.0f, &hit) ? 1 : 0;
+					return rays.size();
+				});
+		}
+
+		for (PhaseTimer& timer : timers)
+		{
+			PhaseResult result = Summarize(timer, triangleCount);
+			results.push_back(result);
+			fprintf(stderr, "  %s: %.0f rays/s\n", timer.phase, result.itemsPerFrame / (result.medianMilliseconds / 1000.0));
+		}
+		fprintf(stderr, "  %zu triangles, %zu BVH nodes built in %.2f ms, %zu of %zu rays hit\n",
+			triangleCount, bvh.GetNodeCount(), buildMilliseconds, hits, rays.size());
+	}
+
+	// --------------------------------------------------------
+	// What PROFILE_SCOPE costs: a frame's worth of nested scopes
+	// recorded and collected, then the same with profiling off
+	// --------------------------------------------------------
+	void RunProfiler(size_t frames, std::vector<PhaseResult>& results)
+	{
+		const size_t ScopesPerFrame = 4096;
+		const char* names[] = { "Update", "Simulate", "Draw", "Present" };
+		CpuProfiler profiler(ScopesPerFrame);
+
+		PhaseTimer timers[] =
+		{
+			{ "profiler_scope", {}, 0 },
+			{ "profiler_end_frame", {}, 0 },
+			{ "profiler_scope_disabled", {}, 0 },
+		};
+		auto recordScopes = [&]()
+			{
+				for (size_t i = 0; i < ScopesPerFrame; i += 2)
+				{
+					ProfileScope outer(profiler, names[i % 4]);
+					ProfileScope inner(profiler, names[(i + 1) % 4]);
+				}
+				return ScopesPerFrame;
+			};
+
+		for (size_t frame = 0; frame < WarmupFrames + frames; frame++)
+		{
+			bool record = frame >= WarmupFrames;
+			profiler.SetEnabled(true);
+			profiler.BeginFrame();
+			Time(timers[0], record, recordScopes);
+			Time(timers[1], record, [&]()
+				{
+					profiler.EndFrame();
+					return profiler.GetLastFrame().events.size();
+				});
+
+			profiler.SetEnabled(false);
+			Time(timers[2], record, recordScopes);
+		}
+
+		for (PhaseTimer& timer : timers)
+		{
+			results.push_back(Summarize(timer, ScopesPerFrame));
+		}
+		fprintf(stderr, "  %zu scopes per frame, %llu dropped\n", ScopesPerFrame, profiler.GetDroppedEventCount());
+	}
+
+	void WriteResults(FILE* file, const Options& options, const std::vector<PhaseResult>& results)
+	{
+		if (options.csv)
+		{
+			fprintf(file, "entities,phase,threads,items_per_frame,median_ms,p95_ms,min_ms,ns_per_item,state_changes\n");
+			for (const PhaseResult& result : results)
+			{
+				double perItem = result.itemsPerFrame ? result.medianMilliseconds * 1e6 / result.itemsPerFrame : 0.0;
+				fprintf(file, "%zu,%s,%zu,%zu,%.6f,%.6f,%.6f,%.3f,%zu\n", result.entities, result.phase, result.threads,
+					result.itemsPerFrame, result.medianMilliseconds, result.p95Milliseconds, result.minMilliseconds, perItem,
+					result.stateChanges);
+			}
+			return;
+		}
+
+		fprintf(file, "{\n  \"benchmark\": \"SceneBenchmark\",\n  \"frames\": %zu,\n  \"results\": [", options.frames);
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const PhaseResult& result = results[i];
+			double perItem = result.itemsPerFrame ? result.medianMilliseconds * 1e6 / result.itemsPerFrame : 0.0;
+			fprintf(file, "%s\n    {\"entities\": %zu, \"phase\": \"%s\", \"threads\": %zu, \"items_per_frame\": %zu, "
+				"\"median_ms\": %.6f, \"p95_ms\": %.6f, \"min_ms\": %.6f, \"ns_per_item\": %.3f, \"state_changes\": %zu}",
+				i ? "," : "", result.entities, result.phase, result.threads, result.itemsPerFrame,
+				result.medianMilliseconds, result.p95Milliseconds, result.minMilliseconds, perItem, result.stateChanges);
+		}
+		fprintf(file, "\n  ]\n}\n");
+	}
+
+	bool ParseOptions(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string argument = argv[i];
+			bool hasValue = i + 1 < argc;
+			if (argument == "--sizes" && hasValue)
+			{
+				options.sizes.clear();
+				for (const char* size = argv[++i]; *size; )
+				{
+					char* end = 0;
+					unsigned long long value = strtoull(size, &end, 10);
+					if (end == size || value == 0)
+						return false;
+					options.sizes.push_back((size_t)value);
+					size = *end == ',' ? end + 1 : end;
+				}
+			}
+			else if (argument == "--frames" && hasValue)
+			{
+				options.frames = (size_t)strtoull(argv[++i], 0, 10);
+				if (options.frames == 0)
+					return false;
+			}
+			else if (argument == "--instances" && hasValue)
+			{
+				options.instances = (size_t)strtoull(argv[++i], 0, 10);
+			}
+			else if (argument == "--threads" && hasValue)
+			{
+				options.maxThreads = (size_t)strtoull(argv[++i], 0, 10);
+			}
+			else if (argument == "--lights" && hasValue)
+			{
+				options.lights = (size_t)strtoull(argv[++i], 0, 10);
+			}
+			else if (argument == "--rays" && hasValue)
+			{
+				options.rays = (size_t)strtoull(argv[++i], 0, 10);
+			}
+			else if (argument == "--format" && hasValue)
+			{
+				std::string format = argv[++i];
+				if (format != "json" && format != "csv")
+					return false;
+				options.csv = format == "csv";
+			}
+			else if (argument == "--output" && hasValue)
+			{
+				options.outputPath = argv[++i];
+			}
+			else
+			{
+				return false;
+			}
+		}
+		return !options.sizes.empty();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		fprintf(stderr, "Usage: SceneBenchmark [--sizes 1000,10000] [--frames 120] [--instances 10000] [--lights 1000] [--rays 10000] [--threads 8] [--format json|csv] [--output file]\n");
+		return 1;
+	}
+
+	std::vector<PhaseResult> results;
+	for (size_t size : options.sizes)
+	{
+		fprintf(stderr, "Benchmarking %zu entities...\n", size);
+		RunScene(size, options.frames, results);
+		RunEntities(size, options.frames, results);
+	}
+	if (options.maxThreads > 0)
+	{
+		size_t largest = *std::max_element(options.sizes.begin(), options.sizes.end());
+		fprintf(stderr, "Benchmarking %zu entities on 1 to %zu threads...\n", largest, options.maxThreads);
+		RunJobScaling(largest, options.maxThreads, options.frames, results);
+	}
+	if (options.instances > 0)
+	{
+		fprintf(stderr, "Benchmarking %zu material instances...\n", options.instances);
+		RunInstances(options.instances, options.frames, results);
+	}
+	if (options.lights > 0)
+	{
+		fprintf(stderr, "Benchmarking %zu lights...\n", options.lights);
+		RunLights(options.lights, options.frames, results);
+	}
+	if (options.rays > 0)
+	{
+		fprintf(stderr, "Benchmarking %zu rays...\n", options.rays);
+		RunRays(options.rays, options.frames, results);
+	}
+	fprintf(stderr, "Benchmarking the profiler...\n");
+	RunProfiler(options.frames, results);
+
+	FILE* file = stdout;
+	if (options.outputPath)
+	{
+		file = fopen(options.outputPath, "w");
+		if (!file)
+		{
+			fprintf(stderr, "Could not open %s\n", options.outputPath);
+			return 1;
+		}
+	}
+
+	WriteResults(file, options, results);
+	if (file != stdout)
+		fclose(file);
+	return 0;
+}
@@ -0,0 +1,245 @@
+#include "ShaderArchive.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	const unsigned char Magic[4] = { 'S', 'H', 'A', 'R' };
+	const size_t HeaderSize = 16;
+	const size_t EntrySize = 32;
+	const size_t DataAlignment = 16;
+
+	// Written a byte at a time so the file reads the same on any host
+	void Put32(unsigned char* at, unsigned int value)
+	{
+		for (int i = 0; i < 4; i++)
+			at[i] = (unsigned char)(value >> (i * 8));
+	}
+
+	void Put64(unsigned char* at, unsigned long long value)
+	{
+		for (int i = 0; i < 8; i++)
+			at[i] = (unsigned char)(value >> (i * 8));
+	}
+
+	unsigned int Get32(const unsigned char* at)
+	{
+		unsigned int value = 0;
+		for (int i = 0; i < 4; i++)
+			value |= (unsigned int)at[i] << (i * 8);
+		return value;
+	}
+
+	unsigned long long Get64(const unsigned char* at)
+	{
+		unsigned long long value = 0;
+		for (int i = 0; i < 8; i++)
+			value |= (unsigned long long)at[i] << (i * 8);
+		return value;
+	}
+
+	size_t Align(size_t offset)
+	{
+		return (offset + DataAlignment - 1) / DataAlignment * DataAlignment;
+	}
+}
+
+unsigned long long ShaderArchive::HashName(const std::string& name)
+{
+	unsigned long long hash = 14695981039346656037ull;
+	for (unsigned char c : name)
+	{
+		hash ^= c;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+bool ShaderArchive::ParseManifest(const std::string& text, std::vector<ShaderPermutation>& permutations, std::string& error)
+{
+	std::istringstream lines(text);
+	std::string line;
+	for (int lineNumber = 1; std::getline(lines, line); lineNumber++)
+	{
+		std::istringstream fields(line);
+		ShaderPermutation permutation;
+		if (!(fields >> permutation.name) || permutation.name[0] == '#')
+			continue;
+
+		if (!(fields >> permutation.sourcePath >> permutation.entryPoint >> permutation.target))
+		{
+			error = "Line " + std::to_string(lineNumber) + ": expected name, source, entry point and target";
+			return false;
+		}
+
+		if (permutation.target.compare(0, 3, "vs_") == 0)
+			permutation.stage = ShaderStage::Vertex;
+		else if (permutation.target.compare(0, 3, "ps_") == 0)
+			permutation.stage = ShaderStage::Pixel;
+		else
+		{
+			error = "Line " + std::to_string(lineNumber) + ": unsupported target " + permutation.target;
+			return false;
+		}
+
+		for (std::string define; fields >> define; )
+			permutation.defines.push_back(define);
+		permutations.push_back(permutation);
+	}
+	return true;
+}
+
+bool ShaderArchiveWriter::Add(const std::string& name, ShaderStage stage, const void* data, size_t size)
+{
+	unsigned long long key = ShaderArchive::HashName(name);
+	for (const Shader& shader : shaders)
+	{
+		if (shader.key == key)
+			return false;
+	}
+
+	Shader shader;
+	shader.name = name;
+	shader.key = key;
+	shader.stage = stage;
+	shader.data.assign((const unsigned char*)data, (const unsigned char*)data + size);
+	shaders.push_back(shader);
+	return true;
+}
+
+size_t ShaderArchiveWriter::GetEntryCount() const { return shaders.size(); }
+
+std::vector<unsigned char> ShaderArchiveWriter::Build() const
+{
+	// Sorted by key so the reader can binary search
+	std::vector<const Shader*> sorted;
+	for (const Shader& shader : shaders)
+		sorted.push_back(&shader);
+	std::sort(sorted.begin(), sorted.end(), [](const Shader* a, const Shader* b) { return a->key < b->key; });
+
+	size_t namesOffset = HeaderSize + EntrySize * sorted.size();
+	size_t end = namesOffset;
+	for (const Shader* shader : sorted)
+		end += shader->name.size();
+
+	std::vector<unsigned char> archive(end);
+	memcpy(archive.data(), Magic, sizeof(Magic));
+	Put32(&archive[4], ShaderArchive::Version);
+	Put32(&archive[8], (unsigned int)sorted.size());
+
+	size_t nameOffset = namesOffset;
+	for (size_t i = 0; i < sorted.size(); i++)
+	{
+		const Shader* shader = sorted[i];
+		memcpy(&archive[nameOffset], shader->name.data(), shader->name.size());
+
+		size_t dataOffset = Align(archive.size());
+		archive.resize(dataOffset + shader->data.size(), 0);
+		memcpy(&archive[dataOffset], shader->data.data(), shader->data.size());
+
+		unsigned char* entry = &archive[HeaderSize + EntrySize * i];
+		Put64(entry, shader->key);
+		Put32(entry + 8, (unsigned int)nameOffset);
+		Put32(entry + 12, (unsigned int)shader->name.size());
+		Put32(entry + 16, (unsigned int)shader->stage);
+		Put32(entry + 20, (unsigned int)dataOffset);
+		Put32(entry + 24, (unsigned int)shader->data.size());
+		nameOffset += shader->name.size();
+	}
+	return archive;
+}
+
+bool ShaderArchiveWriter::WriteFile(const std::filesystem::path& path) const
+{
+	std::vector<unsigned char> archive = Build();
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+		return false;
+	file.write(reinterpret_cast<const char*>(archive.data()), archive.size());
+	return (bool)file;
+}
+
+ShaderArchiveReader::ShaderArchiveReader() :
+	data(0),
+	size(0),
+	entryCount(0)
+{
+}
+
+bool ShaderArchiveReader::Open(const void* archive, size_t archiveSize)
+{
+	Close();
+	const unsigned char* bytes = static_cast<const unsigned char*>(archive);
+	if (!bytes || archiveSize < HeaderSize || memcmp(bytes, Magic, sizeof(Magic)) != 0 || Get32(bytes + 4) != ShaderArchive::Version)
+		return false;
+
+	unsigned int count = Get32(bytes + 8);
+	if (count > (archiveSize - HeaderSize) / EntrySize)
+		return false;
+
+	unsigned long long previousKey = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const unsigned char* entry = bytes + HeaderSize + EntrySize * i;
+		unsigned long long key = Get64(entry);
+		unsigned long long nameEnd = (unsigned long long)Get32(entry + 8) + Get32(entry + 12);
+		unsigned long long dataEnd = (unsigned long long)Get32(entry + 20) + Get32(entry + 24);
+		unsigned int stage = Get32(entry + 16);
+		if (nameEnd > archiveSize || dataEnd > archiveSize || stage > (unsigned int)ShaderStage::Pixel)
+			return false;
+		if (i > 0 && key <= previousKey)
+			return false;
+		previousKey = key;
+	}
+
+	data = bytes;
+	size = archiveSize;
+	entryCount = count;
+	return true;
+}
+
+void ShaderArchiveReader::Close()
+{
+	data = 0;
+	size = 0;
+	entryCount = 0;
+}
+
+bool ShaderArchiveReader::IsOpen() const { return data != 0; }
+size_t ShaderArchiveReader::GetEntryCount() const { return entryCount; }
+
+bool ShaderArchiveReader::GetEntry(size_t index, ShaderArchiveEntry* entry) const
+{
+	if (index >= entryCount)
+		return false;
+
+	const unsigned char* at = data + HeaderSize + EntrySize * index;
+	entry->name.assign(reinterpret_cast<const char*>(data + Get32(at + 8)), Get32(at + 12));
+	entry->stage = (ShaderStage)Get32(at + 16);
+	entry->data = data + Get32(at + 20);
+	entry->size = Get32(at + 24);
+	return true;
+}
+
+bool ShaderArchiveReader::Find(const std::string& name, ShaderArchiveEntry* entry) const
+{
+	unsigned long long key = ShaderArchive::HashName(name);
+	size_t low = 0;
+	size_t high = entryCount;
+	while (low < high)
+	{
+		size_t middle = (low + high) / 2;
+		unsigned long long middleKey = Get64(data + HeaderSize + EntrySize * middle);
+		if (middleKey < key)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	// The key only narrows it down; the name has to match too
+	if (low == entryCount || Get64(data + HeaderSize + EntrySize * low) != key)
+		return false;
+	return GetEntry(low, entry) && entry->name == name;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <filesystem>
+#include <string>
+#include <vector>
+
+enum class ShaderStage : unsigned int { Vertex, Pixel };
+
+// One shader to compile: a source file built with a set of defines
+struct ShaderPermutation
+{
+	std::string name;					// What it's looked up by - the .cso name it stands in for
+	std::string sourcePath;
+	std::string entryPoint;
+	std::string target;					// vs_5_0, ps_5_0...
+	std::vector<std::string> defines;	// NAME or NAME=VALUE
+	ShaderStage stage;
+};
+
+// One compiled shader, pointing straight into the archive's bytes
+struct ShaderArchiveEntry
+{
+	std::string name;
+	ShaderStage stage;
+	const unsigned char* data;
+	size_t size;
+};
+
+// --------------------------------------------------------
+// A single file holding every compiled shader permutation,
+// found by name
+//
+// Layout, with every integer little-endian:
+//  - Header: "SHAR", version, entry count, reserved (u32s)
+//  - Entries sorted by key, 32 bytes each: u64 key (FNV-1a
+//     of the name), u32 name offset, u32 name length, u32
+//     stage, u32 data offset, u32 data size, u32 reserved
+//  - The names, then each shader's bytecode 16 byte aligned
+//
+// Offsets count from the start of the file.  Neither side has
+// any graphics API code, so both run anywhere.
+// --------------------------------------------------------
+namespace ShaderArchive
+{
+	const unsigned int Version = 1;
+
+	unsigned long long HashName(const std::string& name);
+
+	// Reads a permutation list, one per line:
+	//   name  source  entryPoint  target  [DEFINE[=VALUE]...]
+	// Blank lines and lines starting with # are skipped.  On
+	// failure, error names the offending line.
+	bool ParseManifest(const std::string& text, std::vector<ShaderPermutation>& permutations, std::string& error);
+}
+
+class ShaderArchiveWriter
+{
+public:
+	// False if the name is taken, or hashes the same as another
+	bool Add(const std::string& name, ShaderStage stage, const void* data, size_t size);
+	size_t GetEntryCount() const;
+
+	std::vector<unsigned char> Build() const;
+	bool WriteFile(const std::filesystem::path& path) const;
+
+private:
+	struct Shader
+	{
+		std::string name;
+		unsigned long long key;
+		ShaderStage stage;
+		std::vector<unsigned char> data;
+	};
+	std::vector<Shader> shaders;
+};
+
+// --------------------------------------------------------
+// Looks shaders up in archive bytes that are already in memory
+// (usually a mapped file), without copying any bytecode
+//
+// - Open() checks every offset against the size first, so a
+//    truncated or corrupt file is rejected up front
+// - The bytes must outlive the reader and its entries
+// --------------------------------------------------------
+class ShaderArchiveReader
+{
+public:
+	ShaderArchiveReader();
+
+	bool Open(const void* data, size_t size);
+	void Close();
+	bool IsOpen() const;
+
+	size_t GetEntryCount() const;
+	bool GetEntry(size_t index, ShaderArchiveEntry* entry) const;
+	bool Find(const std::string& name, ShaderArchiveEntry* entry) const;
+
+private:
+	const unsigned char* data;
+	size_t size;
+	unsigned int entryCount;
+};
@@ -0,0 +1,116 @@
+// --------------------------------------------------------
+// Compiles every permutation in a manifest and writes them
+// all into one shader archive for the game to map at startup
+//
+// Usage: ShaderArchiveBuilder <manifest> <output>
+//
+// Sources are found relative to the manifest.  D3D11Starter
+// runs it as a custom build step on the manifest, with every
+// shader source as an input, so the archive is rebuilt along
+// with the game whenever any of them changes.
+// --------------------------------------------------------
+#include <Windows.h>
+#include <d3dcompiler.h>
+#include <wrl/client.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include "ShaderArchive.h"
+
+namespace
+{
+	bool Compile(const std::filesystem::path& directory, const ShaderPermutation& permutation, ID3DBlob** code)
+	{
+		UINT flags = D3DCOMPILE_ENABLE_STRICTNESS;
+#if defined(DEBUG) || defined(_DEBUG)
+		flags |= D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+
+		// NAME=VALUE splits in two; a bare NAME is defined as 1.
+		// The strings have to stay put until the compile is done.
+		std::vector<std::pair<std::string, std::string>> defines;
+		for (const std::string& define : permutation.defines)
+		{
+			size_t equals = define.find('=');
+			if (equals == std::string::npos)
+				defines.push_back({ define, "1" });
+			else
+				defines.push_back({ define.substr(0, equals), define.substr(equals + 1) });
+		}
+
+		std::vector<D3D_SHADER_MACRO> macros;
+		for (const auto& define : defines)
+			macros.push_back({ define.first.c_str(), define.second.c_str() });
+		macros.push_back({ 0, 0 });
+
+		Microsoft::WRL::ComPtr<ID3DBlob> messages;
+		HRESULT result = D3DCompileFromFile(
+			(directory / permutation.sourcePath).wstring().c_str(),
+			macros.data(),
+			D3D_COMPILE_STANDARD_FILE_INCLUDE,
+			permutation.entryPoint.c_str(),
+			permutation.target.c_str(),
+			flags,
+			0,
+			code,
+			messages.GetAddressOf());
+
+		if (messages)
+			fprintf(stderr, "%.*s", (int)messages->GetBufferSize(), static_cast<const char*>(messages->GetBufferPointer()));
+		return SUCCEEDED(result) && *code;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc != 3)
+	{
+		fprintf(stderr, "Usage: ShaderArchiveBuilder <manifest> <output>\n");
+		return 1;
+	}
+
+	std::filesystem::path manifestPath = std::filesystem::u8path(argv[1]);
+	std::ifstream manifestFile(manifestPath);
+	if (!manifestFile)
+	{
+		fprintf(stderr, "Could not open %s\n", argv[1]);
+		return 1;
+	}
+
+	std::stringstream manifest;
+	manifest << manifestFile.rdbuf();
+	std::vector<ShaderPermutation> permutations;
+	std::string error;
+	if (!ShaderArchive::ParseManifest(manifest.str(), permutations, error))
+	{
+		fprintf(stderr, "%s: %s\n", argv[1], error.c_str());
+		return 1;
+	}
+
+	ShaderArchiveWriter writer;
+	std::filesystem::path directory = manifestPath.parent_path();
+	for (const ShaderPermutation& permutation : permutations)
+	{
+		Microsoft::WRL::ComPtr<ID3DBlob> code;
+		if (!Compile(directory, permutation, code.GetAddressOf()))
+		{
+			fprintf(stderr, "Failed to compile %s\n", permutation.name.c_str());
+			return 1;
+		}
+		if (!writer.Add(permutation.name, permutation.stage, code->GetBufferPointer(), code->GetBufferSize()))
+		{
+			fprintf(stderr, "%s is in the manifest twice\n", permutation.name.c_str());
+			return 1;
+		}
+		fprintf(stderr, "  %-24s %6zu bytes\n", permutation.name.c_str(), code->GetBufferSize());
+	}
+
+	if (!writer.WriteFile(std::filesystem::u8path(argv[2])))
+	{
+		fprintf(stderr, "Could not write %s\n", argv[2]);
+		return 1;
+	}
+	fprintf(stderr, "Wrote %zu shaders to %s\n", writer.GetEntryCount(), argv[2]);
+	return 0;
+}
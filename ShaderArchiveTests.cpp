@@ -0,0 +1,190 @@
+#include "ShaderArchive.h"
+#include "TestHarness.h"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+	const char* Names[] = { "VertexShader.cso", "PixelShader.cso", "DebugNormalsPS.cso", "CustomPS.cso" };
+
+	// Four fake shaders, each a different length and filled with its index
+	std::vector<unsigned char> BuildArchive()
+	{
+		ShaderArchiveWriter writer;
+		for (int i = 0; i < 4; i++)
+		{
+			std::vector<unsigned char> code(10 + i * 7, (unsigned char)i);
+			writer.Add(Names[i], i == 0 ? ShaderStage::Vertex : ShaderStage::Pixel, code.data(), code.size());
+		}
+		return writer.Build();
+	}
+
+	void Put32(std::vector<unsigned char>& bytes, size_t offset, unsigned int value)
+	{
+		for (int i = 0; i < 4; i++)
+			bytes[offset + i] = (unsigned char)(value >> (i * 8));
+	}
+}
+
+TEST_CASE(ManifestListsPermutations)
+{
+	std::vector<ShaderPermutation> permutations;
+	std::string error;
+	REQUIRE(ShaderArchive::ParseManifest(
+		"# A comment\n"
+		"\n"
+		"VertexShader.cso\tVertexShader.hlsl\tmain\tvs_5_0\n"
+		"DebugUVsPS.cso  PixelShader.hlsl  main  ps_5_0  DEBUG_UVS TILES=4\n",
+		permutations, error));
+	REQUIRE(permutations.size() == 2);
+	CHECK(permutations[0].name == "VertexShader.cso");
+	CHECK(permutations[0].sourcePath == "VertexShader.hlsl");
+	CHECK(permutations[0].stage == ShaderStage::Vertex);
+	CHECK(permutations[0].defines.empty());
+	CHECK(permutations[1].entryPoint == "main");
+	CHECK(permutations[1].target == "ps_5_0");
+	CHECK(permutations[1].stage == ShaderStage::Pixel);
+	REQUIRE(permutations[1].defines.size() == 2);
+	CHECK(permutations[1].defines[1] == "TILES=4");
+}
+
+TEST_CASE(ManifestErrorsNameTheLine)
+{
+	std::vector<ShaderPermutation> permutations;
+	std::string error;
+	CHECK(!ShaderArchive::ParseManifest("A.cso A.hlsl main vs_5_0\nB.cso B.hlsl main cs_5_0\n", permutations, error));
+	CHECK(error.find("Line 2") != std::string::npos);
+	CHECK(error.find("cs_5_0") != std::string::npos);
+
+	CHECK(!ShaderArchive::ParseManifest("A.cso A.hlsl\n", permutations, error));
+	CHECK(error.find("Line 1") != std::string::npos);
+}
+
+TEST_CASE(EveryShaderIsFoundByName)
+{
+	std::vector<unsigned char> archive = BuildArchive();
+	ShaderArchiveReader reader;
+	REQUIRE(reader.Open(archive.data(), archive.size()));
+	CHECK(reader.IsOpen());
+	CHECK(reader.GetEntryCount() == 4);
+
+	for (int i = 0; i < 4; i++)
+	{
+		ShaderArchiveEntry entry;
+		REQUIRE(reader.Find(Names[i], &entry));
+		CHECK(entry.name == Names[i]);
+		CHECK(entry.stage == (i == 0 ? ShaderStage::Vertex : ShaderStage::Pixel));
+		CHECK(entry.size == 10 + i * 7u);
+		CHECK(entry.data[0] == i && entry.data[entry.size - 1] == i);
+
+		// Straight into the archive's bytes, aligned for the driver
+		CHECK(entry.data >= archive.data() && entry.data + entry.size <= archive.data() + archive.size());
+		CHECK((entry.data - archive.data()) % 16 == 0);
+	}
+
+	ShaderArchiveEntry missing;
+	CHECK(!reader.Find("Missing.cso", &missing));
+	CHECK(!reader.Find("", &missing));
+}
+
+TEST_CASE(EntriesAreSortedByKey)
+{
+	std::vector<unsigned char> archive = BuildArchive();
+	ShaderArchiveReader reader;
+	REQUIRE(reader.Open(archive.data(), archive.size()));
+	unsigned long long previous = 0;
+	for (size_t i = 0; i < reader.GetEntryCount(); i++)
+	{
+		ShaderArchiveEntry entry;
+		REQUIRE(reader.GetEntry(i, &entry));
+		unsigned long long key = ShaderArchive::HashName(entry.name);
+		CHECK(i == 0 || key > previous);
+		previous = key;
+	}
+	ShaderArchiveEntry entry;
+	CHECK(!reader.GetEntry(4, &entry));
+}
+
+TEST_CASE(DuplicateNamesAreRefused)
+{
+	ShaderArchiveWriter writer;
+	CHECK(writer.Add("CustomPS.cso", ShaderStage::Pixel, "a", 1));
+	CHECK(!writer.Add("CustomPS.cso", ShaderStage::Pixel, "b", 1));
+	CHECK(writer.GetEntryCount() == 1);
+}
+
+TEST_CASE(EmptyArchiveOpens)
+{
+	std::vector<unsigned char> archive = ShaderArchiveWriter().Build();
+	ShaderArchiveReader reader;
+	REQUIRE(reader.Open(archive.data(), archive.size()));
+	CHECK(reader.GetEntryCount() == 0);
+	ShaderArchiveEntry entry;
+	CHECK(!reader.Find("VertexShader.cso", &entry));
+}
+
+TEST_CASE(CorruptArchivesAreRejected)
+{
+	std::vector<unsigned char> archive = BuildArchive();
+	ShaderArchiveReader reader;
+
+	// Any truncation either fails or leaves every entry in bounds
+	for (size_t length = 0; length < archive.size(); length++)
+	{
+		if (!reader.Open(archive.data(), length))
+			continue;
+		for (size_t i = 0; i < reader.GetEntryCount(); i++)
+		{
+			ShaderArchiveEntry entry;
+			reader.GetEntry(i, &entry);
+			CHECK(entry.data + entry.size <= archive.data() + length);
+		}
+	}
+	CHECK(!reader.Open(archive.data(), archive.size() / 2));
+
+	std::vector<unsigned char> badMagic = archive;
+	badMagic[0] = 'X';
+	CHECK(!reader.Open(badMagic.data(), badMagic.size()));
+	CHECK(!reader.IsOpen());
+
+	std::vector<unsigned char> newerVersion = archive;
+	Put32(newerVersion, 4, ShaderArchive::Version + 1);
+	CHECK(!reader.Open(newerVersion.data(), newerVersion.size()));
+
+	std::vector<unsigned char> tooManyEntries = archive;
+	Put32(tooManyEntries, 8, 1000000);
+	CHECK(!reader.Open(tooManyEntries.data(), tooManyEntries.size()));
+
+	// The first entry's data size, pointing past the end
+	std::vector<unsigned char> dataPastEnd = archive;
+	Put32(dataPastEnd, 16 + 24, (unsigned int)archive.size());
+	CHECK(!reader.Open(dataPastEnd.data(), dataPastEnd.size()));
+
+	// Swapping two entries breaks the sort the binary search needs
+	std::vector<unsigned char> unsorted = archive;
+	std::swap_ranges(unsorted.begin() + 16, unsorted.begin() + 48, unsorted.begin() + 48);
+	CHECK(!reader.Open(unsorted.data(), unsorted.size()));
+
+	CHECK(!reader.Open(0, 0));
+}
+
+TEST_CASE(WrittenFileReadsBack)
+{
+	const char* path = "ShaderArchiveTests.shaderarchive";
+	ShaderArchiveWriter writer;
+	REQUIRE(writer.Add("LitPS.cso", ShaderStage::Pixel, "bytecode", 8));
+	REQUIRE(writer.WriteFile(path));
+
+	std::ifstream file(path, std::ios::binary);
+	std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	file.close();
+	remove(path);
+	CHECK(bytes == writer.Build());
+
+	ShaderArchiveReader reader;
+	REQUIRE(reader.Open(bytes.data(), bytes.size()));
+	ShaderArchiveEntry entry;
+	REQUIRE(reader.Find("LitPS.cso", &entry));
+	CHECK(std::string((const char*)entry.data, entry.size) == "bytecode");
+}
@@ -0,0 +1,513 @@
+#include "ShaderLibrary.h"
+#include "Graphics.h"
+#include "PathHelpers.h"
+#include "Profiler.h"
+#include <d3dcompiler.h>
+#include <d3d11shader.h>
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+	// False for anything a ConstantBufferLayout can't hold, like structs
+	bool ToParameterDesc(const char* name, const D3D11_SHADER_TYPE_DESC& typeDesc, ShaderParameterDesc* desc)
+	{
+		desc->name = name;
+		desc->rows = typeDesc.Rows;
+		desc->columns = typeDesc.Columns;
+		desc->elements = typeDesc.Elements;
+		switch (typeDesc.Class)
+		{
+		case D3D_SVC_SCALAR: desc->parameterClass = ShaderParameterClass::Scalar; break;
+		case D3D_SVC_VECTOR: desc->parameterClass = ShaderParameterClass::Vector; break;
+		case D3D_SVC_MATRIX_ROWS: desc->parameterClass = ShaderParameterClass::MatrixRows; break;
+		case D3D_SVC_MATRIX_COLUMNS: desc->parameterClass = ShaderParameterClass::MatrixColumns; break;
+		default: return false;
+		}
+		switch (typeDesc.Type)
+		{
+		case D3D_SVT_FLOAT: desc->type = ShaderParameterType::Float; break;
+		case D3D_SVT_INT: desc->type = ShaderParameterType::Int; break;
+		case D3D_SVT_UINT: desc->type = ShaderParameterType::UInt; break;
+		case D3D_SVT_BOOL: desc->type = ShaderParameterType::Bool; break;
+		default: return false;
+		}
+		return true;
+	}
+
+	std::shared_ptr<ShaderBytecode> ReadBytecodeFile(const std::wstring& path)
+	{
+		PROFILE_SCOPE("Read Shader");
+		std::ifstream file(std::filesystem::path(FixPath(path)), std::ios::binary | std::ios::ate);
+		if (!file)
+			return 0;
+
+		std::shared_ptr<ShaderBytecode> code = std::make_shared<ShaderBytecode>();
+		code->path = path;
+		code->data.resize((size_t)file.tellg());
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(code->data.data()), code->data.size());
+		if (!file)
+			return 0;
+
+		code->bytes = code->data.data();
+		code->size = code->data.size();
+		code->hash = ShaderLibrary::HashBytecode(code->bytes, code->size);
+		return code;
+	}
+}
+
+ShaderLibrary& ShaderLibrary::Global()
+{
+	static ShaderLibrary library;
+	return library;
+}
+
+// 64-bit FNV-1a
+unsigned long long ShaderLibrary::HashBytecode(const void* data, size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	unsigned long long hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+std::shared_ptr<const ShaderBytecode> ShaderLibrary::GetBytecode(const std::wstring& path)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	stats.requests++;
+
+	bool cacheHit = false;
+	std::shared_ptr<const ShaderBytecode> code = LoadBytecode(lock, path, &cacheHit);
+	if (cacheHit) stats.cacheHits++;
+	return code;
+}
+
+VertexShaderPtr ShaderLibrary::GetVertexShader(const std::wstring& path)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	stats.requests++;
+
+	bool cacheHit = false;
+	std::shared_ptr<const ShaderBytecode> code = LoadBytecode(lock, path, &cacheHit);
+	if (!code)
+		return VertexShaderPtr();
+
+	auto cached = vertexShaders.find(code->hash);
+	if (cached != vertexShaders.end() && cached->second)
+	{
+		stats.cacheHits++;
+		return cached->second;
+	}
+
+	// Device creation is free-threaded, so other loads carry on meanwhile
+	lock.unlock();
+	VertexShaderPtr shader;
+	{
+		PROFILE_SCOPE("Create Vertex Shader");
+		Graphics::Device->CreateVertexShader(code->bytes, code->size, 0, shader.GetAddressOf());
+	}
+	lock.lock();
+
+	// Whoever finished first wins, so everyone shares one object
+	VertexShaderPtr& cachedShader = vertexShaders[code->hash];
+	if (!cachedShader)
+	{
+		cachedShader = shader;
+		stats.shadersCreated++;
+	}
+	return cachedShader;
+}
+
+PixelShaderPtr ShaderLibrary::GetPixelShader(const std::wstring& path)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	stats.requests++;
+
+	bool cacheHit = false;
+	std::shared_ptr<const ShaderBytecode> code = LoadBytecode(lock, path, &cacheHit);
+	if (!code)
+		return PixelShaderPtr();
+
+	auto cached = pixelShaders.find(code->hash);
+	if (cached != pixelShaders.end() && cached->second)
+	{
+		stats.cacheHits++;
+		return cached->second;
+	}
+
+	// Device creation is free-threaded, so other loads carry on meanwhile
+	lock.unlock();
+	PixelShaderPtr shader;
+	{
+		PROFILE_SCOPE("Create Pixel Shader");
+		Graphics::Device->CreatePixelShader(code->bytes, code->size, 0, shader.GetAddressOf());
+	}
+	lock.lock();
+
+	// Whoever finished first wins, so everyone shares one object
+	PixelShaderPtr& cachedShader = pixelShaders[code->hash];
+	if (!cachedShader)
+	{
+		cachedShader = shader;
+		stats.shadersCreated++;
+	}
+	return cachedShader;
+}
+
+// The layout of our Vertex struct for the given vertex shader
+InputLayoutPtr ShaderLibrary::GetInputLayout(const std::wstring& vertexShaderPath)
+{
+	unsigned int count = 0;
+	const D3D11_INPUT_ELEMENT_DESC* elements = InputLayoutCache::GetVertexElements(&count);
+	return GetInputLayout(vertexShaderPath, elements, count);
+}
+
+InputLayoutPtr ShaderLibrary::GetInputLayout(const std::wstring& vertexShaderPath, const D3D11_INPUT_ELEMENT_DESC* elements, unsigned int count)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	stats.requests++;
+
+	bool cacheHit = false;
+	std::shared_ptr<const ShaderBytecode> code = LoadBytecode(lock, vertexShaderPath, &cacheHit);
+	if (!code)
+		return InputLayoutPtr();
+
+	InputLayoutPtr inputLayout = inputLayouts.Get(elements, count, code->bytes, code->size, &cacheHit);
+	if (cacheHit)
+		stats.cacheHits++;
+	else
+		stats.inputLayoutsCreated++;
+	return inputLayout;
+}
+
+std::shared_ptr<const ConstantBufferLayout> ShaderLibrary::GetConstantBufferLayout(const std::wstring& path, const std::string& cbufferName, unsigned int* slot)
+{
+	return GetLayout(path, cbufferName, LayoutPacking::ConstantBuffer, slot);
+}
+
+std::shared_ptr<const ConstantBufferLayout> ShaderLibrary::GetStructuredBufferLayout(const std::wstring& path, const std::string& bufferName, unsigned int* slot)
+{
+	return GetLayout(path, bufferName, LayoutPacking::Structured, slot);
+}
+
+bool ShaderLibrary::CompileFromFile(const ShaderSource& source, std::vector<unsigned char>& bytecode, std::string& errors)
+{
+	UINT flags = D3DCOMPILE_ENABLE_STRICTNESS;
+#if defined(DEBUG) || defined(_DEBUG)
+	flags |= D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+
+	Microsoft::WRL::ComPtr<ID3DBlob> code;
+	Microsoft::WRL::ComPtr<ID3DBlob> messages;
+	HRESULT result = D3DCompileFromFile(
+		NarrowToWide(source.sourcePath).c_str(),
+		0,
+		D3D_COMPILE_STANDARD_FILE_INCLUDE,
+		source.entryPoint.c_str(),
+		source.target.c_str(),
+		flags,
+		0,
+		code.GetAddressOf(),
+		messages.GetAddressOf());
+
+	if (messages)
+		errors.assign(static_cast<const char*>(messages->GetBufferPointer()), messages->GetBufferSize());
+	if (FAILED(result) || !code)
+	{
+		if (errors.empty())
+			errors = "D3DCompileFromFile failed";
+		return false;
+	}
+
+	const unsigned char* data = static_cast<const unsigned char*>(code->GetBufferPointer());
+	bytecode.assign(data, data + code->GetBufferSize());
+	return true;
+}
+
+bool ShaderLibrary::Reload(const std::wstring& path, const std::vector<unsigned char>& data, bool vertexShader)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::shared_ptr<ShaderBytecode> code = std::make_shared<ShaderBytecode>();
+	code->path = path;
+	code->data = data;
+	code->bytes = code->data.data();
+	code->size = code->data.size();
+	code->hash = HashBytecode(data.data(), data.size());
+
+	// Create (or find) the new objects before anything switches over
+	if (vertexShader)
+	{
+		VertexShaderPtr& shader = vertexShaders[code->hash];
+		if (!shader && FAILED(Graphics::Device->CreateVertexShader(data.data(), data.size(), 0, shader.GetAddressOf())))
+		{
+			vertexShaders.erase(code->hash);
+			return false;
+		}
+
+		unsigned int count = 0;
+		const D3D11_INPUT_ELEMENT_DESC* elements = InputLayoutCache::GetVertexElements(&count);
+		if (!inputLayouts.Get(elements, count, data.data(), data.size()))
+			return false;
+	}
+	else
+	{
+		PixelShaderPtr& shader = pixelShaders[code->hash];
+		if (!shader && FAILED(Graphics::Device->CreatePixelShader(data.data(), data.size(), 0, shader.GetAddressOf())))
+		{
+			pixelShaders.erase(code->hash);
+			return false;
+		}
+	}
+
+	// The old shader goes once no other path shares its code;
+	// pipeline states still built on it hold their own reference
+	// until PipelineStateCache::ReleaseUnused()
+	std::shared_ptr<const ShaderBytecode>& cachedCode = bytecode[path];
+	unsigned long long oldHash = cachedCode ? cachedCode->hash : code->hash;
+	cachedCode = code;
+	if (oldHash != code->hash)
+	{
+		bool shared = false;
+		for (const auto& entry : bytecode)
+			shared |= entry.second && entry.second->hash == oldHash;
+		if (!shared && vertexShader)
+			vertexShaders.erase(oldHash);
+		else if (!shared)
+			pixelShaders.erase(oldHash);
+	}
+	stats.reloads++;
+	return true;
+}
+
+ShaderLibraryStats ShaderLibrary::GetStats()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+bool ShaderLibrary::OpenArchive(const std::wstring& path)
+{
+	PROFILE_SCOPE("Open Shader Archive");
+	std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+	bool opened = file->Open(FixPath(path));
+
+	std::lock_guard<std::mutex> lock(mutex);
+	archive.Close();
+	archiveFile.reset();
+	if (!opened || !archive.Open(file->GetData(), file->GetSize()))
+		return false;
+
+	// Bytecode already loaded from it holds its own reference
+	std::error_code error;
+	archiveFile = file;
+	archiveWriteTime = std::filesystem::last_write_time(std::filesystem::path(FixPath(path)), error);
+	return true;
+}
+
+size_t ShaderLibrary::GetArchiveShaderCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return archive.GetEntryCount();
+}
+
+size_t ShaderLibrary::GetShaderCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return vertexShaders.size() + pixelShaders.size();
+}
+
+void ShaderLibrary::Clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	bytecode.clear();
+	vertexShaders.clear();
+	pixelShaders.clear();
+	inputLayouts.Clear();
+	constantBufferLayouts.clear();
+	archive.Close();
+	archiveFile.reset();
+}
+
+// Expects the lock to be held, but lets go of it while reading
+std::shared_ptr<const ShaderBytecode> ShaderLibrary::LoadBytecode(std::unique_lock<std::mutex>& lock, const std::wstring& path, bool* cacheHit)
+{
+	auto cached = bytecode.find(path);
+	if (cached != bytecode.end())
+	{
+		*cacheHit = true;
+		return cached->second;
+	}
+
+	*cacheHit = false;
+	ShaderArchiveEntry entry;
+	if (archive.IsOpen() && archive.Find(std::filesystem::path(path).filename().string(), &entry))
+	{
+		// A .cso written after the archive was built (say, a shader
+		// rebuilt on its own) holds newer code than the archive's copy
+		std::error_code error;
+		std::filesystem::file_time_type looseWriteTime = std::filesystem::last_write_time(std::filesystem::path(FixPath(path)), error);
+		if (error || looseWriteTime <= archiveWriteTime)
+		{
+			std::shared_ptr<ShaderBytecode> code = std::make_shared<ShaderBytecode>();
+			code->path = path;
+			code->bytes = entry.data;
+			code->size = entry.size;
+			code->hash = HashBytecode(entry.data, entry.size);
+			code->archive = archiveFile;
+			bytecode[path] = code;
+			stats.archiveLoads++;
+			return code;
+		}
+		stats.archiveStale++;
+	}
+
+	// Reads can be slow, so other requests carry on meanwhile
+	lock.unlock();
+	std::shared_ptr<ShaderBytecode> code = ReadBytecodeFile(path);
+	lock.lock();
+	if (!code)
+		return 0;
+
+	// Another thread may have read it in the meantime
+	std::shared_ptr<const ShaderBytecode>& cachedCode = bytecode[path];
+	if (!cachedCode)
+	{
+		cachedCode = code;
+		stats.filesRead++;
+		stats.bytesRead += code->size;
+	}
+	return cachedCode;
+}
+
+std::shared_ptr<const ConstantBufferLayout> ShaderLibrary::GetLayout(const std::wstring& path, const std::string& name, LayoutPacking packing, unsigned int* slot)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	stats.requests++;
+
+	bool cacheHit = false;
+	std::shared_ptr<const ShaderBytecode> code = LoadBytecode(lock, path, &cacheHit);
+	if (!code)
+		return 0;
+
+	// Keyed by the code, so a reloaded shader is reflected again.  A
+	// cbuffer and a StructuredBuffer can't share a name in one shader.
+	std::pair<unsigned long long, std::string> key(code->hash, name);
+	auto cached = constantBufferLayouts.find(key);
+	if (cached != constantBufferLayouts.end())
+	{
+		stats.cacheHits++;
+		*slot = cached->second.slot;
+		return cached->second.layout;
+	}
+
+	PROFILE_SCOPE("Reflect Shader");
+	ReflectedLayout reflected = packing == LayoutPacking::Structured ?
+		ReflectStructuredBuffer(*code, name) :
+		ReflectConstantBuffer(*code, name);
+	constantBufferLayouts[key] = reflected;
+	stats.layoutsReflected++;
+	*slot = reflected.slot;
+	return reflected.layout;
+}
+
+ShaderLibrary::ReflectedLayout ShaderLibrary::ReflectConstantBuffer(const ShaderBytecode& code, const std::string& cbufferName)
+{
+	ReflectedLayout reflected = {};
+	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> reflection;
+	if (FAILED(D3DReflect(code.bytes, code.size, __uuidof(ID3D11ShaderReflection), (void**)reflection.GetAddressOf())))
+		return reflected;
+
+	// The compiler strips cbuffers nothing reads, so a missing one is normal
+	D3D11_SHADER_INPUT_BIND_DESC bindDesc = {};
+	if (FAILED(reflection->GetResourceBindingDescByName(cbufferName.c_str(), &bindDesc)) || bindDesc.Type != D3D_SIT_CBUFFER)
+		return reflected;
+
+	ID3D11ShaderReflectionConstantBuffer* constantBuffer = reflection->GetConstantBufferByName(cbufferName.c_str());
+	D3D11_SHADER_BUFFER_DESC bufferDesc = {};
+	if (FAILED(constantBuffer->GetDesc(&bufferDesc)))
+		return reflected;
+
+	std::shared_ptr<ConstantBufferLayout> layout = std::make_shared<ConstantBufferLayout>(cbufferName);
+	for (UINT i = 0; i < bufferDesc.Variables; i++)
+	{
+		ID3D11ShaderReflectionVariable* variable = constantBuffer->GetVariableByIndex(i);
+		D3D11_SHADER_VARIABLE_DESC variableDesc = {};
+		D3D11_SHADER_TYPE_DESC typeDesc = {};
+		variable->GetDesc(&variableDesc);
+		variable->GetType()->GetDesc(&typeDesc);
+
+		ShaderParameterDesc desc = {};
+		if (!ToParameterDesc(variableDesc.Name, typeDesc, &desc))
+			return reflected;
+
+		// Our packing has to agree with the compiler's, or the
+		// bytes we upload would land in the wrong places
+		if (layout->Add(desc) != variableDesc.StartOffset)
+			return reflected;
+	}
+	if (layout->GetSize() != bufferDesc.Size)
+		return reflected;
+
+	reflected.layout = layout;
+	reflected.slot = bindDesc.BindPoint;
+	return reflected;
+}
+
+// --------------------------------------------------------
+// Reflection describes a StructuredBuffer as a buffer holding
+// a single "$Element" variable, whose type is the element -
+// usually a struct, whose members become the parameters
+// --------------------------------------------------------
+ShaderLibrary::ReflectedLayout ShaderLibrary::ReflectStructuredBuffer(const ShaderBytecode& code, const std::string& bufferName)
+{
+	ReflectedLayout reflected = {};
+	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> reflection;
+	if (FAILED(D3DReflect(code.bytes, code.size, __uuidof(ID3D11ShaderReflection), (void**)reflection.GetAddressOf())))
+		return reflected;
+
+	D3D11_SHADER_INPUT_BIND_DESC bindDesc = {};
+	if (FAILED(reflection->GetResourceBindingDescByName(bufferName.c_str(), &bindDesc)) || bindDesc.Type != D3D_SIT_STRUCTURED)
+		return reflected;
+
+	ID3D11ShaderReflectionConstantBuffer* elementBuffer = reflection->GetConstantBufferByName(bufferName.c_str());
+	D3D11_SHADER_BUFFER_DESC bufferDesc = {};
+	if (FAILED(elementBuffer->GetDesc(&bufferDesc)) || bufferDesc.Variables != 1)
+		return reflected;
+
+	ID3D11ShaderReflectionType* elementType = elementBuffer->GetVariableByIndex(0)->GetType();
+	D3D11_SHADER_TYPE_DESC elementDesc = {};
+	elementType->GetDesc(&elementDesc);
+
+	std::shared_ptr<ConstantBufferLayout> layout = std::make_shared<ConstantBufferLayout>(bufferName, LayoutPacking::Structured);
+	if (elementDesc.Class == D3D_SVC_STRUCT)
+	{
+		for (UINT i = 0; i < elementDesc.Members; i++)
+		{
+			D3D11_SHADER_TYPE_DESC memberDesc = {};
+			elementType->GetMemberTypeByIndex(i)->GetDesc(&memberDesc);
+
+			ShaderParameterDesc desc = {};
+			if (!ToParameterDesc(elementType->GetMemberTypeName(i), memberDesc, &desc) || layout->Add(desc) != memberDesc.Offset)
+				return reflected;
+		}
+	}
+	else
+	{
+		// A buffer of plain values is one parameter named after it
+		ShaderParameterDesc desc = {};
+		if (!ToParameterDesc(bufferName.c_str(), elementDesc, &desc))
+			return reflected;
+		layout->Add(desc);
+	}
+	if (layout->GetSize() != bufferDesc.Size)
+		return reflected;
+
+	reflected.layout = layout;
+	reflected.slot = bindDesc.BindPoint;
+	return reflected;
+}
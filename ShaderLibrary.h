@@ -0,0 +1,123 @@
+#pragma once
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "TypeDefs.h"
+#include "ConstantBufferLayout.h"
+#include "InputLayoutCache.h"
+#include "MappedFile.h"
+#include "ShaderArchive.h"
+#include "ShaderReloader.h"
+
+// Compiled shader code, read from a .cso file or found in an archive
+struct ShaderBytecode
+{
+	std::wstring path;
+	std::vector<unsigned char> data;		// Empty when the code is in an archive
+	const unsigned char* bytes;				// data, or straight into the mapped archive
+	size_t size;
+	unsigned long long hash;
+	std::shared_ptr<const MappedFile> archive;	// Keeps those bytes mapped
+};
+
+struct ShaderLibraryStats
+{
+	unsigned int requests;
+	unsigned int cacheHits;		// Requests answered without creating anything
+	unsigned int filesRead;
+	unsigned long long bytesRead;
+	unsigned int archiveLoads;	// Bytecode found in the archive instead
+	unsigned int archiveStale;	// Archive copies passed over for a newer .cso
+	unsigned int shadersCreated;
+	unsigned int inputLayoutsCreated;
+	unsigned int layoutsReflected;
+	unsigned int reloads;
+};
+
+// --------------------------------------------------------
+// Loads and creates each shader exactly once
+//
+// - Bytecode is cached by path, so every .cso is read once;
+//    with an archive open, a path whose file name is in the
+//    archive is served from the mapped archive instead, unless
+//    the .cso was written after the archive
+// - Shader objects are cached by a hash of the bytecode, so
+//    identical code under different paths still shares one
+// - Input layouts are shared by every vertex shader with the
+//    same input signature (see InputLayoutCache)
+// - cbuffer and StructuredBuffer element layouts are reflected
+//    from the bytecode once and shared the same way
+// - Everything handed out is reference counted; materials
+//    using the same file share the same D3D objects
+// - Safe to call from any thread.  Files are read and shaders
+//    created outside the lock, so loads on several threads
+//    overlap; two racing for the same one keep the first result
+// --------------------------------------------------------
+class ShaderLibrary
+{
+public:
+	static ShaderLibrary& Global();
+	static unsigned long long HashBytecode(const void* data, size_t size);
+
+	// Maps a file built by ShaderArchiveBuilder; shaders loaded
+	// after this come from it where it has them.  False (and
+	// loose files only) if it's missing or invalid.
+	bool OpenArchive(const std::wstring& path);
+	size_t GetArchiveShaderCount();
+
+	std::shared_ptr<const ShaderBytecode> GetBytecode(const std::wstring& path);
+	VertexShaderPtr GetVertexShader(const std::wstring& path);
+	PixelShaderPtr GetPixelShader(const std::wstring& path);
+	InputLayoutPtr GetInputLayout(const std::wstring& vertexShaderPath);
+	InputLayoutPtr GetInputLayout(const std::wstring& vertexShaderPath, const D3D11_INPUT_ELEMENT_DESC* elements, unsigned int count);
+
+	// The layout of a shader's cbuffer, rebuilt with HLSL packing
+	// rules and checked against reflection.  Null if the shader
+	// has no such cbuffer or it uses something the layout can't
+	// describe.  slot receives the register it is bound to.
+	std::shared_ptr<const ConstantBufferLayout> GetConstantBufferLayout(const std::wstring& path, const std::string& cbufferName, unsigned int* slot);
+
+	// The same for one element of a StructuredBuffer, laid out
+	// with Structured packing; slot receives its t register
+	std::shared_ptr<const ConstantBufferLayout> GetStructuredBufferLayout(const std::wstring& path, const std::string& bufferName, unsigned int* slot);
+
+	// Compiles HLSL with D3DCompileFromFile - a ShaderReloader compile function
+	static bool CompileFromFile(const ShaderSource& source, std::vector<unsigned char>& bytecode, std::string& errors);
+
+	// Serves new bytecode for a path from now on, as long as its
+	// shader (and input layout, for vertex shaders) can be created
+	bool Reload(const std::wstring& path, const std::vector<unsigned char>& data, bool vertexShader);
+
+	ShaderLibraryStats GetStats();
+	size_t GetShaderCount();
+
+	// Releases every cached object - call before the device goes away
+	void Clear();
+
+private:
+	std::mutex mutex;
+	std::unordered_map<std::wstring, std::shared_ptr<const ShaderBytecode>> bytecode;
+	std::unordered_map<unsigned long long, VertexShaderPtr> vertexShaders;
+	std::unordered_map<unsigned long long, PixelShaderPtr> pixelShaders;
+	InputLayoutCache inputLayouts;
+	std::shared_ptr<const MappedFile> archiveFile;
+	ShaderArchiveReader archive;
+	std::filesystem::file_time_type archiveWriteTime;
+
+	struct ReflectedLayout
+	{
+		std::shared_ptr<const ConstantBufferLayout> layout;
+		unsigned int slot;
+	};
+	std::map<std::pair<unsigned long long, std::string>, ReflectedLayout> constantBufferLayouts;
+	ShaderLibraryStats stats = {};
+
+	std::shared_ptr<const ShaderBytecode> LoadBytecode(std::unique_lock<std::mutex>& lock, const std::wstring& path, bool* cacheHit);
+	std::shared_ptr<const ConstantBufferLayout> GetLayout(const std::wstring& path, const std::string& name, LayoutPacking packing, unsigned int* slot);
+	static ReflectedLayout ReflectConstantBuffer(const ShaderBytecode& code, const std::string& cbufferName);
+	static ReflectedLayout ReflectStructuredBuffer(const ShaderBytecode& code, const std::string& bufferName);
+};
@@ -0,0 +1,229 @@
+#include "ShaderReloader.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+ShaderReloader::ShaderReloader(ShaderCompileFunction compile, FileTimeFunction fileTime) :
+	compile(compile),
+	fileTime(fileTime ? fileTime : FileTimeFunction(GetFileWriteTime)),
+	compiling(false),
+	stopping(false),
+	reloadCount(0),
+	failureCount(0)
+{
+	worker = std::thread(&ShaderReloader::CompileLoop, this);
+}
+
+ShaderReloader::~ShaderReloader()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		requests.clear();
+	}
+	wake.notify_all();
+	worker.join();
+}
+
+bool ShaderReloader::GetFileWriteTime(const std::string& path, long long* writeTime)
+{
+	std::error_code error;
+	std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+	if (error)
+		return false;
+
+	*writeTime = (long long)time.time_since_epoch().count();
+	return true;
+}
+
+std::vector<std::string> ShaderReloader::FindIncludes(const std::string& sourcePath)
+{
+	std::string source = std::filesystem::path(sourcePath).lexically_normal().string();
+	std::vector<std::string> includes;
+	std::vector<std::string> pending(1, source);
+	while (!pending.empty())
+	{
+		std::filesystem::path path(pending.back());
+		pending.pop_back();
+
+		std::ifstream file(path);
+		std::string line;
+		while (std::getline(file, line))
+		{
+			size_t start = line.find_first_not_of(" \t");
+			if (start == std::string::npos || line.compare(start, 8, "#include") != 0)
+				continue;
+			size_t open = line.find('"', start + 8);
+			size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+			if (close == std::string::npos)
+				continue;
+
+			// Each file once, even if several include it (or it includes itself)
+			std::string include = (path.parent_path() / line.substr(open + 1, close - open - 1)).lexically_normal().string();
+			if (include == source || std::find(includes.begin(), includes.end(), include) != includes.end())
+				continue;
+			includes.push_back(include);
+			pending.push_back(include);
+		}
+	}
+	return includes;
+}
+
+size_t ShaderReloader::Watch(const ShaderSource& source)
+{
+	WatchedSource watched = {};
+	watched.source = source;
+	watched.exists = ReadWriteTimes(source, watched.writeTimes);
+	sources.push_back(watched);
+	return sources.size() - 1;
+}
+
+bool ShaderReloader::ReadWriteTimes(const ShaderSource& source, std::vector<long long>& writeTimes)
+{
+	writeTimes.assign(1 + source.includePaths.size(), 0);
+	if (!fileTime(source.sourcePath, &writeTimes[0]))
+		return false;
+	for (size_t i = 0; i < source.includePaths.size(); i++)
+	{
+		if (!fileTime(source.includePaths[i], &writeTimes[i + 1]))
+			return false;
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Queues a compile for every source whose write time, or
+// that of anything it includes, moved since the last poll;
+// returns how many were queued
+// --------------------------------------------------------
+size_t ShaderReloader::Poll()
+{
+	size_t queued = 0;
+	std::vector<long long> writeTimes;
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		// Editors that save by replacing the file briefly delete
+		// it; wait for it to come back rather than failing
+		if (!ReadWriteTimes(sources[i].source, writeTimes))
+		{
+			sources[i].exists = false;
+			continue;
+		}
+
+		if (sources[i].exists && writeTimes == sources[i].writeTimes)
+			continue;
+
+		sources[i].exists = true;
+		sources[i].writeTimes.swap(writeTimes);
+		Recompile(i);
+		queued++;
+	}
+	return queued;
+}
+
+void ShaderReloader::Recompile(size_t sourceIndex)
+{
+	WatchedSource& watched = sources[sourceIndex];
+	CompileRequest request = { sourceIndex, ++watched.generation, watched.source };
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		// A newer request makes any queued one for this file pointless
+		for (auto i = requests.begin(); i != requests.end(); )
+		{
+			if (i->sourceIndex == sourceIndex)
+				i = requests.erase(i);
+			else
+				++i;
+		}
+		requests.push_back(request);
+	}
+	wake.notify_one();
+}
+
+// --------------------------------------------------------
+// Passes each finished compile to swap, skipping any that a
+// newer edit has already superseded; returns swaps made
+// --------------------------------------------------------
+size_t ShaderReloader::ApplyCompleted(const ShaderSwapFunction& swap)
+{
+	std::vector<CompileResult> finished;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		finished.swap(results);
+	}
+
+	size_t swapped = 0;
+	for (CompileResult& result : finished)
+	{
+		WatchedSource& watched = sources[result.sourceIndex];
+		if (result.generation != watched.generation || result.generation <= watched.appliedGeneration)
+			continue;
+
+		if (!result.succeeded)
+		{
+			failureCount++;
+			lastError = watched.source.sourcePath + ":\n" + result.errors;
+			continue;
+		}
+
+		if (!swap(watched.source, result.bytecode))
+		{
+			failureCount++;
+			lastError = watched.source.sourcePath + ": compiled, but the new shader was rejected";
+			continue;
+		}
+
+		watched.appliedGeneration = result.generation;
+		reloadCount++;
+		swapped++;
+		lastError.clear();
+	}
+	return swapped;
+}
+
+void ShaderReloader::WaitForCompiles()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	idle.wait(lock, [this]() { return requests.empty() && !compiling; });
+}
+
+size_t ShaderReloader::GetSourceCount() const { return sources.size(); }
+const ShaderSource& ShaderReloader::GetSource(size_t sourceIndex) const { return sources[sourceIndex].source; }
+unsigned int ShaderReloader::GetReloadCount() const { return reloadCount; }
+unsigned int ShaderReloader::GetFailureCount() const { return failureCount; }
+std::string ShaderReloader::GetLastError() const { return lastError; }
+
+bool ShaderReloader::IsCompiling()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return compiling || !requests.empty();
+}
+
+void ShaderReloader::CompileLoop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		wake.wait(lock, [this]() { return stopping || !requests.empty(); });
+		if (stopping)
+			return;
+
+		CompileRequest request = requests.front();
+		requests.pop_front();
+		compiling = true;
+
+		// The compiler runs unlocked so new edits can still queue
+		lock.unlock();
+		CompileResult result;
+		result.sourceIndex = request.sourceIndex;
+		result.generation = request.generation;
+		result.succeeded = compile(request.source, result.bytecode, result.errors);
+		lock.lock();
+
+		results.push_back(std::move(result));
+		compiling = false;
+		if (requests.empty())
+			idle.notify_all();
+	}
+}
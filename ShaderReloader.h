@@ -0,0 +1,117 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One shader source file being watched
+struct ShaderSource
+{
+	std::string sourcePath;		// The .hlsl file
+	std::string entryPoint;
+	std::string target;			// e.g. "vs_5_0", "ps_5_0"
+	std::wstring shaderKey;		// What the shader is loaded as, e.g. L"CustomPS.cso"
+	std::vector<std::string> includePaths;	// Files it #includes; a change to any recompiles it too
+};
+
+// Compiles a source, filling in bytecode or error text
+typedef std::function<bool(const ShaderSource& source, std::vector<unsigned char>& bytecode, std::string& errors)> ShaderCompileFunction;
+
+// Reports a file's last write time, or false if it can't be read
+typedef std::function<bool(const std::string& path, long long* writeTime)> FileTimeFunction;
+
+// Swaps freshly compiled bytecode in; false if it was rejected
+typedef std::function<bool(const ShaderSource& source, const std::vector<unsigned char>& bytecode)> ShaderSwapFunction;
+
+// --------------------------------------------------------
+// Watches shader sources and recompiles them when they change
+//
+// - Poll() compares write times and queues changed files,
+//    along with every file that includes one of them
+// - Compiles run one at a time on a background thread, so a
+//    slow compile never stalls a frame
+// - ApplyCompleted() hands finished bytecode to the caller on
+//    its own thread, so swaps happen between frames; failed
+//    compiles just record their errors and the old shader stays
+// - Only the newest compile of each file is ever applied
+// - The compiler and file clock are injected, so none of this
+//    depends on D3D or the platform
+// --------------------------------------------------------
+class ShaderReloader
+{
+public:
+	ShaderReloader(ShaderCompileFunction compile, FileTimeFunction fileTime = FileTimeFunction());
+	~ShaderReloader();
+	ShaderReloader(const ShaderReloader&) = delete;
+	ShaderReloader& operator=(const ShaderReloader&) = delete;
+
+	static bool GetFileWriteTime(const std::string& path, long long* writeTime);
+
+	// Every file a source pulls in with #include "...", however
+	// deeply, resolved relative to the file including it
+	static std::vector<std::string> FindIncludes(const std::string& sourcePath);
+
+	size_t Watch(const ShaderSource& source);
+	size_t Poll();
+	void Recompile(size_t sourceIndex);
+	size_t ApplyCompleted(const ShaderSwapFunction& swap);
+
+	// Blocks until every queued compile has finished
+	void WaitForCompiles();
+
+	size_t GetSourceCount() const;
+	const ShaderSource& GetSource(size_t sourceIndex) const;
+	unsigned int GetReloadCount() const;
+	unsigned int GetFailureCount() const;
+	std::string GetLastError() const;
+	bool IsCompiling();
+
+private:
+	struct WatchedSource
+	{
+		ShaderSource source;
+		std::vector<long long> writeTimes;		// The source's, then each include's
+		bool exists;							// False while any of them is missing
+		unsigned int generation;		// Bumped every time a compile is queued
+		unsigned int appliedGeneration;
+	};
+
+	struct CompileRequest
+	{
+		size_t sourceIndex;
+		unsigned int generation;
+		ShaderSource source;
+	};
+
+	struct CompileResult
+	{
+		size_t sourceIndex;
+		unsigned int generation;
+		bool succeeded;
+		std::vector<unsigned char> bytecode;
+		std::string errors;
+	};
+
+	ShaderCompileFunction compile;
+	FileTimeFunction fileTime;
+	std::vector<WatchedSource> sources;		// Only touched by the owning thread
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable idle;
+	std::deque<CompileRequest> requests;
+	std::vector<CompileResult> results;
+	bool compiling;
+	bool stopping;
+	std::thread worker;
+
+	unsigned int reloadCount;
+	unsigned int failureCount;
+	std::string lastError;
+
+	bool ReadWriteTimes(const ShaderSource& source, std::vector<long long>& writeTimes);
+	void CompileLoop();
+};
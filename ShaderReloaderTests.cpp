@@ -0,0 +1,298 @@
+#include "ShaderReloader.h"
+#include "TestHarness.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+
+namespace
+{
+	// --------------------------------------------------------
+	// Stands in for the file system and the shader compiler:
+	// each file's "contents" is just its write time, and odd
+	// times compile to a one byte shader holding that time
+	// while even times fail to compile
+	// --------------------------------------------------------
+	struct StubShaderTools
+	{
+		std::mutex mutex;
+		std::map<std::string, long long> writeTimes;
+		std::atomic<int> compileCount{ 0 };
+
+		void Touch(const std::string& path, long long writeTime)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			writeTimes[path] = writeTime;
+		}
+
+		void Delete(const std::string& path)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			writeTimes.erase(path);
+		}
+
+		bool FileTime(const std::string& path, long long* writeTime)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			std::map<std::string, long long>::iterator file = writeTimes.find(path);
+			if (file == writeTimes.end())
+				return false;
+			*writeTime = file->second;
+			return true;
+		}
+
+		bool Compile(const ShaderSource& source, std::vector<unsigned char>& bytecode, std::string& errors)
+		{
+			compileCount++;
+			long long writeTime = 0;
+			if (!FileTime(source.sourcePath, &writeTime) || writeTime % 2 == 0)
+			{
+				errors = "error X3000: syntax error";
+				return false;
+			}
+			bytecode.assign(1, (unsigned char)writeTime);
+			return true;
+		}
+	};
+
+	std::unique_ptr<ShaderReloader> MakeReloader(StubShaderTools& tools)
+	{
+		return std::unique_ptr<ShaderReloader>(new ShaderReloader(
+			[&tools](const ShaderSource& source, std::vector<unsigned char>& bytecode, std::string& errors) { return tools.Compile(source, bytecode, errors); },
+			[&tools](const std::string& path, long long* writeTime) { return tools.FileTime(path, writeTime); }));
+	}
+
+	const ShaderSource PixelShader = { "PixelShader.hlsl", "main", "ps_5_0", L"PixelShader.cso", {} };
+	const ShaderSource VertexShader = { "VertexShader.hlsl", "main", "vs_5_0", L"VertexShader.cso", {} };
+}
+
+TEST_CASE(UnchangedFilesAreNotRecompiled)
+{
+	StubShaderTools tools;
+	tools.Touch(PixelShader.sourcePath, 1);
+	std::unique_ptr<ShaderReloader> reloader = MakeReloader(tools);
+	CHECK(reloader->Watch(PixelShader) == 0);
+	CHECK(reloader->GetSourceCount() == 1);
+	CHECK(reloader->GetSource(0).shaderKey == PixelShader.shaderKey);
+
+	CHECK(reloader->Poll() == 0);
+	CHECK(reloader->Poll() == 0);
+	reloader->WaitForCompiles();
+	CHECK(tools.compileCount == 0);
+}
+
+TEST_CASE(ChangedFileIsCompiledAndSwappedIn)
+{
+	StubShaderTools tools;
+	tools.Touch(PixelShader.sourcePath, 1);
+	tools.Touch(VertexShader.sourcePath, 1);
+	std::unique_ptr<ShaderReloader> reloader = MakeReloader(tools);
+	reloader->Watch(PixelShader);
+	reloader->Watch(VertexShader);
+
+	tools.Touch(VertexShader.sourcePath, 3);
+	CHECK(reloader->Poll() == 1);
+	reloader->WaitForCompiles();
+	CHECK(!reloader->IsCompiling());
+
+	std::vector<std::wstring> swappedKeys;
+	std::vector<unsigned char> swappedBytecode;
+	size_t swapped = reloader->ApplyCompleted([&](const ShaderSource& source, const std::vector<unsigned char>& bytecode)
+		{
+			swappedKeys.push_back(source.shaderKey);
+			swappedBytecode = bytecode;
+			return true;
+		});
+	CHECK(swapped == 1);
+	REQUIRE(swappedKeys.size() == 1);
+	CHECK(swappedKeys[0] == VertexShader.shaderKey);
+	CHECK(swappedBytecode == std::vector<unsigned char>(1, 3));
+	CHECK(reloader->GetReloadCount() == 1);
+	CHECK(reloader->GetLastError().empty());
+
+	// Nothing is handed over twice
+	CHECK(reloader->ApplyCompleted([](const ShaderSource&, const std::vector<unsigned char>&) { return true; }) == 0);
+}
+
+TEST_CASE(FailedCompileKeepsTheOldShader)
+{
+	StubShaderTools tools;
+	tools.Touch(PixelShader.sourcePath, 1);
+	std::unique_ptr<ShaderReloader> reloader = MakeReloader(tools);
+	reloader->Watch(PixelShader);
+
+	tools.Touch(PixelShader.sourcePath, 2);
+	CHECK(reloader->Poll() == 1);
+	reloader->WaitForCompiles();
+	bool swapCalled = false;
+	CHECK(reloader->ApplyCompleted([&](const ShaderSource&, const std::vector<unsigned char>&) { return swapCalled = true; }) == 0);
+	CHECK(!swapCalled);
+	CHECK(reloader->GetFailureCount() == 1);
+	CHECK(reloader->GetLastError().find("PixelShader.hlsl") != std::string::npos);
+	CHECK(reloader->GetLastError().find("X3000") != std::string::npos);
+
+	// Fixing the file clears the error
+	tools.Touch(PixelShader.sourcePath, 3);
+	reloader->Poll();
+	reloader->WaitForCompiles();
+	CHECK(reloader->ApplyCompleted([](const ShaderSource&, const std::vector<unsigned char>&) { return true; }) == 1);
+	CHECK(reloader->GetLastError().empty());
+}
+
+TEST_CASE(RejectedSwapCountsAsAFailure)
+{
+	StubShaderTools tools;
+	tools.Touch(PixelShader.sourcePath, 1);
+	std::unique_ptr<ShaderReloader> reloader = MakeReloader(tools);
+	reloader->Watch(PixelShader);
+
+	tools.Touch(PixelShader.sourcePath, 3);
+	reloader->Poll();
+	reloader->WaitForCompiles();
+	CHECK(reloader->ApplyCompleted([](const ShaderSource&, const std::vector<unsigned char>&) { return false; }) == 0);
+	CHECK(reloader->GetReloadCount() == 0);
+	CHECK(reloader->GetFailureCount() == 1);
+	CHECK(reloader->GetLastError().find("rejected") != std::string::npos);
+}
+
+TEST_CASE(OnlyTheNewestEditIsApplied)
+{
+	StubShaderTools tools;
+	tools.Touch(PixelShader.sourcePath, 1);
+	std::unique_ptr<ShaderReloader> reloader = MakeReloader(tools);
+	reloader->Watch(PixelShader);
+
+	// Each poll supersedes the compile queued by the last one
+	for (long long writeTime = 3; writeTime <= 25; writeTime += 2)
+	{
+		tools.Touch(PixelShader.sourcePath, writeTime);
+		CHECK(reloader->Poll() == 1);
+	}
+	reloader->WaitForCompiles();
+	CHECK(tools.compileCount <= 12);
+
+	std::vector<unsigned char> applied;
+	CHECK(reloader->ApplyCompleted([&](const ShaderSource&, const std::vector<unsigned char>& bytecode)
+		{
+			applied.insert(applied.end(), bytecode.begin(), bytecode.end());
+			return true;
+		}) == 1);
+	CHECK(applied == std::vector<unsigned char>(1, 25));
+}
+
+TEST_CASE(RecompileIgnoresTheWriteTime)
+{
+	StubShaderTools tools;
+	tools.Touch(PixelShader.sourcePath, 5);
+	std::unique_ptr<ShaderReloader> reloader = MakeReloader(tools);
+	reloader->Watch(PixelShader);
+	reloader->Recompile(0);
+	reloader->WaitForCompiles();
+	CHECK(tools.compileCount == 1);
+	CHECK(reloader->ApplyCompleted([](const ShaderSource&, const std::vector<unsigned char>&) { return true; }) == 1);
+}
+
+TEST_CASE(ReplacedFileIsRecompiledOnceItReturns)
+{
+	// Editors that save by replacing the file briefly delete it
+	StubShaderTools tools;
+	tools.Touch(PixelShader.sourcePath, 1);
+	std::unique_ptr<ShaderReloader> reloader = MakeReloader(tools);
+	reloader->Watch(PixelShader);
+
+	tools.Delete(PixelShader.sourcePath);
+	CHECK(reloader->Poll() == 0);
+	CHECK(reloader->GetFailureCount() == 0);
+
+	// Even with the same write time, it may have new contents
+	tools.Touch(PixelShader.sourcePath, 1);
+	CHECK(reloader->Poll() == 1);
+	reloader->WaitForCompiles();
+	CHECK(reloader->ApplyCompleted([](const ShaderSource&, const std::vector<unsigned char>&) { return true; }) == 1);
+}
+
+TEST_CASE(DestroyingMidCompileDoesNotHang)
+{
+	std::atomic<bool> started(false);
+	{
+		ShaderReloader reloader(
+			[&](const ShaderSource&, std::vector<unsigned char>&, std::string&)
+			{
+				started = true;
+				std::this_thread::sleep_for(std::chrono::milliseconds(20));
+				return true;
+			},
+			[](const std::string&, long long* writeTime) { *writeTime = 0; return true; });
+		reloader.Watch(PixelShader);
+		reloader.Watch(VertexShader);
+		reloader.Recompile(0);
+		reloader.Recompile(1);
+		while (!started)
+			std::this_thread::yield();
+	}
+	CHECK(started);
+}
+
+TEST_CASE(FileWriteTimeComesFromTheFileSystem)
+{
+	const char* path = "ShaderReloaderTests.hlsl";
+	std::ofstream(path) << "float4 main() : SV_TARGET { return 0; }";
+	long long writeTime = 0;
+	CHECK(ShaderReloader::GetFileWriteTime(path, &writeTime));
+	remove(path);
+	CHECK(!ShaderReloader::GetFileWriteTime(path, &writeTime));
+}
+
+TEST_CASE(EditingAnIncludeRecompilesItsIncluders)
+{
+	// DebugNormalsPS.hlsl is PixelShader.hlsl with a define
+	StubShaderTools tools;
+	tools.Touch(PixelShader.sourcePath, 1);
+	tools.Touch("DebugNormalsPS.hlsl", 1);
+	tools.Touch(VertexShader.sourcePath, 1);
+	std::unique_ptr<ShaderReloader> reloader = MakeReloader(tools);
+	ShaderSource debugNormals = { "DebugNormalsPS.hlsl", "main", "ps_5_0", L"DebugNormalsPS.cso", { PixelShader.sourcePath } };
+	reloader->Watch(PixelShader);
+	reloader->Watch(debugNormals);
+	reloader->Watch(VertexShader);
+
+	tools.Touch(PixelShader.sourcePath, 3);
+	CHECK(reloader->Poll() == 2);
+	reloader->WaitForCompiles();
+	std::vector<std::wstring> swapped;
+	reloader->ApplyCompleted([&](const ShaderSource& source, const std::vector<unsigned char>&)
+		{
+			swapped.push_back(source.shaderKey);
+			return true;
+		});
+	REQUIRE(swapped.size() == 2);
+	CHECK(swapped[0] == PixelShader.shaderKey);
+	CHECK(swapped[1] == debugNormals.shaderKey);
+
+	// A missing include waits for it to come back, like the source
+	tools.Delete(PixelShader.sourcePath);
+	CHECK(reloader->Poll() == 0);
+	tools.Touch(PixelShader.sourcePath, 5);
+	CHECK(reloader->Poll() == 2);
+	reloader->WaitForCompiles();
+}
+
+TEST_CASE(IncludesAreFoundThroughEveryLevel)
+{
+	std::ofstream("ShaderReloaderTestsA.hlsl") << "#define DEBUG_NORMALS\n  #include \"ShaderReloaderTestsB.hlsl\"\nfloat4 main() : SV_TARGET { return 0; }\n";
+	std::ofstream("ShaderReloaderTestsB.hlsl") << "// #include \"NotThis.hlsl\"\n#include \"ShaderReloaderTestsC.hlsl\"\n#include \"ShaderReloaderTestsA.hlsl\"\n";
+	std::ofstream("ShaderReloaderTestsC.hlsl") << "#include \"ShaderReloaderTestsB.hlsl\"\n#include <NotQuoted.hlsl>\n";
+
+	// Each file once, and the cycle back to the source ends the search
+	std::vector<std::string> includes = ShaderReloader::FindIncludes("ShaderReloaderTestsA.hlsl");
+	REQUIRE(includes.size() == 2);
+	CHECK(includes[0] == "ShaderReloaderTestsB.hlsl");
+	CHECK(includes[1] == "ShaderReloaderTestsC.hlsl");
+	CHECK(ShaderReloader::FindIncludes("ShaderReloaderTestsMissing.hlsl").empty());
+
+	remove("ShaderReloaderTestsA.hlsl");
+	remove("ShaderReloaderTestsB.hlsl");
+	remove("ShaderReloaderTestsC.hlsl");
+}
@@ -0,0 +1,27 @@
+#include "SpatialPartition.h"
+
+// --------------------------------------------------------
+// Fallback closest-hit cast: gathers every candidate along
+// the ray and lets each hit shorten it for the rest
+// --------------------------------------------------------
+bool SpatialPartition::Raycast(const Ray& ray, float maxDistance,
+	const std::function<float(unsigned int userData, float maxDistance)>& intersect,
+	float* hitDistance, unsigned int* hitUserData) const
+{
+	std::vector<unsigned int> candidates;
+	QueryRay(ray, maxDistance, candidates);
+
+	bool hit = false;
+	for (unsigned int userData : candidates)
+	{
+		float distance = intersect(userData, maxDistance);
+		if (distance >= 0.0f && distance <= maxDistance)
+		{
+			maxDistance = distance;
+			hit = true;
+			if (hitDistance) *hitDistance = distance;
+			if (hitUserData) *hitUserData = userData;
+		}
+	}
+	return hit;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <vector>
+#include <functional>
+#include "Bounds.h"
+
+// --------------------------------------------------------
+// Common interface for anything that can answer spatial 
+// queries about the scene's entities
+//
+// - Proxies are registered with world bounds and an opaque
+//    userData (Game uses Entity::index), and queries report
+//    the userData of everything they find
+// - Implementations may be conservative (e.g. a fattened box),
+//    so callers refine results if they need exact answers
+// --------------------------------------------------------
+class SpatialPartition
+{
+public:
+	static constexpr int NullProxy = -1;
+
+	virtual ~SpatialPartition() {}
+
+	virtual int Insert(const AABB& bounds, unsigned int userData) = 0;
+	virtual void Remove(int proxy) = 0;
+	virtual bool Update(int proxy, const AABB& bounds) = 0;	// True if the structure changed
+	virtual void Clear() = 0;
+
+	// Periodic upkeep after a batch of updates
+	virtual void Optimize() {}
+
+	virtual void QueryFrustum(const Frustum& frustum, std::vector<unsigned int>& results) const = 0;
+	virtual void QueryAABB(const AABB& bounds, std::vector<unsigned int>& results) const = 0;
+	virtual void QuerySphere(const BoundingSphere& sphere, std::vector<unsigned int>& results) const = 0;
+	virtual void QueryRay(const Ray& ray, float maxDistance, std::vector<unsigned int>& results) const = 0;
+
+	// Closest-hit ray cast - intersect() returns the exact hit distance
+	// for a candidate, or a negative value for a miss
+	virtual bool Raycast(const Ray& ray, float maxDistance,
+		const std::function<float(unsigned int userData, float maxDistance)>& intersect,
+		float* hitDistance, unsigned int* hitUserData) const;
+
+	virtual size_t GetProxyCount() const = 0;
+	virtual const char* GetName() const = 0;
+};
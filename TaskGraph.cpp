@@ -0,0 +1,145 @@
+#include "TaskGraph.h"
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+namespace
+{
+	long long Now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+}
+
+TaskGraph::TaskId TaskGraph::Add(const std::string& name, const std::string& category, std::function<bool()> function, const std::vector<TaskId>& dependencies)
+{
+	TaskId id = (TaskId)tasks.size();
+	for (TaskId dependency : dependencies)
+	{
+		if (dependency >= id)
+			return InvalidId;
+	}
+
+	std::unique_ptr<Task> task = std::make_unique<Task>();
+	task->function = std::move(function);
+	task->dependencies = dependencies;
+	task->remaining = (unsigned int)dependencies.size();
+	task->blocked = false;
+	task->timing = { name, category, TaskStatus::Pending, 0.0, 0.0, "" };
+	for (TaskId dependency : dependencies)
+		tasks[dependency]->dependents.push_back(id);
+
+	tasks.push_back(std::move(task));
+	return id;
+}
+
+bool TaskGraph::Run(JobSystem* jobSystem)
+{
+	startNanoseconds = Now();
+	if (jobSystem)
+	{
+		// Only the roots are scheduled here; each finished task
+		// schedules whichever dependents it was the last thing holding up
+		JobCounter counter;
+		for (TaskId id = 0; id < tasks.size(); id++)
+		{
+			if (tasks[id]->dependencies.empty())
+				jobSystem->Run([this, id, jobSystem, &counter]() { Execute(id, jobSystem, &counter); }, &counter);
+		}
+		jobSystem->Wait(&counter);
+	}
+	else
+	{
+		for (TaskId id = 0; id < tasks.size(); id++)
+			Execute(id, 0, 0);
+	}
+	wallMilliseconds = (Now() - startNanoseconds) / 1000000.0;
+
+	for (const std::unique_ptr<Task>& task : tasks)
+	{
+		if (task->timing.status != TaskStatus::Succeeded)
+			return false;
+	}
+	return true;
+}
+
+void TaskGraph::Execute(TaskId id, JobSystem* jobSystem, JobCounter* counter)
+{
+	Task& task = *tasks[id];
+	long long start = Now();
+	if (task.blocked)
+	{
+		task.timing.status = TaskStatus::Skipped;
+	}
+	else
+	{
+		// Thrown on a worker, it would take the whole process down
+		bool succeeded = false;
+		try
+		{
+			succeeded = task.function();
+		}
+		catch (const std::exception& exception)
+		{
+			task.timing.error = exception.what();
+		}
+		catch (...)
+		{
+			task.timing.error = "Unknown exception";
+		}
+		task.timing.status = succeeded ? TaskStatus::Succeeded : TaskStatus::Failed;
+	}
+	long long end = Now();
+	task.timing.startMilliseconds = (start - startNanoseconds) / 1000000.0;
+	task.timing.durationMilliseconds = task.timing.status == TaskStatus::Skipped ? 0.0 : (end - start) / 1000000.0;
+
+	bool succeeded = task.timing.status == TaskStatus::Succeeded;
+	for (TaskId dependentId : task.dependents)
+	{
+		Task& dependent = *tasks[dependentId];
+		if (!succeeded)
+			dependent.blocked = true;
+
+		// Still run when blocked, just to be marked skipped and
+		// pass that along to its own dependents
+		if (--dependent.remaining == 0 && jobSystem)
+			jobSystem->Run([this, dependentId, jobSystem, counter]() { Execute(dependentId, jobSystem, counter); }, counter);
+	}
+}
+
+size_t TaskGraph::GetTaskCount() const { return tasks.size(); }
+const TaskTiming& TaskGraph::GetTiming(TaskId id) const { return tasks[id]->timing; }
+double TaskGraph::GetWallMilliseconds() const { return wallMilliseconds; }
+
+std::vector<TaskTiming> TaskGraph::GetTimings() const
+{
+	std::vector<TaskTiming> timings;
+	for (const std::unique_ptr<Task>& task : tasks)
+		timings.push_back(task->timing);
+	return timings;
+}
+
+double TaskGraph::GetTotalTaskMilliseconds() const
+{
+	double total = 0.0;
+	for (const std::unique_ptr<Task>& task : tasks)
+		total += task->timing.durationMilliseconds;
+	return total;
+}
+
+double TaskGraph::GetCriticalPathMilliseconds() const
+{
+	// Dependencies always come first, so one pass in order will do
+	std::vector<double> finish(tasks.size(), 0.0);
+	double longest = 0.0;
+	for (TaskId id = 0; id < tasks.size(); id++)
+	{
+		double start = 0.0;
+		for (TaskId dependency : tasks[id]->dependencies)
+			start = std::max(start, finish[dependency]);
+		finish[id] = start + tasks[id]->timing.durationMilliseconds;
+		longest = std::max(longest, finish[id]);
+	}
+	return longest;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "JobSystem.h"
+
+enum class TaskStatus { Pending, Succeeded, Failed, Skipped };
+
+// When and how long one task ran, relative to the start of Run()
+struct TaskTiming
+{
+	std::string name;
+	std::string category;		// "Shader", "Mesh"... for grouping in reports
+	TaskStatus status;
+	double startMilliseconds;
+	double durationMilliseconds;
+	std::string error;			// What it threw, if it failed by throwing
+};
+
+// --------------------------------------------------------
+// A one-shot graph of tasks run on the job system, each as
+// soon as everything it depends on has finished
+//
+// - A task returns false (or throws) to fail; anything that
+//    depends on it, directly or not, is skipped instead of run
+// - Dependencies must be added before their dependents, so
+//    the graph can't have cycles and adding order is a valid
+//    serial order (used when there's no job system)
+// - Tasks only touch what they're given, so the graph itself
+//    has no idea what it's creating and runs anywhere
+// --------------------------------------------------------
+class TaskGraph
+{
+public:
+	typedef unsigned int TaskId;
+	static const TaskId InvalidId = 0xFFFFFFFF;
+
+	// InvalidId if a dependency hasn't been added yet
+	TaskId Add(const std::string& name, const std::string& category, std::function<bool()> function, const std::vector<TaskId>& dependencies = {});
+
+	// Blocks until every task has run or been skipped.  True if
+	// they all succeeded.  Only call once.
+	bool Run(JobSystem* jobSystem);
+
+	size_t GetTaskCount() const;
+	const TaskTiming& GetTiming(TaskId id) const;
+	std::vector<TaskTiming> GetTimings() const;
+
+	double GetWallMilliseconds() const;
+	double GetTotalTaskMilliseconds() const;	// Summed, as if run serially
+	double GetCriticalPathMilliseconds() const;	// The longest chain of dependencies
+
+private:
+	struct Task
+	{
+		std::function<bool()> function;
+		std::vector<TaskId> dependencies;
+		std::vector<TaskId> dependents;
+		std::atomic<unsigned int> remaining;	// Dependencies yet to finish
+		std::atomic<bool> blocked;				// One of them failed
+		TaskTiming timing;
+	};
+
+	void Execute(TaskId id, JobSystem* jobSystem, JobCounter* counter);
+
+	std::vector<std::unique_ptr<Task>> tasks;
+	long long startNanoseconds = 0;
+	double wallMilliseconds = 0.0;
+};
@@ -0,0 +1,224 @@
+#include "TaskGraph.h"
+#include "TestHarness.h"
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+namespace
+{
+	// Stands in for the ShaderLibrary and device: records what was
+	// created, in what order, and refuses anything asked for too early
+	struct MockDevice
+	{
+		std::mutex mutex;
+		std::map<std::string, int> created;
+		std::vector<std::string> order;
+		bool outOfOrder = false;
+
+		bool Create(const std::string& name, const std::vector<std::string>& needs = {})
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			std::lock_guard<std::mutex> lock(mutex);
+			for (const std::string& need : needs)
+				outOfOrder |= created.count(need) == 0;
+			created[name]++;
+			order.push_back(name);
+			return true;
+		}
+
+		size_t IndexOf(const std::string& name)
+		{
+			for (size_t i = 0; i < order.size(); i++)
+			{
+				if (order[i] == name)
+					return i;
+			}
+			return order.size();
+		}
+	};
+
+	// The same shape as Game::LoadStartupAssets(): read, then create
+	// and build an input layout from the same bytecode
+	TaskGraph::TaskId AddVertexShader(TaskGraph& graph, MockDevice& device, const std::string& name)
+	{
+		TaskGraph::TaskId read = graph.Add(name, "Read Shader", [&device, name]() { return device.Create(name + " bytecode"); });
+		graph.Add(name, "Create Shader", [&device, name]() { return device.Create(name, { name + " bytecode" }); }, { read });
+		graph.Add(name, "Input Layout", [&device, name]() { return device.Create(name + " layout", { name + " bytecode" }); }, { read });
+		return read;
+	}
+
+	unsigned int TestWorkers()
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		return hardwareThreads > 4 ? hardwareThreads - 1 : 3;
+	}
+}
+
+TEST_CASE(EverythingIsCreatedOnceAfterItsInputs)
+{
+	JobSystem jobs(TestWorkers());
+	for (JobSystem* jobSystem : { (JobSystem*)0, &jobs })
+	{
+		MockDevice device;
+		TaskGraph graph;
+		AddVertexShader(graph, device, "VertexShader.cso");
+		AddVertexShader(graph, device, "SkinnedVS.cso");
+		for (const char* mesh : { "sphere.obj", "cube.obj", "torus.obj" })
+			graph.Add(mesh, "Mesh", [&device, mesh]() { return device.Create(mesh); });
+
+		CHECK(graph.GetTaskCount() == 9);
+		REQUIRE(graph.Run(jobSystem));
+		CHECK(!device.outOfOrder);
+		CHECK(device.order.size() == 9);
+		for (const std::pair<const std::string, int>& creation : device.created)
+			CHECK(creation.second == 1);
+
+		for (const TaskTiming& timing : graph.GetTimings())
+		{
+			CHECK(timing.status == TaskStatus::Succeeded);
+			CHECK(timing.error.empty());
+		}
+	}
+}
+
+TEST_CASE(SerialRunsFollowAddingOrder)
+{
+	MockDevice device;
+	TaskGraph graph;
+	AddVertexShader(graph, device, "VertexShader.cso");
+	graph.Add("cube.obj", "Mesh", [&device]() { return device.Create("cube.obj"); });
+	REQUIRE(graph.Run(0));
+
+	const char* expected[] = { "VertexShader.cso bytecode", "VertexShader.cso", "VertexShader.cso layout", "cube.obj" };
+	REQUIRE(device.order.size() == 4);
+	for (size_t i = 0; i < 4; i++)
+		CHECK(device.order[i] == expected[i]);
+}
+
+TEST_CASE(FailuresSkipEverythingDownstream)
+{
+	JobSystem jobs(TestWorkers());
+	for (JobSystem* jobSystem : { (JobSystem*)0, &jobs })
+	{
+		MockDevice device;
+		TaskGraph graph;
+		TaskGraph::TaskId missing = graph.Add("Missing.cso", "Read Shader", []() { return false; });
+		TaskGraph::TaskId create = graph.Add("Missing.cso", "Create Shader", [&device]() { return device.Create("Missing.cso"); }, { missing });
+		TaskGraph::TaskId material = graph.Add("Material", "Material", [&device]() { return device.Create("Material"); }, { create });
+		TaskGraph::TaskId mesh = graph.Add("cube.obj", "Mesh", [&device]() { return device.Create("cube.obj"); });
+		TaskGraph::TaskId row = graph.Add("Row", "Entity", [&device]() { return device.Create("Row", { "cube.obj" }); }, { mesh });
+
+		CHECK(!graph.Run(jobSystem));
+		CHECK(graph.GetTiming(missing).status == TaskStatus::Failed);
+		CHECK(graph.GetTiming(create).status == TaskStatus::Skipped);
+		CHECK(graph.GetTiming(material).status == TaskStatus::Skipped);
+		CHECK(graph.GetTiming(material).durationMilliseconds == 0.0);
+
+		// Unrelated tasks still run
+		CHECK(graph.GetTiming(row).status == TaskStatus::Succeeded);
+		CHECK(device.created.count("Missing.cso") == 0);
+		CHECK(device.created.count("Material") == 0);
+		CHECK(!device.outOfOrder);
+	}
+}
+
+TEST_CASE(ThrownErrorsAreCaughtAndRecorded)
+{
+	JobSystem jobs(TestWorkers());
+	for (JobSystem* jobSystem : { (JobSystem*)0, &jobs })
+	{
+		MockDevice device;
+		TaskGraph graph;
+		TaskGraph::TaskId mesh = graph.Add("missing.obj", "Mesh", []() -> bool { throw std::runtime_error("Could not open file"); });
+		TaskGraph::TaskId odd = graph.Add("odd.obj", "Mesh", []() -> bool { throw 42; });
+		TaskGraph::TaskId row = graph.Add("Row", "Entity", [&device]() { return device.Create("Row"); }, { mesh, odd });
+
+		CHECK(!graph.Run(jobSystem));
+		CHECK(graph.GetTiming(mesh).status == TaskStatus::Failed);
+		CHECK(graph.GetTiming(mesh).error == "Could not open file");
+
+		// Anything else thrown still fails the task rather than the process
+		CHECK(graph.GetTiming(odd).status == TaskStatus::Failed);
+		CHECK(!graph.GetTiming(odd).error.empty());
+		CHECK(graph.GetTiming(row).status == TaskStatus::Skipped);
+		CHECK(device.order.empty());
+	}
+}
+
+TEST_CASE(DependenciesMustAlreadyExist)
+{
+	TaskGraph graph;
+	TaskGraph::TaskId first = graph.Add("a", "Shader", []() { return true; });
+	CHECK(graph.Add("b", "Shader", []() { return true; }, { first + 1 }) == TaskGraph::InvalidId);
+	CHECK(graph.Add("c", "Shader", []() { return true; }, { 99 }) == TaskGraph::InvalidId);
+	CHECK(graph.GetTaskCount() == 1);
+	CHECK(graph.Add("d", "Shader", []() { return true; }, { first }) == 1);
+}
+
+TEST_CASE(TimingsCoverTheCriticalPath)
+{
+	JobSystem jobs(TestWorkers());
+	MockDevice device;
+	TaskGraph graph;
+
+	// A chain of three, alongside four independent tasks
+	TaskGraph::TaskId previous = graph.Add("chain0", "Chain", [&device]() { return device.Create("chain0"); });
+	for (int i = 1; i < 3; i++)
+	{
+		std::string name = "chain" + std::to_string(i);
+		std::string before = "chain" + std::to_string(i - 1);
+		previous = graph.Add(name, "Chain", [&device, name, before]() { return device.Create(name, { before }); }, { previous });
+	}
+	for (int i = 0; i < 4; i++)
+	{
+		std::string name = "wide" + std::to_string(i);
+		graph.Add(name, "Wide", [&device, name]() { return device.Create(name); });
+	}
+
+	REQUIRE(graph.Run(&jobs));
+	CHECK(!device.outOfOrder);
+	CHECK(device.IndexOf("chain0") < device.IndexOf("chain1"));
+	CHECK(device.IndexOf("chain1") < device.IndexOf("chain2"));
+
+	double total = graph.GetTotalTaskMilliseconds();
+	double critical = graph.GetCriticalPathMilliseconds();
+	CHECK(critical > 0.0);
+	CHECK(critical <= total);
+	CHECK(critical >= graph.GetTiming(previous).durationMilliseconds);
+	for (const TaskTiming& timing : graph.GetTimings())
+		CHECK(timing.startMilliseconds >= 0.0 && timing.startMilliseconds <= graph.GetWallMilliseconds());
+}
+
+TEST_CASE(LargeGraphsRunEveryTaskAfterItsDependencies)
+{
+	JobSystem jobs(TestWorkers());
+	TaskGraph graph;
+	const int count = 2000;
+	std::vector<std::atomic<int>> done(count);
+	std::atomic<bool> outOfOrder(false);
+	unsigned int seed = 12345;
+	for (int i = 0; i < count; i++)
+	{
+		std::vector<TaskGraph::TaskId> dependencies;
+		for (int k = 0; k < 3 && i > 0; k++)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			dependencies.push_back((seed >> 8) % i);
+		}
+		graph.Add("Task", "Stress", [&done, &outOfOrder, i, dependencies]()
+			{
+				for (TaskGraph::TaskId dependency : dependencies)
+					outOfOrder = outOfOrder || done[dependency].load() == 0;
+				done[i] = 1;
+				return true;
+			}, dependencies);
+	}
+
+	REQUIRE(graph.Run(&jobs));
+	CHECK(!outOfOrder);
+	int finished = 0;
+	for (std::atomic<int>& task : done)
+		finished += task.load();
+	CHECK(finished == count);
+}
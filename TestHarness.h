@@ -0,0 +1,46 @@
+#pragma once
+#include <cmath>
+#include <vector>
+
+// --------------------------------------------------------
+// Just enough of a unit test framework for the modules with
+// no graphics API code, so their tests build anywhere CMake does
+//
+// - TEST_CASE(name) { ... } registers a test, and TestMain.cpp
+//    runs every test linked into the executable
+// - CHECK records a failure and carries on, REQUIRE also ends
+//    the test (for when the rest would crash)
+// --------------------------------------------------------
+namespace TestHarness
+{
+	struct TestCase
+	{
+		const char* name;
+		void (*function)();
+	};
+
+	// Thrown by REQUIRE to end the current test
+	struct RequireFailed {};
+
+	std::vector<TestCase>& GetTests();
+	void ReportFailure(const char* file, int line, const char* expression);
+
+	struct Registrar
+	{
+		Registrar(const char* name, void (*function)()) { GetTests().push_back({ name, function }); }
+	};
+}
+
+#define TEST_CASE(name) \
+	static void name(); \
+	static TestHarness::Registrar name##Registrar(#name, name); \
+	static void name()
+
+#define CHECK(expression) \
+	((expression) ? (void)0 : TestHarness::ReportFailure(__FILE__, __LINE__, #expression))
+
+#define REQUIRE(expression) \
+	do { if (!(expression)) { TestHarness::ReportFailure(__FILE__, __LINE__, #expression); throw TestHarness::RequireFailed(); } } while (0)
+
+#define CHECK_NEAR(a, b, tolerance) \
+	CHECK(std::fabs((double)(a) - (double)(b)) <= (double)(tolerance))
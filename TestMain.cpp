@@ -0,0 +1,70 @@
+#include "TestHarness.h"
+#include <cstdio>
+#include <cstring>
+#include <exception>
+
+namespace
+{
+	int failures = 0;
+}
+
+std::vector<TestHarness::TestCase>& TestHarness::GetTests()
+{
+	static std::vector<TestCase> tests;
+	return tests;
+}
+
+void TestHarness::ReportFailure(const char* file, int line, const char* expression)
+{
+	printf("%s(%d): failed: %s\n", file, line, expression);
+	failures++;
+}
+
+// --------------------------------------------------------
+// Runs every registered test, or only those whose names
+// contain the first argument, and fails if any check did
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	const char* filter = argc > 1 ? argv[1] : 0;
+	int run = 0;
+	int failedTests = 0;
+	for (const TestHarness::TestCase& test : TestHarness::GetTests())
+	{
+		if (filter && !strstr(test.name, filter))
+			continue;
+
+		int failuresBefore = failures;
+		try
+		{
+			test.function();
+		}
+		catch (const TestHarness::RequireFailed&)
+		{
+		}
+		catch (const std::exception& exception)
+		{
+			printf("%s: threw: %s\n", test.name, exception.what());
+			failures++;
+		}
+		catch (...)
+		{
+			printf("%s: threw an unknown exception\n", test.name);
+			failures++;
+		}
+
+		run++;
+		if (failures != failuresBefore)
+		{
+			printf("[FAILED] %s\n", test.name);
+			failedTests++;
+		}
+		else
+		{
+			printf("[passed] %s\n", test.name);
+		}
+	}
+
+	printf("%d of %d tests passed\n", run - failedTests, run);
+	return failedTests == 0 && run > 0 ? 0 : 1;
+}
@@ -0,0 +1,219 @@
+#include "TriangleBVH.h"
+#include <algorithm>
+
+using namespace DirectX;
+
+namespace
+{
+	const unsigned int MaxLeafTriangles = 4;
+	const int BinCount = 8;
+
+	// Keeps the traversal stack a fixed size - deeper runs become leaves
+	const unsigned int MaxDepth = 48;
+	const int StackSize = MaxDepth + 2;
+}
+
+TriangleBVH::TriangleBVH(const XMFLOAT3* positions, size_t positionStride, const unsigned int* indices, size_t indexCount)
+{
+	// Gather each triangle's corners so leaves can be tested without
+	// chasing indices
+	size_t triangleCount = indexCount / 3;
+	triangles.resize(triangleCount);
+	triangleIndices.resize(triangleCount);
+	std::vector<AABB> triangleBounds(triangleCount);
+	std::vector<XMFLOAT3> centers(triangleCount);
+	const char* base = reinterpret_cast<const char*>(positions);
+	for (size_t i = 0; i < triangleCount; i++)
+	{
+		Triangle& triangle = triangles[i];
+		triangle.v0 = *reinterpret_cast<const XMFLOAT3*>(base + indices[i * 3 + 0] * positionStride);
+		triangle.v1 = *reinterpret_cast<const XMFLOAT3*>(base + indices[i * 3 + 1] * positionStride);
+		triangle.v2 = *reinterpret_cast<const XMFLOAT3*>(base + indices[i * 3 + 2] * positionStride);
+		triangleIndices[i] = (unsigned int)i;
+
+		AABB bounds = { triangle.v0, triangle.v0 };
+		bounds = Bounds::Union(bounds, AABB{ triangle.v1, triangle.v1 });
+		bounds = Bounds::Union(bounds, AABB{ triangle.v2, triangle.v2 });
+		triangleBounds[i] = bounds;
+		centers[i] = Bounds::Center(bounds);
+	}
+
+	Node root = {};
+	root.bounds = Bounds::Empty();
+	nodes.reserve(triangleCount > 0 ? triangleCount * 2 - 1 : 1);
+	nodes.push_back(root);
+	if (triangleCount > 0)
+		Build(0, 0, (unsigned int)triangleCount, 0, triangleBounds, centers);
+}
+
+// --------------------------------------------------------
+// Closest hit along the ray, in the mesh's local space
+// --------------------------------------------------------
+bool TriangleBVH::Raycast(const Ray& ray, float maxDistance, TriangleHit* hit) const
+{
+	if (triangles.empty())
+		return false;
+
+	bool found = false;
+	unsigned int stack[StackSize];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		const Node& node = nodes[stack[--stackSize]];
+		if (!Bounds::IntersectRay(ray, node.bounds, maxDistance, 0))
+			continue;
+
+		if (node.count > 0)
+		{
+			for (unsigned int i = node.first; i < node.first + node.count; i++)
+			{
+				const Triangle& triangle = triangles[i];
+				float distance, u, v;
+				if (Bounds::IntersectTriangle(ray, triangle.v0, triangle.v1, triangle.v2, maxDistance, &distance, &u, &v))
+				{
+					maxDistance = distance;
+					found = true;
+					if (hit)
+					{
+						hit->distance = distance;
+						hit->triangle = triangleIndices[i];
+						hit->u = u;
+						hit->v = v;
+					}
+				}
+			}
+			continue;
+		}
+
+		// Visit the nearer child first so its hits can prune the other
+		float near0 = 0, near1 = 0;
+		bool hit0 = Bounds::IntersectRay(ray, nodes[node.first].bounds, maxDistance, &near0);
+		bool hit1 = Bounds::IntersectRay(ray, nodes[node.first + 1].bounds, maxDistance, &near1);
+		if (hit0 && hit1)
+		{
+			bool swap = near1 < near0;
+			stack[stackSize++] = swap ? node.first : node.first + 1;
+			stack[stackSize++] = swap ? node.first + 1 : node.first;
+		}
+		else if (hit0)
+		{
+			stack[stackSize++] = node.first;
+		}
+		else if (hit1)
+		{
+			stack[stackSize++] = node.first + 1;
+		}
+	}
+	return found;
+}
+
+size_t TriangleBVH::GetNodeCount() const { return nodes.size(); }
+size_t TriangleBVH::GetTriangleCount() const { return triangles.size(); }
+const AABB& TriangleBVH::GetBounds() const { return nodes[0].bounds; }
+
+// --------------------------------------------------------
+// Fills in a node over a run of triangles, splitting with a
+// binned SAH until splitting costs more than testing them all
+// --------------------------------------------------------
+void TriangleBVH::Build(unsigned int nodeIndex, unsigned int first, unsigned int count, unsigned int depth, std::vector<AABB>& triangleBounds, std::vector<XMFLOAT3>& centers)
+{
+	AABB bounds = Bounds::Empty();
+	AABB centerBounds = Bounds::Empty();
+	for (unsigned int i = first; i < first + count; i++)
+	{
+		bounds = Bounds::Union(bounds, triangleBounds[i]);
+		centerBounds = Bounds::Union(centerBounds, AABB{ centers[i], centers[i] });
+	}
+	nodes[nodeIndex].bounds = bounds;
+	nodes[nodeIndex].first = first;
+	nodes[nodeIndex].count = count;
+	if (count <= MaxLeafTriangles || depth >= MaxDepth)
+		return;
+
+	float extents[3] = {
+		centerBounds.max.x - centerBounds.min.x,
+		centerBounds.max.y - centerBounds.min.y,
+		centerBounds.max.z - centerBounds.min.z };
+	int axis = 0;
+	if (extents[1] > extents[axis]) axis = 1;
+	if (extents[2] > extents[axis]) axis = 2;
+	if (extents[axis] <= 0.0f)
+		return; // Every center in one spot - nothing to split on
+
+	float axisMin = (&centerBounds.min.x)[axis];
+	float binScale = BinCount / extents[axis];
+	auto binOf = [&](unsigned int i)
+	{
+		int bin = (int)(((&centers[i].x)[axis] - axisMin) * binScale);
+		return bin < BinCount ? bin : BinCount - 1;
+	};
+
+	AABB binBounds[BinCount];
+	unsigned int binCounts[BinCount] = {};
+	for (AABB& binBox : binBounds) binBox = Bounds::Empty();
+	for (unsigned int i = first; i < first + count; i++)
+	{
+		int bin = binOf(i);
+		binBounds[bin] = Bounds::Union(binBounds[bin], triangleBounds[i]);
+		binCounts[bin]++;
+	}
+
+	float rightCosts[BinCount] = {};
+	AABB rightBounds = Bounds::Empty();
+	unsigned int rightCount = 0;
+	for (int b = BinCount - 1; b > 0; b--)
+	{
+		rightBounds = Bounds::Union(rightBounds, binBounds[b]);
+		rightCount += binCounts[b];
+		rightCosts[b] = rightCount * Bounds::SurfaceArea(rightBounds);
+	}
+
+	AABB leftBounds = Bounds::Empty();
+	unsigned int leftCount = 0;
+	float bestCost = -1.0f;
+	int bestSplit = 0;
+	for (int b = 0; b < BinCount - 1; b++)
+	{
+		leftBounds = Bounds::Union(leftBounds, binBounds[b]);
+		leftCount += binCounts[b];
+		float cost = leftCount * Bounds::SurfaceArea(leftBounds) + rightCosts[b + 1];
+		if (leftCount > 0 && leftCount < count && (bestCost < 0.0f || cost < bestCost))
+		{
+			bestCost = cost;
+			bestSplit = b;
+		}
+	}
+
+	// Stay a leaf if testing every triangle is cheaper than splitting
+	if (bestCost < 0.0f || bestCost >= count * Bounds::SurfaceArea(bounds))
+		return;
+
+	// Partition the run in place, keeping every per-triangle array in step
+	unsigned int left = first;
+	unsigned int right = first + count - 1;
+	while (left <= right)
+	{
+		if (binOf(left) <= bestSplit)
+		{
+			left++;
+		}
+		else
+		{
+			std::swap(triangles[left], triangles[right]);
+			std::swap(triangleIndices[left], triangleIndices[right]);
+			std::swap(triangleBounds[left], triangleBounds[right]);
+			std::swap(centers[left], centers[right]);
+			right--;
+		}
+	}
+
+	unsigned int leftChildCount = left - first;
+	unsigned int children = (unsigned int)nodes.size();
+	nodes.push_back(Node());
+	nodes.push_back(Node());
+	nodes[nodeIndex].first = children;
+	nodes[nodeIndex].count = 0;
+	Build(children, first, leftChildCount, depth + 1, triangleBounds, centers);
+	Build(children + 1, left, count - leftChildCount, depth + 1, triangleBounds, centers);
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include "Bounds.h"
+
+// Where a ray struck a mesh
+struct TriangleHit
+{
+	float distance;
+	unsigned int triangle;	// Index of the triangle in the mesh's index buffer order
+	float u, v;				// Barycentrics of the triangle's 2nd and 3rd vertices
+};
+
+// --------------------------------------------------------
+// A static bounding volume hierarchy over one mesh's triangles
+//
+// - Built once from the mesh's CPU-side positions and indices,
+//    in the mesh's local space
+// - Nodes are stored flat, depth first, with each leaf owning
+//    a contiguous run of reordered triangles
+// --------------------------------------------------------
+class TriangleBVH
+{
+public:
+	TriangleBVH(const DirectX::XMFLOAT3* positions, size_t positionStride, const unsigned int* indices, size_t indexCount);
+
+	bool Raycast(const Ray& ray, float maxDistance, TriangleHit* hit) const;
+
+	size_t GetNodeCount() const;
+	size_t GetTriangleCount() const;
+	const AABB& GetBounds() const;
+
+private:
+	struct Node
+	{
+		AABB bounds;
+		unsigned int first;	// First child (internal) or first triangle (leaf)
+		unsigned int count;	// Triangles in a leaf, 0 for internal nodes
+	};
+
+	struct Triangle
+	{
+		DirectX::XMFLOAT3 v0, v1, v2;
+	};
+
+	std::vector<Node> nodes;
+	std::vector<Triangle> triangles;
+	std::vector<unsigned int> triangleIndices;	// Original index of each reordered triangle
+
+	void Build(unsigned int node, unsigned int first, unsigned int count, unsigned int depth, std::vector<AABB>& triangleBounds, std::vector<DirectX::XMFLOAT3>& centers);
+};
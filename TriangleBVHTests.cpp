@@ -0,0 +1,189 @@
+#include "TriangleBVH.h"
+#include "TestHarness.h"
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	// A bumpy sphere, so rays can enter and leave it more than once
+	void MakeMesh(int slices, int stacks, std::vector<XMFLOAT3>& positions, std::vector<unsigned int>& indices)
+	{
+		for (int stack = 0; stack <= stacks; stack++)
+		{
+			float phi = XM_PI * stack / stacks;
+			for (int slice = 0; slice <= slices; slice++)
+			{
+				float theta = XM_2PI * slice / slices;
+				float radius = 1.0f + 0.3f * sinf(theta * 5.0f) * sinf(phi * 4.0f);
+				positions.push_back(XMFLOAT3(sinf(phi) * cosf(theta) * radius, cosf(phi) * radius, sinf(phi) * sinf(theta) * radius));
+			}
+		}
+		for (int stack = 0; stack < stacks; stack++)
+		{
+			for (int slice = 0; slice < slices; slice++)
+			{
+				unsigned int corner = stack * (slices + 1) + slice;
+				unsigned int below = corner + slices + 1;
+				indices.insert(indices.end(), { corner, below, corner + 1, corner + 1, below, below + 1 });
+			}
+		}
+	}
+
+	// Every triangle, in index buffer order, as Mesh::Raycast does
+	// without a BVH
+	bool RaycastBruteForce(const std::vector<XMFLOAT3>& positions, const std::vector<unsigned int>& indices,
+		const Ray& ray, float maxDistance, TriangleHit* hit)
+	{
+		bool found = false;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			float distance, u, v;
+			if (Bounds::IntersectTriangle(ray, positions[indices[i]], positions[indices[i + 1]], positions[indices[i + 2]], maxDistance, &distance, &u, &v))
+			{
+				maxDistance = distance;
+				found = true;
+				*hit = { distance, (unsigned int)(i / 3), u, v };
+			}
+		}
+		return found;
+	}
+
+	const XMFLOAT3 V0(0.0f, 0.0f, 0.0f);
+	const XMFLOAT3 V1(1.0f, 0.0f, 0.0f);
+	const XMFLOAT3 V2(0.0f, 1.0f, 0.0f);
+}
+
+TEST_CASE(RayHitsTriangleWithBarycentrics)
+{
+	Ray ray = { XMFLOAT3(0.25f, 0.5f, -2.0f), XMFLOAT3(0.0f, 0.0f, 1.0f) };
+	float distance = 0, u = 0, v = 0;
+	REQUIRE(Bounds::IntersectTriangle(ray, V0, V1, V2, 100.0f, &distance, &u, &v));
+	CHECK_NEAR(distance, 2.0f, 1e-6f);
+	CHECK_NEAR(u, 0.25f, 1e-6f);
+	CHECK_NEAR(v, 0.5f, 1e-6f);
+
+	// Either winding
+	Ray back = { XMFLOAT3(0.25f, 0.5f, 2.0f), XMFLOAT3(0.0f, 0.0f, -1.0f) };
+	CHECK(Bounds::IntersectTriangle(back, V0, V1, V2, 100.0f, &distance, &u, &v));
+}
+
+TEST_CASE(RayMissesTriangle)
+{
+	float distance = 0, u = 0, v = 0;
+	Ray outside = { XMFLOAT3(0.75f, 0.75f, -1.0f), XMFLOAT3(0.0f, 0.0f, 1.0f) };
+	CHECK(!Bounds::IntersectTriangle(outside, V0, V1, V2, 100.0f, &distance, &u, &v));
+
+	Ray behind = { XMFLOAT3(0.25f, 0.25f, 1.0f), XMFLOAT3(0.0f, 0.0f, 1.0f) };
+	CHECK(!Bounds::IntersectTriangle(behind, V0, V1, V2, 100.0f, &distance, &u, &v));
+
+	Ray parallel = { XMFLOAT3(-1.0f, 0.25f, 0.0f), XMFLOAT3(1.0f, 0.0f, 0.0f) };
+	CHECK(!Bounds::IntersectTriangle(parallel, V0, V1, V2, 100.0f, &distance, &u, &v));
+
+	Ray tooFar = { XMFLOAT3(0.25f, 0.25f, -5.0f), XMFLOAT3(0.0f, 0.0f, 1.0f) };
+	CHECK(!Bounds::IntersectTriangle(tooFar, V0, V1, V2, 4.0f, &distance, &u, &v));
+}
+
+TEST_CASE(DistancesScaleWithTheDirection)
+{
+	// Picking relies on this: a scaled entity's local ray isn't
+	// renormalized, so hits come back in world distances
+	float distance = 0, u = 0, v = 0;
+	Ray ray = { XMFLOAT3(0.25f, 0.25f, -4.0f), XMFLOAT3(0.0f, 0.0f, 2.0f) };
+	REQUIRE(Bounds::IntersectTriangle(ray, V0, V1, V2, 100.0f, &distance, &u, &v));
+	CHECK_NEAR(distance, 2.0f, 1e-6f);
+
+	AABB box = { XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(1.0f, 1.0f, 1.0f) };
+	REQUIRE(Bounds::IntersectRay(ray, box, 100.0f, &distance));
+	CHECK_NEAR(distance, 1.5f, 1e-6f);
+}
+
+TEST_CASE(RayStartingInsideABoxEntersAtZero)
+{
+	AABB box = { XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(1.0f, 1.0f, 1.0f) };
+	Ray ray = { XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 0.0f, 0.0f) };
+	float distance = -1.0f;
+	CHECK(Bounds::IntersectRay(ray, box, 10.0f, &distance));
+	CHECK(distance == 0.0f);
+
+	Ray away = { XMFLOAT3(2.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 0.0f, 0.0f) };
+	CHECK(!Bounds::IntersectRay(away, box, 10.0f, &distance));
+}
+
+TEST_CASE(BuildCoversEveryTriangle)
+{
+	std::vector<XMFLOAT3> positions;
+	std::vector<unsigned int> indices;
+	MakeMesh(48, 24, positions, indices);
+	TriangleBVH bvh(positions.data(), sizeof(XMFLOAT3), indices.data(), indices.size());
+
+	CHECK(bvh.GetTriangleCount() == indices.size() / 3);
+	CHECK(bvh.GetNodeCount() > 1);
+	CHECK(bvh.GetNodeCount() % 2 == 1);
+	for (const XMFLOAT3& position : positions)
+		CHECK(Bounds::Contains(bvh.GetBounds(), AABB{ position, position }));
+}
+
+TEST_CASE(TraversalMatchesEveryTriangle)
+{
+	std::vector<XMFLOAT3> positions;
+	std::vector<unsigned int> indices;
+	MakeMesh(48, 24, positions, indices);
+	TriangleBVH bvh(positions.data(), sizeof(XMFLOAT3), indices.data(), indices.size());
+
+	std::mt19937 random(17);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	int hits = 0;
+	for (int cast = 0; cast < 2000; cast++)
+	{
+		// From outside towards somewhere near the mesh, including
+		// rays that start inside it and some that stop short
+		XMVECTOR origin = XMVectorSet(unit(random), unit(random), unit(random), 0.0f) * (cast % 4 == 0 ? 0.5f : 4.0f);
+		XMVECTOR target = XMVectorSet(unit(random), unit(random), unit(random), 0.0f) * 1.2f;
+		Ray ray = {};
+		XMStoreFloat3(&ray.origin, origin);
+		XMStoreFloat3(&ray.direction, XMVector3Normalize(target - origin));
+		float maxDistance = cast % 5 == 0 ? 2.5f : 100.0f;
+
+		TriangleHit expected = {};
+		TriangleHit hit = {};
+		bool expectHit = RaycastBruteForce(positions, indices, ray, maxDistance, &expected);
+		REQUIRE(bvh.Raycast(ray, maxDistance, &hit) == expectHit);
+		if (!expectHit)
+			continue;
+
+		// Ties between triangles sharing an edge can go either way
+		hits++;
+		CHECK_NEAR(hit.distance, expected.distance, 1e-5f);
+		if (hit.triangle == expected.triangle)
+		{
+			CHECK_NEAR(hit.u, expected.u, 1e-5f);
+			CHECK_NEAR(hit.v, expected.v, 1e-5f);
+		}
+		REQUIRE(hit.triangle < indices.size() / 3);
+	}
+	CHECK(hits > 1000);
+}
+
+TEST_CASE(StrideSkipsOtherVertexData)
+{
+	struct Vertex { XMFLOAT3 position; XMFLOAT2 uv; };
+	Vertex vertices[] = { { V0, {} }, { V1, {} }, { V2, {} } };
+	unsigned int indices[] = { 0, 1, 2 };
+	TriangleBVH bvh(&vertices[0].position, sizeof(Vertex), indices, 3);
+
+	Ray ray = { XMFLOAT3(0.25f, 0.25f, -1.0f), XMFLOAT3(0.0f, 0.0f, 1.0f) };
+	TriangleHit hit = {};
+	REQUIRE(bvh.Raycast(ray, 10.0f, &hit));
+	CHECK(hit.triangle == 0);
+	CHECK_NEAR(hit.distance, 1.0f, 1e-6f);
+}
+
+TEST_CASE(EmptyMeshNeverHits)
+{
+	XMFLOAT3 position(0.0f, 0.0f, 0.0f);
+	TriangleBVH bvh(&position, sizeof(XMFLOAT3), 0, 0);
+	Ray ray = { XMFLOAT3(0.0f, 0.0f, -1.0f), XMFLOAT3(0.0f, 0.0f, 1.0f) };
+	CHECK(!bvh.Raycast(ray, 10.0f, 0));
+}
@@ -3,4 +3,5 @@
 
 typedef Microsoft::WRL::ComPtr<ID3D11VertexShader> VertexShaderPtr;
 typedef Microsoft::WRL::ComPtr<ID3D11PixelShader> PixelShaderPtr;
-typedef Microsoft::WRL::ComPtr<ID3D11InputLayout> InputLayoutPtr;
\ No newline at end of file
+typedef Microsoft::WRL::ComPtr<ID3D11InputLayout> InputLayoutPtr;
+typedef Microsoft::WRL::ComPtr<ID3D11Buffer> ConstantBufferPtr;
\ No newline at end of file
@@ -1,9 +1,30 @@
-cbuffer ExternalData : register(b0)
+cbuffer PerFrame : register(b0)
 {
-    matrix worldMatrix;
     matrix view;
     matrix projection;
+    matrix viewProjection;
+    float time;
+}
+
+// Matches PerInstanceData in BufferStructs.h, padding included,
+// so the buffer's stride is the same on both sides
+struct InstanceData
+{
+    matrix worldMatrix;
+    matrix worldViewProjection;
+    uint materialId;
+    uint3 padding;
+};
+
+// Every instance drawn this frame
+StructuredBuffer<InstanceData> instances : register(t0);
+
+// Where this draw's instances start in them
+cbuffer PerDraw : register(b1)
+{
+    uint firstInstance;
 }
+
 // Struct representing a single vertex worth of data
 // - This should match the vertex definition in our C++ code
 // - By "match", I mean the size, order and number of members
@@ -36,6 +57,9 @@ struct VertexToPixel
 	float4 screenPosition	: SV_POSITION;	// XYZW position (System Value Position)
     float2 uv				: TEXCOORD;
 	float3 normal			: NORMAL;
+	nointerpolation uint materialId : MATERIAL;	// From here on, pixel shaders can leave them out
+	float3 worldPosition	: POSITION;
+	float3 worldNormal		: WORLDNORMAL;
 };
 
 // --------------------------------------------------------
@@ -45,7 +69,7 @@ struct VertexToPixel
 // - Output is a single struct of data to pass down the pipeline
 // - Named "main" because that's the default the shader compiler looks for
 // --------------------------------------------------------
-VertexToPixel main( VertexShaderInput input )
+VertexToPixel main( VertexShaderInput input, uint instanceID : SV_InstanceID )
 {
 	// Set up output struct
 	VertexToPixel output;
@@ -58,10 +82,14 @@ VertexToPixel main( VertexShaderInput input )
 	// - Each of these components is then automatically divided by the W component, 
 	//   which we're leaving at 1.0 for now (this is more useful when dealing with 
 	//   a perspective projection matrix, which we'll get to in the future).
-    matrix wvp = mul(projection, mul(view, worldMatrix));
-    output.screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
+    // World, view and projection were already combined on the CPU
+    InstanceData instance = instances[firstInstance + instanceID];
+    output.screenPosition = mul(instance.worldViewProjection, float4(input.localPosition, 1.0f));
     output.uv = input.uv;
 	output.normal = input.normal;
+	output.materialId = instance.materialId;
+	output.worldPosition = mul(instance.worldMatrix, float4(input.localPosition, 1.0f)).xyz;
+	output.worldNormal = mul((float3x3)instance.worldMatrix, input.normal);
 	// Whatever we return will make its way through the pipeline to the
 	// next programmable stage we're using (the pixel shader for now)
 	return output;
@@ -2,6 +2,7 @@
 #include "Window.h"
 #include "Graphics.h"
 #include "Input.h"
+#include "FrameTimeHistory.h"
 
 #include <sstream>
 
@@ -162,7 +163,9 @@ HRESULT Window::Create(
 // Updates the window's title bar with several stats once
 // per second, including:
 //  - The window's width & height
-//  - The current FPS and ms/frame
+//  - The current FPS
+//  - Median, 99th percentile and worst frame times, which
+//     show spikes an average would hide (see FrameTimeHistory)
 //  - The graphics API in use
 // --------------------------------------------------------
 void Window::UpdateStats(float totalTime)
@@ -175,8 +178,7 @@ void Window::UpdateStats(float totalTime)
 	if (!windowStats || elapsed < 1.0f)
 		return;
 
-	// How long did each frame take?  (Approx)
-	float mspf = 1000.0f / (float)fpsFrameCounter;
+	FrameTimeSummary frameTimes = FrameTimeHistory::Global().Summarize();
 
 	// Quick and dirty title bar text (mostly for debugging)
 	std::wostringstream output;
@@ -185,7 +187,10 @@ void Window::UpdateStats(float totalTime)
 		"    Width: " << windowWidth <<
 		"    Height: " << windowHeight <<
 		"    FPS: " << fpsFrameCounter <<
-		"    Frame Time: " << mspf << "ms" <<
+		"    Frame Time p50: " << frameTimes.p50Milliseconds << "ms" <<
+		"  p99: " << frameTimes.p99Milliseconds << "ms" <<
+		"  Max: " << frameTimes.maxMilliseconds << "ms" <<
+		"    Hitches: " << frameTimes.hitchCount <<
 		"    Graphics: " << Graphics::APIName();
 
 	// Actually update the title bar and reset fps data